@@ -18,6 +18,8 @@
  *
  * o swapped Polygon for TVectorPath and other tweaks
  * o nextPos(): avoid segfault when newPos is -1
+ * o connectEdges(): avoid segfault when the other end of an edge isn't
+ *   in the result
  * o todo: some glitches during union where cageo144.zip threw away points during union
  * o todo: support for curves
  
@@ -1421,6 +1423,9 @@ void BooleanOpImp::connectEdges(const std::deque<SweepEvent*> &sortedEvents, toa
     }
   }
 
+  // events which aren't in the result have no position
+  for(auto it: sortedEvents)
+    it->pos = resultEvents.size();
   for(size_t i = 0; i < resultEvents.size (); ++i) {
     resultEvents[i]->pos = i;
       if(!resultEvents[i]->left)
@@ -1435,7 +1440,12 @@ void BooleanOpImp::connectEdges(const std::deque<SweepEvent*> &sortedEvents, toa
     const TPoint &initial = resultEvents[i]->point;
     out.move(initial);
     while(resultEvents[pos]->otherEvent->point != initial) {
-      processed[pos] = true; 
+      processed[pos] = true;
+      if (resultEvents[pos]->pos >= resultEvents.size()) {
+cerr << "connectEdges: the other end of " << resultEvents[pos]->id << " isn't in the result" << endl;
+        booleanop_gap_error = true;
+        break;
+      }
       pos = resultEvents[pos]->pos;
       processed[pos] = true;
       if(resultEvents[pos]->curve) {
@@ -1456,7 +1466,9 @@ cerr << "connectEdges: found a gap near " << resultEvents[oldpos]->id << ", " <<
       }
     }
     out.close();
-    processed[pos] = processed[resultEvents[pos]->pos] = true;
+    processed[pos] = true;
+    if (resultEvents[pos]->pos < resultEvents.size())
+      processed[resultEvents[pos]->pos] = true;
   }
 }
 
@@ -22,6 +22,7 @@
 #include <toad/figuremodel.hh>
 #include <toad/figureeditor.hh>
 #include <toad/figure/connectfigure.hh>
+#include <toad/vector.hh>
 #include <cmath>
 
 #include <toad/dialog.hh>
@@ -75,7 +76,9 @@ TFigure::initialize()
   serialize.registerObject(new TFFrame());
   serialize.registerObject(new TFGroup());
   serialize.registerObject(new TFImage());
+  serialize.registerObject(new TFInstance());
   serialize.registerObject(new TFRectangle());
+  serialize.registerObject(new TFSymbol());
   serialize.registerObject(new TFText());
   serialize.registerObject(new TFWindow());
   serialize.registerObject(new TFigureModel());
@@ -85,6 +88,11 @@ TFigure::initialize()
   serialize.registerObject(new TMenuSeparator());
   serialize.registerObject(new TSerializableRGB());
   serialize.registerObject(new TSpringLayout());
+  // TFConnection, TFText and TFSymbol refer to other figures
+  serialize.registerReference("start");
+  serialize.registerReference("end");
+  serialize.registerReference("relation");
+  serialize.registerReference("symbol");
 }
 
 void
@@ -97,14 +105,50 @@ TInObjectStream TFigure::serialize;
 
 TFigure::TFigure()
 {
+  id = TFigureIds::acquire(this);
 }
 
 TFigure::TFigure(const TFigure &f)
 {
+  id = TFigureIds::acquire(this);
 }
 
 TFigure::~TFigure()
 {
+  TFigureIds::release(id);
+}
+
+/**
+ * Figures keep their id and their graphic is created again for the
+ * assigned shape.
+ */
+TFigure&
+TFigure::operator=(const TFigure &)
+{
+  invalidatePath();
+  return *this;
+}
+
+/**
+ * The figure as a vector graphic or nullptr when the figure can't provide
+ * one.
+ *
+ * The graphic is created by buildPath() on the first call and kept until
+ * invalidatePath() is called, so that figures like TFConnection can look
+ * at the shape of their neighbours without creating it every time.
+ */
+const TVectorGraphic*
+TFigure::getPath() const
+{
+  if (!pathValid) {
+    if (!cachedPath)
+      cachedPath.reset(new TVectorGraphic);
+    cachedPath->clear();
+    if (!buildPath(cachedPath.get()))
+      cachedPath.reset();
+    pathValid = true;
+  }
+  return cachedPath.get();
 }
 
 /**
@@ -197,6 +241,7 @@ TAttributedFigure::setAttributes(const TFigureAttributeModel *preferences)
     line_style = preferences->linestyle;
   if (preferences->reason.alpha)
     alpha = preferences->alpha;
+  invalidatePath();
 }
 
 void
@@ -445,6 +490,7 @@ TAttributedFigure::restore(TInObjectStream &in)
   bool b;
   if (in.what==ATV_START) {
     filled = false;
+    invalidatePath();
     return true;
   }
   if (::restore(in, "filled", &b))
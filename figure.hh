@@ -22,6 +22,7 @@
 #define _TOAD_FIGURE_HH 1
 
 #include <math.h>
+#include <memory>
 #include <toad/penbase.hh>
 #include <toad/window.hh>
 #include <toad/bitmap.hh>
@@ -56,7 +57,8 @@ class TFigureEditEvent
       //! the figures listed in model->figures are to be removed from the model
       RELATION_REMOVED,
       
-      //! the figures listed in model->figures have been modified
+      //! the figures listed in model->figures have been modified (all of
+      //! them when model is nullptr)
       RELATION_MODIFIED,
     
       GET_DISTANCE,
@@ -106,12 +108,20 @@ class TVectorPath;
 class TFigure:
   public TSerializable
 {
+    friend class TFigureIds;
+    unsigned id;
   public:
     TFigure();
     TFigure(const TFigure &);
     virtual ~TFigure();
+    TFigure& operator=(const TFigure &);
+
+    //! dense id, unique among all existing figures, used by TFigureSet
+    unsigned getId() const { return id; }
     
-    virtual TVectorGraphic *getPath() const { return nullptr; }
+    const TVectorGraphic* getPath() const;
+    //! to be called after the figure's shape or attributes were modified
+    void invalidatePath() const { pathValid = false; }
 
     virtual bool editEvent(TFigureEditEvent &ee);
     
@@ -209,9 +219,19 @@ class TFigure:
     static void terminate();
     static TInObjectStream serialize;
 
+    //! append the figures this one is made of, ie. the gadgets of a group
+    virtual void getFigures(std::vector<TFigure*> *figures) const {}
+
 //    SERIALIZABLE_INTERFACE(toad::, TFigure);
     void store(TOutObjectStream &out) const override;
     bool restore(TInObjectStream &in) override;
+
+  protected:
+    //! add the figure's paths to 'graphic', return 'false' when it has none
+    virtual bool buildPath(TVectorGraphic *graphic) const { return false; }
+  private:
+    mutable std::unique_ptr<TVectorGraphic> cachedPath;
+    mutable bool pathValid = false;
 };
 
 class TAttributedFigure:
@@ -241,13 +261,16 @@ class TAttributedFigure:
 
     void setStrokeColor(const TRGB &color) {
       line_color = color;
+      invalidatePath();
     }
     void setFillColor(const TRGB &color) {
       fill_color = color;
       filled = true;
+      invalidatePath();
     }
     void unsetFillColor() {
       filled = false;
+      invalidatePath();
     }
     bool isFilled() const { return filled && closed; }
 //    virtual void setFont(const string&);
@@ -262,10 +285,18 @@ class TFTransformBase:
 {
   public:
     TFigure *figure;
+    TFTransformBase(): figure(nullptr) {}
+    TFTransformBase(const TFTransformBase &t):
+      TFigure(t),
+      figure(t.figure ? static_cast<TFigure*>(t.figure->clone()) : nullptr) {}
     ~TFTransformBase() {
       if (figure)
         delete figure;
     }
+    void getFigures(std::vector<TFigure*> *figures) const override {
+      if (figure)
+        figures->push_back(figure);
+    }
 };
 
 /*
@@ -312,9 +343,15 @@ class TFTransform:
   public TFAffiniteTransformBase
 {
   public:
-    TVectorGraphic *getPath() const override;
+    //! to be called after 'matrix' or 'figure' were modified
+    void invalidateBounds() { boundsValid = false; invalidatePath(); }
   protected:
+    mutable bool boundsValid = false;
+    mutable unsigned boundsEdits;  // TFigureModel::getDirectEdits() for 'cachedBounds'
+    mutable TRectangle cachedBounds;
+
     void paint(TPenBase &pen, EPaintType type=NORMAL) override;
+    bool buildPath(TVectorGraphic *graphic) const override;
     
     TCoord distance(const TPoint &pos) override;
     TRectangle bounds() const override;
@@ -349,12 +386,13 @@ class TFRectangle:
       p1.y = y;
       p2.x = x+w;
       p2.y = y+h;
+      invalidatePath();
     }
     void setShape(const TRectangle &r) {
       p1 = r.origin;
       p2 = r.origin + r.size;
+      invalidatePath();
     }
-    TVectorGraphic* getPath() const override;
     void paint(TPenBase &pen, EPaintType type=NORMAL) override;
     TRectangle bounds() const override;
 
@@ -368,6 +406,7 @@ class TFRectangle:
   protected:
     TPoint p1, p2;
 
+    bool buildPath(TVectorGraphic *graphic) const override;
     void startCreate(const TPoint &start) override;
     void dragCreate(const TPoint &end) override;
 };
@@ -418,10 +457,11 @@ class TFCircle:
     void paint(TPenBase &, EPaintType) override;
     
     TCoord distance(const TPoint &pos) override;
-    TVectorGraphic* getPath() const override;
     
     TCloneable* clone() const override { return new TFCircle(*this); }
     const char * getClassName() const override { return "toad::TFCircle"; } 
+  protected:
+    bool buildPath(TVectorGraphic *graphic) const override;
 };
 
 /**
@@ -454,7 +494,7 @@ class TFText:
     void paint(TPenBase &, EPaintType) override;
     bool transform(const TMatrix2D &transform) override;
     TRectangle bounds() const override;
-    // TVectorGraphic* getPath() const override; [NSBezierPath appendBezierPathWithGlyphs:count:inFont]
+    // bool buildPath(TVectorGraphic*) const override; [NSBezierPath appendBezierPathWithGlyphs:count:inFont]
 
     TCoord distance(const TPoint &pos) override;
     bool getHandle(unsigned n, TPoint *p) override;
@@ -559,6 +599,7 @@ class TFGroup:
     TFGroup(const TFGroup &g);
     ~TFGroup();
     void paint(TPenBase&, EPaintType) override;
+    TRectangle bounds() const override;
     TCoord _distance(TFigureEditor *fe, TCoord x, TCoord y) override;
     bool getHandle(unsigned n, TPoint *p) override;
     bool startTranslateHandle() override;
@@ -575,6 +616,9 @@ class TFGroup:
 
     bool transform(const TMatrix2D &transform) override;
     bool editEvent(TFigureEditEvent &ee) override;
+    void getFigures(std::vector<TFigure*> *figures) const override {
+      figures->insert(figures->end(), gadgets.begin(), gadgets.end());
+    }
 
     TCloneable* clone() const override { return new TFGroup(*this); }
     const char * getClassName() const override { return "toad::TFGroup"; }
@@ -585,6 +629,69 @@ class TFGroup:
     void modelChanged();
 };
 
+/**
+ * \ingroup figure
+ *
+ * Figures shared by several TFInstance objects.
+ *
+ * The symbol is reference counted and deleted along with its last
+ * instance. Modifying its figures modifies all instances.
+ */
+class TFSymbol:
+  public TFigureModel
+{
+    typedef TFigureModel super;
+  public:
+    TFSymbol();
+    TFSymbol(const TFSymbol &symbol);
+    ~TFSymbol();
+
+    string name;
+
+    TVectorGraphic* getDisplayList() const;
+
+    SERIALIZABLE_INTERFACE_PUBLIC(toad::, TFSymbol)
+
+  protected:
+    mutable TVectorGraphic *displayList;
+    mutable bool displayListValid;
+    void modelChanged();
+    void clearDisplayList() const;
+};
+
+typedef GSmartPointer<TFSymbol> PFSymbol;
+
+/**
+ * \ingroup figure
+ *
+ * A reference to a TFSymbol, painted with its own matrix.
+ *
+ * Copies of an instance share the symbol's figures instead of cloning
+ * them and the symbol is stored only once along with the first instance.
+ */
+class TFInstance:
+  public TAttributedFigure
+{
+    typedef TAttributedFigure super;
+  public:
+    TFInstance();
+    TFInstance(TFSymbol *symbol, const TMatrix2D *matrix=nullptr);
+
+    PFSymbol symbol;
+    TMatrix2D matrix;
+    //! paint with the instance's attributes instead of the symbol's
+    bool overrideAttributes;
+
+    void paint(TPenBase&, EPaintType) override;
+    TRectangle bounds() const override;
+    TCoord _distance(TFigureEditor *fe, TCoord x, TCoord y) override;
+    bool transform(const TMatrix2D &transform) override;
+
+    void setAttributes(const TFigureAttributeModel*) override;
+
+    SERIALIZABLE_INTERFACE(toad::, TFInstance)
+};
+
 class TFPerspectiveTransform:
   public TFigure
 {
@@ -606,6 +713,9 @@ class TFPerspectiveTransform:
     TCoord _distance(TFigureEditor *fe, TCoord mx, TCoord my) override;
     bool getHandle(unsigned n, TPoint *p) override;
     void translateHandle(unsigned handle, TCoord x, TCoord y, unsigned modifier) override;
+    void getFigures(std::vector<TFigure*> *figures) const override {
+      figures->insert(figures->end(), this->figures.begin(), this->figures.end());
+    }
 
     TCloneable* clone() const override { return new TFPerspectiveTransform(*this); }
     const char * getClassName() const override { return "toad::TFPerspectiveTransform"; }
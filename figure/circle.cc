@@ -71,8 +71,8 @@ TFCircle::distance(const TPoint &pos)
   return sqrt(dx*dx+dy*dy);
 }
 
-TVectorGraphic*
-TFCircle::getPath() const
+bool
+TFCircle::buildPath(TVectorGraphic *graphic) const
 {
   // Michael Goldapp, "Approximation of circular arcs by cubic polynomials"
   // Computer Aided Geometric Design (#8 1991 pp.227-238) Tor Dokken and
@@ -88,7 +88,8 @@ TFCircle::getPath() const
   TCoord cx = (double)r.origin.x+rx;
   TCoord cy = (double)r.origin.y+ry;
   
-  auto *path = new TVectorPath;
+  graphic->emplace_back(this);
+  TVectorPath *path = &graphic->back().path;
   path->move (cx         , cy-ry);
   path->curve(cx + rx * f, cy-ry,
               cx + rx    , cy-ry*f,
@@ -103,8 +104,5 @@ TFCircle::getPath() const
               cx - rx * f, cy-ry,
               cx         , cy-ry);
   path->close();
-  
-  auto *vg = new TVectorGraphic;
-  vg->push_back(new TVectorPainter(this, path));
-  return vg;
+  return true;
 }
@@ -31,7 +31,13 @@ TFConnection::editEvent(TFigureEditEvent &editEvent)
   // FIXME: add helper functions for RELATION_REMOVED, RELATION_REPLACED and REMOVED
   switch(editEvent.type) {
     case TFigureEditEvent::RELATION_MODIFIED:
-      updatePoints();
+      // only the ends attached to the modified figures need to follow them
+      if (editEvent.model) {
+        updatePoints(editEvent.model->figures.contains(start),
+                     editEvent.model->figures.contains(end));
+      } else {
+        updatePoints();
+      }
       break;
     case TFigureEditEvent::RELATION_REPLACED:
       if (editEvent.data.relationReplaced.oldRelation == start) {
@@ -171,86 +177,110 @@ TFConnection::paint(TPenBase &pen, EPaintType type)
   pen.setAlpha(1);
 }
 
-TVectorGraphic*
-TFConnection::getPath() const
+bool
+TFConnection::buildPath(TVectorGraphic *graphic) const
 {
-  auto *path = new TVectorPath;
-  path->move(p[0]);
+  graphic->emplace_back(this);
+  TVectorPath &path = graphic->back().path;
+  path.move(p[0]);
   for(size_t i=1; i<p.size(); ++i)
-    path->line(p[i]);
-  
-  auto *vg = new TVectorGraphic;
-  return vg;
+    path.line(p[i]);
+  return true;
 }
 
+namespace {
+
+// the figure's cached outline and the center of its bounds
+const TVectorGraphic*
+cachedOutline(TFigure *figure, TPoint *center)
+{
+  const TVectorGraphic *graphic = figure->getPath();
+  if (!graphic) {
+    cerr << __FILE__ << ":" << __LINE__ << ":" << __FUNCTION__ << ": figure " << figure->getClassName() << " returned no path" << endl;
+    return nullptr;
+  }
+  TBoundary b;
+  for(auto &p: *graphic)
+    b.expand(p.path.bounds());
+  *center = b.center();
+  return graphic;
+}
+
+// the last point where the line from 'inside' to 'outside' crosses the
+// outline or 'inside' when it doesn't
+TPoint
+exitPoint(const TVectorGraphic *graphic, const TPoint &inside, const TPoint &outside)
+{
+  TVectorPath line;
+  line.move(inside);
+  line.line(outside);
+  TBoundary lb = line.bounds();
+  TIntersectionList il;
+  for(auto &p: *graphic) {
+    // most of a hub's outline is far away from each of its connections
+    TBoundary pb = p.path.bounds();
+    if (pb.empty ||
+        pb.p1.x < lb.p0.x || pb.p0.x > lb.p1.x ||
+        pb.p1.y < lb.p0.y || pb.p0.y > lb.p1.y)
+      continue;
+    p.path.intersect(il, line);
+  }
+  TCoord d=0.0;
+  TPoint pt(inside);
+  for(auto &p: il) {
+    if (p.seg1.u>d) {
+      d = p.seg1.u;
+      pt = p.seg1.pt;
+    }
+  }
+  return pt;
+}
+
+} // unnamed namespace
+
 void 
 TFConnection::updatePoints()
 {
-  TVectorGraphic *f0, *f1;
+  updatePoints(true, true);
+}
 
-  if (start) {
-    f0 = start->getPath();
-    if (!f0) {
-      cerr << __FILE__ << ":" << __LINE__ << ":" << __FUNCTION__ << ": figure " << start->getClassName() << " returned no path" << endl;
+/**
+ * Recalculate the points where the connection meets the figures at its
+ * start and/or end.
+ *
+ * With points between both ends, each end depends only on its own figure
+ * and the other end is kept. Otherwise the line runs from center to center
+ * and both ends are recalculated.
+ */
+void
+TFConnection::updatePoints(bool updateStart, bool updateEnd)
+{
+  if (!updateStart && !updateEnd)
+    return;
+  if (p.size()==2)
+    updateStart = updateEnd = true;
+
+  invalidatePath();
+
+  // the paths are owned and cached by the figures, so following a moving
+  // figure doesn't create them again for every connection
+  const TVectorGraphic *f0 = nullptr, *f1 = nullptr;
+
+  if (start && updateStart) {
+    f0 = cachedOutline(start, &p.front());
+    if (!f0)
       return;
-    }
-    TBoundary b;
-    for(auto &p: *f0)
-      b.expand(p->path->bounds());
-    p.front() = b.center();
   }
-
-  if (end) {
-    f1 = end->getPath();
-    if (!f1) {
-      cerr << __FILE__ << ":" << __LINE__ << ":" << __FUNCTION__ << ": figure " << end->getClassName() << " returned no path" << endl;
+  if (end && updateEnd) {
+    f1 = cachedOutline(end, &p.back());
+    if (!f1)
       return;
-    }
-    TBoundary b;
-    for(auto &p: *f1)
-      b.expand(p->path->bounds());
-    p.back() = b.center();
   }
 
-  // FIXME: we now need two different lines (the head and tail segments)
-  
-  if (start) {
-    TVectorPath line;
-    line.move(p.front());
-    line.line(*(this->p.begin()+1));
-    TIntersectionList il;
-    for(auto &p: *f0)
-      p->path->intersect(il, line);
-    TCoord d=0.0;
-    TPoint pt(p.front());
-    for(auto &p: il) {
-      if (p.seg1.u>d) {
-        d = p.seg1.u;
-        pt = p.seg1.pt;
-      }
-    }
-    p.front() = pt;
-    delete f0;
-  }
-  
-  if (end) {
-    TVectorPath line;
-    line.move(*(this->p.end()-2));
-    line.line(p.back());
-    TIntersectionList il;
-    for(auto &p: *f1)
-      p->path->intersect(il, line);
-    TCoord d=1.0;
-    TPoint pt(p.back());
-    for(auto &p: il) {
-      if (p.seg1.u<d) {
-        d = p.seg1.u;
-        pt = p.seg1.pt;
-      }
-    }
-    p.back() = pt;
-    delete f1;
-  }
+  if (f0)
+    p.front() = exitPoint(f0, p.front(), *(p.begin()+1));
+  if (f1)
+    p.back() = exitPoint(f1, p.back(), *(p.end()-2));
 }
 
 bool
@@ -277,6 +307,7 @@ TFConnection::translateHandle(unsigned handle, TCoord x, TCoord y, unsigned modi
   if (handle==0 || handle>=p.size()-1)
     return;
   p[handle] = TPoint(x, y);
+  invalidatePath();
 }
 
 static vector<TPoint>::iterator newpoint;
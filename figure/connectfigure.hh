@@ -31,6 +31,7 @@ class TFConnection:
     typedef TAttributedFigure super;
   public:
     void updatePoints();
+    void updatePoints(bool updateStart, bool updateEnd);
     vector<TPoint> p;
     TFigure *start, *end;
     
@@ -43,7 +44,6 @@ class TFConnection:
       p.assign(2, TPoint(0, 0));
     }
     void paint(TPenBase &pen, EPaintType type=NORMAL) override;
-    TVectorGraphic* getPath() const override;
     TRectangle bounds() const override;
     TCoord distance(const TPoint &pos) override;
     bool editEvent(TFigureEditEvent &ee) override;
@@ -60,6 +60,8 @@ class TFConnection:
     void getAttributes(TFigureAttributeModel*) const override;
 
     SERIALIZABLE_INTERFACE(toad::, TFConnection);
+  protected:
+    bool buildPath(TVectorGraphic *graphic) const override;
 };
 
 } // namespace toad
@@ -118,13 +118,12 @@ TConnectTool::paintSelection(TFigureEditor *fe, TPenBase &pen)
     if (!figure)
       continue;
 
-    TVectorGraphic *graphic = figure->getPath();
+    const TVectorGraphic *graphic = figure->getPath();
     if (graphic) {
       for(auto &painter: *graphic) {
-        painter->path->apply(pen);
+        painter.path.apply(pen);
         pen.stroke();
       }
-      delete graphic;
     }
   }
 
@@ -36,9 +36,20 @@ TFGroup::TFGroup(const TFGroup &g):
   connect(gadgets.sigChanged, this, &TFGroup::modelChanged);
 }
 
+/**
+ * Keep the group's size in sync with its figures.
+ */
 void
 TFGroup::modelChanged()
 {
+  switch(gadgets.type) {
+    case TFigureModel::MODIFY:
+    case TFigureModel::REMOVE:
+    case TFigureModel::DELETE:
+      break;
+    default:
+      calcSize();
+  }
 }
 
 TFGroup::~TFGroup()
@@ -47,67 +58,27 @@ TFGroup::~TFGroup()
 }
 
 /**
- * Calculate the size.
- *
+ * Calculate the size from the bounds of all figures in the group, which
+ * TFigureModel caches until one of them is modified.
  */
 void 
 TFGroup::calcSize()
 {
-#if 0
-  TFigureModel::iterator p,e;
-  p = gadgets.begin();
-  e = gadgets.end();
-  if (p==e)
+  const TBoundary &b = gadgets.bounds();
+  invalidatePath();
+  if (b.empty) {
+    p1 = p2 = TPoint(0, 0);
     return;
-  TRectangle r;
-  TMatrix2D m;
-  bool first = true;
-  
-  while(p!=e) {
-    TFigure *f = *p;
-    r = f->bounds();
-#if 0
-    if (mat)
-      m = *mat;
-    else
-#endif
-      m.identity();
-    if (f->mat)
-      m.multiply(f->mat);
-    for(int i=0; i<4; ++i) {
-      int x, y;
-      switch(i) {
-        case 0:
-          m.map(r.x, r.y, &x, &y);
-          break;
-        case 1:
-          m.map(r.x+r.w, r.y, &x, &y);
-          break;
-        case 2:
-          m.map(r.x+r.w, r.y+r.h, &x, &y);
-          break;
-        case 3:
-          m.map(r.x, r.y+r.h, &x, &y);
-          break;
-      }
-      if (first) {
-        p1.x = p2.x = x;
-        p1.y = p2.y = y;
-        first = false;
-      } else {
-        if (p1.x>x)
-          p1.x=x;
-        if (p2.x<x)
-          p2.x=x;
-        if (p1.y>y) 
-          p1.y=y;
-        if (p2.y<y)
-          p2.y=y;
-      }
-    }
-    ++p;
   }
-#endif
+  p1 = b.p0;
+  p2 = b.p1;
+}
+
+TRectangle
+TFGroup::bounds() const
+{
+  const TBoundary &b = gadgets.bounds();
+  return b.empty ? TRectangle(0, 0, 0, 0) : TRectangle(b);
 }
 
 void 
@@ -182,15 +182,16 @@ TFPerspectiveTransform::paint(TPenBase &pen, EPaintType type)
   }
 
   for(auto p: figures) {
-    TVectorGraphic *vg = p->getPath();
-    if (!vg)
+    const TVectorGraphic *path = p->getPath();
+    if (!path)
       continue;
-    for(auto &painter: *vg) {
-      for(auto &point: painter->path->points) {
+    TVectorGraphic vg(*path);
+    for(auto &painter: vg) {
+      for(auto &point: painter.path.points) {
         point = transform(point);
       }
     }
-    vg->paint(pen);
+    vg.paint(pen);
   }
 }
 
@@ -98,6 +98,7 @@ TFRectangle::transform(const TMatrix2D &transform)
     return false;
   transform.map(p1, &p1);
   transform.map(p2, &p2);
+  invalidatePath();
   return true;
 }
 
@@ -146,35 +147,34 @@ TFRectangle::translateHandle(unsigned handle, TCoord x, TCoord y, unsigned)
       p2.y = y;
       break;
   }
+  invalidatePath();
 }
 
 void
 TFRectangle::startCreate(const TPoint &point)
 {
   p1 = p2 = point;
+  invalidatePath();
 }
 
 void
 TFRectangle::dragCreate(const TPoint &point)
 {
   p2 = point;
+  invalidatePath();
 }
 
-TVectorGraphic*
-TFRectangle::getPath() const
+bool
+TFRectangle::buildPath(TVectorGraphic *graphic) const
 {
-  // auto vb = make_shared<sync_queue>(200);
-  
-  auto *path = new TVectorPath;
-  path->move(p1.x, p1.y);
-  path->line(p2.x, p1.y);
-  path->line(p2.x, p2.y);
-  path->line(p1.x, p2.y);
-  path->close();
-  
-  auto *vg = new TVectorGraphic;
-  vg->push_back(new TVectorPainter(this, path));
-  return vg;
+  graphic->emplace_back(this);
+  TVectorPath &path = graphic->back().path;
+  path.move(p1.x, p1.y);
+  path.line(p2.x, p1.y);
+  path.line(p2.x, p2.y);
+  path.line(p1.x, p2.y);
+  path.close();
+  return true;
 }
 
 void
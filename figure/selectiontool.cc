@@ -497,16 +497,19 @@ TSelectionTool::paintOutline(const TFigureSet &figures, TPenBase &pen)
   pen.setAlpha(1.0);
   pen.setScreenLineWidth(1.0);
   for(auto &f: figures) {
-    TVectorGraphic *graphic = f->getPath();
+    const TVectorGraphic *graphic = f->getPath();
     if (!graphic)
       continue;
     for(auto &painter: *graphic) {
-      if (state==STATE_MOVE_HANDLE || state==STATE_MOVE_SELECTION)
-        painter->path->transform(m);
-      painter->path->apply(pen);
+      if (state==STATE_MOVE_HANDLE || state==STATE_MOVE_SELECTION) {
+        TVectorPath path(painter.path);
+        path.transform(m);
+        path.apply(pen);
+      } else {
+        painter.path.apply(pen);
+      }
       pen.stroke();
     }
-    delete graphic;
   }
 }
 
@@ -0,0 +1,221 @@
+/*
+ * TOAD -- A Simple and Powerful C++ GUI Toolkit for the X Window System
+ * Copyright (C) 1996-2017 by Mark-André Hopf <mhopf@mark13.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,   
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307,  USA
+ */
+
+#include <toad/figure.hh>
+#include <toad/vector.hh>
+
+using namespace toad;
+
+TFSymbol::TFSymbol():
+  displayList(nullptr),
+  displayListValid(false)
+{
+  connect(sigChanged, this, &TFSymbol::modelChanged);
+}
+
+TFSymbol::TFSymbol(const TFSymbol &symbol):
+  super(symbol),
+  name(symbol.name),
+  displayList(nullptr),
+  displayListValid(false)
+{
+  connect(sigChanged, this, &TFSymbol::modelChanged);
+}
+
+TFSymbol::~TFSymbol()
+{
+  sigChanged.remove(this);
+  clearDisplayList();
+}
+
+void
+TFSymbol::modelChanged()
+{
+  clearDisplayList();
+}
+
+void
+TFSymbol::clearDisplayList() const
+{
+  if (displayList) {
+    delete displayList;
+    displayList = nullptr;
+  }
+  displayListValid = false;
+}
+
+/**
+ * The paths of all figures, created once and kept until the symbol is
+ * modified.
+ *
+ * Returns nullptr when one of the figures doesn't provide a path.
+ */
+TVectorGraphic*
+TFSymbol::getDisplayList() const
+{
+  if (displayListValid)
+    return displayList;
+  displayListValid = true;
+  displayList = new TVectorGraphic;
+  for(auto &&figure: storage) {
+    const TVectorGraphic *graphic = figure->getPath();
+    if (!graphic) {
+      clearDisplayList();
+      displayListValid = true;
+      return nullptr;
+    }
+    displayList->insert(displayList->end(), graphic->begin(), graphic->end());
+  }
+  return displayList;
+}
+
+void
+TFSymbol::store(TOutObjectStream &out) const
+{
+  TSerializable::store(out);
+  if (!name.empty())
+    ::store(out, "name", name);
+  super::store(out);
+}
+
+bool
+TFSymbol::restore(TInObjectStream &in)
+{
+  if (
+    ::restore(in, "name", &name) ||
+    super::restore(in) ||
+    TSerializable::restore(in)
+  ) return true;
+  ATV_FAILED(in);
+  return false;
+}
+
+TFInstance::TFInstance():
+  overrideAttributes(false)
+{
+}
+
+TFInstance::TFInstance(TFSymbol *symbol, const TMatrix2D *matrix):
+  symbol(symbol),
+  overrideAttributes(false)
+{
+  if (matrix)
+    this->matrix = *matrix;
+}
+
+/**
+ * Paint the symbol's figures. With overridden attributes the symbol's
+ * display list is used instead, when all of its figures provide a path.
+ */
+void
+TFInstance::paint(TPenBase &pen, EPaintType type)
+{
+  if (!symbol)
+    return;
+  pen.push();
+  pen.multiply(&matrix);
+  TVectorGraphic *displayList = overrideAttributes ? symbol->getDisplayList() : nullptr;
+  if (displayList) {
+    displayList->paint(pen, this);
+  } else {
+    for(auto &&figure: *symbol)
+      figure->paint(pen, NORMAL);
+  }
+  pen.pop();
+}
+
+TRectangle
+TFInstance::bounds() const
+{
+  if (!symbol || symbol->empty())
+    return TRectangle(0, 0, 0, 0);
+  const TBoundary &b = symbol->bounds();
+  TBoundary r;
+  TPoint p;
+  matrix.map(b.p0, &p); r.expand(p);
+  matrix.map(TPoint(b.p1.x, b.p0.y), &p); r.expand(p);
+  matrix.map(b.p1, &p); r.expand(p);
+  matrix.map(TPoint(b.p0.x, b.p1.y), &p); r.expand(p);
+  return TRectangle(r);
+}
+
+TCoord
+TFInstance::_distance(TFigureEditor *fe, TCoord x, TCoord y)
+{
+  if (!symbol)
+    return OUT_OF_RANGE;
+  TMatrix2D m(matrix);
+  m.invert();
+  m.map(x, y, &x, &y);
+  TCoord min = OUT_OF_RANGE;
+  for(auto &&figure: *symbol) {
+    TCoord d = figure->_distance(fe, x, y);
+    if (d==INSIDE)
+      return INSIDE;
+    if (d<min)
+      min = d;
+  }
+  return min;
+}
+
+bool
+TFInstance::transform(const TMatrix2D &transform)
+{
+  matrix = transform * matrix;
+  return true;
+}
+
+void
+TFInstance::setAttributes(const TFigureAttributeModel *attributes)
+{
+  super::setAttributes(attributes);
+  overrideAttributes = true;
+}
+
+void
+TFInstance::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  if (overrideAttributes)
+    ::store(out, "override", true);
+  if (!matrix.isIdentity())
+    ::store(out, "matrix", matrix);
+  ::storeShared(out, "symbol", symbol);
+}
+
+bool
+TFInstance::restore(TInObjectStream &in)
+{
+  if (in.attribute == "matrix" && in.what == ATV_GROUP) {
+    in.setInterpreter(&matrix);
+    return true;
+  }
+  TFSymbol *s;
+  if (::restoreShared(in, "symbol", &s)) {
+    symbol = s;
+    return true;
+  }
+  if (
+    ::restore(in, "override", &overrideAttributes) ||
+    super::restore(in)
+  ) return true;
+  ATV_FAILED(in);
+  return false;
+}
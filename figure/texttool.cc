@@ -97,6 +97,8 @@ TTextTool::keyEvent(TFigureEditor *fe, const TKeyEvent &ke)
 
   switch(ke.type) {
     case TKeyEvent::DOWN:
+      if (fe->getModel())
+        fe->getModel()->modify(text);
       text->keyDown(fe, ke.key, const_cast<char*>(ke.string.c_str()), ke.modifier);
       break;
   }
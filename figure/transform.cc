@@ -33,29 +33,36 @@ TFTransform::paint(TPenBase &pen, EPaintType type)
     pen.setFillColor(TColor::WHITE);
   }
 */
-  TVectorGraphic *vg = getPath();
+  const TVectorGraphic *vg = getPath();
   if (!vg)
     return;
   vg->paint(pen);
-  delete vg;
 }
 
-TVectorGraphic*
-TFTransform::getPath() const
+bool
+TFTransform::buildPath(TVectorGraphic *graphic) const
 {
-  TVectorGraphic *vg = figure->getPath();
-  if (vg)
-    vg->transform(matrix);
-  return vg;
+  const TVectorGraphic *vg = figure->getPath();
+  if (!vg)
+    return false;
+  *graphic = *vg;
+  graphic->transform(matrix);
+  return true;
 }
 
 TRectangle
 TFTransform::bounds() const
 {
+  // 'figure' might have been modified directly
+  if (boundsValid && boundsEdits == TFigureModel::getDirectEdits())
+    return cachedBounds;
+  boundsEdits = TFigureModel::getDirectEdits();
   TVectorPath path;
   path.addRect(figure->bounds());
   path.transform(matrix);
-  return path.bounds();
+  cachedBounds = path.bounds();
+  boundsValid = true;
+  return cachedBounds;
 }
 
 TCoord
@@ -91,6 +98,7 @@ TFTransform::translateHandle(unsigned handle, TCoord x, TCoord y, unsigned modif
   m.invert();
   m.map(x, y, &x, &y);
   figure->translateHandle(handle, x, y, modifier);
+  invalidateBounds();
 }
 
 void
@@ -43,6 +43,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <mutex>
 
 // missing in mingw
 #ifndef M_PI
@@ -222,6 +223,8 @@ struct TRelationToBeRestored
   const TFigure *to;
 };
 std::vector<TRelationToBeRestored> restoreRelations;
+// figures are also restored on the threads of TLazyLoader::loadAll
+std::mutex restoreRelationsMutex;
 
 /**
  * \param from the pointer containing the figure being pointed to
@@ -230,9 +233,21 @@ std::vector<TRelationToBeRestored> restoreRelations;
 void
 TFigureEditor::restoreRelation(const TFigure **from, const TFigure *to)
 {
+  std::lock_guard<std::mutex> lock(restoreRelationsMutex);
   ::restoreRelations.push_back(TRelationToBeRestored(from, to));
 }
 
+/**
+ * Forget the relations collected by restoreRelation(), ie. when the
+ * figures they belong to were deleted because loading failed.
+ */
+void
+TFigureEditor::discardRelations()
+{
+  std::lock_guard<std::mutex> lock(restoreRelationsMutex);
+  ::restoreRelations.clear();
+}
+
 void
 TFigureEditor::restoreRelations()
 {
@@ -897,6 +912,12 @@ TFigureEditor::modelChanged()
       #warning "not removing figure (group) from selection"
       invalidateWindow(visible); // OPTIMIZE ME
       break;
+    case TFigureModel::RESTORED:
+      // figures might have been replaced by other instances
+      selection.clear();
+      invalidateWindow(visible);
+      update_scrollbars = true;
+      break;
   }
   
   if (update_scrollbars) {
@@ -941,7 +962,7 @@ TFigureEditor::clearSelection()
   {
     invalidateFigure(*p);
   }
-  selection.erase(selection.begin(), selection.end());
+  selection.clear();
   return true;
 }
 
@@ -1425,6 +1446,9 @@ void
 TFigureEditor::invalidateFigure(const TFigure* figure)
 {
   assert(figure);
+  // tools which modify figures directly call this before and after
+  if (model)
+    model->invalidateBounds();
   if (!window)
     return;
   TRectangle r;
@@ -1642,28 +1666,23 @@ DBM(cout << __PRETTY_FUNCTION__ << ": entry" << endl;)
   
   minimalAreaSize(&x1, &y1, &x2, &y2);
 
-  if (model) {
-    TRectangle r;
-    for(TFigureModel::iterator p = model->begin();
-        p != model->end();
-        ++p)
-    {
-      TCoord ax1, ay1, ax2, ay2;
-      r=(*p)->editBounds();
-      ax1=r.origin.x;
-      ay1=r.origin.y;
-      ax2=r.origin.x+r.size.width-1;
-      ay2=r.origin.y+r.size.height-1;
-
-      if (ax1<x1)
-        x1=ax1;  
-      if (ax2>x2)
-        x2=ax2;  
-      if (ay1<y1)
-        y1=ay1;  
-      if (ay2>y2)
-        y2=ay2;  
-    }
+  // the models bounds are cached, so there's no need to iterate all figures
+  if (model && !model->editBounds().empty) {
+    const TBoundary &b = model->editBounds();
+    TCoord ax1, ay1, ax2, ay2;
+    ax1=b.p0.x;
+    ay1=b.p0.y;
+    ax2=b.p1.x-1;
+    ay2=b.p1.y-1;
+
+    if (ax1<x1)
+      x1=ax1;  
+    if (ax2>x2)
+      x2=ax2;  
+    if (ay1<y1)
+      y1=ay1;  
+    if (ay2>y2)
+      y2=ay2;  
   }
   
   if (x1>0) x1=0;
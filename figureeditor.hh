@@ -200,6 +200,7 @@ class TFigureEditor:
     static std::map<const TFigure*, std::set<const TFigure*>> relatedTo;
     static void restoreRelation(const TFigure **from, const TFigure *to);
     static void restoreRelations();
+    static void discardRelations();
 
     bool quick:1;     // active TFigureTool wants quick drawing method
     bool quickready:1;// TFigureEditor is prepared for quick drawing mode
@@ -25,6 +25,12 @@
 #include <toad/undomanager.hh>
 #include <toad/io/binstream.hh>
 
+#include <set>
+#include <sstream>
+#include <unordered_set>
+#include <mutex>
+#include <cassert>
+
 /**
  * \ingroup figure
  * \class toad::TFigureModel
@@ -36,12 +42,270 @@
 
 using namespace toad;
 
-TFigureModel::TFigureModel()
+namespace {
+
+// the number of ids given to figures so far
+unsigned usedFigureIds = 0;
+
+// figures might be created during static initialization
+std::vector<unsigned>&
+unusedFigureIds()
+{
+  static std::vector<unsigned> *ids = new std::vector<unsigned>();
+  return *ids;
+}
+
+// figures are also created on the threads of TLazyLoader::loadAll
+std::mutex&
+figureIdsMutex()
+{
+  static std::mutex *mutex = new std::mutex();
+  return *mutex;
+}
+
+// ids of deleted figures kept for the figures replacing them
+std::set<unsigned>&
+reservedFigureIds()
+{
+  static std::set<unsigned> *ids = new std::set<unsigned>();
+  return *ids;
+}
+
+} // namespace
+
+std::atomic<TFigure**> TFigureIds::blocks[16384];
+std::atomic<uint64_t> TFigureIds::releases(0);
+std::atomic<std::atomic<uint64_t>*> TFigureIds::releasedAt[16384];
+
+unsigned
+TFigureIds::acquire(TFigure *figure)
+{
+  std::lock_guard<std::mutex> lock(figureIdsMutex());
+  unsigned id;
+  if (unusedFigureIds().empty()) {
+    id = usedFigureIds++;
+    if (id % BLOCK == 0) {
+      assert(id / BLOCK < sizeof(blocks)/sizeof(blocks[0]));
+      releasedAt[id / BLOCK].store(new std::atomic<uint64_t>[BLOCK](), std::memory_order_release);
+      blocks[id / BLOCK].store(new TFigure*[BLOCK], std::memory_order_release);
+    }
+  } else {
+    id = unusedFigureIds().back();
+    unusedFigureIds().pop_back();
+  }
+  blocks[id / BLOCK].load(std::memory_order_relaxed)[id % BLOCK] = figure;
+  return id;
+}
+
+void
+TFigureIds::release(unsigned id)
+{
+  std::lock_guard<std::mutex> lock(figureIdsMutex());
+  blocks[id / BLOCK].load(std::memory_order_relaxed)[id % BLOCK] = nullptr;
+  if (reservedFigureIds().count(id))
+    return;
+  unusedFigureIds().push_back(id);
+
+  // the id will be given to another figure, drop it from all sets
+  uint64_t n = releases.load(std::memory_order_relaxed) + 1;
+  releasedAt[id / BLOCK].load(std::memory_order_relaxed)[id % BLOCK].store(n, std::memory_order_relaxed);
+  releases.store(n, std::memory_order_release);
+}
+
+/**
+ * Keep 'id' when its figure is deleted so that assign() can give it to
+ * another figure.
+ */
+void
+TFigureIds::reserve(unsigned id)
+{
+  std::lock_guard<std::mutex> lock(figureIdsMutex());
+  reservedFigureIds().insert(id);
+}
+
+/**
+ * Give the reserved 'id' to 'figure', which frees the id it had.
+ */
+void
+TFigureIds::assign(TFigure *figure, unsigned id)
+{
+  unsigned old = figure->id;
+  {
+    std::lock_guard<std::mutex> lock(figureIdsMutex());
+    assert(reservedFigureIds().count(id));
+    reservedFigureIds().erase(id);
+    blocks[id / BLOCK].load(std::memory_order_relaxed)[id % BLOCK] = figure;
+    figure->id = id;
+  }
+  release(old);
+}
+
+/**
+ * Free a reserved 'id' which wasn't assigned.
+ */
+void
+TFigureIds::unreserve(unsigned id)
+{
+  {
+    std::lock_guard<std::mutex> lock(figureIdsMutex());
+    if (!reservedFigureIds().erase(id))
+      return;
+  }
+  release(id);
+}
+
+/**
+ * Return word 'i' of the set without the ids released since it was
+ * updated.
+ */
+TFigureSet::TWord
+TFigureSet::word(size_t i) const
+{
+  TWord w = bits[i];
+  if (fresh())
+    return w;
+  for(TWord m = w; m; m &= m - 1) {
+    size_t id = i * BITS + __builtin_ctzll(m);
+    if (TFigureIds::released(id) > releases)
+      w &= ~(TWord(1) << (id % BITS));
+  }
+  return w;
+}
+
+/**
+ * Drop the ids released since the set was updated.
+ */
+void
+TFigureSet::update()
+{
+  if (fresh())
+    return;
+  n = 0;
+  for(size_t i=0; i<bits.size(); ++i) {
+    bits[i] = word(i);
+    n += __builtin_popcountll(bits[i]);
+  }
+  releases = TFigureIds::releases.load(std::memory_order_acquire);
+}
+
+TFigureSet::size_type
+TFigureSet::size() const
+{
+  if (fresh())
+    return n;
+  size_type result = 0;
+  for(size_t i=0; i<bits.size(); ++i)
+    result += __builtin_popcountll(word(i));
+  return result;
+}
+
+void
+TFigureSet::clear()
+{
+  bits.clear();
+  n = 0;
+  releases = TFigureIds::releases.load(std::memory_order_acquire);
+}
+
+/**
+ * Return the first id >= 'id' in the set or END when there is none.
+ */
+size_t
+TFigureSet::next(size_t id) const
+{
+  size_t i = id / BITS;
+  if (i >= bits.size())
+    return END;
+  TWord w = word(i) & (~TWord(0) << (id % BITS));
+  while(!w) {
+    if (++i >= bits.size())
+      return END;
+    w = word(i);
+  }
+  return i * BITS + __builtin_ctzll(w);
+}
+
+bool
+TFigureSet::contains(const TFigure *figure) const
+{
+  if (!figure)
+    return false;
+  size_t id = figure->getId();
+  size_t i = id / BITS;
+  return i < bits.size() && (word(i) >> (id % BITS)) & 1;
+}
+
+TFigureSet::const_iterator
+TFigureSet::find(const TFigure *figure) const
+{
+  return contains(figure) ? const_iterator(this, figure->getId()) : end();
+}
+
+std::pair<TFigureSet::iterator, bool>
+TFigureSet::insert(TFigure *figure)
+{
+  if (!figure)
+    return std::make_pair(end(), false);
+  update();
+  size_t id = figure->getId();
+  size_t i = id / BITS;
+  if (i >= bits.size())
+    bits.resize(i+1);
+  TWord mask = TWord(1) << (id % BITS);
+  bool inserted = !(bits[i] & mask);
+  if (inserted) {
+    bits[i] |= mask;
+    ++n;
+  }
+  return std::make_pair(const_iterator(this, id), inserted);
+}
+
+TFigureSet::size_type
+TFigureSet::erase(const TFigure *figure)
+{
+  update();
+  if (!contains(figure))
+    return 0;
+  size_t id = figure->getId();
+  bits[id / BITS] &= ~(TWord(1) << (id % BITS));
+  --n;
+  return 1;
+}
+
+TFigureSet::iterator
+TFigureSet::erase(const_iterator p)
+{
+  update();
+  size_t id = p.id;
+  bits[id / BITS] &= ~(TWord(1) << (id % BITS));
+  --n;
+  return const_iterator(this, next(id+1));
+}
+
+bool
+TFigureSet::operator==(const TFigureSet &set) const
+{
+  if (size() != set.size())
+    return false;
+  size_t i, e = std::min(bits.size(), set.bits.size());
+  for(i=0; i<e; ++i) {
+    if (word(i) != set.word(i))
+      return false;
+  }
+  // with equal size the remaining words must be zero
+  return true;
+}
+
+TFigureModel::TFigureModel():
+  boundsValid(false),
+  snapshotUndo(false)
 {
 //  cerr << "new TFigureModel " << this << endl;
 }
 
-TFigureModel::TFigureModel(const TFigureModel &m)
+TFigureModel::TFigureModel(const TFigureModel &m):
+  boundsValid(false),
+  snapshotUndo(false)
 {
 //  cerr << "copy constructed TFigureModel " << this << " from " << &m << endl;
   for(TStorage::const_iterator p = m.storage.begin();
@@ -62,26 +326,33 @@ TFigureModel::~TFigureModel()
 class TUndoGroup:
   public TUndo
 {
-    TFigureAtDepthList figures;
+    // the group is kept by its id, which the group read back by a spilled
+    // TUndoRemove takes over, and its gadgets are the grouped figures at
+    // 'depths'
+    vector<unsigned> depths;
     TFigureModel *model;
-    TFGroup *group;
+    TFigureSet group;
   public:
     TUndoGroup(TFigureModel *model) {
       this->model = model;
     }
-    ~TUndoGroup() {
-      figures.drop(); // clear to avoid deleting the figures
-    }
     void insert(TFigure *f, unsigned d)
     {
-//cerr << "TUndoRemove: store figure " << f << " at depth " << d << endl;
-      figures.push_back(f, d);
+      depths.push_back(d);
     }
     void setGroup(TFGroup *group) {
-      this->group = group;
+      this->group.insert(group);
     }
   protected:
     void undo() {
+      TFGroup *group = nullptr;
+      for(auto &&figure: this->group)
+        group = dynamic_cast<TFGroup*>(figure);
+      if (!group || group->gadgets.size()!=depths.size())
+        return;
+      TFigureAtDepthList figures;
+      for(size_t i=0; i<depths.size(); ++i)
+        figures.push_back(group->gadgets[i], depths[i]);
       group->drop();
       model->_undoGroup(group, figures);
       figures.drop();
@@ -136,14 +407,14 @@ class TUndoTranslateHandle:
   public TUndo
 {
     TFigureModel *model;
-    TFigure* figure;
+    TFigureSet figure;
     unsigned handle;
     TCoord dx, dy;
     unsigned m;
   public:
     TUndoTranslateHandle(TFigureModel *model, TFigure *figure, unsigned handle, TCoord dx, TCoord dy, unsigned m) {
       this->model = model;
-      this->figure = figure;
+      this->figure.insert(figure);
       this->handle = handle;
       this->dx = dx;
       this->dy = dy;
@@ -152,7 +423,8 @@ class TUndoTranslateHandle:
   protected:
     void undo() {
 //cout << "undo translate " << dx << ", " << dy << endl;
-      model->translateHandle(figure, handle, dx, dy, m);
+      for(auto &&figure: this->figure)
+        model->translateHandle(figure, handle, dx, dy, m);
     }
     bool getUndoName(string *name) const {
       *name = "Undo: Move Handle";
@@ -204,12 +476,16 @@ class TUndoInsert:
 void
 TFigureModel::insert(TFigureAtDepthList &figuresAtDepth)
 {
+  bool snapshotted = checkpoint();
+
   pureInsert(figuresAtDepth);
 
-  TUndoInsert *undo = new TUndoInsert(this);
-  for(auto &&p: figuresAtDepth.store)
-    undo->figures.insert(p.figure);
-  TUndoManager::registerUndo(this, undo);
+  if (!snapshotted) {
+    TUndoInsert *undo = new TUndoInsert(this);
+    for(auto &&p: figuresAtDepth.store)
+      undo->figures.insert(p.figure);
+    TUndoManager::registerUndo(this, undo);
+  }
   
   type = ADD;
   figures.clear();
@@ -223,14 +499,48 @@ TFigureModel::insert(TFigureAtDepthList &figuresAtDepth)
 void 
 TFigureModel::pureInsert(const TFigureAtDepthList &figuresAtDepth)
 {
-  for(auto p=figuresAtDepth.store.begin();
+  boundsValid = false;
+  if (figuresAtDepth.store.empty())
+    return;
+
+  // a single merge pass requires strictly ascending depths, as they are
+  // created by pureErase
+  bool ascending = true;
+  for(auto p=figuresAtDepth.store.begin()+1;
       p!=figuresAtDepth.store.end();
       ++p)
   {
-    storage.insert(
-      storage.begin() + p->depth,
-      p->figure);
+    if ((p-1)->depth >= p->depth) {
+      ascending = false;
+      break;
+    }
+  }
+  if (!ascending) {
+    for(auto p=figuresAtDepth.store.begin();
+        p!=figuresAtDepth.store.end();
+        ++p)
+    {
+      storage.insert(
+        storage.begin() + p->depth,
+        p->figure);
+      edited(p->depth, 0, 1);
+    }
+    return;
+  }
+
+  TStorage merged;
+  merged.reserve(storage.size() + figuresAtDepth.store.size());
+  auto from = storage.begin();
+  for(auto &&p: figuresAtDepth.store) {
+    while(merged.size() < p.depth && from != storage.end()) {
+      merged.push_back(*from);
+      ++from;
+    }
+    edited(merged.size(), 0, 1);
+    merged.push_back(p.figure);
   }
+  merged.insert(merged.end(), from, storage.end());
+  storage.swap(merged);
 }
 
 /**
@@ -241,11 +551,18 @@ TFigureModel::pureInsert(const TFigureAtDepthList &figuresAtDepth)
  */
 void 
 TFigureModel::add(TFigure *figure) {
-  TUndoInsert *undo = new TUndoInsert(this);
-  undo->insert(figure);
-  TUndoManager::registerUndo(this, undo);
+  if (!checkpoint()) {
+    TUndoInsert *undo = new TUndoInsert(this);
+    undo->insert(figure);
+    TUndoManager::registerUndo(this, undo);
+  }
 
   storage.push_back(figure);
+  edited(storage.size()-1, 0, 1);
+  if (boundsValid) {
+    cachedBounds.expand(TBoundary(figure->bounds()));
+    cachedEditBounds.expand(TBoundary(figure->editBounds()));
+  }
 
   type = ADD;
   figures.clear();
@@ -271,17 +588,25 @@ TFigureModel::add(TFigureVector &newfigures) {
   ee.type = TFigureEditEvent::ADDED;
   figures.clear();
   type = ADD;
-  TUndoInsert *undo = new TUndoInsert(this);
+  bool snapshotted = checkpoint();
+  TUndoInsert *undo = snapshotted ? nullptr : new TUndoInsert(this);
+  edited(storage.size(), 0, newfigures.size());
   for(TFigureVector::iterator p = newfigures.begin();
       p != newfigures.end();
       ++p)
   {
     storage.push_back(*p);
+    if (boundsValid) {
+      cachedBounds.expand(TBoundary((*p)->bounds()));
+      cachedEditBounds.expand(TBoundary((*p)->editBounds()));
+    }
     figures.insert(*p);
-    undo->insert(*p);
+    if (undo)
+      undo->insert(*p);
     (*p)->editEvent(ee);
   }
-  TUndoManager::registerUndo(this, undo);
+  if (undo)
+    TUndoManager::registerUndo(this, undo);
   sigChanged();
 }
 
@@ -293,25 +618,115 @@ TFigureModel::add(TFigureVector &newfigures) {
 
 namespace {
 
+// append 'figure' and the figures it's made of
+void
+flatten(TFigure *figure, vector<TFigure*> *figures)
+{
+  figures->push_back(figure);
+  vector<TFigure*> inner;
+  figure->getFigures(&inner);
+  for(auto &&f: inner)
+    flatten(f, figures);
+}
+
 class TUndoRemove:
   public TUndo
 {
     TFigureModel *model;
+    mutable size_t memorySize;
+    vector<unsigned> spilledDepths;
+    // the ids of the spilled figures, including those they're made of, are
+    // given to the figures read back so that the other undo objects refer
+    // to these instead
+    vector<unsigned> spilledIds;
   public:
     TFigureAtDepthList figures;
     TUndoRemove(TFigureModel *model) {
       this->model = model;
+      memorySize = 0;
+    }
+    ~TUndoRemove() {
+      for(auto &&id: spilledIds)
+        TFigureIds::unreserve(id);
     }
     void insert(TFigure *f, unsigned d)
     {
 //cerr << "TUndoRemove: store figure " << f << " at depth " << d << endl;
       figures.push_back(f, d);
+      memorySize = 0;
     }
   protected:
     void undo() {
       model->insert(figures);
       figures.drop();
     }
+    void storeFigures(ostream &out) const {
+      TOutObjectStream os(&out);
+      for(auto &&p: figures)
+        os.store(p.figure);
+    }
+    // the serialized size is used as estimate, which is also what spill()
+    // will write; it's computed once as the figures don't change
+    size_t getMemorySize() const override {
+      if (figures.size()==0)
+        return sizeof(*this) + (spilledDepths.capacity() + spilledIds.capacity()) * sizeof(unsigned);
+      if (!memorySize) {
+        ostringstream out;
+        storeFigures(out);
+        memorySize = sizeof(*this) + out.tellp();
+      }
+      return memorySize;
+    }
+    bool spill(ostream &out) override {
+      // references to figures outside the spill record can't be restored
+      for(auto &&relation: TFigureEditor::relatedTo) {
+        for(auto &&p: figures) {
+          if (relation.first == p.figure ||
+              relation.second.find(p.figure) != relation.second.end())
+            return false;
+        }
+      }
+      ostream::pos_type start = out.tellp();
+      storeFigures(out);
+      if (!memorySize)
+        memorySize = sizeof(*this) + (out.tellp() - start);
+      vector<TFigure*> all;
+      for(auto &&p: figures) {
+        spilledDepths.push_back(p.depth);
+        flatten(p.figure, &all);
+      }
+      for(auto &&figure: all) {
+        spilledIds.push_back(figure->getId());
+        TFigureIds::reserve(figure->getId());
+      }
+      for(auto &&p: figures)
+        delete p.figure;
+      figures.drop();
+      return true;
+    }
+    bool unspill(istream &in) override {
+      TInObjectStream is(&in);
+      size_t depth = 0, id = 0;
+      while(TSerializable *s = is.restore()) {
+        TFigure *figure = dynamic_cast<TFigure*>(s);
+        vector<TFigure*> all;
+        if (figure)
+          flatten(figure, &all);
+        if (!figure || depth==spilledDepths.size() ||
+            all.size() > spilledIds.size() - id)
+        {
+          delete s;
+          spilledIds.erase(spilledIds.begin(), spilledIds.begin() + id);
+          return false;
+        }
+        for(auto &&f: all)
+          TFigureIds::assign(f, spilledIds[id++]);
+        figures.push_back(figure, spilledDepths[depth++]);
+      }
+      spilledDepths.clear();
+      spilledIds.clear();
+      return true;
+    }
     bool getUndoName(string *name) const {
       *name = "Undo: Remove";
       return true;
@@ -327,9 +742,28 @@ class TUndoRemove:
 void
 TFigureModel::erase(TFigureSet &set, TFigureAtDepthList *placement)
 {
+  if (set.empty())
+    return;
+
+  // views might modify 'set' (ie. TFigureEditor::selection) on REMOVE
+  figures = set;
+  type = REMOVE;
+  sigChanged();
+  TFigureSet removed;
+  removed.swap(figures);
+
   // FIXME: create TFigureEditEvents
+  if (checkpoint()) {
+    // the snapshot registered by checkpoint() now owns the figures
+    TFigureAtDepthList placed;
+    pureErase(removed, &placed);
+    for(auto &&p: placed)
+      nodes.erase(p.figure);
+    placed.drop();
+    return;
+  }
   TUndoRemove *undo = new TUndoRemove(this);
-  pureErase(set, &undo->figures);
+  pureErase(removed, &undo->figures);
   TUndoManager::registerUndo(this, undo);
 }
 
@@ -346,6 +780,7 @@ TFigureModel::pureErase(TFigureSet &set, TFigureAtDepthList *placement)
 {
   if (set.empty())
     return;
+  boundsValid = false;
 
 //  TFigureEditEvent ee;
 //  ee.model = this;
@@ -374,20 +809,21 @@ TFigureModel::pureErase(TFigureSet &set, TFigureAtDepthList *placement)
     
   ee.type = TFigureEditEvent::REMOVED;
 */
-  unsigned depth = 0;
-  auto iterator=storage.begin();
-  while(iterator!=storage.end()) {
-    TFigureSet::iterator q = set.find(*iterator);
-    if (q!=set.end()) {
+  // stable compaction in a single pass instead of one erase per figure
+  unsigned depth = 0, erased = 0;
+  auto out = storage.begin();
+  for(auto in = storage.begin(); in!=storage.end(); ++in, ++depth) {
+    if (set.find(*in)!=set.end()) {
+      edited(depth - erased++, 1, 0);
       if (placement)
-        placement->push_back(*iterator, depth);
-//      (*p)->editEvent(ee);
-      iterator = storage.erase(iterator);
+        placement->push_back(*in, depth);
+//      (*in)->editEvent(ee);
     } else {
-      ++iterator;
+      *out = *in;
+      ++out;
     }
-    ++depth;
   }
+  storage.erase(out, storage.end());
 }
 
 void
@@ -459,6 +895,8 @@ class TUndoTransform:
 void
 TFigureModel::transform(TFigureSet *selection, const TMatrix2D &matrix, bool invert)
 {
+  bool snapshotted = checkpoint(selection);
+
   figures = *selection;
   type = MODIFY;
   sigChanged();
@@ -485,17 +923,24 @@ TFigureModel::transform(TFigureSet *selection, const TMatrix2D &matrix, bool inv
 */
     
   ee.type = TFigureEditEvent::RELATION_MODIFIED;
+  // collect the related figures first, so that a figure related to several
+  // of the transformed figures (ie. a connection between them) is updated
+  // only once. it finds the transformed figures in model->figures.
+  std::set<const TFigure*> related;
   for(auto &figure: *selection) {
     auto relation = TFigureEditor::relatedTo.find(figure);
     if (relation==TFigureEditor::relatedTo.end())
       continue;
-    for(auto &relatedFigure: relation->second)
-      const_cast<TFigure*>(relatedFigure)->editEvent(ee);
+    related.insert(relation->second.begin(), relation->second.end());
   }
+  for(auto &relatedFigure: related)
+    const_cast<TFigure*>(relatedFigure)->editEvent(ee);
 
-  TUndoManager::registerUndo(this,
-    new TUndoTransform(this, *selection, matrix, !invert)
-  );
+  if (!snapshotted) {
+    TUndoManager::registerUndo(this,
+      new TUndoTransform(this, *selection, matrix, !invert)
+    );
+  }
 }
 
 /**
@@ -514,11 +959,13 @@ void
 TFigureModel::pureTransform(TFigureSet *selection, const TMatrix2D &matrix)
 {
   TFigureSet addTransform, removeTransform;
+  boundsValid = false;
 
   for(auto &&figure: *selection) {
     TFTransform *transform = dynamic_cast<TFTransform*>(figure);
     if (transform) {
       transform->matrix = matrix * transform->matrix;
+      transform->invalidateBounds();
       if (transform->matrix.isIdentity()) {
         removeTransform.insert(figure);
       }
@@ -539,6 +986,7 @@ TFigureModel::pureTransform(TFigureSet *selection, const TMatrix2D &matrix)
 
       TFTransform *transform = new TFTransform();
       transform->matrix = matrix;
+      detach(place.figure);
       transform->figure = place.figure;
       place.figure = transform;
       selection->erase(transform->figure);
@@ -577,7 +1025,7 @@ TFigureModel::pureTransform(TFigureSet *selection, const TMatrix2D &matrix)
       }
 
       transform->figure = nullptr;
-      delete transform;
+      dispose(transform);
     }
   }
   pureInsert(replaceAtDepth);
@@ -626,6 +1074,8 @@ TFigureModel::translateHandle(TFigure *figure, unsigned handle, TCoord x, TCoord
   
   figures.clear();
   figures.insert(figure);
+  bool snapshotted = checkpoint(&figures);
+  boundsValid = false;
   
   type = MODIFY;
   sigChanged();
@@ -638,8 +1088,10 @@ TFigureModel::translateHandle(TFigure *figure, unsigned handle, TCoord x, TCoord
   type = MODIFIED;
   sigChanged();
   
-  TUndoTranslateHandle *undo = new TUndoTranslateHandle(this, figure, handle, x, y, modifier);
-  TUndoManager::registerUndo(this, undo);
+  if (!snapshotted) {
+    TUndoTranslateHandle *undo = new TUndoTranslateHandle(this, figure, handle, x, y, modifier);
+    TUndoManager::registerUndo(this, undo);
+  }
 }
 
 /**
@@ -684,21 +1136,26 @@ TFigureModel::group(TFigureSet &set)
   if (set.size()<2)
     return 0;
     
-  TUndoGroup *undo = new TUndoGroup(this);
+  bool snapshotted = checkpoint();
+  TUndoGroup *undo = snapshotted ? nullptr : new TUndoGroup(this);
   
   unsigned count = 0;
   unsigned depth = 0;
   TFGroup *group = new TFGroup();
-  undo->setGroup(group);
+  if (undo)
+    undo->setGroup(group);
   TStorage::iterator last;
   for(TStorage::iterator p = storage.begin();
       p!=storage.end(); ++depth)
   {
     if (set.find(*p)!=set.end()) {
+      detach(*p);
       group->gadgets.add(*p);
-      undo->insert(*p, depth);
+      if (undo)
+        undo->insert(*p, depth);
       unsigned pi = p - storage.begin();
       storage.erase(p);
+      edited(pi, 1, 0);
       last = p = storage.begin() + pi;
       ++count;
     } else {
@@ -711,10 +1168,13 @@ TFigureModel::group(TFigureSet &set)
     // return 0;
   }
   
-  TUndoManager::registerUndo(this, undo);
+  if (undo)
+    TUndoManager::registerUndo(this, undo);
   
   group->calcSize();
+  edited(last - storage.begin(), 0, 1);
   storage.insert(last, group);
+  boundsValid = false;
   
   type = GROUP;
   figures.clear();
@@ -728,6 +1188,7 @@ TFigure*
 TFigureModel::transform(TFigureSet &set, TFPerspectiveTransform *transform)
 {
 //  TUndoGroup *undo = new TUndoGroup(this);
+  checkpoint();
   
   unsigned count = 0;
   unsigned depth = 0;
@@ -738,10 +1199,12 @@ TFigureModel::transform(TFigureSet &set, TFPerspectiveTransform *transform)
       p!=storage.end(); ++depth)
   {
     if (set.find(*p)!=set.end()) {
+      detach(*p);
       transform->add(*p);
 //      undo->insert(*p, depth);
       unsigned pi = p - storage.begin();
       storage.erase(p);
+      edited(pi, 1, 0);
       last = p = storage.begin() + pi;
       ++count;
     } else {
@@ -752,7 +1215,9 @@ TFigureModel::transform(TFigureSet &set, TFPerspectiveTransform *transform)
 //  TUndoManager::registerUndo(this, undo);
   
   transform->init();
+  edited(last - storage.begin(), 0, 1);
   storage.insert(last, transform);
+  boundsValid = false;
   
   type = GROUP;
   figures.clear();
@@ -779,6 +1244,8 @@ TFigureModel::transform(TFigureSet &set, TFPerspectiveTransform *transform)
 void
 TFigureModel::ungroup(TFigureSet &grouped, TFigureSet *ungrouped)
 {
+  checkpoint();
+  boundsValid = false;
   TFigureSet memo;
   for(TStorage::iterator p = storage.begin();
       p != storage.end();
@@ -787,11 +1254,13 @@ TFigureModel::ungroup(TFigureSet &grouped, TFigureSet *ungrouped)
     if (grouped.find(*p)!=grouped.end()) {
       TFGroup *group = dynamic_cast<TFGroup*>(*p);
       if (group) {
+        detach(group);
         int pi = p - storage.begin();
         storage.erase(p);
         p = storage.begin() + pi;
 
         storage.insert(p, group->gadgets.storage.begin(), group->gadgets.storage.end());
+        edited(pi, 1, group->gadgets.storage.size());
         p = storage.begin() + pi + group->gadgets.storage.size()-1;
         memo.insert(group->gadgets.begin(), group->gadgets.end());
         group->gadgets.erase(group->gadgets.begin(),group->gadgets.end());
@@ -815,11 +1284,17 @@ class TUndoAttributes:
 {
     TFigureModel *model;
     struct TNode {
-      TFigure *figure;
+      unsigned id;
       TFigureAttributeModel attributes;
       TNode *next;
     };
     TNode *list;
+    // the figures, kept by id like in TFigureSet
+    TFigureSet figures;
+    TFigure* figure(const TNode *node) const {
+      TFigure *figure = TFigureIds::get(node->id);
+      return figures.contains(figure) ? figure : nullptr;
+    }
   public:
     TUndoAttributes(TFigureModel *model) {
       this->model = model;
@@ -834,7 +1309,8 @@ class TUndoAttributes:
     }
     void insert(TFigure *f) {
       TNode *node = new TNode;
-      node->figure = f;
+      node->id = f->getId();
+      figures.insert(f);
       f->getAttributes(&node->attributes);
       node->attributes.setAllReasons();
       node->next = list;
@@ -847,7 +1323,7 @@ class TUndoAttributes:
       model->figures.clear();
       TNode *node = list;
       while(node) {
-        model->figures.insert(node->figure);
+        model->figures.insert(figure(node));
         node = node->next;
       }
       model->type = TFigureModel::MODIFY;
@@ -855,8 +1331,10 @@ class TUndoAttributes:
       
       node = list;
       while(node) {
-        undo->insert(node->figure);
-        node->figure->setAttributes(&node->attributes);
+        if (TFigure *figure = this->figure(node)) {
+          undo->insert(figure);
+          figure->setAttributes(&node->attributes);
+        }
         node = node->next;
       }
       TUndoManager::registerUndo(model, undo);
@@ -882,21 +1360,25 @@ TFigureModel::setAttributes(TFigureSet &set, const TFigureAttributeModel *attrib
 
   figures.clear();
   figures.insert(set.begin(), set.end());
+  bool snapshotted = checkpoint(&set);
+  boundsValid = false;
 
   type = MODIFY;
   sigChanged();
   
-  TUndoAttributes *undo = new TUndoAttributes(this);
+  TUndoAttributes *undo = snapshotted ? nullptr : new TUndoAttributes(this);
 
   for(TFigureSet::iterator p=set.begin();
       p!=set.end();
       ++p)
   {
-    undo->insert(*p);
+    if (undo)
+      undo->insert(*p);
     (*p)->setAttributes(attributes);
   }
   
-  TUndoManager::registerUndo(this, undo);
+  if (undo)
+    TUndoManager::registerUndo(this, undo);
 
   type = MODIFIED;
   sigChanged();
@@ -914,13 +1396,11 @@ TFigureModel::_undoGroup(TFGroup *group, TFigureAtDepthList &store)
   
   TUndoUngroup *undo = new TUndoUngroup(this);
   
+  pureInsert(store);
   for(TFigureAtDepthList::TStore::iterator p = store.store.begin();
       p!=store.store.end();
       ++p)
   {
-    storage.insert(
-      storage.begin() + p->depth,
-      p->figure);
     figures.insert(p->figure);
     undo->insert(p->figure);
   }
@@ -931,10 +1411,12 @@ TFigureModel::_undoGroup(TFGroup *group, TFigureAtDepthList &store)
       ++p)
   {
     if (*p == group) {
+      edited(p - storage.begin(), 1, 0);
       storage.erase(p);
       break;
     }
   }
+  boundsValid = false;
   TUndoManager::registerUndo(this, undo);
 }
 
@@ -944,6 +1426,8 @@ TFigureModel::insert(const iterator &p, TFigure *g)
 {
   type = MODIFIED;
   sigChanged();
+  boundsValid = false;
+  edited(p - storage.begin(), 0, 1);
   storage.insert(p, g);
 }
 
@@ -952,9 +1436,80 @@ TFigureModel::insert(const iterator &at, const iterator &from, const iterator &t
 {
   type = MODIFIED;
   sigChanged();
+  boundsValid = false;
+  edited(at - storage.begin(), 0, to - from);
   storage.insert(at, from, to);
 }
 
+std::atomic<unsigned> TFigureModel::directEdits(0);
+
+void
+TFigureModel::calcBounds() const
+{
+  boundsEdits = getDirectEdits();
+  cachedBounds.clear();
+  cachedEditBounds.clear();
+  for(auto &&figure: storage) {
+    cachedBounds.expand(TBoundary(figure->bounds()));
+    cachedEditBounds.expand(TBoundary(figure->editBounds()));
+  }
+  boundsValid = true;
+}
+
+/**
+ * Returns the union of the bounds of all figures.
+ *
+ * The result is cached until the model is modified or invalidateBounds()
+ * is called on any model, as the figure modified might be in a group of
+ * this one.
+ */
+const TBoundary&
+TFigureModel::bounds() const
+{
+  if (!boundsValid || boundsEdits != getDirectEdits())
+    calcBounds();
+  return cachedBounds;
+}
+
+/**
+ * Returns the union of the edit bounds of all figures.
+ */
+const TBoundary&
+TFigureModel::editBounds() const
+{
+  if (!boundsValid || boundsEdits != getDirectEdits())
+    calcBounds();
+  return cachedEditBounds;
+}
+
+/**
+ * Tell the observers that 'figure' is about to be modified without using
+ * the model, ie. while its text is edited in place.
+ *
+ * This method doesn't create an undo object.
+ */
+void
+TFigureModel::modify(TFigure *figure)
+{
+  figures.clear();
+  figures.insert(figure);
+  type = MODIFY;
+  sigChanged();
+  cachedSnapshot.reset();
+  invalidateBounds();
+}
+
+/**
+ * Figures modified without using the model might be inside a group or
+ * transform, whose cached bounds are calculated again.
+ */
+void
+TFigureModel::invalidateBounds()
+{
+  boundsValid = false;
+  directEdits.fetch_add(1, std::memory_order_relaxed);
+}
+
 /**
  * Remove all figures from the model.
  *
@@ -970,10 +1525,433 @@ TFigureModel::clear()
   p = storage.begin();
   e = storage.end();
   while(p!=e) {
-    delete *p;
+    dispose(*p);
     ++p;
   }
   storage.erase(storage.begin(), storage.end());
+  chunks.clear();
+  cachedSnapshot.reset();
+  boundsValid = false;
+}
+
+void
+TFigureModel::drop()
+{
+  if (snapshotUndo) {
+    for(auto &&figure: storage)
+      detach(figure);
+  }
+  storage.clear();
+  chunks.clear();
+  cachedSnapshot.reset();
+  boundsValid = false;
+}
+
+/*****************************************************************************
+ *                                                                           *
+ *                              S N A P S H O T S                            *
+ *                                                                           *
+ *****************************************************************************/
+
+/**
+ * \struct toad::TFigureModel::TFigureNode
+ *
+ * Reference counted owner of a figure while the model is in snapshot
+ * undo mode. A node is shared between the live model and all snapshots
+ * taken while the figure wasn't modified.
+ */
+struct TFigureModel::TFigureNode
+{
+  TFigureNode(TFigure *figure, TFigure *origin=nullptr):
+    figure(figure), origin(origin), chunk(nullptr) {}
+  ~TFigureNode() { delete figure; }
+  TFigure *figure;
+  TFigure *origin; // live figure this one was cloned from
+  const TFigureChunk *chunk; // the model's chunk holding the node
+};
+
+/**
+ * \struct toad::TFigureModel::TFigureChunk
+ *
+ * A run of consecutive figures, shared by all snapshots taken while none
+ * of them was modified and no figure was inserted or removed within the
+ * run.
+ */
+struct TFigureModel::TFigureChunk
+{
+  vector<TFigureModel::PFigureNode> nodes;
+};
+
+/**
+ * A snapshot is a list of chunks. Consecutive snapshots share all chunks
+ * but those which were modified in between.
+ */
+class toad::TFigureModelSnapshot
+{
+  public:
+    vector<TFigureModel::PFigureChunk> chunks;
+    size_t getMemorySize() const {
+      return sizeof(*this) + chunks.capacity() * sizeof(TFigureModel::PFigureChunk);
+    }
+};
+
+namespace {
+
+// the number of figures in a chunk created from modified figures, which is
+// a trade off between the size of a snapshot's list of chunks and the
+// number of figures looked up again for a modified chunk
+const size_t chunkSize = 64;
+
+class TUndoSnapshot:
+  public TUndo
+{
+    TFigureModel *model;
+    TFigureModel::PSnapshot snapshot;
+  public:
+    TUndoSnapshot(TFigureModel *model, const TFigureModel::PSnapshot &snapshot):
+      model(model), snapshot(snapshot) {}
+  protected:
+    size_t getMemorySize() const override {
+      // chunks are shared with other snapshots, just count the references
+      return sizeof(*this) + snapshot->getMemorySize();
+    }
+    void undo() {
+      model->restoreSnapshot(snapshot);
+    }
+    bool getUndoName(string *name) const {
+      *name = "Undo: Change";
+      return true;
+    }
+    bool getRedoName(string *name) const {
+      *name = "Redo: Change";
+      return true;
+    }
+};
+
+} // namespace
+
+/**
+ * Record undo checkpoints as snapshots instead of TUndo objects.
+ *
+ * A snapshot shares all figures with the model. Only figures which are
+ * about to be modified get cloned. The figures are kept in chunks of
+ * consecutive figures, which are shared between snapshots, so taking a
+ * checkpoint costs O(number of figures / chunk size) pointer copies and
+ * O(modified chunks * chunk size) for the chunks being created again, no
+ * matter how expensive the individual TUndo object would have been.
+ *
+ * Figures keep their identity in the live model; after an undo the
+ * figures which were modified in the meantime are replaced by their
+ * clones and TFigureEditor::relatedTo is updated accordingly.
+ */
+void
+TFigureModel::setSnapshotUndo(bool enable)
+{
+  if (snapshotUndo == enable)
+    return;
+  chunks.clear();
+  if (!enable) {
+    for(auto &&figure: storage)
+      detach(figure);
+  } else {
+    chunks.push_back(TChunkSlot { {}, nullptr, storage.size() });
+  }
+  snapshotUndo = enable;
+  cachedSnapshot.reset();
+}
+
+/**
+ * Tell the chunks that storage[at, at+erased) was replaced by 'inserted'
+ * figures, so that the next snapshot creates the chunk around them again.
+ */
+void
+TFigureModel::edited(size_t at, size_t erased, size_t inserted)
+{
+  cachedSnapshot.reset();
+  if (!snapshotUndo)
+    return;
+  if (chunks.empty())
+    chunks.push_back(TChunkSlot { {}, nullptr, 0 });
+
+  size_t i = 0, pos = 0;
+  while(i+1<chunks.size() && pos + chunks[i].size < at) {
+    pos += chunks[i].size;
+    ++i;
+  }
+
+  // the slot at 'at' takes the inserted figures and what's left of the
+  // slots from which figures are erased
+  TChunkSlot &slot = chunks[i];
+  slot.chunk.reset();
+  slot.address = nullptr;
+  size_t n = std::min(erased, pos + slot.size - at);
+  slot.size -= n;
+  erased -= n;
+  size_t j = i+1;
+  for(; erased && j<chunks.size(); ++j) {
+    n = std::min(erased, chunks[j].size);
+    slot.size += chunks[j].size - n;
+    erased -= n;
+  }
+  chunks.erase(chunks.begin()+i+1, chunks.begin()+j);
+  slot.size += inserted;
+}
+
+/**
+ * Return a snapshot of the current model or nullptr when snapshot undo
+ * mode is disabled.
+ *
+ * As long as the model isn't modified, the same snapshot is returned.
+ */
+TFigureModel::PSnapshot
+TFigureModel::snapshot()
+{
+  if (!snapshotUndo)
+    return nullptr;
+  if (cachedSnapshot)
+    return cachedSnapshot;
+
+  // storage was modified without telling edited(), start from scratch
+  size_t size = 0;
+  for(auto &&slot: chunks)
+    size += slot.size;
+  if (size != storage.size()) {
+    chunks.clear();
+    chunks.push_back(TChunkSlot { {}, nullptr, storage.size() });
+  }
+
+  auto result = std::make_shared<TFigureModelSnapshot>();
+  vector<TChunkSlot> slots;
+  slots.reserve(chunks.size());
+  size_t pos = 0;
+  for(size_t i=0; i<chunks.size();) {
+    PFigureChunk chunk = chunks[i].chunk.lock();
+    if (chunk) {
+      result->chunks.push_back(chunk);
+      slots.push_back(chunks[i]);
+      pos += chunks[i].size;
+      ++i;
+      continue;
+    }
+
+    // a run of modified slots, along with the next slot when the run is
+    // small, so that the chunks don't get ever smaller
+    size_t end = pos;
+    while(i<chunks.size() && chunks[i].chunk.expired()) {
+      end += chunks[i].size;
+      ++i;
+    }
+    if (end > pos && end - pos < chunkSize/2 && i<chunks.size()) {
+      end += chunks[i].size;
+      ++i;
+    }
+
+    size_t count = (end - pos + chunkSize - 1) / chunkSize;
+    for(size_t k=0; k<count; ++k) {
+      size_t from = pos + (end - pos) * k / count;
+      size_t to   = pos + (end - pos) * (k+1) / count;
+      auto chunk = std::make_shared<TFigureChunk>();
+      chunk->nodes.reserve(to - from);
+      for(size_t j=from; j<to; ++j) {
+        PFigureNode &node = nodes[storage[j]];
+        if (!node)
+          node = std::make_shared<TFigureNode>(storage[j]);
+        node->chunk = chunk.get();
+        chunk->nodes.push_back(node);
+      }
+      result->chunks.push_back(chunk);
+      slots.push_back(TChunkSlot { chunk, chunk.get(), to - from });
+    }
+    pos = end;
+  }
+  chunks.swap(slots);
+  cachedSnapshot = result;
+  return cachedSnapshot;
+}
+
+/**
+ * Replace the models figures with the ones from the snapshot.
+ *
+ * This function notifies all its views about the modification and
+ * registers an undo object.
+ */
+void
+TFigureModel::restoreSnapshot(const PSnapshot &snapshot)
+{
+  if (!snapshotUndo || !snapshot)
+    return;
+
+  PSnapshot current = this->snapshot();
+  TUndoManager::registerUndo(this, new TUndoSnapshot(this, current));
+
+  figures.clear();
+  figures.insert(storage.begin(), storage.end());
+  type = MODIFY;
+  sigChanged();
+
+  // only the chunks which aren't in both snapshots hold figures which
+  // leave, enter or were replaced by their clones
+  std::unordered_set<const TFigureChunk*> before, after;
+  for(auto &&chunk: current->chunks)
+    before.insert(chunk.get());
+  for(auto &&chunk: snapshot->chunks)
+    after.insert(chunk.get());
+  vector<const TFigureChunk*> leavingChunks, enteringChunks;
+  std::unordered_set<const TFigure*> leaving, entering;
+  for(auto &&chunk: current->chunks) {
+    if (after.count(chunk.get()))
+      continue;
+    leavingChunks.push_back(chunk.get());
+    for(auto &&node: chunk->nodes)
+      leaving.insert(node->figure);
+  }
+  for(auto &&chunk: snapshot->chunks) {
+    if (before.count(chunk.get()))
+      continue;
+    enteringChunks.push_back(chunk.get());
+    for(auto &&node: chunk->nodes)
+      entering.insert(node->figure);
+  }
+
+  for(auto &&figure: leaving) {
+    if (!entering.count(figure))
+      nodes.erase(figure);
+  }
+  for(auto &&chunk: enteringChunks) {
+    for(auto &&node: chunk->nodes) {
+      nodes[node->figure] = node;
+      node->chunk = chunk;
+    }
+  }
+  storage.clear();
+  chunks.clear();
+  for(auto &&chunk: snapshot->chunks) {
+    for(auto &&node: chunk->nodes)
+      storage.push_back(node->figure);
+    chunks.push_back(TChunkSlot { chunk, chunk.get(), chunk->nodes.size() });
+  }
+  cachedSnapshot = snapshot;
+  boundsValid = false;
+
+  // figures modified since the snapshot was taken are replaced by their clones
+  std::map<const TFigure*, const TFigure*> replaced;
+  for(auto &&chunk: enteringChunks) {
+    for(auto &&node: chunk->nodes) {
+      if (node->origin && leaving.count(node->origin) && !entering.count(node->origin))
+        replaced[node->origin] = node->figure;
+    }
+  }
+  for(auto &&chunk: leavingChunks) {
+    for(auto &&node: chunk->nodes) {
+      if (node->origin && entering.count(node->origin) && !leaving.count(node->origin))
+        replaced[node->figure] = node->origin;
+    }
+  }
+  for(auto &&r: replaced) {
+    auto relation = TFigureEditor::relatedTo.find(r.first);
+    if (relation==TFigureEditor::relatedTo.end())
+      continue;
+    TFigureEditEvent ee;
+    ee.model = this;
+    ee.type = TFigureEditEvent::RELATION_REPLACED;
+    ee.data.relationReplaced.oldRelation = const_cast<TFigure*>(r.first);
+    ee.data.relationReplaced.newRelation = const_cast<TFigure*>(r.second);
+    for(auto &&relatedFigure: relation->second)
+      const_cast<TFigure*>(relatedFigure)->editEvent(ee);
+    auto related = std::move(relation->second);
+    TFigureEditor::relatedTo.erase(relation);
+    TFigureEditor::relatedTo[r.second] = std::move(related);
+  }
+  if (!replaced.empty()) {
+    for(auto &&relation: TFigureEditor::relatedTo) {
+      for(auto &&r: replaced) {
+        if (relation.second.erase(r.first))
+          relation.second.insert(r.second);
+      }
+    }
+  }
+
+  figures.clear();
+  figures.insert(storage.begin(), storage.end());
+  type = RESTORED;
+  sigChanged();
+}
+
+/**
+ * Register a snapshot undo object and prepare the figures in 'modified'
+ * for being modified.
+ *
+ * \return
+ *   false when snapshot undo mode is disabled and the caller has to
+ *   register it's own undo object.
+ */
+bool
+TFigureModel::checkpoint(const TFigureSet *modified)
+{
+  if (!snapshotUndo)
+    return false;
+  TUndoManager::registerUndo(this, new TUndoSnapshot(this, snapshot()));
+  cachedSnapshot.reset();
+  if (modified) {
+    for(auto &&figure: *modified)
+      fork(figure);
+  }
+  return true;
+}
+
+/**
+ * Move the current state of 'figure' into a clone owned by the snapshots
+ * sharing it, so that the live figure can be modified.
+ */
+void
+TFigureModel::fork(TFigure *figure)
+{
+  auto p = nodes.find(figure);
+  if (p==nodes.end() || p->second.use_count()==1)
+    return;
+  // the next snapshot needs a chunk with the figure's new node
+  for(auto &&slot: chunks) {
+    if (slot.address == p->second->chunk) {
+      slot.chunk.reset();
+      slot.address = nullptr;
+      break;
+    }
+  }
+  p->second->figure = static_cast<TFigure*>(figure->clone());
+  p->second->origin = figure;
+  p->second = std::make_shared<TFigureNode>(figure);
+}
+
+/**
+ * The figure is going to be owned by someone else than the model.
+ */
+void
+TFigureModel::detach(TFigure *figure)
+{
+  auto p = nodes.find(figure);
+  if (p==nodes.end())
+    return;
+  if (p->second.use_count()==1) {
+    p->second->figure = nullptr;
+  } else {
+    p->second->figure = static_cast<TFigure*>(figure->clone());
+    p->second->origin = figure;
+  }
+  nodes.erase(p);
+}
+
+/**
+ * Delete a figure owned by the model unless a snapshot still refers to it.
+ */
+void
+TFigureModel::dispose(TFigure *figure)
+{
+  auto p = nodes.find(figure);
+  if (p==nodes.end()) {
+    delete figure;
+    return;
+  }
+  nodes.erase(p);
 }
 
 void
@@ -1008,6 +1986,8 @@ TFigureModel::restore(TInObjectStream &in)
         }
 //        cerr << "adding new gadget to TFigureModel " << this << endl;
         storage.push_back(g);
+        edited(storage.size()-1, 0, 1);
+        boundsValid = false;
 //        cerr << "new storage size is " << storage.size() << endl;
         in.setInterpreter(s);
         return true;
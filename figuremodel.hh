@@ -23,7 +23,13 @@
 
 #include <vector>
 #include <set>
+#include <atomic>
+#include <iterator>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include <toad/model.hh>
+#include <toad/types.hh>
 #include <toad/io/serializable.hh>
 
 namespace toad {
@@ -35,20 +41,142 @@ class TFPerspectiveTransform;
 
 /**
  * \ingroup figure
+ *
+ * Dense ids for all existing figures, which are recycled after a figure
+ * was deleted.
  */
-class TFigureSet:
-  public set<TFigure*>
+class TFigureIds
 {
   public:
-    bool contains(TFigure *figure) {
-      return find(figure) != end();
+    static unsigned acquire(TFigure *figure);
+    static void release(unsigned id);
+    // keep the id of a figure about to be deleted for the figure replacing
+    // it, ie. one read back from the undo spill file, so that sets with the
+    // id refer to the replacement
+    static void reserve(unsigned id);
+    static void assign(TFigure *figure, unsigned id);
+    static void unreserve(unsigned id);
+    static TFigure* const & get(unsigned id) {
+      return blocks[id / BLOCK].load(std::memory_order_acquire)[id % BLOCK];
+    }
+  private:
+    friend class TFigureSet;
+    // the figures are stored in blocks, which never move, behind an index
+    // of fixed size, so that get() needs no lock while acquire() adds
+    // blocks on another thread. they're never deleted because static
+    // figures might outlive them
+    static const unsigned BLOCK = 4096;
+    static std::atomic<TFigure**> blocks[16384];
+
+    // release() counts the releases and stamps the id with the count, so
+    // that sets can tell ids which were released after they were updated
+    static std::atomic<uint64_t> releases;
+    static std::atomic<std::atomic<uint64_t>*> releasedAt[16384];
+    static uint64_t released(unsigned id) {
+      return releasedAt[id / BLOCK].load(std::memory_order_acquire)[id % BLOCK].load(std::memory_order_relaxed);
     }
 };
+
+/**
+ * \ingroup figure
+ *
+ * A set of figures with an interface similar to std::set<TFigure*>.
+ *
+ * It is stored as bitset over the figures' ids, so that membership tests
+ * are O(1) and iterating, copying and clearing are linear passes over
+ * a contiguous block of memory. Iteration is in id order, not in the
+ * order of the figures' addresses as with std::set<TFigure*>.
+ *
+ * Ids are recycled, hence a deleted figure must not be found in any set,
+ * as they'd otherwise contain the next figure getting its id. Instead of
+ * changing all sets, each set remembers the number of releases when it
+ * was last modified and ignores the ids released after that, until the
+ * next modification drops them.
+ */
+class TFigureSet
+{
+    typedef uint64_t TWord;
+    static const unsigned BITS = 64;
+    static const size_t END = ~size_t(0);
+    std::vector<TWord> bits;
+    size_t n;
+    uint64_t releases;   // TFigureIds::releases when 'bits' was updated
+
+    bool fresh() const {
+      return releases == TFigureIds::releases.load(std::memory_order_acquire);
+    }
+    TWord word(size_t i) const;
+    void update();
+
+    size_t next(size_t id) const;
+
+  public:
+    typedef TFigure* key_type;
+    typedef TFigure* value_type;
+    typedef size_t size_type;
+
+    class const_iterator
+    {
+        friend class TFigureSet;
+        const TFigureSet *set;
+        size_t id;
+        const_iterator(const TFigureSet *set, size_t id): set(set), id(id) {}
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef TFigure* value_type;
+        typedef ptrdiff_t difference_type;
+        typedef TFigure* const * pointer;
+        typedef TFigure* const & reference;
+
+        const_iterator(): set(nullptr), id(0) {}
+        reference operator*() const { return TFigureIds::get(id); }
+        pointer operator->() const { return &TFigureIds::get(id); }
+        const_iterator& operator++() { id = set->next(id+1); return *this; }
+        const_iterator operator++(int) { const_iterator i(*this); ++*this; return i; }
+        bool operator==(const const_iterator &i) const { return id == i.id; }
+        bool operator!=(const const_iterator &i) const { return id != i.id; }
+    };
+    typedef const_iterator iterator;
+
+    TFigureSet(): n(0), releases(TFigureIds::releases.load(std::memory_order_acquire)) {}
+    template <class I>
+    TFigureSet(I first, I last): TFigureSet() { insert(first, last); }
+
+    const_iterator begin() const { return const_iterator(this, next(0)); }
+    const_iterator end() const { return const_iterator(this, END); }
+
+    size_type size() const;
+    bool empty() const { return size()==0; }
+    void clear();
+    void swap(TFigureSet &set) {
+      bits.swap(set.bits);
+      std::swap(n, set.n);
+      std::swap(releases, set.releases);
+    }
+
+    bool contains(const TFigure *figure) const;
+    size_type count(const TFigure *figure) const { return contains(figure) ? 1 : 0; }
+    const_iterator find(const TFigure *figure) const;
+
+    std::pair<iterator, bool> insert(TFigure *figure);
+    template <class I>
+    void insert(I first, I last) {
+      for(; first!=last; ++first)
+        insert(*first);
+    }
+
+    size_type erase(const TFigure *figure);
+    iterator erase(const_iterator p);
+
+    bool operator==(const TFigureSet &set) const;
+    bool operator!=(const TFigureSet &set) const { return !(*this == set); }
+};
   
 typedef vector<TFigure*> TFigureVector;
 
 class TFigureAtDepthList;
 class TFigureAttributeModel;
+class TFigureModelSnapshot;
 
 /**
  * \ingroup figure
@@ -57,6 +185,7 @@ class TFigureModel:
   public TModel, public TSerializable
 {
 //    friend class TFigureWindow; // debugging
+    friend class TFigureModelSnapshot;
   protected:
     typedef std::vector<TFigure*> TStorage;
   public:
@@ -80,6 +209,7 @@ class TFigureModel:
            GROUP, UNGROUP,
            TRANSLATE,
            ROTATE,
+           RESTORED,  // after all figures were replaced by a snapshot
            _UNDO_GROUP
     } type;
     //! additional information for type attribute FIXME: move to TFigureEditEvent?
@@ -134,17 +264,62 @@ class TFigureModel:
     void pureErase(TFigureSet&, TFigureAtDepthList *placement);
     void pureInsert(const TFigureAtDepthList &placement);
 
+    // bounds of all figures, calculated again after the model was modified
+    const TBoundary& bounds() const;
+    const TBoundary& editBounds() const;
+    //! to be called after a figure was modified without using the model
+    void invalidateBounds();
+    //! counts the figures modified without using a model, so that groups
+    //! and transforms containing them calculate their bounds again
+    static unsigned getDirectEdits() { return directEdits.load(std::memory_order_relaxed); }
+    //! to be called before a figure is modified without using the model
+    void modify(TFigure *figure);
+
     //! remove and delete all figures
     void clear();
 
     //! remove all figures but don't delete them
-    void drop() {
-      storage.clear();
-    }
+    void drop();
+
+    // copy-on-write snapshots as an alternative to the TUndo classes
+    typedef std::shared_ptr<const TFigureModelSnapshot> PSnapshot;
+    void setSnapshotUndo(bool enable);
+    bool isSnapshotUndo() const { return snapshotUndo; }
+    PSnapshot snapshot();
+    void restoreSnapshot(const PSnapshot &snapshot);
 
     SERIALIZABLE_INTERFACE_PUBLIC(toad::, TFigureModel)
   protected:
     TStorage storage;
+
+    mutable bool boundsValid;
+    mutable unsigned boundsEdits;  // getDirectEdits() for the cached bounds
+    mutable TBoundary cachedBounds, cachedEditBounds;
+    void calcBounds() const;
+    static std::atomic<unsigned> directEdits;
+
+    struct TFigureNode;
+    typedef std::shared_ptr<TFigureNode> PFigureNode;
+    struct TFigureChunk;
+    typedef std::shared_ptr<const TFigureChunk> PFigureChunk;
+    bool snapshotUndo;
+    std::unordered_map<const TFigure*, PFigureNode> nodes;
+    PSnapshot cachedSnapshot;
+
+    // 'storage' split into runs of figures, each being a chunk shared with
+    // the snapshots or expired when it was modified since the last snapshot
+    struct TChunkSlot {
+      std::weak_ptr<const TFigureChunk> chunk;
+      const TFigureChunk *address;
+      size_t size;
+    };
+    std::vector<TChunkSlot> chunks;
+
+    bool checkpoint(const TFigureSet *modified=nullptr);
+    void edited(size_t at, size_t erased, size_t inserted);
+    void fork(TFigure *figure);
+    void detach(TFigure *figure);
+    void dispose(TFigure *figure);
 };
 
 /**
@@ -0,0 +1,383 @@
+/*
+ * Fischland -- A 2D vector graphics editor
+ * Copyright (C) 1999-2005 by Mark-André Hopf <mhopf@mark13.org>
+ * Visit http://www.mark13.org/fischland/.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "page.hh"
+#include "journal.hh"
+
+#include <toad/figureeditor.hh>
+#include <stdio.h>
+
+using namespace fischland;
+
+static char*
+number()
+{
+  static unsigned counter = 0;
+  counter++;
+  static char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%u", counter);
+  return buffer;
+}
+  
+TPlainSlide::TPlainSlide()
+{
+  name = "unnamed #";
+  name += number();
+  lock = false;
+  show = true;
+  print = true;
+}
+
+namespace {
+
+void
+updateSlides(TSlide *slide)
+{
+  for(; slide; slide = slide->next) {
+    slide->content.update(false);
+    updateSlides(slide->down);
+  }
+}
+
+// put a layer restored on its own in the place of its placeholder
+bool
+replaceLayer(TSlide *slide, TLayer *placeholder, TLayer *layer)
+{
+  for(; slide; slide = slide->next) {
+    TLayer *previous = nullptr;
+    for(TLayer *p = slide->content.getRoot(); p; previous = p, p = p->next) {
+      if (p != placeholder)
+        continue;
+      if (previous)
+        previous->next = layer;
+      else
+        slide->content.setRoot(layer);
+      layer->next = placeholder->next;
+      return true;
+    }
+    if (replaceLayer(slide->down, placeholder, layer))
+      return true;
+  }
+  return false;
+}
+
+// tell the placeholders of the layers not restored yet about the loader,
+// which has to forget them when they're deleted along with their slide
+void
+watchPlaceholders(TSlide *slide, const shared_ptr<TLazyLoader> &loader)
+{
+  for(; slide; slide = slide->next) {
+    for(TLayer *p = slide->content.getRoot(); p; p = p->next) {
+      if (loader->isPending(p))
+        p->loader = loader;
+    }
+    watchPlaceholders(slide->down, loader);
+  }
+}
+
+} // namespace
+
+/**
+ * Restore a document from 'text' without the layers, except for those
+ * connected with the rest of the document. The others are restored by
+ * load() when their slide is shown.
+ *
+ * \return the document, or NULL when 'text' isn't a document or couldn't
+ *         be restored
+ */
+TDocument*
+TDocument::restoreLazy(const string &text)
+{
+  auto loader = make_shared<TLazyLoader>();
+  TLazyLoader *l = loader.get();
+  TSerializable *s = loader->restore(text, "fischland::TLayer", [l](TSerializable *placeholder, TSerializable *layer) {
+    TDocument *document = dynamic_cast<TDocument*>(l->obj);
+    if (document &&
+        replaceLayer(document->content.getRoot(),
+                     static_cast<TLayer*>(placeholder),
+                     static_cast<TLayer*>(layer)))
+    {
+      delete placeholder;
+    } else {
+      // a layer outside of a document's slides, which TDocument::store
+      // doesn't write
+      delete layer;
+    }
+  });
+  TDocument *document = dynamic_cast<TDocument*>(s);
+  if (!document) {
+    delete s;
+    TFigureEditor::discardRelations();
+    return nullptr;
+  }
+  TFigureEditor::restoreRelations();
+  updateSlides(document->content.getRoot());
+  if (loader->getPending()) {
+    watchPlaceholders(document->content.getRoot(), loader);
+    document->loader = loader;
+  }
+  return document;
+}
+
+/**
+ * Restore the layers of a slide left out by restoreLazy(), along with the
+ * layers of other slides they're connected with.
+ */
+bool
+TDocument::load(TSlide *slide)
+{
+  if (!loader)
+    return true;
+  bool result = true;
+  while(true) {
+    TLayer *layer = slide->content.getRoot();
+    while(layer && !loader->isPending(layer))
+      layer = layer->next;
+    if (!layer)
+      break;
+    if (!loader->load(layer)) {
+      TFigureEditor::discardRelations();
+      result = false;
+      break;
+    }
+    TFigureEditor::restoreRelations();
+  }
+  updateSlides(content.getRoot());
+  if (journal)
+    journal->track();
+  if (!loader->getPending())
+    loader.reset();
+  return result;
+}
+
+/**
+ * Restore the first layer left out by restoreLazy(), ie. while the
+ * application is idle.
+ *
+ * \return 'false' when there are no layers left or one couldn't be restored
+ */
+bool
+TDocument::loadNext()
+{
+  if (!loader)
+    return false;
+  if (!loader->loadNext()) {
+    TFigureEditor::discardRelations();
+    return false;
+  }
+  TFigureEditor::restoreRelations();
+  updateSlides(content.getRoot());
+  if (journal)
+    journal->track();
+  if (!loader->getPending()) {
+    loader.reset();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Restore all layers left out by restoreLazy(), ie. before the document is
+ * saved or printed.
+ */
+bool
+TDocument::loadAll()
+{
+  if (!loader)
+    return true;
+  if (loader->loadAll()) {
+    TFigureEditor::restoreRelations();
+  } else {
+    // some relations may belong to the figures which failed, and were
+    // deleted
+    TFigureEditor::discardRelations();
+  }
+  updateSlides(content.getRoot());
+  if (journal)
+    journal->track();
+  if (loader->getPending())
+    return false;
+  loader.reset();
+  return true;
+}
+
+void
+TDocument::store(TOutObjectStream &out) const
+{
+  ::store(out, "author", author);
+  ::store(out, "date", date);
+  ::store(out, "description", description);
+
+  for(TSlide *slide = content.getRoot();
+      slide;
+      slide = slide->next)
+  {
+//cout << "document stores slide " << slide->name << endl;
+    out.store(slide);
+  }
+}
+
+bool
+TDocument::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP && in.type == "fischland::TSlide") {
+    TSlide *slide = new TSlide();
+    // content.push_back(slide);
+    TSlide *p = content.getRoot();
+    if (!p) {
+      content.setRoot(slide);
+    } else {
+      while(p->next)
+        p = p->next;
+      p->next = slide;
+    }
+    in.setInterpreter(slide);
+    return true;
+  }
+  if (in.what == ATV_FINISHED) {
+    content.update(false);
+  }
+  if (
+    ::restore(in, "author", &author) ||
+    ::restore(in, "date", &date) ||
+    ::restore(in, "description", &description) ||
+    TSerializable::restore(in)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+void
+TSlide::store(TOutObjectStream &out) const
+{
+//cout << "slide " << name << " stores itself" << endl;
+  ::store(out, "name",    name);
+  ::store(out, "comment", comment);
+  ::store(out, "lock",    lock);
+  ::store(out, "show",    show);
+  ::store(out, "print",   print);
+
+  for(TLayer *layer = content.getRoot();
+      layer;
+      layer = layer->next)
+  {
+//cout << "slide " << name << " stores layer " << layer->name << endl;
+    out.store(layer);
+  }
+  
+  for(TSlide *slide = down;
+      slide;
+      slide = slide->next)
+  {
+//cout << "slide " << name << " stores down slide " << slide->name << endl;
+    out.store(slide);
+  }
+}
+
+bool
+TSlide::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP && in.type == "fischland::TLayer") {
+    TLayer *layer = new TLayer();
+    // content.push_back(slide);
+    TLayer *p = content.getRoot();
+    if (!p) {
+      content.setRoot(layer);
+    } else {
+      while(p->next)
+        p = p->next;
+      p->next = layer;
+    }
+    in.setInterpreter(layer);
+    return true;
+  }
+  if (in.what == ATV_GROUP && in.type == "fischland::TSlide") {
+    TSlide *slide = new TSlide();
+    // content.push_back(slide);
+    if (!down) {
+      down = slide;
+    } else {
+      TSlide *p = down;
+      while(p->next) {
+        p = p->next;
+      }
+      p->next = slide;
+    }
+    in.setInterpreter(slide);
+    return true;
+  }
+  if (in.what == ATV_FINISHED) {
+    content.update(false);
+  }
+  if (
+    ::restore(in, "name",    &name) ||
+    ::restore(in, "comment", &comment) ||
+    ::restore(in, "lock",    &lock) ||
+    ::restore(in, "show",    &show) ||
+    ::restore(in, "print",   &print) ||
+    TSerializable::restore(in)
+  ) return true;
+
+  ATV_FAILED(in)
+  return false;
+}
+
+TLayer::~TLayer()
+{
+  // the loader mustn't take a layer created at this address for us
+  if (auto l = loader.lock())
+    l->forget(this);
+}
+
+void
+TLayer::store(TOutObjectStream &out) const
+{
+//cout << "layer " << name << " stores itself" << endl;
+  ::store(out, "name",    name);
+  ::store(out, "comment", comment);
+  ::store(out, "lock",    lock);
+  ::store(out, "show",    show);
+  ::store(out, "print",   print);
+
+  content.store(out);
+
+  for(TLayer *layer = down;
+      layer;
+      layer = layer->next)
+  {
+    out.store(layer);
+  }
+}
+
+bool
+TLayer::restore(TInObjectStream &in)
+{
+  if (
+    content.restore(in) ||
+    ::restore(in, "name",    &name) ||
+    ::restore(in, "comment", &comment) ||
+    ::restore(in, "lock",    &lock) ||
+    ::restore(in, "show",    &show) ||
+    ::restore(in, "print",   &print) ||
+    TSerializable::restore(in)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
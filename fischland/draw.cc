@@ -24,6 +24,7 @@
 #include "colorpalette.hh"
 #include "lineal.hh"
 #include "page.hh"
+#include "journal.hh"
 #include "config.h"
 
 #ifdef HAVE_LIBCAIRO
@@ -52,8 +53,11 @@
 #include <toad/popupmenu.hh>
 #include <toad/messagebox.hh>
 #include <toad/springlayout.hh>
+#include <toad/simpletimer.hh>
 
 #include <fstream>
+#include <sstream>
+#include <iterator>
 #include <vector>
 #include <stdlib.h>
 #include <time.h>
@@ -73,6 +77,13 @@ string datadir("/usr/local/share");
 string resourcename("fischland");
 string version("snapshot");
 
+// restore the slides of a document while idle instead of when they're shown
+bool loadInBackground = false;
+
+// save the changes to a journal next to the file instead of writing all of
+// it again, and autosave them there
+bool useJournal = false;
+
 /**
  * 
  *
@@ -233,6 +244,27 @@ TCollection::restore(TInObjectStream &in)
   return false;
 }
 
+class TMainWindow;
+
+// restores the layers of the document one after the other, see
+// loadInBackground
+class TBackgroundLoader:
+  public TSimpleTimer
+{
+  public:
+    TMainWindow *window;
+    void tick() override;
+};
+
+// appends the changes to the journal every minute, see useJournal
+class TAutosave:
+  public TSimpleTimer
+{
+  public:
+    TMainWindow *window;
+    void tick() override;
+};
+
 class TMainWindow:
   public TWindow
 {
@@ -242,15 +274,20 @@ class TMainWindow:
     PEditModel editmodel;
     TFischEditor *editor;
     TSingleSelectionModel currentPage;
+    TBackgroundLoader background;
+    TAutosave autosave;
     
     bool _check();
     bool _save(const string &title);
+    bool _loadAll(const string &title);
+    bool _replay(TDocument *document, const string &filename, const string &text);
 
   public:
     TMainWindow(TWindow *parent, const string &title, TEditModel *m=0);
     ~TMainWindow();
     
     void load(const string &filename);
+    void saveJournal();
     
     void menuNew();
     void menuNewView();
@@ -554,6 +591,9 @@ TMainWindow::_check()
         return false;
     } else if (r!=TMessageBox::NO) {
       return false;
+    } else if (editmodel->document && editmodel->document->journal) {
+      // drop the changes autosaved since
+      editmodel->document->journal->discard();
     }
   }
   return true;
@@ -586,23 +626,33 @@ void
 TMainWindow::load(const string &filename)
 {    
   ifstream fin(filename.c_str());
-  TInObjectStream in(&fin);
+  string text((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+  istringstream sin;
+  TInObjectStream in(&sin);
 //  in.setVerbose(true);
 //  in.setDebug(true);
 
-  TSerializable *s = in.restore();
-  if (!in || !s) {
-    string msg =
-      programname + " failed to load '" + filename + "'\n\n" +
-      in.getErrorText();
-      messageBox(0, 
-               "Failed to load file",
-               msg,
-               TMessageBox::ICON_STOP | TMessageBox::OK);
-    return;
+  // the layers' figures are the bulk of a document, restore them when their
+  // slide is shown
+  TSerializable *s = TDocument::restoreLazy(text);
+  if (!s) {
+    // ie. a file from before TDocument
+    TFigureEditor::discardRelations();
+    sin.str(text);
+    s = in.restore();
+    if (!in || !s) {
+      string msg =
+        programname + " failed to load '" + filename + "'\n\n" +
+        in.getErrorText();
+        messageBox(0, 
+                 "Failed to load file",
+                 msg,
+                 TMessageBox::ICON_STOP | TMessageBox::OK);
+      return;
+    }
+    in.close();
+    TFigureEditor::restoreRelations(); // FIXME: TFigureEditor should be able to register this in TInObjectStream
   }
-  in.close();
-  TFigureEditor::restoreRelations(); // FIXME: TFigureEditor should be able to register this in TInObjectStream
 
   TFigureModel *figuremodel;
   TCollection *collection;
@@ -652,8 +702,12 @@ TMainWindow::load(const string &filename)
   document = dynamic_cast<TDocument*>(s);
   if (document) {
     cout << "found document!" << endl;
+    bool recovered = useJournal && _replay(document, filename, text);
     editmodel->setDocument(document);
-    editor->clearFischModified();
+    if (!recovered)
+      editor->clearFischModified();
+    if (loadInBackground && document->loader)
+      background.startTimer(0, 50000);
     goto done;
   }
 
@@ -673,6 +727,48 @@ done:
   setTitle(programname+ ": " + basename((char*)filename.c_str()));
 }
 
+/**
+ * Apply the changes saved in the journal of the file, see TJournal.
+ *
+ * \return 'true' when the document differs from the saved one, ie. after
+ *         changes which weren't saved were recovered
+ */
+bool
+TMainWindow::_replay(TDocument *document, const string &filename, const string &text)
+{
+  auto journal = make_shared<TJournal>(document);
+  if (!journal->read(filename, text)) {
+    messageBox(NULL,
+               "Failed to load journal",
+               "The changes saved in the journal of '" + filename + "' are lost:\n\n" +
+               journal->getErrorText(),
+               TMessageBox::ICON_EXCLAMATION | TMessageBox::OK);
+    return false;
+  }
+  bool unsaved = false;
+  if (journal->getUnsaved()) {
+    unsigned r = messageBox(NULL,
+      "Recover changes",
+      "'" + filename + "' has changes which weren't saved, ie. because " +
+      programname + " crashed.\n\n"
+      "Do you want to recover them?",
+      TMessageBox::ICON_QUESTION |
+      TMessageBox::YES | TMessageBox::NO );
+    unsaved = r==TMessageBox::YES;
+  }
+  if (!journal->replay(unsaved)) {
+    messageBox(NULL,
+               "Failed to load journal",
+               "Parts of the changes saved in the journal of '" + filename +
+               "' failed to load, the document may be incomplete:\n\n" +
+               journal->getErrorText(),
+               TMessageBox::ICON_EXCLAMATION | TMessageBox::OK);
+    return true;
+  }
+  document->journal = journal;
+  return unsaved;
+}
+
 void
 TMainWindow::setEditModel(TEditModel *e)
 {
@@ -718,9 +814,69 @@ TMainWindow::menuSaveAs()
   return false;
 }
 
+void
+TBackgroundLoader::tick()
+{
+  TDocument *document = window->getEditModel()->document;
+  if (!document || !document->loadNext())
+    stopTimer();
+}
+
+void
+TAutosave::tick()
+{
+  window->saveJournal();
+}
+
+/**
+ * Append the changes to the journal without marking the document as
+ * saved, so that they can be recovered after a crash.
+ */
+void
+TMainWindow::saveJournal()
+{
+  TDocument *document = editmodel->document;
+  // changes the journal can't express, and those which would make it too
+  // large, are left to the next save
+  if (document && document->journal && document->journal->isChanged())
+    document->journal->append(false);
+}
+
+/**
+ * Restore the layers of the document which weren't restored yet, see
+ * TDocument::restoreLazy().
+ */
+bool
+TMainWindow::_loadAll(const string &title)
+{
+  TDocument *document = editmodel->document;
+  if (!document || document->loadAll())
+    return true;
+  messageBox(NULL,
+             title,
+             "Parts of the document failed to load:\n\n" +
+             document->loader->getErrorText(),
+             TMessageBox::ICON_EXCLAMATION | TMessageBox::OK);
+  return false;
+}
+
 bool
 TMainWindow::_save(const string &title)
 {
+  TDocument *document = editmodel->document;
+  // after small changes appending them to the journal takes a fraction of
+  // the time needed to write the whole document
+  if (useJournal &&
+      document && document->journal &&
+      document->journal->getFilename()==filename &&
+      document->journal->append(true))
+  {
+    editor->clearFischModified();
+    return true;
+  }
+
+  if (!_loadAll(title))
+    return false;
   ofstream out(filename.c_str());
   if (!out) {
     messageBox(NULL,
@@ -729,10 +885,20 @@ TMainWindow::_save(const string &title)
                TMessageBox::ICON_EXCLAMATION | TMessageBox::OK);
     return false;
   }
-  out << "// fish -- a Fischland 2D Vector Graphics file" << endl
-      << "// Please see http://www.mark13.org/fischland/ for more details." << endl;
-  TOutObjectStream oout(&out);
-  oout.store(editmodel->document);
+  ostringstream text;
+  text << "// fish -- a Fischland 2D Vector Graphics file" << endl
+       << "// Please see http://www.mark13.org/fischland/ for more details." << endl;
+  {
+    TOutObjectStream oout(&text);
+    oout.store(document);
+  }
+  out << text.str();
+  if (useJournal && document) {
+    // the journal's entries apply to this version of the file
+    if (!document->journal)
+      document->journal = make_shared<TJournal>(document);
+    document->journal->snapshot(filename, text.str());
+  }
   editor->clearFischModified();
   return true;
 }
@@ -804,6 +970,8 @@ void
 TMainWindow::menuPrint2Clipboard()
 {
   // either selection or current page?
+  if (!_loadAll("Print"))
+    return;
   TPen pen;
 cout << "initClipboard" << endl;
   pen.initClipboard(boundsOfSlide(editmodel->document->content.getRoot()));
@@ -824,6 +992,8 @@ cout << "inited ClipBoad" << endl;
 void
 TMainWindow::menuPrint()
 {
+  if (!_loadAll("Print"))
+    return;
   TPen pen("output.pdf"/*, boundsOfSlide(editmodel->document->content.getRoot())*/);
   // all pages
   printSlide(pen, editmodel->document->content.getRoot());
@@ -945,6 +1115,10 @@ TMainWindow::editorModified()
 TMainWindow::TMainWindow(TWindow *p, const string &t, TEditModel *e):
   super(p, t)
 {
+  background.window = this;
+  autosave.window = this;
+  if (useJournal)
+    autosave.startTimer(60, 0, true);
   new TUndoManager(this, "undomanager");
 
   TFischEditor *me = new TFischEditor(this, "figureeditor");
@@ -1253,6 +1427,13 @@ main(int argc, char **argv, char **envv)
     }
   }
 
+  for(int i=1; i<argc; ++i) {
+    if (strcmp(argv[i], "--load-in-background")==0)
+      loadInBackground = true;
+    if (strcmp(argv[i], "--journal")==0)
+      useJournal = true;
+  }
+
   toad::initialize(argc, argv);
 
 //    createMemoryFiles();
@@ -1262,6 +1443,8 @@ main(int argc, char **argv, char **envv)
   toad::getDefaultStore().registerObject(new TDocument());
   toad::getDefaultStore().registerObject(new TSlide());
   toad::getDefaultStore().registerObject(new TLayer());
+  toad::getDefaultStore().registerObject(new TJournalEntry());
+  toad::getDefaultStore().registerObject(new TJournalSplice());
 
   bmp_vlogo = new TBitmap();
   bmp_vlogo->load(RESOURCE("logo_vertical.jpg"));
@@ -0,0 +1,478 @@
+/*
+ * Fischland -- A 2D vector graphics editor
+ * Copyright (C) 1999-2017 by Mark-André Hopf <mhopf@mark13.org>
+ * Visit http://www.mark13.org/fischland/.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "filltool.hh"
+#include <toad/geometry.hh>
+#include <unordered_set>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+using namespace fischland;
+
+// bezierIntersection() treats end points closer than this as touching,
+// the arrangement uses the same distance to merge vertices
+static const TCoord mergeDistance = 1.0;
+
+// the component of a path which wasn't assigned to one yet
+static const size_t NO_COMPONENT = static_cast<size_t>(-1);
+
+static TPoint
+evaluate(const TPolygon &polygon, TCoord u)
+{
+  size_t i = 0;
+  while(u>1.0 && i+6<polygon.size()) {
+    u-=1.0;
+    i+=3;
+  }
+  TCoord mu = 1.0 - u;
+  TCoord b0 = mu * mu * mu;
+  TCoord b1 = 3.0 * mu * mu * u;
+  TCoord b2 = 3.0 * mu * u * u;
+  TCoord b3 = u * u * u;
+  return TPoint(polygon[i  ].x * b0 + polygon[i+1].x * b1 + polygon[i+2].x * b2 + polygon[i+3].x * b3,
+                polygon[i  ].y * b0 + polygon[i+1].y * b1 + polygon[i+2].y * b2 + polygon[i+3].y * b3);
+}
+
+static bool
+isInside(const vector<TPoint> &polygon, TCoord x, TCoord y)
+{
+  bool inside = false;
+  for(size_t i=0, j=polygon.size()-1; i<polygon.size(); j=i++) {
+    if ((polygon[i].y > y) != (polygon[j].y > y) &&
+        x < (polygon[j].x - polygon[i].x) * (y - polygon[i].y) / (polygon[j].y - polygon[i].y) + polygon[i].x)
+      inside = !inside;
+  }
+  return inside;
+}
+
+TFillArrangement::TFillArrangement():
+  dirty(true)
+{
+}
+
+void
+TFillArrangement::clear()
+{
+  paths.clear();
+  entries.clear();
+  known.clear();
+  components.clear();
+}
+
+void
+TFillArrangement::modelChanged(bool newmodel)
+{
+  if (newmodel) {
+    clear();
+  } else {
+    switch(model->type) {
+      case TFigureModel::MODIFY:
+      case TFigureModel::MODIFIED:
+      case TFigureModel::TRANSLATE:
+      case TFigureModel::ROTATE:
+        for(auto &&figure: model->figures)
+          known.erase(figure);
+        break;
+      default:
+        ;
+    }
+  }
+  dirty = true;
+  stopTimer();
+  if (model)
+    startTimer(1, 0, true);
+}
+
+void
+TFillArrangement::tick()
+{
+  stopTimer();
+  update();
+}
+
+/**
+ * Bring the arrangement up to date with the model.
+ */
+void
+TFillArrangement::update()
+{
+  if (!dirty)
+    return;
+  dirty = false;
+  stopTimer();
+  if (!model) {
+    clear();
+    return;
+  }
+
+  paths.clear();
+  TFigureSet live;
+  vector<const TFPath*> modified;
+  for(auto &&figure: *model) {
+    const TFPath *path = dynamic_cast<const TFPath*>(figure);
+    if (!path)
+      continue;
+    // filling next to already filled areas failes sometimes, so we
+    // do not do this until the real issue is fixed
+    if (path->isFilled())
+      continue;
+    if (path->pointCount()<4)
+      continue;
+    paths.push_back(path);
+    live.insert(figure);
+    if (!known.contains(path))
+      modified.push_back(path);
+  }
+
+  // paths which are gone or were modified lose their intersections, also
+  // on the paths they intersected with, and their components are split
+  // into faces again
+  vector<bool> rebuild(components.size());
+  vector<unsigned> invalid;
+  for(auto &&entry: entries) {
+    TFigure *figure = TFigureIds::get(entry.first);
+    if (!known.contains(figure) || !live.contains(figure)) {
+      invalid.push_back(entry.first);
+      // a figure returning to the model, ie. by undo, counts as new
+      known.erase(figure);
+    }
+  }
+  for(auto &&id: invalid) {
+    const TPathEntry &entry = entries[id];
+    if (entry.component != NO_COMPONENT)
+      rebuild[entry.component] = true;
+    for(auto &&cut: entry.cuts) {
+      auto other = entries.find(cut.other);
+      if (other == entries.end() || other->first == id)
+        continue;
+      auto &cuts = other->second.cuts;
+      cuts.erase(remove_if(cuts.begin(), cuts.end(), [&](const TCut &cut) {
+        return cut.other == id;
+      }), cuts.end());
+      if (other->second.component != NO_COMPONENT)
+        rebuild[other->second.component] = true;
+    }
+  }
+  for(auto &&id: invalid)
+    entries.erase(id);
+  if (modified.empty() && invalid.empty())
+    return;
+
+  for(auto &&path: modified) {
+    known.insert(const_cast<TFPath*>(path));
+    TPathEntry &entry = entries[path->getId()];
+    entry.path = path;
+    entry.cuts.clear();
+    entry.component = NO_COMPONENT;
+  }
+  intersect(modified);
+
+  // paths which got new intersections also change their components
+  for(auto &&path: modified) {
+    for(auto &&cut: entries[path->getId()].cuts) {
+      size_t c = entries[cut.other].component;
+      if (c != NO_COMPONENT)
+        rebuild[c] = true;
+    }
+  }
+
+  // keep the other components
+  vector<size_t> index(components.size(), NO_COMPONENT);
+  size_t n = 0;
+  for(size_t c=0; c<components.size(); ++c) {
+    if (rebuild[c])
+      continue;
+    index[c] = n;
+    if (n != c)
+      components[n] = std::move(components[c]);
+    ++n;
+  }
+  components.resize(n);
+  for(auto &&entry: entries) {
+    if (entry.second.component != NO_COMPONENT)
+      entry.second.component = index[entry.second.component];
+  }
+
+  // collect the paths connected by intersections into new components
+  for(auto &&path: paths) {
+    unsigned id = path->getId();
+    if (entries[id].component != NO_COMPONENT)
+      continue;
+    size_t c = components.size();
+    components.push_back(TComponent());
+    entries[id].component = c;
+    vector<unsigned> stack(1, id);
+    while(!stack.empty()) {
+      id = stack.back();
+      stack.pop_back();
+      components[c].paths.push_back(id);
+      for(auto &&cut: entries[id].cuts) {
+        TPathEntry &other = entries[cut.other];
+        if (other.component == NO_COMPONENT) {
+          other.component = c;
+          stack.push_back(cut.other);
+        }
+      }
+    }
+    buildFaces(&components[c]);
+  }
+}
+
+/**
+ * Intersect the modified paths with the paths near them.
+ */
+void
+TFillArrangement::intersect(const vector<const TFPath*> &modified)
+{
+  TPathIndex index(paths);
+  unordered_set<const TFPath*> done;
+  vector<const TFPath*> near;
+  for(auto &&path: modified) {
+    TPathEntry &a = entries[path->getId()];
+    index.nearPath(path, &near);
+    for(auto &&other: near) {
+      if (other == path || done.find(other) != done.end())
+        continue;
+      TPathEntry &b = entries[other->getId()];
+      IntersectionPointList list;
+      bezierIntersection(list, path, other);
+      for(auto &&q: list) {
+        a.cuts.push_back(TCut(q.a, other->getId()));
+        b.cuts.push_back(TCut(q.b, path->getId()));
+      }
+    }
+    done.insert(path);
+  }
+}
+
+/**
+ * Return the vertex of 'component' at 'p', which is created when there is
+ * none closer than 'mergeDistance'.
+ */
+size_t
+TFillArrangement::vertex(TComponent *component, const TPoint &p, unordered_map<uint64_t, vector<size_t>> *grid)
+{
+  auto key = [](int32_t x, int32_t y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+  };
+  vector<TPoint> &vertices = component->vertices;
+  int32_t cx = floor(p.x / mergeDistance);
+  int32_t cy = floor(p.y / mergeDistance);
+  for(int32_t y=cy-1; y<=cy+1; ++y) {
+    for(int32_t x=cx-1; x<=cx+1; ++x) {
+      auto cell = grid->find(key(x, y));
+      if (cell == grid->end())
+        continue;
+      for(auto &&v: cell->second) {
+        if (fabs(vertices[v].x - p.x) < mergeDistance && fabs(vertices[v].y - p.y) < mergeDistance)
+          return v;
+      }
+    }
+  }
+  vertices.push_back(p);
+  (*grid)[key(cx, cy)].push_back(vertices.size()-1);
+  return vertices.size()-1;
+}
+
+/**
+ * Split the paths of 'component' at their intersections into edges and
+ * collect the bounded faces by walking along the edges, always taking
+ * the leftmost turn.
+ */
+void
+TFillArrangement::buildFaces(TComponent *component)
+{
+  vector<TEdge> &edges = component->edges;
+  vector<TFace> &faces = component->faces;
+
+  unordered_map<uint64_t, vector<size_t>> grid;
+  TPolygon buffer;
+  for(auto &&id: component->paths) {
+    const TPathEntry &entry = entries[id];
+    const TPolygon &polygon = entry.path->points(buffer);
+    TCoord end = (polygon.size()-1)/3;
+    vector<TCoord> u;
+    u.push_back(0.0);
+    for(auto &&cut: entry.cuts)
+      u.push_back(min(max(cut.u, 0.0), end));
+    u.push_back(end);
+    sort(u.begin(), u.end());
+
+    for(size_t i=0; i+1<u.size(); ++i) {
+      TCoord u0 = u[i], u1 = u[i+1];
+      if (u1 - u0 < 1e-9)
+        continue;
+      TEdge edge;
+      edge.path = entry.path;
+      edge.u0 = u0;
+      edge.u1 = u1;
+      size_t n = max<size_t>(4, ceil((u1 - u0) * 8.0));
+      TCoord length = 0.0;
+      for(size_t j=0; j<=n; ++j) {
+        edge.outline.push_back(evaluate(polygon, u0 + (u1 - u0) * j / n));
+        if (j>0)
+          length += distance(edge.outline[j-1], edge.outline[j]);
+      }
+      edge.v0 = vertex(component, edge.outline.front(), &grid);
+      edge.v1 = vertex(component, edge.outline.back(), &grid);
+      // drop pieces between intersections which were found more than once
+      if (edge.v0 == edge.v1 && length < 2.0 * mergeDistance)
+        continue;
+      TPoint p0 = evaluate(polygon, u0 + (u1 - u0) * 0.01);
+      TPoint p1 = evaluate(polygon, u1 - (u1 - u0) * 0.01);
+      edge.a0 = atan2(p0.y - edge.outline.front().y, p0.x - edge.outline.front().x);
+      edge.a1 = atan2(p1.y - edge.outline.back().y, p1.x - edge.outline.back().x);
+      edges.push_back(edge);
+    }
+  }
+  size_t vertexCount = component->vertices.size();
+
+  // remove dangling edges, they don't enclose anything
+  vector<bool> removed(edges.size());
+  vector<size_t> degree(vertexCount);
+  for(auto &&edge: edges) {
+    ++degree[edge.v0];
+    ++degree[edge.v1];
+  }
+  vector<vector<size_t>> incident(vertexCount);
+  for(size_t e=0; e<edges.size(); ++e) {
+    incident[edges[e].v0].push_back(e);
+    incident[edges[e].v1].push_back(e);
+  }
+  vector<size_t> dangling;
+  for(size_t v=0; v<vertexCount; ++v) {
+    if (degree[v]==1)
+      dangling.push_back(v);
+  }
+  while(!dangling.empty()) {
+    size_t v = dangling.back();
+    dangling.pop_back();
+    for(auto &&e: incident[v]) {
+      if (removed[e])
+        continue;
+      removed[e] = true;
+      size_t other = edges[e].v0 == v ? edges[e].v1 : edges[e].v0;
+      --degree[v];
+      if (--degree[other]==1)
+        dangling.push_back(other);
+    }
+  }
+
+  // outgoing half-edges of each vertex, sorted by angle
+  auto origin = [&](size_t h) { return (h&1) ? edges[h/2].v1 : edges[h/2].v0; };
+  auto angle  = [&](size_t h) { return (h&1) ? edges[h/2].a1 : edges[h/2].a0; };
+  vector<vector<size_t>> outgoing(vertexCount);
+  for(size_t e=0; e<edges.size(); ++e) {
+    if (removed[e])
+      continue;
+    outgoing[edges[e].v0].push_back(e*2);
+    outgoing[edges[e].v1].push_back(e*2+1);
+  }
+  vector<size_t> position(edges.size()*2);
+  for(auto &&out: outgoing) {
+    sort(out.begin(), out.end(), [&](size_t a, size_t b) { return angle(a) < angle(b); });
+    for(size_t i=0; i<out.size(); ++i)
+      position[out[i]] = i;
+  }
+
+  // walk the faces: arriving at a vertex, leave on the half-edge
+  // clockwise next to the one we came from
+  vector<bool> visited(edges.size()*2);
+  for(size_t start=0; start<edges.size()*2; ++start) {
+    if (removed[start/2] || visited[start])
+      continue;
+    TFace face;
+    size_t h = start;
+    bool closed = false;
+    for(size_t steps=0; steps<edges.size()*2; ++steps) {
+      visited[h] = true;
+      face.halfedges.push_back(h);
+      const TEdge &edge = edges[h/2];
+      if (h&1)
+        face.outline.insert(face.outline.end(), edge.outline.rbegin(), edge.outline.rend()-1);
+      else
+        face.outline.insert(face.outline.end(), edge.outline.begin(), edge.outline.end()-1);
+      size_t twin = h^1;
+      const vector<size_t> &out = outgoing[origin(twin)];
+      h = out[(position[twin] + out.size() - 1) % out.size()];
+      if (h == start) {
+        closed = true;
+        break;
+      }
+    }
+    if (!closed)
+      continue;
+    face.area = 0.0;
+    for(size_t i=0, j=face.outline.size()-1; i<face.outline.size(); j=i++) {
+      face.area += face.outline[j].x * face.outline[i].y - face.outline[i].x * face.outline[j].y;
+      face.bounds.expand(face.outline[i]);
+    }
+    face.area *= 0.5;
+    // the outer boundary of a group of edges runs the other way round
+    if (face.area <= 0.0)
+      continue;
+    component->bounds.expand(face.bounds);
+    faces.push_back(face);
+  }
+}
+
+/**
+ * Return the boundary of the smallest face containing (x, y) or NULL.
+ */
+TFPath*
+TFillArrangement::fill(TCoord x, TCoord y)
+{
+  update();
+
+  auto contains = [x, y](const TBoundary &b) {
+    return !b.empty && b.p0.x <= x && x <= b.p1.x && b.p0.y <= y && y <= b.p1.y;
+  };
+  const TComponent *in = nullptr;
+  const TFace *found = nullptr;
+  for(auto &&component: components) {
+    if (!contains(component.bounds))
+      continue;
+    for(auto &&face: component.faces) {
+      if (found && face.area >= found->area)
+        continue;
+      if (!contains(face.bounds))
+        continue;
+      if (isInside(face.outline, x, y)) {
+        in = &component;
+        found = &face;
+      }
+    }
+  }
+  if (!found)
+    return nullptr;
+
+  // segmentstack2path skips the first entry
+  segmentstack_t stack;
+  stack.push_back(segment_t());
+  for(auto &&h: found->halfedges) {
+    const TEdge &edge = in->edges[h/2];
+    stack.push_back(segment_t());
+    stack.back().path = edge.path;
+    stack.back().u0 = (h&1) ? edge.u1 : edge.u0;
+    stack.back().u1 = (h&1) ? edge.u0 : edge.u1;
+  }
+  return segmentstack2path(stack);
+}
@@ -22,6 +22,8 @@
 #define _FISCHLAND_FILLTOOL_HH 1
 
 #include <toad/figuretool.hh>
+#include <toad/simpletimer.hh>
+#include <unordered_map>
 
 #include "fpath.hh"
 
@@ -30,14 +32,6 @@ namespace fischland {
 using namespace std;
 using namespace toad;
 
-class TFillTool:
-  public TFigureTool
-{
-  public:
-    static TFillTool* getTool();
-    void mouseEvent(TFigureEditor *fe, const TMouseEvent &me);
-};
-
 double angleAtPoint(const TFPath *a, TCoord u);
 void divideBezier(const TPoint *a, TPoint *p, TCoord u=0.5);
 void divideBezier(const TFPath *a, TPoint *p, TCoord u=0.5);
@@ -55,32 +49,44 @@ struct IntersectionPoint {
 };
 typedef vector<IntersectionPoint> IntersectionPointList;
 
-void
-bezierIntersection(IntersectionPointList &found,
-                   const TPoint *a,
-                   const TPoint *b,
-                   const TFPath *ap,
-                   const TFPath *bp,
-                   TCoord as=0.0, TCoord bs=0.0,
-                   TCoord a0=0.0, TCoord a1=1.0,
-                   TCoord b0=0.0, TCoord b1=1.0,
-                   unsigned d=0);
-
 void
 bezierIntersection(IntersectionPointList &found,
                    const TFPath *ap,
                    const TFPath *bp);
 
-struct direction_t {
-  direction_t(TCoord aDegree, const TFPath *aPath, TCoord aPosition, bool aForward)
-    :degree(aDegree), path(aPath), position(aPosition), forward(aForward)
-  {}
-  TCoord degree;
-  const TFPath *path;
-  TCoord position;
-  bool forward;
+/**
+ * A uniform grid over the bounds of the bézier segments of a list of
+ * paths, so that TFillArrangement only needs to intersect a path with
+ * the paths near it instead of with all of them.
+ *
+ * The paths returned are in the order of the list, so the results don't
+ * depend on whether the index was used or not.
+ */
+class TPathIndex
+{
+  public:
+    TPathIndex(const vector<const TFPath*> &paths);
+    size_t size() const { return paths.size(); }
+    const TBoundary& bounds() const { return area; }
+    void nearPath(const TFPath *path, vector<const TFPath*> *result) const;
+
+  protected:
+    struct TSegment {
+      TSegment(const TBoundary &b, size_t p): bounds(b), path(p) {}
+      TBoundary bounds;
+      size_t path; // index into 'paths'
+    };
+    vector<const TFPath*> paths;
+    vector<TSegment> segments;
+    vector<vector<size_t>> cells;  // indices into 'segments'
+    TBoundary area;
+    size_t columns, rows;
+    TCoord cellWidth, cellHeight;
+
+    void cellRange(const TBoundary &b, size_t *x0, size_t *y0, size_t *x1, size_t *y1) const;
+    void query(const TBoundary &b, vector<bool> *hit) const;
+    void collect(const vector<bool> &hit, vector<const TFPath*> *result) const;
 };
-typedef vector<direction_t> directionstack_t;
 
 struct segment_t {
   segment_t() {
@@ -103,13 +109,90 @@ struct segment_t {
 };
 typedef vector<segment_t> segmentstack_t;
 
-bool
-insidepath(TCoord x,
-           const IntersectionPointList &linelist,
-           const segmentstack_t &stack);
-
 TFPath* segmentstack2path(const segmentstack_t &stack);
-TFPath* floodfill(TFigureModel &model, TCoord x, TCoord y);
+
+/**
+ * The planar arrangement of all unfilled TFPath figures in a model: the
+ * paths are split at their intersections into edges, which enclose
+ * faces. A fill is a lookup of the face containing the point.
+ *
+ * Intersections are kept per path and only those of paths which were
+ * added, modified or removed are computed again. Paths connected by
+ * intersections form a component with its own faces, and only the
+ * components with such paths are split into faces again. The update
+ * runs when the model didn't change for a moment or latest with the next
+ * fill.
+ *
+ * Paths are known by their figure id along with 'known', which loses
+ * the ids of deleted figures, so that a figure reusing the id or the
+ * address of a deleted one is taken for a new path. Modifications are
+ * taken from the model's notifications, so tools which modify a path
+ * directly need to call TFigureModel::modify().
+ */
+class TFillArrangement:
+  public GModelOwner<TFigureModel>, public TSimpleTimer
+{
+  public:
+    TFillArrangement();
+    void update();
+    TFPath* fill(TCoord x, TCoord y);
+
+  protected:
+    void modelChanged(bool newmodel) override;
+    void tick() override;
+    void clear();
+
+    struct TCut {
+      TCut(TCoord u, unsigned other): u(u), other(other) {}
+      TCoord u;              // position on the path
+      unsigned other;        // id of the path intersecting at u
+    };
+    struct TPathEntry {
+      const TFPath *path;
+      vector<TCut> cuts;
+      size_t component;      // index into 'components'
+    };
+    vector<const TFPath*> paths;  // in model order
+    std::unordered_map<unsigned, TPathEntry> entries;
+    TFigureSet known;             // the paths in 'entries', as they are
+    bool dirty;
+
+    struct TEdge {
+      const TFPath *path;
+      TCoord u0, u1;
+      size_t v0, v1;
+      TCoord a0, a1;         // direction leaving v0 and leaving v1
+      vector<TPoint> outline;
+    };
+    struct TFace {
+      vector<size_t> halfedges;  // edge*2 + (backward ? 1 : 0)
+      vector<TPoint> outline;
+      TBoundary bounds;
+      TCoord area;
+    };
+    struct TComponent {
+      vector<unsigned> paths;    // ids of the paths
+      vector<TPoint> vertices;
+      vector<TEdge> edges;
+      vector<TFace> faces;
+      TBoundary bounds;          // of the faces
+    };
+    vector<TComponent> components;
+
+    void intersect(const vector<const TFPath*> &modified);
+    void buildFaces(TComponent *component);
+    size_t vertex(TComponent *component, const TPoint &p, std::unordered_map<uint64_t, vector<size_t>> *grid);
+};
+
+class TFillTool:
+  public TFigureTool
+{
+  public:
+    static TFillTool* getTool();
+    void mouseEvent(TFigureEditor *fe, const TMouseEvent &me);
+  protected:
+    TFillArrangement arrangement;
+};
 
 static inline TCoord
 fac(unsigned n)
@@ -1,4 +1,6 @@
 #include "filltool.hh"
+#include <toad/geometry.hh>
+#include <cmath>
 
 namespace fischland {
 
@@ -60,10 +62,8 @@ divideBezier(const TFPath *a, TPoint *p, TCoord u)
     i+=3;
   }
   TPoint pt[4];
-  for(size_t j=0; j<4; ++j) {
-    pt[j].x = a->polygon[i+j].x;
-    pt[j].y = a->polygon[i+j].y;
-  }
+  for(size_t j=0; j<4; ++j)
+    pt[j] = a->point(i+j);
   divideBezier(pt, p, u);
 }
 
@@ -76,18 +76,16 @@ angleAtPoint(const TFPath *a, TCoord u)
     i+=3;
   }
   if (u<=0.0) {
-    return atan2(a->polygon[i+1].y - a->polygon[i+0].y,
-                 a->polygon[i+1].x - a->polygon[i+0].x);
+    return atan2(a->point(i+1).y - a->point(i+0).y,
+                 a->point(i+1).x - a->point(i+0).x);
   }
   if (u>=1.0) {
-    return atan2(a->polygon[i+3].y - a->polygon[i+2].y,
-                 a->polygon[i+3].x - a->polygon[i+2].x);
+    return atan2(a->point(i+3).y - a->point(i+2).y,
+                 a->point(i+3).x - a->point(i+2).x);
   }
   TPoint pt[4], p[7];
-  for(size_t j=0; j<4; ++j) {
-    pt[j].x = a->polygon[i+j].x;
-    pt[j].y = a->polygon[i+j].y;
-  }
+  for(size_t j=0; j<4; ++j)
+    pt[j] = a->point(i+j);
   divideBezier(pt, p, u);
   return atan2(p[4].y-p[3].y, p[4].x-p[3].x);
 }
@@ -178,250 +176,30 @@ pointsOverlap(const TFPath *p0, TCoord u0, const TFPath *p1, TCoord u1, TCoord r
     u1-=1.0;
   }
   for(size_t i=0; i<4; ++i) {
-    a0[i].x = p0->polygon[i+i0].x;
-    a0[i].y = p0->polygon[i+i0].y;
-    a1[i].x = p1->polygon[i+i1].x;
-    a1[i].y = p1->polygon[i+i1].y;
+    a0[i] = p0->point(i+i0);
+    a1[i] = p1->point(i+i1);
   }
   return pointsOverlap(a0, u0, a1, u1, range);
 }
 
-bool foo=false;
-double m;
-
-void
-bezierIntersection(IntersectionPointList &found,
-                   const TPoint *a,
-                   const TPoint *b,
-                   const TFPath *ap,
-                   const TFPath *bp,
-                   TCoord as, TCoord bs,
-                   TCoord a0, TCoord a1,
-                   TCoord b0, TCoord b1,
-                   unsigned d)
-{
-#if 0
-  static int foo=0;
-  ++foo;
-  if (d==0 || foo>=807 || true) {
-    cout <<"    bezierIntersection: "<<foo<<endl
-         <<"      ("<<a[0].x<<","<<a[0].y<<"), ("
-         <<a[1].x<<","<<a[1].y<<"), ("
-         <<a[2].x<<","<<a[2].y<<"), ("
-         <<a[3].x<<","<<a[3].y<<")"<<endl
-         <<"      ("<<b[0].x<<","<<b[0].y<<"), ("
-         <<b[1].x<<","<<b[1].y<<"), ("
-         <<b[2].x<<","<<b[2].y<<"), ("
-         <<b[3].x<<","<<b[3].y<<")"<<endl;
-  }
-#endif
-  bool done;
-#if 0
-  done = true;
-  for(int i=1; i<4; ++i) {
-    if (fabs(a[0].x-a[i].x)>0.5 || fabs(a[0].y-a[i].y)>0.5) {
-      done = false;
-      break;
-    }
-  }
-  if (done) {
-    for(int i=0; i<4; ++i) {
-      if (fabs(a[0].x-b[i].x)>0.5 || fabs(a[0].y-b[i].y)>0.5) {
-        done = false;
-        break;
-      }
-    }
-  }
-  if (done) {
-    cout << "same point" << endl;
-  }
-#endif
-  // return no intersection when both beziér are the same
-  done = true;
-  for(int i=0; i<4; ++i) {
-    if (a[i].x!=b[i].x || a[i].y!=b[i].y) {
-      done = false;
-      break;
-    }
-  }
-  if (done) {
-    cout << "same line" << endl;
-    return;
-  }
-  done = true;
-  for(int i=0; i<4; ++i) {
-    if (a[i].x!=b[3-i].x || a[i].y!=b[3-i].y) {
-      done = false;
-      break;
-    }
-  }
-  if (done) {
-    cout << "same line reverted" << endl;
-    return;
-  }
-#if 0
-//cout << "depth " << d << endl;
-if (d&1)
-  cout << "depth " << d << " " << b0 << " - " << b1 << ", " << a0 << " - " << a1 << endl;
-else
-  cout << "depth " << d << " " << a0 << " - " << a1 << ", " << b0 << " - " << b1 << endl;
-#endif
-if (d>100) {
-  cout << "**** depth is above 100, emergency abort" << endl;
-  return;
-}
-
-  done = true;
-
-  // intersection check with bounding rectangle
-  TCoord ax0, ax1, ay0, ay1;
-  ax0=ax1=a[0].x;
-  ay0=ay1=a[0].y;
-  TCoord bx0, bx1, by0, by1;
-  bx0=bx1=b[0].x;
-  by0=by1=b[0].y;
-  for(int i=1; i<4; ++i) {
-    if (ax0>a[i].x) ax0=a[i].x;
-    if (ax1<a[i].x) ax1=a[i].x;
-    if (ay0>a[i].y) ay0=a[i].y;
-    if (ay1<a[i].y) ay1=a[i].y;
-    if (bx0>b[i].x) bx0=b[i].x;
-    if (bx1<b[i].x) bx1=b[i].x;
-    if (by0>b[i].y) by0=b[i].y;
-    if (by1<b[i].y) by1=b[i].y;
-  }
-/*
-cout << "ax: " << ax0 << " - " << ax1
-     <<" ay: " << ay0 << " - " << ay1 << endl;
-cout << "bx: " << bx0 << " - " << bx1
-     <<" by: " << by0 << " - " << by1 << endl;
-*/
-  if ((ax0<=bx0 && bx0<=ax1 &&
-       ax0<=bx1 && bx1<=ax1 &&
-       ay0<=by0 && by0<=ay1 &&
-       ay0<=by1 && by1<=ay1) ||
-      (bx0<=ax0 && ax0<=bx1 &&
-       bx0<=ax1 && ax1<=bx1 &&
-       by0<=ay0 && ay0<=by1 &&
-       by0<=ay1 && ay1<=by1))
-  {
-//    cout << "contains" << endl;
-  } else {
-    // line intersection
-    done = true;
-    for(int i=0; i<4; ++i) {
-      for(int j=0; j<4; ++j) {
-        if (lineIntersection(a[i], a[(i+1)%4], b[j], b[(j+1)%4]))
-          done = false;
-      }
-    }
-    if (done) {
-//      cout << "no line intersections" << endl;
-      return;
-    }
-  }
-
-
-  TPoint p[7];
-  divideBezier(a, p);
-
-  done = true;
-  
-  double m0 = 0.1;
-  for(int i=1; i<4; ++i) {
-    if (fabs(a[0].x-a[i].x)>m0 || fabs(a[i].y-a[i].y)>m0 ||
-        fabs(b[0].x-b[i].x)>m0 || fabs(b[i].y-b[i].y)>m0) 
-    {
-      done = false;
-      break;
-    }
-  }
-  if (done) {
-    m = min(m, fabs(b[0].x-p[3].x));
-    m = min(m, fabs(b[0].y-p[3].y));
-    if (fabs(b[0].x-p[3].x)>m0 || fabs(b[0].y-p[3].y)>m0)
-      done = false;
-  }
-
-  if (done) {
-//    cout << "draw circle" << endl;
-#ifdef DEBUG
-    if (paintflag) {
-      pen->drawCirclePC(a[0].x-2, a[0].y-2, 5, 5);
-    }
-#endif
-#if 0
-    cout << " depth=" << d << ", intersection " 
-         << bp << ":" << (b0+(b1-b0)/2.0+bs) << "; "
-         << ap << ":" << (a0+(a1-a0)/2.0+as) << endl;
-#endif
-    if (d & 1) {
-      found.push_back(IntersectionPoint(a[0], b0+(b1-b0)/2.0+bs, a0+(a1-a0)/2.0+as, bp, ap));
-    } else {
-      found.push_back(IntersectionPoint(a[0], a0+(a1-a0)/2.0+as, b0+(b1-b0)/2.0+bs, ap, bp));
-    }
-    return;
-  }
-
-  done = true;
-  for(int i=1; i<4; ++i) {
-    if (a[0].x!=a[i].x || a[0].y!=a[i].y) {
-      done = false;
-      break;
-    }
-  }
-  if (done) {
-    done = true;
-    for(int i=1; i<4; ++i) {
-      if (b[0].x!=b[i].x || b[0].y!=b[i].y) {
-        done = false;
-        break;
-      }
-    }
-    if (done)
-      bezierIntersection(found, b, a, bp, ap, bs, as, b0, b1, a0, a1, d+1);
-    else
-      cout << "SINGLE POINTS WHICH DO NOT OVERLAPP" << endl;
-    return;
-  }
-
-  bezierIntersection(found, b, p,   bp, ap, bs, as, b0, b1, a0            , a0+(a1-a0)/2.0, d+1);
-  bezierIntersection(found, b, p+3, bp, ap, bs, as, b0, b1, a0+(a1-a0)/2.0, a1            , d+1);
-}
-
 void
 bezierIntersection(IntersectionPointList &found,
                    const TFPath *ap,
                    const TFPath *bp)
 {
-  size_t oldsize = found.size();
+  TPolygon abuffer, bbuffer;
+  const TPolygon &a = ap->points(abuffer);
+  const TPolygon &b = bp->points(bbuffer);
 
-  TPoint a[4], b[4];
-  TCoord as = 0.0;
-  for(size_t i=0; i+3<ap->polygon.size(); i+=3) {
-    for(size_t u=0; u<4; ++u) {
-      a[u].x = ap->polygon[i+u].x;
-      a[u].y = ap->polygon[i+u].y;
-    }
-    TCoord bs = 0.0;
-    for(size_t j=0; j+3<bp->polygon.size(); j+=3) {
-      for(size_t u=0; u<4; ++u) {
-        b[u].x = bp->polygon[j+u].x;
-        b[u].y = bp->polygon[j+u].y;
-      }
-/*
-cout << "    intersect segment a" << i << " with segment b" << j << endl;
-for(size_t j=0; j<4; ++j) {
-  cout << "      a["<<j<<"].set("<<a[j].x<<","<<a[j].y<<");"<<endl;
-}
-for(size_t j=0; j<4; ++j) {
-  cout << "      b["<<j<<"].set("<<b[j].x<<","<<b[j].y<<");"<<endl;
-}
-*/
-      bezierIntersection(found, a, b, ap, bp, as, bs);
-      bs += 1.0;
-    }
-    as += 1.0;
+  TIntersectionList ilist;
+  intersectCurves(ilist,
+                  a.data(), a.size(),
+                  b.data(), b.size());
+  for(auto &&i: ilist) {
+    // the curves are cut out of the paths' polygons
+    TCoord u = (i.seg0.src - a.data()) / 3 + i.seg0.u;
+    TCoord v = (i.seg1.src - b.data()) / 3 + i.seg1.u;
+    found.push_back(IntersectionPoint(i.seg1.pt, u, v, ap, bp));
   }
 
   // end points may not overlap with the other path but might be near
@@ -429,90 +207,148 @@ for(size_t j=0; j<4; ++j) {
 
 //cout << "look at end points" << endl;
   TCoord d, x, y, f;
-assert(!ap->polygon.empty());
-assert(!bp->polygon.empty());
-  d = bp->findPointNear(ap->polygon[0].x, ap->polygon[0].y, &x, &y, &f);
+assert(!a.empty());
+assert(!b.empty());
+  d = bp->findPointNear(a[0].x, a[0].y, &x, &y, &f);
 //cout << "distance 1 = " << d << endl;
 //printf("d=%f\n", d);
   if (d<1.0) {
-    found.push_back(IntersectionPoint(ap->polygon[0], 0, f, ap, bp));
+    found.push_back(IntersectionPoint(a[0], 0, f, ap, bp));
   }
-  d = bp->findPointNear(ap->polygon.back().x, ap->polygon.back().y, &x, &y, &f);
+  d = bp->findPointNear(a.back().x, a.back().y, &x, &y, &f);
 //cout << "distance 2 = " << d << endl;
   if (d<1.0) {
-//cout << "polygon.size() = " << ap->polygon.size() << " -> " << (ap->polygon.size()-1)/3 << ", f="<< f << endl;
-    found.push_back(IntersectionPoint(ap->polygon.back(), (ap->polygon.size()-1)/3, f, ap, bp));
+//cout << "polygon.size() = " << a.size() << " -> " << (a.size()-1)/3 << ", f="<< f << endl;
+    found.push_back(IntersectionPoint(a.back(), (a.size()-1)/3, f, ap, bp));
   }
-  d = ap->findPointNear(bp->polygon[0].x, bp->polygon[0].y, &x, &y, &f);
+  d = ap->findPointNear(b[0].x, b[0].y, &x, &y, &f);
 //cout << "distance 3 = " << d << endl;
   if (d<1.0) {
-//    found.push_back(IntersectionPoint(bp->polygon[0], 0, f, bp, ap));
-    found.push_back(IntersectionPoint(bp->polygon[0], f, 0, ap, bp));
+//    found.push_back(IntersectionPoint(b[0], 0, f, bp, ap));
+    found.push_back(IntersectionPoint(b[0], f, 0, ap, bp));
   }
-  d = ap->findPointNear(bp->polygon.back().x, bp->polygon.back().y, &x, &y, &f);
+  d = ap->findPointNear(b.back().x, b.back().y, &x, &y, &f);
 //cout << "distance 4 = " << d << endl;
   if (d<1.0) {
-//cout << "polygon.size() = " << ap->polygon.size() << " -> " << (ap->polygon.size()-1)/3 << endl;
-//    found.push_back(IntersectionPoint(bp->polygon.back(), (bp->polygon.size()-1)/3, f, bp, ap));
-    found.push_back(IntersectionPoint(bp->polygon.back(), f, (bp->polygon.size()-1)/3, ap, bp));
+//cout << "polygon.size() = " << a.size() << " -> " << (a.size()-1)/3 << endl;
+//    found.push_back(IntersectionPoint(b.back(), (b.size()-1)/3, f, bp, ap));
+    found.push_back(IntersectionPoint(b.back(), f, (b.size()-1)/3, ap, bp));
   }
 //cout << "looked at end points" << endl;
 
 }
 
+TPathIndex::TPathIndex(const vector<const TFPath*> &paths):
+  paths(paths)
+{
+  TPolygon buffer;
+  for(size_t idx=0; idx<paths.size(); ++idx) {
+    const TPolygon &polygon = paths[idx]->points(buffer);
+    if (polygon.empty())
+      continue;
+
+    // bezierIntersection also reports end points closer than 1.0 to the
+    // other path, hence the segments are enlarged by 1.0
+    if (polygon.size()<4) {
+      TBoundary b;
+      for(auto &&pt: polygon)
+        b.expand(pt);
+      b.set(b.p0.x-1.0, b.p0.y-1.0, b.p1.x+1.0, b.p1.y+1.0);
+      segments.push_back(TSegment(b, idx));
+      area.expand(b);
+      continue;
+    }
+    for(size_t i=0; i+3<polygon.size(); i+=3) {
+      TBoundary b(curveBounds(&polygon[i]));
+      b.set(b.p0.x-1.0, b.p0.y-1.0, b.p1.x+1.0, b.p1.y+1.0);
+      segments.push_back(TSegment(b, idx));
+      area.expand(b);
+    }
+  }
+
+  columns = rows = min<size_t>(max<size_t>(1, ceil(sqrt(segments.size()))), 256);
+  cellWidth  = area.empty ? 1.0 : area.width()  / columns;
+  cellHeight = area.empty ? 1.0 : area.height() / rows;
+  if (cellWidth<=0.0)
+    cellWidth = 1.0;
+  if (cellHeight<=0.0)
+    cellHeight = 1.0;
+
+  cells.resize(columns*rows);
+  for(size_t i=0; i<segments.size(); ++i) {
+    size_t x0, y0, x1, y1;
+    cellRange(segments[i].bounds, &x0, &y0, &x1, &y1);
+    for(size_t y=y0; y<=y1; ++y)
+      for(size_t x=x0; x<=x1; ++x)
+        cells[x+y*columns].push_back(i);
+  }
+}
+
+void
+TPathIndex::cellRange(const TBoundary &b, size_t *x0, size_t *y0, size_t *x1, size_t *y1) const
+{
+  auto cell = [](TCoord v, TCoord size, size_t n) -> size_t {
+    if (v<=0.0)
+      return 0;
+    TCoord c = floor(v/size);
+    return c>=n ? n-1 : static_cast<size_t>(c);
+  };
+  *x0 = cell(b.p0.x-area.p0.x, cellWidth,  columns);
+  *x1 = cell(b.p1.x-area.p0.x, cellWidth,  columns);
+  *y0 = cell(b.p0.y-area.p0.y, cellHeight, rows);
+  *y1 = cell(b.p1.y-area.p0.y, cellHeight, rows);
+}
+
 /**
- * check if a point is inside a given bezier path
- * \param x
- *   x coordinate of the point
- * \param linelist
- *   list of intersections of a horizontal line through point (x,y) with
- *   all known beziers
- * \param stack
- *   
+ * mark all paths with a segment overlapping 'b' in 'hit'
  */
-bool
-insidepath(TCoord x,
-           const IntersectionPointList &linelist,
-           const segmentstack_t &stack)
+void
+TPathIndex::query(const TBoundary &b, vector<bool> *hit) const
 {
-cout << "insidepath" << endl;
-  if (stack.empty())
-    return false;
-  unsigned intersections = 0;
-  for(IntersectionPointList::const_iterator p0 = linelist.begin();
-      p0 != linelist.end();
-      ++p0)
-  {
-    if (x <= p0->coord.x)
-      continue;
-/*
-    cout << "  p0->coord.x=" << p0->coord.x
-         << ", p0->bp=" << p0->bp
-         << ", p0->b=" << p0->b
-         << endl;
-*/
-    for(segmentstack_t::const_iterator p1 = stack.begin()+1;
-        p1 != stack.end();
-        ++p1)
-    {
-      if (p0->bp!=p1->path)
-        continue;
-      if (p1->u0 <= p1->u1) {
-        if ( p1->u0 <= p0->b && p0->b <= p1->u1)
-          ++intersections;
-      } else {
-        if ( p1->u1 <= p0->b && p0->b <= p1->u0)
-          ++intersections;
+  if (area.empty || !area.isOverlapping(b))
+    return;
+  size_t x0, y0, x1, y1;
+  cellRange(b, &x0, &y0, &x1, &y1);
+  for(size_t y=y0; y<=y1; ++y) {
+    for(size_t x=x0; x<=x1; ++x) {
+      for(auto &&i: cells[x+y*columns]) {
+        const TSegment &segment = segments[i];
+        if (!(*hit)[segment.path] && segment.bounds.isOverlapping(b))
+          (*hit)[segment.path] = true;
       }
-      cout << "    p1->path=" << p1->path
-           << ", p1->u0=" << p1->u0
-           << ", p1->u1=" << p1->u1
-           << endl; 
     }
   }
-  cout << "intersections = " << intersections << endl;
-return true;
-  return intersections!=0 && (intersections&1);
+}
+
+void
+TPathIndex::collect(const vector<bool> &hit, vector<const TFPath*> *result) const
+{
+  result->clear();
+  for(size_t i=0; i<paths.size(); ++i) {
+    if (hit[i])
+      result->push_back(paths[i]);
+  }
+}
+
+/**
+ * Paths which might intersect with 'path', including 'path' itself
+ * when it is in the index.
+ */
+void
+TPathIndex::nearPath(const TFPath *path, vector<const TFPath*> *result) const
+{
+  vector<bool> hit(paths.size());
+  TPolygon buffer;
+  const TPolygon &polygon = path->points(buffer);
+  if (polygon.size()<4) {
+    TBoundary b;
+    for(auto &&pt: polygon)
+      b.expand(pt);
+    query(b, &hit);
+  }
+  for(size_t i=0; i+3<polygon.size(); i+=3)
+    query(TBoundary(curveBounds(&polygon[i])), &hit);
+  collect(hit, result);
 }
 
 /**
@@ -534,6 +370,8 @@ segmentstack2path(const segmentstack_t &stack)
     if (p==stack.begin())
       continue;
     cout << "segment " << ++cntr << ": path " << p->path << " from " << p->u0 << " to " << p->u1 << endl;
+    TPolygon buffer;
+    const TPolygon &polygon = p->path->points(buffer);
     TCoord u0 = p->u0, u1=p->u1;
 //if (cntr==2) {
 //  u0 = p->u1, u1=p->u0;
@@ -549,7 +387,7 @@ segmentstack2path(const segmentstack_t &stack)
       i1+=3;
     }
     
-    if (i1+2>=p->path->polygon.size()) {
+    if (i1+2>=polygon.size()) {
 cout << "******** i1 is out of bounds, fixing it without knowing why..." << endl;
       i1-=3;
       u1 = 1.0;
@@ -560,13 +398,13 @@ cout << "******** i1 is out of bounds, fixing it without knowing why..." << endl
       TPoint in[4], out0[7], out1[7];
       if (u0<u1) {
         for(size_t i=0; i<4; ++i) {
-          in[i].x = p->path->polygon[i0+i].x;
-          in[i].y = p->path->polygon[i0+i].y;
+          in[i].x = polygon[i0+i].x;
+          in[i].y = polygon[i0+i].y;
         }
       } else {
         for(size_t i=0; i<4; ++i) {
-          in[3-i].x = p->path->polygon[i0+i].x;
-          in[3-i].y = p->path->polygon[i0+i].y;
+          in[3-i].x = polygon[i0+i].x;
+          in[3-i].y = polygon[i0+i].y;
         }
         u0 = 1.0 - u0;
         u1 = 1.0 - u1;
@@ -574,9 +412,9 @@ cout << "******** i1 is out of bounds, fixing it without knowing why..." << endl
       divideBezier(in, out0, u0);
       u1 = ( u1 - u0 ) / ( 1 - u0 );
       divideBezier(out0+3, out1, u1);
-      for(int i=path->polygon.empty() ? 0 : 1; i<4; ++i) {
+      for(int i=path->pointCount()==0 ? 0 : 1; i<4; ++i) {
 //cout << "0 cntr:" << out1[i].x << ", " << out1[i].y << endl;
-        path->polygon.addPoint(out1[i].x, out1[i].y);
+        path->addPoint(out1[i].x, out1[i].y);
       }
       continue;
     }
@@ -586,86 +424,86 @@ cout << "******** i1 is out of bounds, fixing it without knowing why..." << endl
       // this segment is backwards
       // head
       for(size_t i=0; i<4; ++i) {
-        in[3-i].x = p->path->polygon[i0+i].x;
-        in[3-i].y = p->path->polygon[i0+i].y;
+        in[3-i].x = polygon[i0+i].x;
+        in[3-i].y = polygon[i0+i].y;
       }
       divideBezier(in, out, 1.0-u0);
 #ifdef DEBUG
 pen->drawRectangle(out[3].x-2,out[3].y-2,5,5);
 #endif
-      for(int i=path->polygon.empty() ? 3 : 4; i<7; ++i) {
-        path->polygon.addPoint(out[i].x, out[i].y);
+      for(int i=path->pointCount()==0 ? 3 : 4; i<7; ++i) {
+        path->addPoint(out[i].x, out[i].y);
 //cout << "1 head:" << out[i].x << ", " << out[i].y << endl;
       }
       // middle
       for(size_t j=i0-3; j>i1; j-=3) {
 //        printf("middle from %u to %u, doing %u\n", i0, i1, j);
         for(size_t i=0; i<4; ++i) {
-          assert(j+i< p->path->polygon.size());
-          out[3-i].x = p->path->polygon[j+i].x;
-          out[3-i].y = p->path->polygon[j+i].y;
+          assert(j+i< polygon.size());
+          out[3-i].x = polygon[j+i].x;
+          out[3-i].y = polygon[j+i].y;
         }
         for(int i=1; i<4; ++i) {
-          path->polygon.addPoint(out[i].x, out[i].y);
+          path->addPoint(out[i].x, out[i].y);
 //cout << "1 midl:" << out[i].x << ", " << out[i].y << endl;
         }
       }
 
       // tail
       for(size_t i=0; i<4; ++i) {
-        in[3-i].x = p->path->polygon[i1+i].x;
-        in[3-i].y = p->path->polygon[i1+i].y;
+        in[3-i].x = polygon[i1+i].x;
+        in[3-i].y = polygon[i1+i].y;
       }
       divideBezier(in, out, 1.0-u1);
       for(int i=1; i<4; ++i) {
 //cout << "1 tail:" << out[i].x << ", " << out[i].y << endl;
-        path->polygon.addPoint(out[i].x, out[i].y);
+        path->addPoint(out[i].x, out[i].y);
       }
     } else {
       // head
-//cout << "2 head: i0="<<i0<<", i1="<<i1<<", size="<<p->path->polygon.size()<<endl;
-//for(size_t i=0; i<p->path->polygon.size(); ++i)
-//  cout << i << ": " << p->path->polygon[i].x << ", " << p->path->polygon[i].y << endl;
+//cout << "2 head: i0="<<i0<<", i1="<<i1<<", size="<<polygon.size()<<endl;
+//for(size_t i=0; i<polygon.size(); ++i)
+//  cout << i << ": " << polygon[i].x << ", " << polygon[i].y << endl;
       for(size_t i=0; i<4; ++i) {
-        in[i].x = p->path->polygon[i0+i].x;
-        in[i].y = p->path->polygon[i0+i].y;
+        in[i].x = polygon[i0+i].x;
+        in[i].y = polygon[i0+i].y;
       }
       divideBezier(in, out, u0);
 #ifdef DEBUG
 pen->drawRectangle(out[3].x-2,out[3].y-2,5,5);
 #endif
-      for(int i=path->polygon.empty() ? 3 : 4; i<7; ++i) {
+      for(int i=path->pointCount()==0 ? 3 : 4; i<7; ++i) {
 //cout << "2 head:" << out[i].x << ", " << out[i].y << endl;
-        path->polygon.addPoint(out[i].x, out[i].y);
+        path->addPoint(out[i].x, out[i].y);
       }
       // middle
       for(size_t j=i0+3; j<i1; j+=3) {
 //        printf("middle from %u to %u, doing %u\n", i0, i1, j);
         for(size_t i=0; i<4; ++i) {
-          assert(j+i< p->path->polygon.size());
-          out[i].x = p->path->polygon[j+i].x;
-          out[i].y = p->path->polygon[j+i].y;
+          assert(j+i< polygon.size());
+          out[i].x = polygon[j+i].x;
+          out[i].y = polygon[j+i].y;
         }
         for(int i=1; i<4; ++i) {
 //cout << "2 midl:" << out[i].x << ", " << out[i].y << endl;
-          path->polygon.addPoint(out[i].x, out[i].y);
+          path->addPoint(out[i].x, out[i].y);
         }
       }
     
       // tail
       for(size_t i=0; i<4; ++i) {
-if (i1+i>=p->path->polygon.size()) {
+if (i1+i>=polygon.size()) {
   fprintf(stderr,"%s:%u: assertion\n",__FILE__,__LINE__);
   return 0;
 }
-        in[i].x = p->path->polygon[i1+i].x;
-        in[i].y = p->path->polygon[i1+i].y;
+        in[i].x = polygon[i1+i].x;
+        in[i].y = polygon[i1+i].y;
       }
 //cout << "divide at " << u1 << endl;
       divideBezier(in, out, u1);
       for(int i=1; i<4; ++i) {
 //cout << "2 tail " << i << ":" << out[i].x << ", " << out[i].y << endl;
-        path->polygon.addPoint(out[i].x, out[i].y);
+        path->addPoint(out[i].x, out[i].y);
       }
     }
   }
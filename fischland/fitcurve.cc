@@ -97,8 +97,9 @@ service marks of Xara Group Ltd. All rights in these marks are reserved.
 =================================XARAHEADEREND============================
 */
 
-#include <toad/figure.hh>
+#include "fitcurve.hh"
 #include <cmath>
+#include <vector>
 
 using namespace toad;
 
@@ -202,22 +203,21 @@ FitPoint::setLength(double NewLen) const
 
 struct CurveFitObject {
   CurveFitObject() {
-    PathArray = 0;
-    Distances = 0;
+    TotalCoords = 0;
+    fig = 0;
+    Ends = 0;
     Error = 50.0 * 960.0;
   }
-  ~CurveFitObject() {
-    if (PathArray) delete[] PathArray;
-    if (Distances) delete[] Distances;
-  }
 
-  DocCoord *PathArray;
+  std::vector<DocCoord> PathArray;
   int TotalCoords;
   
   TPolygon* fig;
+  // when set, the index of the last point of each inserted curve segment
+  std::vector<int>* Ends;
 
 	// An array that holds the distance of each point from the start of the path
-	int* Distances;
+	std::vector<int> Distances;
 
 	// The accuracy of the required fit. The larger this number, the smoother the fit.
 	// Values of about 27,000,000 give smooth curves in millipoints at 100% zoom factor
@@ -225,6 +225,8 @@ struct CurveFitObject {
 
 
   bool initialise(const TPolygon &in, TPolygon *out);
+  void append(const DocCoord &point);
+  bool isCusp(int i) const;
   void fitCurve();
   
   FitPoint bezierPoint( FitPoint* Bez, double u) const;
@@ -263,111 +265,12 @@ CurveFitObject::initialise(const TPolygon &polygon, TPolygon *out)
 	if (polygon.size()<2)
 	  return false;
 
-	PathArray = new DocCoord[polygon.size()];
-	if (PathArray==NULL)
-		return false;
-
-	int NumPoints = TotalCoords = polygon.size();
-	for(int i=0; i<TotalCoords; ++i) {
-	  PathArray[i].x = polygon[i].x;
-	  PathArray[i].y = polygon[i].y;
-	}
-#if 0
-	// copy the data out of the path and into the array. Only copy points of interest
-	CopyPath->FindStartOfPath();
-	DocCoord* Coords = CopyPath->GetCoordArray();
-
-	// Deal with the flags - We have to look for Spare1 being true, meaning that the previous
-	// Lineto was meant to stay as a straight line
-	PathFlags* Flags = CopyPath->GetFlagArray();
-	TotalStraightLines = 0;
-	for (int i=0; i<NumPoints; i++)	{
-		if (Flags[i].Spare1==TRUE)
-			TotalStraightLines++;
-	}
-
-	// Get some memory to store the positions of the line breaks in
-	if (TotalStraightLines>0)	{
-		LineArray = new int[TotalStraightLines];
-		if (LineArray==NULL) {
-			delete PathArray;
-			PathArray = NULL;
-			return FALSE;
-		}
-	}
-
-	// copy the MoveTo out of the path and into our array
-	PathArray[0].x = Coords[0].x;
-	PathArray[0].y = Coords[0].y;
-
-	int IncludePoint = 1;
-	int StraightLinePos = 0;
-	for (int i=1; i<NumPoints; i++)	{
-		// If this is one of the straight line bits, then make a note of its position
-		if (Flags[i].Spare1==TRUE) {
-			LineArray[StraightLinePos] = IncludePoint;
-			StraightLinePos++;
-		}
-
-		// Check to see if this coordinate is really needed (last point is always needed)
-		if ((Coords[i].x != PathArray[IncludePoint-1].x) || (Coords[i].y != PathArray[IncludePoint-1].y) &&
-			(i!=NumPoints-1))
-		{
-			// This point is not the same as the one before, so add it into the array
-			PathArray[IncludePoint].x = Coords[i].x;
-			PathArray[IncludePoint].y = Coords[i].y;
-
-			IncludePoint++;
-		}
-	}
-
-	// Add the last point in the track data to the path array if it is not already there
-	if ((PathArray[IncludePoint-1].x != Coords[NumPoints-1].x) ||
-		(PathArray[IncludePoint-1].y != Coords[NumPoints-1].y))
-	{
-		PathArray[IncludePoint].x = Coords[NumPoints-1].x;
-		PathArray[IncludePoint].y = Coords[NumPoints-1].y;
-		IncludePoint++;
-	}
-
-	// increment the Include count (as we have just added a point to the array) and then
-	// set the true number of points properly.
-	NumPoints = IncludePoint;
-
-	if (NumPoints<2) {
-		delete PathArray;
-		delete LineArray;
-		PathArray = NULL;
-		LineArray = NULL;
-		return false;
-	}
-#endif
-	// Build an array of the distances along the path
-	Distances = new int[NumPoints];
-	if (Distances==NULL) {
-		delete PathArray;
-		PathArray = NULL;
-		return false;
-	}
-
-	Distances[0] = 0;
-	int dx, dy, min;
-	for (int i=1; i<NumPoints; i++)	{
-		// This is doing an approximation to a Square Root
-		// It is about 250 times faster on a machine without FPU
-
-		// find the difference between the last 2 points
-		dx = fabs(PathArray[i].x - PathArray[i-1].x);
-		dy = fabs(PathArray[i].y - PathArray[i-1].y);
-
-		// Find out half the smallest of dx and dy
-		if (dx>dy)
-			min = dy>>1;
-		else
-			min = dx>>1;
-
-		Distances[i] = Distances[i-1] + dx + dy - min;
-	}
+	int NumPoints = polygon.size();
+	PathArray.clear();
+	Distances.clear();
+	TotalCoords = 0;
+	for(int i=0; i<NumPoints; ++i)
+	  append(polygon[i]);
 
 	// Now we can delete the Path Data in the path we are to put the smoothed path in
 #if 1
@@ -378,33 +281,70 @@ CurveFitObject::initialise(const TPolygon &polygon, TPolygon *out)
 	LongPath->FindStartOfPath();
 	LongPath->InsertMoveTo(PathArray[0]);
 #endif
-	// Store the total number of coords in the array for future reference
-	TotalCoords = NumPoints;
-
 	return true;
 }
 
+/**
+ * Add a point to the end of the path array and its distance along the path
+ * to the distance array.
+ */
+void
+CurveFitObject::append(const DocCoord &point)
+{
+	PathArray.push_back(point);
+	if (TotalCoords==0) {
+		Distances.push_back(0);
+		++TotalCoords;
+		return;
+	}
+
+	// This is doing an approximation to a Square Root
+	// It is about 250 times faster on a machine without FPU
+	int i = TotalCoords++;
+	int dx, dy, min;
+
+	// find the difference between the last 2 points
+	dx = fabs(PathArray[i].x - PathArray[i-1].x);
+	dy = fabs(PathArray[i].y - PathArray[i-1].y);
+
+	// Find out half the smallest of dx and dy
+	if (dx>dy)
+		min = dy>>1;
+	else
+		min = dx>>1;
+
+	Distances.push_back(Distances[i-1] + dx + dy - min);
+}
+
+/**
+ * See if point 'i' is a cusp in the curve. This needs the points before and
+ * after 'i'.
+ */
+bool
+CurveFitObject::isCusp(int i) const
+{
+	// Go find the angle between a group of points
+	double Angle1 = atan2((double)PathArray[i].y-PathArray[i-1].y, (double)PathArray[i].x-PathArray[i-1].x);
+	double Angle2 = atan2((double)PathArray[i+1].y-PathArray[i].y, (double)PathArray[i+1].x-PathArray[i].x);
+	
+	// Get them in a sensible range
+	if (Angle1 < -M_PI)	Angle1 += 2*M_PI;
+	if (Angle1 > M_PI)	Angle1 -= 2*M_PI;
+	if (Angle2 < -M_PI)	Angle2 += 2*M_PI;
+	if (Angle2 > M_PI)	Angle2 -= 2*M_PI;
+	
+	return (fabs(Angle2-Angle1) > (M_PI/2)) && (fabs(Angle2-Angle1) <= M_PI);
+}
+
 void
 CurveFitObject::fitCurve()
 {
   FitPoint Tangent1, Tangent2;
-  double Angle1, Angle2;
   int Start = 0;
-	int StraightLinePos = 0;
 
 	for(int i=1; i<TotalCoords-1; i++) {
-    // Go find the angle between a group of points
-		Angle1 = atan2((double)PathArray[i].y-PathArray[i-1].y, (double)PathArray[i].x-PathArray[i-1].x);
-		Angle2 = atan2((double)PathArray[i+1].y-PathArray[i].y, (double)PathArray[i+1].x-PathArray[i].x);
-		
-		// Get them in a sensible range
-		if (Angle1 < -M_PI)	Angle1 += 2*M_PI;
-		if (Angle1 > M_PI)	Angle1 -= 2*M_PI;
-		if (Angle2 < -M_PI)	Angle2 += 2*M_PI;
-		if (Angle2 > M_PI)	Angle2 -= 2*M_PI;
-		
 		// See if this point is a cusp in the curve
-		if ((fabs(Angle2-Angle1) > (M_PI/2)) && (fabs(Angle2-Angle1) <= M_PI)) {
+		if (isCusp(i)) {
 			// calculate the tangents off the end of the path
 			Tangent1 = leftTangent(Start);
 			Tangent2 = rightTangent(i);
@@ -587,8 +527,12 @@ CurveFitObject::fitCubic(int FirstPoint, int LastPoint,
 	int NumPoints = LastPoint - FirstPoint + 1;
 
 	// if this segment only has 2 points in it then do the special case
-	if ( NumPoints == 2 )	{
+	// (and also when the points are too close for the chord length
+	// parameterisation, which would divide by zero)
+	if ( NumPoints == 2 || Distances[LastPoint] == Distances[FirstPoint] )	{
 		insertLine(PathArray[FirstPoint], PathArray[LastPoint], Tangent1, Tangent2, IsStartCusp, IsEndCusp);
+		if (Ends)
+			Ends->push_back(LastPoint);
 		return;
 	}
 	
@@ -606,6 +550,8 @@ CurveFitObject::fitCubic(int FirstPoint, int LastPoint,
 
 		// add it to the path
 		insertBezier(Bezier, IsStartCusp, IsEndCusp);
+		if (Ends)
+			Ends->push_back(LastPoint);
 		return;
 	}
 
@@ -617,6 +563,8 @@ CurveFitObject::fitCubic(int FirstPoint, int LastPoint,
 	if (MaxError < Error)	{
 		// The mapping was good, so output the curve segment
 		insertBezier(Bezier, IsStartCusp, IsEndCusp);
+		if (Ends)
+			Ends->push_back(LastPoint);
 		return;
 	}
 	
@@ -801,8 +749,10 @@ CurveFitObject::generateBezier(int FirstPoint, int LastPoint,
 	if (det_C0_C1 == 0.0)
 		det_C0_C1 = (C[0][0] * C[1][1]) * 10e-12;	// oh err, whats it up to here then!
 	
-	double AlphaLeft  = det_X_C1 / det_C0_C1;
-	double AlphaRight = det_C0_X / det_C0_C1;
+	// (and when the points are so close that the integer distances are all
+	// zero or the whole distance, there's nothing to derive them from)
+	double AlphaLeft  = det_C0_C1 != 0.0 ? det_X_C1 / det_C0_C1 : -1.0;
+	double AlphaRight = det_C0_C1 != 0.0 ? det_C0_X / det_C0_C1 : -1.0;
 	
 	Bezier[0] = PathArray[FirstPoint];
 	Bezier[3] = PathArray[LastPoint];
@@ -829,3 +779,126 @@ fitCurve(const TPolygon &in, TPolygon *out, int smoothness)
     c.fitCurve();
   }
 }
+
+// try to fix curves each time the tail has grown by this many samples
+#define FIX_STEP        32
+
+TCurveFitter::TCurveFitter(int smoothness)
+{
+  fit = new CurveFitObject();
+  fit->Error = smoothness;
+  clear();
+}
+
+TCurveFitter::~TCurveFitter()
+{
+  delete fit;
+}
+
+void
+TCurveFitter::clear()
+{
+  fit->PathArray.clear();
+  fit->Distances.clear();
+  fit->TotalCoords = 0;
+  fixed.clear();
+  start = 0;
+  smooth = false;
+  next = FIX_STEP;
+}
+
+void
+TCurveFitter::setSmoothness(int smoothness)
+{
+  fit->Error = smoothness;
+}
+
+bool
+TCurveFitter::empty() const
+{
+  return fit->TotalCoords==0;
+}
+
+size_t
+TCurveFitter::size() const
+{
+  return fit->TotalCoords;
+}
+
+/**
+ * Add a sample.
+ *
+ * The curve up to a cusp is fixed at once, just like fitCurve() does. When
+ * there's no cusp for a while, the tail is fitted and all but its last
+ * curve are fixed, so that the work for each sample doesn't grow with the
+ * length of the stroke.
+ */
+void
+TCurveFitter::add(const TPoint &p)
+{
+  int n = fit->TotalCoords;
+  if (n>0 && fit->PathArray[n-1]==p)
+    return;
+  fit->append(p);
+  ++n;
+  if (n<3)
+    return;
+
+  int i = n-2;
+  if (fit->isCusp(i)) {
+    FitPoint Tangent1 = smooth ? FitPoint(tangent) : fit->leftTangent(start);
+    fit->fig = &fixed;
+    fit->fitCubic(start, i, Tangent1, fit->rightTangent(i));
+    start = i;
+    smooth = false;
+    next = FIX_STEP;
+    return;
+  }
+
+  int last = n-1;
+  if (last-start < next)
+    return;
+
+  TPolygon tail;
+  std::vector<int> ends;
+  fitTail(&tail, &ends);
+
+  // the centre tangent at the new start must not change with the samples
+  // still to come
+  size_t k = ends.size()-1;
+  while(k>0 && ends[k-1]+2 > last)
+    --k;
+  if (k==0) {
+    next = last-start + FIX_STEP;
+    return;
+  }
+  fixed.insert(fixed.end(), tail.begin(), tail.begin()+3*k);
+  start = ends[k-1];
+  smooth = true;
+  FitPoint t = -fit->centreTangent(start);
+  tangent.set(t.x, t.y);
+  next = FIX_STEP;
+}
+
+void
+TCurveFitter::fitTail(TPolygon *out, std::vector<int> *ends) const
+{
+  int last = fit->TotalCoords-1;
+  FitPoint Tangent1 = smooth ? FitPoint(tangent) : fit->leftTangent(start);
+  fit->fig = out;
+  fit->Ends = ends;
+  fit->fitCubic(start, last, Tangent1, fit->rightTangent(last));
+  fit->Ends = 0;
+}
+
+void
+TCurveFitter::curve(TPolygon *out) const
+{
+  out->clear();
+  if (fit->TotalCoords==0)
+    return;
+  out->addPoint(fit->PathArray[0].x, fit->PathArray[0].y);
+  out->insert(out->end(), fixed.begin(), fixed.end());
+  if (fit->TotalCoords-1 > start)
+    fitTail(out, nullptr);
+}
@@ -0,0 +1,82 @@
+/*
+ * Fischland -- A 2D vector graphics editor
+ * Copyright (C) 1999-2007 by Mark-André Hopf <mhopf@mark13.org>
+ * Visit http://www.mark13.org/fischland/.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _FISCHLAND_FITCURVE_HH
+#define _FISCHLAND_FITCURVE_HH 1
+
+#include <toad/types.hh>
+#include <vector>
+
+using namespace toad;
+
+struct CurveFitObject;
+
+/**
+ * Fit bézier curves to the points in 'in'.
+ *
+ * 'out' starts with the first point followed by three points, two control
+ * points and the end point, for each curve. 'smoothness' is the maximal
+ * squared distance of the points from the curves.
+ */
+void fitCurve(const TPolygon &in, TPolygon *out, int smoothness);
+
+/**
+ * Fit bézier curves to freehand samples while they arrive.
+ *
+ * Curves which end at a cusp or which are far enough behind the last
+ * sample are fixed, only the remaining tail is fitted again when the
+ * curve is requested. The result is the same as fitCurve() as long as the
+ * samples are split at cusps only, otherwise it stays within the
+ * smoothness of it.
+ */
+class TCurveFitter
+{
+  public:
+    TCurveFitter(int smoothness=50);
+    TCurveFitter(const TCurveFitter&) = delete;
+    TCurveFitter& operator=(const TCurveFitter&) = delete;
+    ~TCurveFitter();
+
+    void clear();
+    void setSmoothness(int smoothness);
+    void add(const TPoint &p);
+    bool empty() const;
+    //! number of samples, without repeated ones
+    size_t size() const;
+
+    //! the fixed curves and a fit of the tail, in the format of fitCurve()
+    void curve(TPolygon *out) const;
+
+  protected:
+    CurveFitObject *fit;
+    // the fixed curves without the first point
+    TPolygon fixed;
+    // first sample of the tail and whether it starts with the tangent
+    // 'tangent' instead of one after a cusp
+    int start;
+    bool smooth;
+    TPoint tangent;
+    // number of samples in the tail at which to try to fix more curves
+    int next;
+
+    void fitTail(TPolygon *out, std::vector<int> *ends) const;
+};
+
+#endif
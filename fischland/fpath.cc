@@ -24,6 +24,7 @@
 #include <toad/figureeditor.hh>
 #include <toad/geometry.hh>
 #include <cmath>
+#include <climits>
 
 /**
  *
@@ -69,17 +70,114 @@ TFPath::getAttributes(TFigureAttributeModel *preferences) const
   preferences->arrowtype = arrowtype;
 }
 
+// compact storage
+//---------------------------------------------------------------------------
+
+/**
+ * When 'true', paths are made compact after they were restored.
+ */
+bool TFPath::compactOnRestore = true;
+
+/**
+ * Store the points as 16 bit integers relative to the first point instead
+ * of in 'polygon', which needs 16 bytes per point.
+ *
+ * This is only possible when all coordinates are integers, which is the
+ * case for paths restored from a file, and the path is not wider or higher
+ * than 32767 units. Methods modifying the path call expand() to restore
+ * 'polygon' first.
+ *
+ * \return 'true' when the path is compact
+ */
+bool
+TFPath::compact()
+{
+  if (isCompact())
+    return true;
+  if (polygon.empty())
+    return false;
+
+  TPoint o = polygon[0];
+  if (o.x != rint(o.x) || o.y != rint(o.y))
+    return false;
+  for(auto &&p: polygon) {
+    TCoord dx = p.x - o.x,
+           dy = p.y - o.y;
+    if (dx != rint(dx) || dy != rint(dy) ||
+        dx < SHRT_MIN || dx > SHRT_MAX || dy < SHRT_MIN || dy > SHRT_MAX)
+      return false;
+  }
+
+  origin = o;
+  packed.reserve(polygon.size()*2);
+  for(auto &&p: polygon) {
+    packed.push_back(p.x - origin.x);
+    packed.push_back(p.y - origin.y);
+  }
+  TPolygon().swap(polygon);
+  corner.shrink_to_fit();
+  return true;
+}
+
+/**
+ * Restore 'polygon' of a compact path.
+ */
+void
+TFPath::expand() const
+{
+  if (!isCompact())
+    return;
+  decode(&polygon);
+  vector<int16_t>().swap(packed);
+}
+
+void
+TFPath::decode(TPolygon *out) const
+{
+  out->clear();
+  out->reserve(packed.size()/2);
+  for(size_t i=0; i<packed.size(); i+=2)
+    out->addPoint(origin.x + packed[i], origin.y + packed[i+1]);
+}
+
+/**
+ * The points for read-only access without expanding a compact path.
+ *
+ * For compact paths the points are decoded into the caller's 'buffer',
+ * so this can be called from several threads and results can be kept.
+ */
+const TPolygon&
+TFPath::points(TPolygon &buffer) const
+{
+  if (!isCompact())
+    return polygon;
+  decode(&buffer);
+  return buffer;
+}
+
+/**
+ * Memory used by this figure in bytes.
+ */
+size_t
+TFPath::getMemorySize() const
+{
+  return sizeof(TFPath) +
+         polygon.capacity() * sizeof(TPoint) +
+         packed.capacity() * sizeof(int16_t) +
+         corner.capacity() * sizeof(unsigned char);
+}
+
 
 TRectangle
 TFPath::bounds() const
 {
-  const TPoint *p = polygon.data();
-  size_t n = polygon.size();
+  size_t n = pointCount();
   TBoundary b;
-  while(n>3) {
-    b.expand(curveBounds(&(*p)));
-    p+=3;
-    n-=3;
+  for(size_t i=0; i+3<n; i+=3) {
+    TPoint curve[4];
+    for(size_t j=0; j<4; ++j)
+      curve[j] = point(i+j);
+    b.expand(curveBounds(curve));
   }
   return TRectangle(b);
 }
@@ -87,25 +185,27 @@ TFPath::bounds() const
 TRectangle
 TFPath::editBounds() const
 {
-  TRectangle r;
-  polygon.getShape(&r);
-  return r;
+  size_t n = pointCount();
+  TBoundary b;
+  for(size_t i=0; i<n; ++i)
+    b.expand(point(i));
+  return TRectangle(b);
 }
 
 bool
 TFPath::transform(const TMatrix2D &transform)
 {
-  for(auto &&p: polygon)
-    transform.map(p, &p);
+  expand();
+  polygon.transform(transform);
   return true;
 }
 
 bool 
 TFPath::getHandle(unsigned handle, TPoint *p)
 {
-  if (handle >= polygon.size())
+  if (handle >= pointCount())
     return false;
-  *p = polygon[handle];
+  *p = point(handle);
   return true;
 }
 
@@ -113,6 +213,7 @@ void
 TFPath::translateHandle(unsigned handle, TCoord x, TCoord y, unsigned m)
 {
 //cout << "TFPath::translateHandle: " << handle << endl;
+  expand();
   
   unsigned c = cornerAtHandle(handle);
   switch( (handle+1)%3 ) {
@@ -207,6 +308,8 @@ TFPath::paintSelection(TPenBase &pen, int handle)
 {
   pen.setLineWidth(1);
 
+  size_t n = pointCount();
+
   TMatrix2D _m0;
   const TMatrix2D *m0 = pen.getMatrix();
   if (m0) {
@@ -218,14 +321,16 @@ TFPath::paintSelection(TPenBase &pen, int handle)
   pen.setFillColor(TColor::WHITE);
 
 //  if (type==EDIT || type==SELECT) {
-    for(TPolygon::size_type i=0; i<polygon.size(); i+=3) {
+    for(TPolygon::size_type i=0; i<n; i+=3) {
       // line before corner
       TCoord x0, y0, x1, y1;
+      TPoint corner = point(i);
       if (i>0) {
-        x0 = polygon[i].x;
-        y0 = polygon[i].y;
-        x1 = polygon[i-1].x;
-        y1 = polygon[i-1].y;
+        TPoint handle = point(i-1);
+        x0 = corner.x;
+        y0 = corner.y;
+        x1 = handle.x;
+        y1 = handle.y;
         if (m0) {
           m0->map(x0, y0, &x0, &y0);
           m0->map(x1, y1, &x1, &y1);
@@ -250,11 +355,12 @@ TFPath::paintSelection(TPenBase &pen, int handle)
       }
 */    
       // line after corner
-      if (i+1<polygon.size()) {
-        x0 = polygon[i].x;
-        y0 = polygon[i].y;
-        x1 = polygon[i+1].x;
-        y1 = polygon[i+1].y;
+      if (i+1<n) {
+        TPoint handle = point(i+1);
+        x0 = corner.x;
+        y0 = corner.y;
+        x1 = handle.x;
+        y1 = handle.y;
         if (m0) {
           m0->map(x0, y0, &x0, &y0);
           m0->map(x1, y1, &x1, &y1);
@@ -264,13 +370,14 @@ TFPath::paintSelection(TPenBase &pen, int handle)
         pen.drawCirclePC(x1-2,y1-2,5,5);
       }
 //    }
-    for(TPolygon::size_type i=0; i<polygon.size(); i+=3) {
+    for(TPolygon::size_type i=0; i<n; i+=3) {
       TCoord x, y;
+      TPoint corner = point(i);
       if (m0) {
-        m0->map(polygon[i].x, polygon[i].y, &x, &y);
+        m0->map(corner.x, corner.y, &x, &y);
       } else {
-        x = polygon[i].x;
-        y = polygon[i].y;
+        x = corner.x;
+        y = corner.y;
       }
       pen.fillRectanglePC(x-2,y-2,5,5);
       pen.drawRectanglePC(x-2,y-2,5,5);
@@ -302,6 +409,11 @@ TFPath::paint(TPenBase &pen, EPaintType type)
   pen.setLineStyle(line_style);
   pen.setLineWidth(line_width);
 
+  // the pen needs the points in one piece, keep the memory for the next
+  // compact path
+  static thread_local TPolygon buffer;
+  const TPolygon &polygon = points(buffer);
+
   if (closed && filled) {
     pen.setFillColor(fill_color);
     pen.fillBezier(polygon);
@@ -344,14 +456,27 @@ TFPath::paint(TPenBase &pen, EPaintType type)
 double
 TFPath::_distance(TFigureEditor *fe, TCoord x, TCoord y)
 {
+  static thread_local TPolygon buffer;
+  const TPolygon &polygon = points(buffer);
   if (!polygon.isInside(x, y)) {
     TCoord min = polygon.distance(TPoint(x, y));
     if (min > 0.5*fe->fuzziness*TFigure::RANGE)
       return OUT_OF_RANGE;
   }
    
-  TPolygon p2;
-  TPenBase::poly2Bezier(polygon, p2);
+  // a quarter of a pixel on the screen
+  TCoord tolerance = 0.25;
+  const TMatrix2D *m = fe->getMatrix();
+  if (m) {
+    TCoord scale = sqrt(fabs(m->a * m->d - m->b * m->c));
+    if (scale>0.0)
+      tolerance /= scale;
+  }
+  // only the paths near the pointer get here, keep a few of them as lines
+  // while the pointer moves over them
+  static TFlatteningCache flattened[8];
+  TFlatteningCache &cache = flattened[(reinterpret_cast<uintptr_t>(this) / sizeof(TFPath)) % 8];
+  const TPolygon &p2 = cache.flatten(polygon, tolerance);
   if (closed && filled) {
     if (p2.isInside(x, y))
       return INSIDE;
@@ -410,6 +535,7 @@ TFPath::mouseRDown(TFigureEditor *editor, TMouseEvent &m)
 //cerr << " 1s point at (" << polygon[0].x << ", " << polygon[0].y << ")\n";
 
 //cerr << "editor->fuzziness = " << editor->fuzziness << endl;
+  expand();
   unsigned i=0;
   bool found=false;
   for(TPolygon::iterator p=polygon.begin();
@@ -440,6 +566,8 @@ TFPath::mouseRDown(TFigureEditor *editor, TMouseEvent &m)
       _x, m.pos.x,
       _y, m.pos.y,
       edit->invalidateFigure(figure);
+      if (edit->getModel())
+        edit->getModel()->modify(figure);
       figure->insertPointNear(_x, _y);
       edit->invalidateFigure(figure); 
     )
@@ -455,6 +583,8 @@ TFPath::mouseRDown(TFigureEditor *editor, TMouseEvent &m)
         edit->deleteFigure(figure);   
       } else {
         edit->invalidateFigure(figure);
+        if (edit->getModel())
+          edit->getModel()->modify(figure);
         figure->deletePoint(_i);
       }
       edit->invalidateFigure(figure);
@@ -570,6 +700,7 @@ void
 TFPath::insertPointNear(TCoord x, TCoord y)
 {
 //  cerr << "add point near " << x << ", " << y << endl;
+  expand();
 
   unsigned i=0, j;
   TCoord f, min;
@@ -629,17 +760,19 @@ TFPath::insertPointNear(TCoord x, TCoord y)
 TCoord
 TFPath::findPointNear(TCoord inX, TCoord inY, TCoord *outX, TCoord *outY, TCoord *outF) const
 {
-  assert(polygon.size()>=4);
+  size_t n = pointCount();
+  assert(n>=4);
   unsigned i=0, j;
   TCoord f, f0, min;
 
-  for(j=0; j+3 <= polygon.size(); j+=3) {
+  for(j=0; j+3 <= n; j+=3) {
     TCoord u, d;
+    TPoint p0 = point(j), p1 = point(j+1), p2 = point(j+2), p3 = point(j+3);
     u = bezpoint(inX, inY,
-                 polygon[j  ].x, polygon[j  ].y,
-                 polygon[j+1].x, polygon[j+1].y,
-                 polygon[j+2].x, polygon[j+2].y,
-                 polygon[j+3].x, polygon[j+3].y,
+                 p0.x, p0.y,
+                 p1.x, p1.y,
+                 p2.x, p2.y,
+                 p3.x, p3.y,
                  0.0, 1.0, &d);
 //cout << "distance to ("<<inX<<","<<inY<<" is "<<d<<endl;
     if (j==0) {
@@ -655,12 +788,13 @@ TFPath::findPointNear(TCoord inX, TCoord inY, TCoord *outX, TCoord *outY, TCoord
     }  
   }    
        
-  TCoord x0 = f*(polygon[i+1].x-polygon[i+0].x) + polygon[i+0].x;
-  TCoord y0 = f*(polygon[i+1].y-polygon[i+0].y) + polygon[i+0].y;
-  TCoord x1 = f*(polygon[i+2].x-polygon[i+1].x) + polygon[i+1].x;
-  TCoord y1 = f*(polygon[i+2].y-polygon[i+1].y) + polygon[i+1].y;
-  TCoord x2 = f*(polygon[i+3].x-polygon[i+2].x) + polygon[i+2].x;
-  TCoord y2 = f*(polygon[i+3].y-polygon[i+2].y) + polygon[i+2].y;
+  TPoint p0 = point(i), p1 = point(i+1), p2 = point(i+2), p3 = point(i+3);
+  TCoord x0 = f*(p1.x-p0.x) + p0.x;
+  TCoord y0 = f*(p1.y-p0.y) + p0.y;
+  TCoord x1 = f*(p2.x-p1.x) + p1.x;
+  TCoord y1 = f*(p2.y-p1.y) + p1.y;
+  TCoord x2 = f*(p3.x-p2.x) + p2.x;
+  TCoord y2 = f*(p3.y-p2.y) + p2.y;
 
   TCoord x3 = f*(x1-x0) + x0;
   TCoord y3 = f*(y1-y0) + y0;
@@ -683,6 +817,7 @@ TFPath::deletePoint(unsigned i)
   // don't delete curve handles
   if ((i%3)!=0)
     return;
+  expand();
   if (polygon.size()<=4)
     return;
 
@@ -739,20 +874,19 @@ TFPath::store(TOutObjectStream &out) const
   }
 
   ::store(out, "closed", closed);
-  unsigned i = 0;
-  for(TPolygon::const_iterator p = polygon.begin();
-      p != polygon.end();
-      ++p, ++i)
-  {
-    if (i==0 || i%3 == 2 ) {
-      out.indent();
-      unsigned c = 3;
-      unsigned j = (i+1)/3;
-      if (j<corner.size())
-        c = corner[j];
-      out << c;
-    }
-    out << ' ' << p->x << ' ' << p->y;
+  size_t size = pointCount();
+  for(size_t i=0; i<size; i += i==0 ? 2 : 3) {
+    out.indent();
+    unsigned c = 3;
+    unsigned j = (i+1)/3;
+    if (j<corner.size())
+      c = corner[j];
+    out << c;
+    size_t n = min<size_t>(i==0 ? 2 : 3, size-i);
+    TPoint p[3];
+    for(size_t k=0; k<n; ++k)
+      p[k] = point(i+k);
+    storeNumbers(out, reinterpret_cast<const TCoord*>(p), 2*n);
   }
 }
 
@@ -762,6 +896,11 @@ TFPath::store(TOutObjectStream &out) const
 bool
 TFPath::restore(TInObjectStream &in)
 {
+  if (in.what == ATV_FINISHED) {
+    if (compactOnRestore)
+      compact();
+    return TAttributedFigure::restore(in);
+  }
   if (in.what == ATV_VALUE && in.attribute.empty() && in.type.empty()) {
 //    cerr << "corner: " << in.value << endl;
     unsigned n;
@@ -780,13 +919,15 @@ TFPath::restore(TInObjectStream &in)
         in.putback('}');
         break;
       }
-      int x, y;
-      x = atoi(in.value.c_str());
-//      cerr << in.value << ", ";
-      in.parse();
-      y = atoi(in.value.c_str());
-      polygon.addPoint(x, y);
-//      cerr << in.value << ", ";
+      TPoint pt;
+      if (!parseNumber(in.value, &pt.x) ||
+          !restoreNumbers(in, &pt.y, 1))
+      {
+        in.setInterpreter(this);
+        ATV_FAILED(in)
+        return false;
+      }
+      polygon.addPoint(pt);
     }
 //    cerr << endl;
     in.setInterpreter(this);
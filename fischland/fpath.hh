@@ -21,6 +21,8 @@
 #ifndef _FISCHLAND_FPATH_HH
 #define _FISCHLAND_FPATH_HH 1
 #include <toad/figure.hh>
+#include <toad/geometry.hh>
+#include <cstdint>
 
 using namespace toad;
 
@@ -42,8 +44,8 @@ class TFPath:
     TCoord _distance(TFigureEditor *fe, TCoord x, TCoord y) override;
     unsigned mouseRDown(TFigureEditor*, TMouseEvent &) override;
     
-    void addPoint(const TPoint &p) { polygon.addPoint(p); }
-    void addPoint(TCoord x, TCoord y) { polygon.addPoint(x,y); }
+    void addPoint(const TPoint &p) { expand(); polygon.addPoint(p); }
+    void addPoint(TCoord x, TCoord y) { expand(); polygon.addPoint(x,y); }
     TCoord findPointNear(TCoord inX, TCoord inY, TCoord *outX, TCoord *outY, TCoord *outF=0) const;
     void insertPointNear(TCoord x, TCoord y);
     void deletePoint(unsigned i);
@@ -55,8 +57,23 @@ class TFPath:
     unsigned cornerAtHandle(TPolygon::size_type handle);
 
 //    bool closed;
-    TPolygon polygon;
     vector<unsigned char> corner;
+
+    // compact storage of the points as 16 bit integers relative to an origin
+    static bool compactOnRestore;
+    bool compact();
+    void expand() const;
+    bool isCompact() const { return !packed.empty(); }
+    size_t getMemorySize() const;
+    //! the points for modifying the path, expands a compact path
+    TPolygon& getPolygon() { expand(); return polygon; }
+    //! read only access without expanding, decodes a compact path into 'buffer'
+    const TPolygon& points(TPolygon &buffer) const;
+    //! read only access to a single point without expanding
+    TPoint point(size_t i) const {
+      return isCompact() ? TPoint(origin.x + packed[i*2], origin.y + packed[i*2+1]) : polygon[i];
+    }
+    size_t pointCount() const { return isCompact() ? packed.size()/2 : polygon.size(); }
     
     void setAttributes(const TFigureAttributeModel*) override;
     void getAttributes(TFigureAttributeModel*) const override;
@@ -65,6 +82,15 @@ class TFPath:
     TFigureArrow::EArrowType arrowtype;
     TCoord arrowheight;
     TCoord arrowwidth;
+
+  protected:
+    void decode(TPolygon *out) const;
+
+  private:
+    // empty while the path is compact
+    mutable TPolygon polygon;
+    TPoint origin;
+    mutable vector<int16_t> packed;
 };
 
 #endif
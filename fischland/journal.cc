@@ -0,0 +1,706 @@
+/*
+ * Fischland -- A 2D vector graphics editor
+ * Copyright (C) 1999-2005 by Mark-André Hopf <mhopf@mark13.org>
+ * Visit http://www.mark13.org/fischland/.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "journal.hh"
+#include "page.hh"
+
+#include <toad/figureeditor.hh>
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <unordered_map>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace fischland;
+
+namespace {
+
+// FNV-1a, to recognize the file a journal belongs to
+string
+fingerprint(const string &text)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for(unsigned char c: text) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+  return buffer;
+}
+
+struct TPlace
+{
+  TSlide *slide;
+  TLayer *layer;
+  string address;
+  bool pending;
+};
+
+void
+collectLayers(TDocument *document, TSlide *slide, TLayer *layer, const string &address, vector<TPlace> *places)
+{
+  for(unsigned i=0; layer; layer=layer->next, ++i) {
+    string a = address + to_string(i);
+    bool pending = document->loader && document->loader->isPending(layer);
+    places->push_back({ slide, layer, a, pending });
+    collectLayers(document, slide, layer->down, a + ".", places);
+  }
+}
+
+// the slides of the document, each followed by those below it, and their
+// layers along with their address
+void
+collectLayers(TDocument *document, TSlide *slide, vector<TSlide*> *slides, vector<TPlace> *places)
+{
+  for(; slide; slide=slide->next) {
+    string address = to_string(slides->size()) + ":";
+    slides->push_back(slide);
+    collectLayers(document, slide, slide->content.getRoot(), address, places);
+    collectLayers(document, slide->down, slides, places);
+  }
+}
+
+void
+describe(ostream &out, const string &text)
+{
+  out << text.size() << ':' << text;
+}
+
+void
+describe(ostream &out, const TPlainSlide *slide)
+{
+  describe(out, slide->name);
+  describe(out, slide->comment);
+  out << slide->lock << slide->show << slide->print;
+}
+
+void
+describeSlides(ostream &out, TSlide *slide)
+{
+  for(; slide; slide=slide->next) {
+    describe(out, slide);
+    // the layers' own attributes are in describeLayer(), as they aren't
+    // known before a layer is restored
+    unsigned n = 0;
+    for(TLayer *layer = slide->content.getRoot(); layer; layer=layer->next)
+      ++n;
+    out << n << '(';
+    describeSlides(out, slide->down);
+    out << ')';
+  }
+}
+
+// the parts of the document which aren't in the layers' figures
+string
+describeSlides(TDocument *document)
+{
+  ostringstream out;
+  describe(out, document->author);
+  describe(out, document->date);
+  describe(out, document->description);
+  describeSlides(out, document->content.getRoot());
+  return out.str();
+}
+
+string
+describeLayer(TLayer *layer)
+{
+  ostringstream out;
+  describe(out, layer);
+  unsigned n = 0;
+  for(TLayer *down = layer->down; down; down=down->next)
+    ++n;
+  out << n;
+  return out.str();
+}
+
+// write 'text' to the end of the file or in place of it and wait until it
+// reached the disk, so that an entry isn't lost by a crash after append()
+// reported it as written
+bool
+writeSynced(const string &filename, const string &text, bool append, ostream &err)
+{
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0644);
+  if (fd==-1) {
+    err << "failed to open '" << filename << "': " << strerror(errno) << endl;
+    return false;
+  }
+  const char *p = text.data(), *e = p + text.size();
+  while(p<e) {
+    ssize_t n = write(fd, p, e-p);
+    if (n==-1 && errno==EINTR)
+      continue;
+    if (n==-1) {
+      err << "failed to write '" << filename << "': " << strerror(errno) << endl;
+      close(fd);
+      return false;
+    }
+    p += n;
+  }
+#ifdef F_FULLFSYNC
+  // fsync() on macOS leaves the data in the drive's cache
+  bool synced = fcntl(fd, F_FULLFSYNC)!=-1 || fsync(fd)==0;
+#else
+  bool synced = fsync(fd)==0;
+#endif
+  if (close(fd)==-1)
+    synced = false;
+  if (!synced) {
+    err << "failed to write '" << filename << "': " << strerror(errno) << endl;
+    return false;
+  }
+  return true;
+}
+
+void
+deleteSplices(TJournalEntry *entry, bool figures)
+{
+  for(auto &&splice: entry->splices) {
+    if (figures) {
+      for(auto &&figure: splice->figures)
+        delete figure;
+    }
+    delete splice;
+  }
+  entry->splices.clear();
+}
+
+} // namespace
+
+TJournal::TJournal(TDocument *document):
+  document(document)
+{
+  snapshotSize = size = savedSize = 0;
+  changed = false;
+  savedEntries = 0;
+}
+
+TJournal::~TJournal()
+{
+  untrack();
+  clearEntries();
+}
+
+/**
+ * Read the journal of the file 'filename', which contains 'text', and
+ * keep the entries belonging to this version of the file for replay().
+ */
+bool
+TJournal::read(const string &filename, const string &text)
+{
+  clearEntries();
+  err.str("");
+  this->filename = filename;
+  hash = fingerprint(text);
+  snapshotSize = text.size();
+  size = savedSize = 0;
+
+  ifstream fin((filename + ".journal").c_str());
+  if (!fin)
+    return true;
+  string journal((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+
+  // an entry cut off by a crash while it was written is left out
+  vector<TATVGroupRange> groups;
+  findGroups(journal, "fischland::TJournalEntry", &groups);
+  for(auto &&group: groups) {
+    if (group.end==0)
+      break;
+    istringstream stream(journal.substr(group.begin, group.end - group.begin));
+    TInObjectStream in(&stream);
+    TSerializable *s = in.restore();
+    TJournalEntry *entry = dynamic_cast<TJournalEntry*>(s);
+    if (!in || !entry) {
+      err << in.getErrorText();
+      if (entry)
+        deleteSplices(entry, true);
+      delete s;
+      clearEntries();
+      return false;
+    }
+    if (entry->snapshot!=hash) {
+      // the journal of an older version of the file
+      deleteSplices(entry, true);
+      delete entry;
+      break;
+    }
+    entries.push_back(entry);
+    // TOutObjectStream starts each entry with a newline, so the one after
+    // an entry belongs to the next and is cut off along with it
+    ends.push_back(group.end);
+    if (entry->saved)
+      savedEntries = entries.size();
+  }
+  return true;
+}
+
+/**
+ * Apply the entries found by read() to the document and start to track
+ * its changes.
+ *
+ * \param unsaved also apply the entries which weren't marked as saved
+ */
+bool
+TJournal::replay(bool unsaved)
+{
+  size_t n = unsaved ? entries.size() : savedEntries;
+  for(size_t i=0; i<n; ++i) {
+    for(auto &&splice: entries[i]->splices) {
+      if (!apply(splice)) {
+        // keep the journal as it is, as the document may be incomplete now
+        clearEntries();
+        filename.clear();
+        return false;
+      }
+    }
+  }
+
+  // truncate what wasn't replayed, ie. what a crash left after the last
+  // entry
+  size = n ? ends[n-1] : 0;
+  savedSize = savedEntries ? ends[savedEntries-1] : 0;
+  clearEntries();
+  string journal = filename + ".journal";
+  if (size)
+    truncate(journal.c_str(), size);
+  else
+    unlink(journal.c_str());
+  reset();
+  return true;
+}
+
+bool
+TJournal::apply(TJournalSplice *splice)
+{
+  vector<TSlide*> slides;
+  vector<TPlace> places;
+  collectLayers(document, document->content.getRoot(), &slides, &places);
+  auto place = find_if(places.begin(), places.end(),
+                       [&](const TPlace &p) { return p.address == splice->layer; });
+  if (place==places.end() || place->pending) {
+    // the layer wasn't restored yet, see TDocument::restoreLazy()
+    size_t n = atoi(splice->layer.c_str());
+    if (n>=slides.size() || !document->load(slides[n])) {
+      err << "failed to restore the slide of layer " << splice->layer << endl;
+      return false;
+    }
+    slides.clear();
+    places.clear();
+    collectLayers(document, document->content.getRoot(), &slides, &places);
+    place = find_if(places.begin(), places.end(),
+                    [&](const TPlace &p) { return p.address == splice->layer; });
+    if (place==places.end()) {
+      err << "there is no layer " << splice->layer << endl;
+      return false;
+    }
+  }
+
+  return splice->apply(&place->layer->content, err);
+}
+
+/**
+ * Start a new journal after the document was written to 'filename' as
+ * 'text'.
+ */
+void
+TJournal::snapshot(const string &filename, const string &text)
+{
+  clearEntries();
+  err.str("");
+  this->filename = filename;
+  hash = fingerprint(text);
+  snapshotSize = text.size();
+  size = savedSize = 0;
+  unlink((filename + ".journal").c_str());
+  reset();
+}
+
+/**
+ * Append the changes since the journal was written last.
+ *
+ * \param saved 'true' when the document is saved, 'false' for autosaves
+ * \return 'false' when the document has to be written again instead, see
+ *         the class description
+ */
+bool
+TJournal::append(bool saved)
+{
+  if (filename.empty())
+    return false;
+  // replaying a journal larger than half of the file takes about as long as
+  // restoring the file, which autosaves mustn't make any slower either
+  if (size > snapshotSize/2)
+    return false;
+  if (describeSlides(document)!=outline)
+    return false;
+
+  vector<TSlide*> slides;
+  vector<TPlace> places;
+  collectLayers(document, document->content.getRoot(), &slides, &places);
+
+  std::set<const TFigure*> related;
+  for(auto &&relation: TFigureEditor::relatedTo) {
+    related.insert(relation.first);
+    related.insert(relation.second.begin(), relation.second.end());
+  }
+
+  TJournalEntry entry;
+  entry.snapshot = hash;
+  entry.saved = saved;
+  vector<std::pair<TFigureModel*, TLayerState*>> modified;
+  bool result = true;
+  for(auto &&place: places) {
+    if (place.pending)
+      continue;
+    TFigureModel *model = &place.layer->content;
+    auto p = layers.find(model);
+    if (p==layers.end() ||
+        p->second.address != place.address ||
+        p->second.description != describeLayer(place.layer))
+    {
+      result = false;
+      break;
+    }
+    TLayerState &state = p->second;
+    if (state.dirty.empty() &&
+        state.figures.size()==model->size() &&
+        equal(state.figures.begin(), state.figures.end(), model->begin()))
+    {
+      continue;
+    }
+    if (!TJournalSplice::diff(state.figures, *model, state.dirty, place.address, related, &entry.splices)) {
+      result = false;
+      break;
+    }
+    modified.push_back(std::make_pair(model, &state));
+  }
+  if (!result) {
+    deleteSplices(&entry, false);
+    return false;
+  }
+
+  if (!entry.splices.empty() || (saved && savedSize<size)) {
+    ostringstream text;
+    {
+      TOutObjectStream out(&text);
+      out.store(&entry);
+    }
+    deleteSplices(&entry, false);
+
+    string journal = filename + ".journal";
+    if (!writeSynced(journal, text.str(), size!=0, err)) {
+      // don't leave a part of the entry in front of the next one
+      if (size)
+        truncate(journal.c_str(), size);
+      else
+        unlink(journal.c_str());
+      return false;
+    }
+    size += text.str().size();
+    if (saved)
+      savedSize = size;
+  }
+
+  for(auto &&p: modified) {
+    p.second->figures.assign(p.first->begin(), p.first->end());
+    p.second->dirty.clear();
+  }
+  changed = false;
+  return true;
+}
+
+/**
+ * Drop the entries autosaved since the document was saved last, ie. when
+ * it's closed without saving it.
+ *
+ * The journal doesn't match the document afterwards, so the next save
+ * has to write the whole document again.
+ */
+void
+TJournal::discard()
+{
+  if (filename.empty())
+    return;
+  if (size!=savedSize) {
+    string journal = filename + ".journal";
+    if (savedSize)
+      truncate(journal.c_str(), savedSize);
+    else
+      unlink(journal.c_str());
+  }
+  filename.clear();
+}
+
+/**
+ * Track the changes of the layers which were restored since, see
+ * TDocument::load().
+ */
+void
+TJournal::track()
+{
+  vector<TSlide*> slides;
+  vector<TPlace> places;
+  collectLayers(document, document->content.getRoot(), &slides, &places);
+  for(auto &&place: places) {
+    if (place.pending)
+      continue;
+    TFigureModel *model = &place.layer->content;
+    auto p = layers.insert(std::make_pair(model, TLayerState()));
+    if (!p.second)
+      continue;
+    TLayerState &state = p.first->second;
+    state.address = place.address;
+    state.description = describeLayer(place.layer);
+    state.figures.assign(model->begin(), model->end());
+    state.link = model->sigChanged.add([this, model] { modelChanged(model); });
+  }
+}
+
+// the document as it is is the one in the journal
+void
+TJournal::reset()
+{
+  untrack();
+  track();
+  outline = describeSlides(document);
+  changed = false;
+}
+
+void
+TJournal::untrack()
+{
+  for(auto &&p: layers)
+    p.first->sigChanged.remove(p.second.link);
+  layers.clear();
+}
+
+void
+TJournal::modelChanged(TFigureModel *model)
+{
+  auto p = layers.find(model);
+  if (p==layers.end())
+    return;
+  if (model->type==TFigureModel::DELETE) {
+    // the layer is deleted along with the signal
+    layers.erase(p);
+    return;
+  }
+  changed = true;
+  // figures which were added, removed or replaced are found by comparing
+  // the figures in append(), those modified in place are listed here. the
+  // list may be left over from an earlier notification, so it might contain
+  // figures which were deleted since.
+  for(auto &&figure: model->figures) {
+    if (figure)
+      p->second.dirty.insert(figure);
+  }
+}
+
+void
+TJournal::clearEntries()
+{
+  for(auto &&entry: entries) {
+    deleteSplices(entry, true);
+    delete entry;
+  }
+  entries.clear();
+  ends.clear();
+  savedEntries = 0;
+}
+
+/**
+ * Append the splices which turn the figures 'before' into those of
+ * 'model' to 'splices'.
+ *
+ * The figures found in both, in the same order and not 'dirty' are kept,
+ * these are the longest increasing run of their former positions. Each gap
+ * between them becomes a splice. They're appended from the last to the
+ * first, so that the position of each splice is still the one in 'before'
+ * when they're applied one after the other.
+ *
+ * \return 'false' when a figure in a splice is connected by a relation,
+ *         which the journal can't restore
+ */
+bool
+TJournalSplice::diff(const vector<TFigure*> &before, const TFigureModel &model,
+                     const TFigureSet &dirty, const string &address,
+                     const std::set<const TFigure*> &related,
+                     vector<TJournalSplice*> *splices)
+{
+  std::unordered_map<const TFigure*, size_t> position;
+  position.reserve(before.size());
+  for(size_t i=0; i<before.size(); ++i)
+    position[before[i]] = i;
+
+  // the figures which may be kept, as pairs of their position before and now
+  vector<std::pair<size_t, size_t>> kept;
+  for(size_t i=0; i<model.size(); ++i) {
+    if (dirty.contains(model[i]))
+      continue;
+    auto p = position.find(model[i]);
+    if (p!=position.end())
+      kept.push_back(std::make_pair(p->second, i));
+  }
+
+  // tails[n] is the index in kept of the smallest end of a run of length n+1
+  vector<size_t> tails, previous(kept.size());
+  for(size_t i=0; i<kept.size(); ++i) {
+    auto t = lower_bound(tails.begin(), tails.end(), kept[i].first,
+                         [&](size_t k, size_t value) { return kept[k].first < value; });
+    previous[i] = t==tails.begin() ? kept.size() : *(t-1);
+    if (t==tails.end())
+      tails.push_back(i);
+    else
+      *t = i;
+  }
+  vector<std::pair<size_t, size_t>> anchors(tails.size());
+  for(size_t i=tails.size(), k=tails.empty() ? 0 : tails.back(); i>0; k=previous[k])
+    anchors[--i] = kept[k];
+  anchors.push_back(std::make_pair(before.size(), model.size()));
+
+  vector<TJournalSplice*> layerSplices;
+  size_t from = 0, to = 0;
+  bool result = true;
+  for(auto &&anchor: anchors) {
+    if (anchor.first > from || anchor.second > to) {
+      TJournalSplice *splice = new TJournalSplice();
+      layerSplices.push_back(splice);
+      splice->layer = address;
+      splice->at = from;
+      splice->erase = anchor.first - from;
+      splice->figures.assign(model.begin() + to, model.begin() + anchor.second);
+      for(size_t i=from; i<anchor.first; ++i) {
+        if (related.find(before[i])!=related.end())
+          result = false;
+      }
+      for(auto &&figure: splice->figures) {
+        if (related.find(figure)!=related.end())
+          result = false;
+      }
+    }
+    from = anchor.first + 1;
+    to = anchor.second + 1;
+  }
+  if (!result) {
+    for(auto &&splice: layerSplices)
+      delete splice;
+    return false;
+  }
+  splices->insert(splices->end(), layerSplices.rbegin(), layerSplices.rend());
+  return true;
+}
+
+/**
+ * Replace the figures of 'model' the splice refers to with those of the
+ * splice, which are handed over to the model.
+ *
+ * \return 'false' when the model has fewer figures than the splice erases
+ */
+bool
+TJournalSplice::apply(TFigureModel *model, ostream &err)
+{
+  if (at + erase > model->size()) {
+    err << "layer " << layer << " has " << model->size()
+        << " figures but the journal replaces " << at << " to "
+        << (at + erase) << endl;
+    return false;
+  }
+  TFigureSet erased;
+  for(size_t i=at; i<at+erase; ++i)
+    erased.insert((*model)[i]);
+  // deletes the figures when it goes out of scope
+  TFigureAtDepthList deleted;
+  model->pureErase(erased, &deleted);
+
+  TFigureAtDepthList placement;
+  for(size_t i=0; i<figures.size(); ++i)
+    placement.push_back(figures[i], at + i);
+  model->pureInsert(placement);
+  placement.drop();
+  figures.clear();
+  return true;
+}
+
+void
+TJournalSplice::store(TOutObjectStream &out) const
+{
+  ::store(out, "layer", layer);
+  ::store(out, "at", at);
+  ::store(out, "erase", erase);
+  for(auto &&figure: figures)
+    ::store(out, figure);
+}
+
+bool
+TJournalSplice::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP) {
+    TSerializable *s = in.clone(in.type);
+    TFigure *figure = dynamic_cast<TFigure*>(s);
+    if (!figure) {
+      delete s;
+      return false;
+    }
+    figures.push_back(figure);
+    in.setInterpreter(figure);
+    return true;
+  }
+  if (
+    ::restore(in, "layer", &layer) ||
+    ::restore(in, "at", &at) ||
+    ::restore(in, "erase", &erase) ||
+    TSerializable::restore(in)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+void
+TJournalEntry::store(TOutObjectStream &out) const
+{
+  ::store(out, "snapshot", snapshot);
+  ::store(out, "saved", saved);
+  for(auto &&splice: splices)
+    out.store(splice);
+}
+
+bool
+TJournalEntry::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP && in.type == "fischland::TJournalSplice") {
+    TJournalSplice *splice = new TJournalSplice();
+    splices.push_back(splice);
+    in.setInterpreter(splice);
+    return true;
+  }
+  if (
+    ::restore(in, "snapshot", &snapshot) ||
+    ::restore(in, "saved", &saved) ||
+    TSerializable::restore(in)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
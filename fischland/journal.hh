@@ -0,0 +1,159 @@
+/*
+ * Fischland -- A 2D vector graphics editor
+ * Copyright (C) 1999-2005 by Mark-André Hopf <mhopf@mark13.org>
+ * Visit http://www.mark13.org/fischland/.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _FISCHLAND_JOURNAL_HH
+#define _FISCHLAND_JOURNAL_HH 1
+
+#include <toad/figuremodel.hh>
+#include <toad/io/serializable.hh>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fischland {
+
+using namespace toad;
+
+struct TDocument;
+
+/**
+ * Replaces the figures 'at' to 'at'+'erase' of a layer with 'figures'.
+ *
+ * The layer is given by its address, the number of its slide and the
+ * path to it in the slide's layer tree, ie. "3:0.1".
+ */
+struct TJournalSplice:
+  public TSerializable
+{
+  SERIALIZABLE_INTERFACE(fischland::, TJournalSplice);
+public:
+  TJournalSplice() {
+    at = erase = 0;
+  }
+  static bool diff(const vector<TFigure*> &before, const TFigureModel &model,
+                   const TFigureSet &dirty, const string &address,
+                   const std::set<const TFigure*> &related,
+                   vector<TJournalSplice*> *splices);
+  bool apply(TFigureModel *model, std::ostream &err);
+
+  string layer;
+  unsigned at, erase;
+  // not owned, they're either in a layer or handed over to one by
+  // TJournal::replay()
+  vector<TFigure*> figures;
+};
+
+/**
+ * The changes made to a document between two calls to TJournal::append().
+ */
+struct TJournalEntry:
+  public TSerializable
+{
+  SERIALIZABLE_INTERFACE(fischland::, TJournalEntry);
+public:
+  TJournalEntry() {
+    saved = false;
+  }
+
+  // the hash of the file the entry applies to
+  string snapshot;
+  // written when the document was saved instead of autosaved
+  bool saved;
+  // not owned, see TJournal::clearEntries()
+  vector<TJournalSplice*> splices;
+};
+
+/**
+ * Saves a document by appending the changes since it was saved last to a
+ * journal next to its file, instead of writing all of it again.
+ *
+ * The journal's entries apply to the file with the hash they were written
+ * for, so a journal left over from an older version of the file is
+ * ignored. Entries written by autosaves aren't marked as saved, replay()
+ * applies them only when asked to recover them.
+ *
+ * append() fails when the changes can't be expressed as splices of the
+ * layers' figures, ie. when slides or layers were added, moved or renamed,
+ * when figures connected by relations were modified, or when the journal
+ * grew too large. The document has to be written again then, followed by
+ * snapshot(), which starts a new journal.
+ */
+class TJournal
+{
+  public:
+    TJournal(TDocument *document);
+    ~TJournal();
+    TJournal(const TJournal&) = delete;
+    TJournal& operator=(const TJournal&) = delete;
+
+    bool read(const string &filename, const string &text);
+    size_t getUnsaved() const { return entries.size() - savedEntries; }
+    bool replay(bool unsaved);
+
+    void snapshot(const string &filename, const string &text);
+    bool append(bool saved);
+    void discard();
+    void track();
+
+    const string& getFilename() const { return filename; }
+    bool isChanged() const { return changed; }
+    string getErrorText() const { return err.str(); }
+
+  protected:
+    // the figures of a layer when the journal was written last
+    struct TLayerState {
+      string address;
+      string description;
+      vector<TFigure*> figures;
+      TFigureSet dirty;
+      TSignalLink *link;
+    };
+
+    TDocument *document;
+    string filename;
+    string hash;
+    // the size of the document's file and of the journal up to the last
+    // entry and up to the last entry marked as saved
+    size_t snapshotSize, size, savedSize;
+    // the structure of the slides when the journal was written last
+    string outline;
+    std::map<TFigureModel*, TLayerState> layers;
+    bool changed;
+
+    // the entries read() found, of which the first 'savedEntries' end with
+    // one marked as saved, along with the size of the journal up to each
+    vector<TJournalEntry*> entries;
+    vector<size_t> ends;
+    size_t savedEntries;
+
+    std::stringstream err;
+
+    void modelChanged(TFigureModel *model);
+    bool apply(TJournalSplice *splice);
+    void reset();
+    void untrack();
+    void clearEntries();
+};
+
+} // namespace fischland
+
+#endif
@@ -23,28 +23,10 @@
 
 #include <toad/pushbutton.hh>
 #include <toad/textfield.hh>
+#include <toad/messagebox.hh>
 
 using namespace fischland;
 
-static char*
-number()
-{
-  static unsigned counter = 0;
-  counter++;
-  static char buffer[64];
-  snprintf(buffer, sizeof(buffer), "%u", counter);
-  return buffer;
-}
-  
-TPlainSlide::TPlainSlide()
-{
-  name = "unnamed #";
-  name += number();
-  lock = false;
-  show = true;
-  print = true;
-}
-
 TSlideTreeModel*
 TEditModel::getSlideTreeModel()
 {
@@ -150,6 +132,22 @@ TEditModel::changed(EReason reason)
       }
     }
     case SLIDE_CHANGED: {
+      if (document && document->loader) {
+        // restore the layers of the slide and of those above it, which are
+        // drawn along with it
+        size_t n = slide.getRow();
+        vector<TSlide*> path;
+        buildSlidePath(&path, document->content.getRoot(), &n);
+        for(auto &&s: path) {
+          if (!document->load(s)) {
+            messageBox(NULL,
+                       "Failed to load slide",
+                       "The layers of slide '" + s->name + "' failed to load:\n\n" +
+                       document->loader->getErrorText(),
+                       TMessageBox::ICON_EXCLAMATION | TMessageBox::OK);
+          }
+        }
+      }
       layer.select(0,0);
       TLayerTreeModel *nltm = getLayerTreeModel();
       if (nltm!=ltm) {
@@ -570,160 +568,3 @@ TPageDialog::command(unsigned cmd)
 #endif
   table->setFocus();
 }
-
-void
-TDocument::store(TOutObjectStream &out) const
-{
-  ::store(out, "author", author);
-  ::store(out, "date", date);
-  ::store(out, "description", description);
-
-  for(TSlide *slide = content.getRoot();
-      slide;
-      slide = slide->next)
-  {
-//cout << "document stores slide " << slide->name << endl;
-    out.store(slide);
-  }
-}
-
-bool
-TDocument::restore(TInObjectStream &in)
-{
-  if (in.what == ATV_GROUP && in.type == "fischland::TSlide") {
-    TSlide *slide = new TSlide();
-    // content.push_back(slide);
-    TSlide *p = content.getRoot();
-    if (!p) {
-      content.setRoot(slide);
-    } else {
-      while(p->next)
-        p = p->next;
-      p->next = slide;
-    }
-    in.setInterpreter(slide);
-    return true;
-  }
-  if (in.what == ATV_FINISHED) {
-    content.update(false);
-  }
-  if (
-    ::restore(in, "author", &author) ||
-    ::restore(in, "date", &date) ||
-    ::restore(in, "description", &description) ||
-    TSerializable::restore(in)
-  ) return true;
-  ATV_FAILED(in)
-  return false;
-}
-
-void
-TSlide::store(TOutObjectStream &out) const
-{
-//cout << "slide " << name << " stores itself" << endl;
-  ::store(out, "name",    name);
-  ::store(out, "comment", comment);
-  ::store(out, "lock",    lock);
-  ::store(out, "show",    show);
-  ::store(out, "print",   print);
-
-  for(TLayer *layer = content.getRoot();
-      layer;
-      layer = layer->next)
-  {
-//cout << "slide " << name << " stores layer " << layer->name << endl;
-    out.store(layer);
-  }
-  
-  for(TSlide *slide = down;
-      slide;
-      slide = slide->next)
-  {
-//cout << "slide " << name << " stores down slide " << slide->name << endl;
-    out.store(slide);
-  }
-}
-
-bool
-TSlide::restore(TInObjectStream &in)
-{
-  if (in.what == ATV_GROUP && in.type == "fischland::TLayer") {
-    TLayer *layer = new TLayer();
-    // content.push_back(slide);
-    TLayer *p = content.getRoot();
-    if (!p) {
-      content.setRoot(layer);
-    } else {
-      while(p->next)
-        p = p->next;
-      p->next = layer;
-    }
-    in.setInterpreter(layer);
-    return true;
-  }
-  if (in.what == ATV_GROUP && in.type == "fischland::TSlide") {
-    TSlide *slide = new TSlide();
-    // content.push_back(slide);
-    if (!down) {
-      down = slide;
-    } else {
-      TSlide *p = down;
-      while(p->next) {
-        p = p->next;
-      }
-      p->next = slide;
-    }
-    in.setInterpreter(slide);
-    return true;
-  }
-  if (in.what == ATV_FINISHED) {
-    content.update(false);
-  }
-  if (
-    ::restore(in, "name",    &name) ||
-    ::restore(in, "comment", &comment) ||
-    ::restore(in, "lock",    &lock) ||
-    ::restore(in, "show",    &show) ||
-    ::restore(in, "print",   &print) ||
-    TSerializable::restore(in)
-  ) return true;
-
-  ATV_FAILED(in)
-  return false;
-}
-
-void
-TLayer::store(TOutObjectStream &out) const
-{
-//cout << "layer " << name << " stores itself" << endl;
-  ::store(out, "name",    name);
-  ::store(out, "comment", comment);
-  ::store(out, "lock",    lock);
-  ::store(out, "show",    show);
-  ::store(out, "print",   print);
-
-  content.store(out);
-
-  for(TLayer *layer = down;
-      layer;
-      layer = layer->next)
-  {
-    out.store(layer);
-  }
-}
-
-bool
-TLayer::restore(TInObjectStream &in)
-{
-  if (
-    content.restore(in) ||
-    ::restore(in, "name",    &name) ||
-    ::restore(in, "comment", &comment) ||
-    ::restore(in, "lock",    &lock) ||
-    ::restore(in, "show",    &show) ||
-    ::restore(in, "print",   &print) ||
-    TSerializable::restore(in)
-  ) return true;
-  ATV_FAILED(in)
-  return false;
-}
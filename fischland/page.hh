@@ -27,6 +27,7 @@
 #include <toad/dialog.hh>
 #include <toad/treeadapter.hh>
 #include <toad/io/serializable.hh>
+#include <memory>
 
 namespace fischland {
 
@@ -54,6 +55,8 @@ struct TPlainSlide:
 
 // TDocument -> TSlide -> TLayer
 
+class TJournal;
+
 struct TLayer:
   public TPlainSlide
 {
@@ -63,8 +66,12 @@ public:
   TLayer() {
     next = down = 0;
   }
+  ~TLayer();
   TFigureModel content;
   TLayer *next, *down;
+  // set while this is the placeholder of a layer not restored yet, see
+  // TDocument::restoreLazy()
+  std::weak_ptr<TLazyLoader> loader;
 };
 
 class TLayerTreeModel:
@@ -100,6 +107,17 @@ public:
   string date;
   string description;
   TSlideTreeModel content;
+
+  static TDocument* restoreLazy(const string &text);
+  bool load(TSlide *slide);
+  bool loadNext();
+  bool loadAll();
+
+  // the layers not restored yet, when the document was restored by
+  // restoreLazy()
+  std::shared_ptr<TLazyLoader> loader;
+  // the changes since the document was saved, see TJournal
+  std::shared_ptr<TJournal> journal;
 };
 
 // usually there's only one edit model? no!
@@ -67,7 +67,9 @@ TPencilTool::paintSelection(TFigureEditor *fe, TPenBase &pen)
 {
 //  if ([NSEvent isMouseCoalescingEnabled]) {
 //printf("paint\n");
-    pen.drawLines(polygon);
+    TPolygon curve;
+    fitter.curve(&curve);
+    pen.drawBezier(curve);
     return true;
 //  }
 
@@ -104,8 +106,6 @@ TPencilTool::stop(TFigureEditor *fe)
   fe->invalidateWindow();
 }
 
-void fitCurve(const TPolygon &in, TPolygon *out, int smoothness);
-
 void
 TPencilTool::keyEvent(TFigureEditor *fe, const TKeyEvent &ke)
 {
@@ -119,6 +119,14 @@ TPencilTool::keyEvent(TFigureEditor *fe, const TKeyEvent &ke)
 }
  
 
+// whether (x, y) is within 'fuzziness' of 'p'
+static bool
+isNear(const TPoint &p, TCoord x, TCoord y, TCoord fuzziness)
+{
+  return p.x - fuzziness <= x && x <= p.x + fuzziness &&
+         p.y - fuzziness <= y && y <= p.y + fuzziness;
+}
+
 void 
 TPencilTool::mouseEvent(TFigureEditor *fe, const TMouseEvent &me)
 {
@@ -145,6 +153,9 @@ static timeval t0;
       gettimeofday(&t0, 0);
       polygon.clear();
       polygon.addPoint(x, y);
+      fitter.clear();
+      fitter.setSmoothness(smoothness);
+      fitter.add(pos);
       closed = false;
       
       // check if we start at the head or tail of another line
@@ -156,25 +167,19 @@ static timeval t0;
         if (f) {
 /*
           cout << "found path" << endl;
-          cout << "  front: " << f->polygon.front().x << ", " << f->polygon.front().y << endl;
-          cout << "  back: " << f->polygon.back().x << ", " << f->polygon.back().y << endl;
+          cout << "  front: " << f->point(0).x << ", " << f->point(0).y << endl;
+          cout << "  back: " << f->point(f->pointCount()-1).x << ", " << f->point(f->pointCount()-1).y << endl;
           cout << "  mouse: " << x << ", " << y << endl;
           cout << "  fuzziness: " << fe->fuzziness << endl;
 */
           if (!f->closed &&
-              f->polygon.back().x - fe->fuzziness <= x &&
-              f->polygon.back().x + fe->fuzziness >= x &&
-              f->polygon.back().y - fe->fuzziness <= y &&
-              f->polygon.back().y + fe->fuzziness >= y )
+              isNear(f->point(f->pointCount()-1), x, y, fe->fuzziness))
           {
             back = f;
             break;
           } else
           if (!f->closed &&
-              f->polygon.front().x - fe->fuzziness <= x &&
-              f->polygon.front().x + fe->fuzziness >= x &&
-              f->polygon.front().y - fe->fuzziness <= y &&
-              f->polygon.front().y + fe->fuzziness >= y )
+              isNear(f->point(0), x, y, fe->fuzziness))
           {
             front = f;
             break;
@@ -194,19 +199,13 @@ static timeval t0;
           TFPath *f = dynamic_cast<TFPath*>(*p);
           if (f) {
             if (!f->closed &&
-                f->polygon.back().x - fe->fuzziness <= x &&
-                f->polygon.back().x + fe->fuzziness >= x &&
-                f->polygon.back().y - fe->fuzziness <= y &&
-                f->polygon.back().y + fe->fuzziness >= y )
+                isNear(f->point(f->pointCount()-1), x, y, fe->fuzziness))
             {
               fe->getWindow()->setCursor(fischland::cursor[CURSOR_PENCIL_CLOSE]);
               return;
             } else
             if (!f->closed &&
-                f->polygon.front().x - fe->fuzziness <= x &&
-                f->polygon.front().x + fe->fuzziness >= x &&
-                f->polygon.front().y - fe->fuzziness <= y &&
-                f->polygon.front().y + fe->fuzziness >= y )
+                isNear(f->point(0), x, y, fe->fuzziness))
             {
               fe->getWindow()->setCursor(fischland::cursor[CURSOR_PENCIL_CLOSE]);
               return;
@@ -220,18 +219,11 @@ static timeval t0;
       // closed := near end of other selected path
       if (
         ( front &&
-          front->polygon.back().x-fe->fuzziness <= x && 
-          front->polygon.back().x+fe->fuzziness >= x &&
-          front->polygon.back().y-fe->fuzziness <= y &&
-          front->polygon.back().y+fe->fuzziness >= y) ||
+          isNear(front->point(front->pointCount()-1), x, y, fe->fuzziness)) ||
         ( back &&
-          back->polygon.front().x-fe->fuzziness <= x && 
-          back->polygon.front().x+fe->fuzziness >= x &&
-          back->polygon.front().y-fe->fuzziness <= y &&
-          back->polygon.front().y+fe->fuzziness >= y) ||
+          isNear(back->point(0), x, y, fe->fuzziness)) ||
         (!polygon.empty() &&
-          polygon.front().x-fe->fuzziness<=x && x<=polygon.front().x+fe->fuzziness &&
-          polygon.front().y-fe->fuzziness<=y && y<=polygon.front().y+fe->fuzziness)
+          isNear(polygon.front(), x, y, fe->fuzziness))
         )
       {
         fe->getWindow()->setCursor(fischland::cursor[CURSOR_PENCIL_CLOSE]);
@@ -243,6 +235,7 @@ static timeval t0;
       
       // sample the new point
       polygon.addPoint(x,y);
+      fitter.add(pos);
 
       // indicate the new point to the user
       timeval t1;
@@ -270,13 +263,15 @@ static timeval t0;
         TFPath *f = new TFPath();
         if (me.modifier() & MK_CONTROL || (closed&&!front&&!back)) {
           polygon.addPoint(polygon[0].x, polygon[0].y);
+          fitter.add(polygon[0]);
           f->closed = true;
         }
         fe->getAttributes()->setAllReasons();
         f->setAttributes(fe->getAttributes());
         fe->getAttributes()->clearReasons();
 
-        fitCurve(polygon, &f->polygon, smoothness);
+        TPolygon &curve = f->getPolygon();
+        fitter.curve(&curve);
 
         // snap to another path
         // this could be improved: if we cross the other line, we cut
@@ -293,13 +288,13 @@ static timeval t0;
             if (!path)
               continue;
             TCoord x, y, d;
-            d = path->findPointNear(f->polygon[0].x, f->polygon[0].y, &x, &y);
+            d = path->findPointNear(curve[0].x, curve[0].y, &x, &y);
             if (d < d0) {
               d0 = d;
               x0 = x;
               y0 = y;
             }
-            d = path->findPointNear(f->polygon.back().x, f->polygon.back().y, &x, &y);
+            d = path->findPointNear(curve.back().x, curve.back().y, &x, &y);
             if (d < d1) {
               d1 = d;
               x1 = x;
@@ -307,12 +302,12 @@ static timeval t0;
             }
           }
           if ( d0 <= fe->fuzziness*2.0 ) {
-            f->polygon[0].x = x0;
-            f->polygon[0].y = y0;
+            curve[0].x = x0;
+            curve[0].y = y0;
           }
           if ( d1 <= fe->fuzziness*2.0 ) {
-            f->polygon.back().x = x1;
-            f->polygon.back().y = y1;
+            curve.back().x = x1;
+            curve.back().y = y1;
           }
         }
         
@@ -321,9 +316,9 @@ static timeval t0;
         if (back) {
           // insert at the back of another path
           TUndoManager::beginUndoGrouping(fe->getModel());
-          f->polygon.insert(f->polygon.begin(),
-                            back->polygon.begin(),
-                            back->polygon.end()-1);
+          TPolygon buffer;
+          const TPolygon &other = back->points(buffer);
+          curve.insert(curve.begin(), other.begin(), other.end()-1);
           f->closed = closed;
           fe->deleteFigure(back);
           fe->addFigure(f);
@@ -333,17 +328,17 @@ static timeval t0;
         if (front) {
           // insert at the front of another path
           TUndoManager::beginUndoGrouping(fe->getModel());
+          TPolygon buffer;
+          const TPolygon &other = front->points(buffer);
           TPoint pt;
-          f->polygon.insert(f->polygon.begin(),
-                            front->polygon.size()-1,
-                            pt);
-          for(size_t i=0, j=front->polygon.size()-1;
-              i<front->polygon.size()-1;
+          curve.insert(curve.begin(), other.size()-1, pt);
+          for(size_t i=0, j=other.size()-1;
+              i<other.size()-1;
               ++i, --j)
           {
-            assert(i<front->polygon.size());
-            assert(j<f->polygon.size());
-            f->polygon[i] = front->polygon[j];
+            assert(i<other.size());
+            assert(j<curve.size());
+            curve[i] = other[j];
           }
           f->closed = closed;
           fe->deleteFigure(front);
@@ -361,15 +356,16 @@ static timeval t0;
         }
         // set the corner flags
         f->corner.clear();
-        if (f->polygon.size()>=3) {
+        if (curve.size()>=3) {
           f->corner.push_back(2);
-          for(size_t i=0; i<(f->polygon.size()+1)/3; ++i) {
+          for(size_t i=0; i<(curve.size()+1)/3; ++i) {
             f->corner.push_back(4);
           }
           f->corner.push_back(1);
         }
       }
       polygon.clear();
+      fitter.clear();
       fe->getWindow()->flagCompressMotion = true;
       [NSEvent setMouseCoalescingEnabled: TRUE];
       break;
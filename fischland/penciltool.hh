@@ -22,6 +22,7 @@
 #define _FISCHLAND_PENCILTOOL_HH 1
 
 #include "fpath.hh"
+#include "fitcurve.hh"
 #include <toad/figuretool.hh>
 #include <toad/integermodel.hh>
 #include <toad/boolmodel.hh>
@@ -32,6 +33,7 @@ class TPencilTool:
   public TFigureTool
 {
     TPolygon polygon;
+    TCurveFitter fitter;
     bool closed;
     TFPath *back, *front;
     
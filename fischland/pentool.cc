@@ -45,16 +45,17 @@ TPenTool::cursor(TFigureEditor *fe, int x, int y)
     fe->getWindow()->setCursor(fischland::cursor[CURSOR_PEN_DRAG]);
     return;
   }
-  if (!path->polygon.empty() &&
-       path->polygon.front().x-fe->fuzziness<=x && x<=path->polygon.front().x+fe->fuzziness &&
-       path->polygon.front().y-fe->fuzziness<=y && y<=path->polygon.front().y+fe->fuzziness)
+  const TPolygon &polygon = path->getPolygon();
+  if (!polygon.empty() &&
+       polygon.front().x-fe->fuzziness<=x && x<=polygon.front().x+fe->fuzziness &&
+       polygon.front().y-fe->fuzziness<=y && y<=polygon.front().y+fe->fuzziness)
   {
     fe->getWindow()->setCursor(fischland::cursor[CURSOR_PEN_CLOSE]);
     return;
   }
-  if (!path->polygon.empty() &&
-       path->polygon.back().x-fe->fuzziness<=x && x<=path->polygon.back().x+fe->fuzziness &&
-       path->polygon.back().y-fe->fuzziness<=y && y<=path->polygon.back().y+fe->fuzziness)
+  if (!polygon.empty() &&
+       polygon.back().x-fe->fuzziness<=x && x<=polygon.back().x+fe->fuzziness &&
+       polygon.back().y-fe->fuzziness<=y && y<=polygon.back().y+fe->fuzziness)
   {
     fe->getWindow()->setCursor(fischland::cursor[CURSOR_PEN_EDGE]);
     return;
@@ -77,7 +78,7 @@ for(unsigned i=0; i<path->corner.size(); ++i)
   cout << i << ": " << (unsigned)path->corner[i] << endl;
 cout << "---------------" << endl;
 */
-    if (path->polygon.size()>=4)
+    if (path->pointCount()>=4)
       fe->addFigure(path);
     else
       delete path;
@@ -98,7 +99,7 @@ TPenTool::mouseEvent(TFigureEditor *fe, const TMouseEvent &me)
     case TMouseEvent::ENTER:
       cursor(fe, x, y);
       break;
-    case TMouseEvent::LDOWN:
+    case TMouseEvent::LDOWN: {
       if (state == STATE_NONE) {
         // start creation
         state = STATE_CREATE;
@@ -113,15 +114,16 @@ TPenTool::mouseEvent(TFigureEditor *fe, const TMouseEvent &me)
         stop(fe);
         fe->getWindow()->setCursor(fischland::cursor[CURSOR_PEN]);
         return;
-      } else
-      if (!path->polygon.empty() &&
-          path->polygon.front().x-fe->fuzziness<=x && x<=path->polygon.front().x+fe->fuzziness &&
-          path->polygon.front().y-fe->fuzziness<=y && y<=path->polygon.front().y+fe->fuzziness)
+      }
+      TPolygon &polygon = path->getPolygon();
+      if (!polygon.empty() &&
+          polygon.front().x-fe->fuzziness<=x && x<=polygon.front().x+fe->fuzziness &&
+          polygon.front().y-fe->fuzziness<=y && y<=polygon.front().y+fe->fuzziness)
       {
         // end with closed path
         TPolygon::iterator p0, p1;
-        if (path->polygon.size()%3 == 1) {
-          p0 = path->polygon.end();
+        if (polygon.size()%3 == 1) {
+          p0 = polygon.end();
           --p0;
           p1 = p0;
           --p0;
@@ -133,17 +135,17 @@ TPenTool::mouseEvent(TFigureEditor *fe, const TMouseEvent &me)
               path->corner.back() = 4;
             path->corner.push_back(1);
           }
-          path->polygon.addPoint(p1->x - ( p0->x - p1->x ),
-                                 p1->y - ( p0->y - p1->y ));
+          polygon.addPoint(p1->x - ( p0->x - p1->x ),
+                           p1->y - ( p0->y - p1->y ));
         } else {
           path->corner.push_back(1);
         }
-        p0 = p1 = path->polygon.begin();
+        p0 = p1 = polygon.begin();
         ++p0;
         TCoord x1 = p1->x, y1 = p1->y;
-        path->polygon.addPoint(p1->x - ( p0->x - p1->x ),
-                               p1->y - ( p0->y - p1->y ));
-        path->polygon.addPoint(x1, y1);
+        polygon.addPoint(p1->x - ( p0->x - p1->x ),
+                         p1->y - ( p0->y - p1->y ));
+        polygon.addPoint(x1, y1);
         path->closed = true;
         stop(fe);
         fe->getWindow()->setCursor(fischland::cursor[CURSOR_PEN]);
@@ -154,55 +156,56 @@ TPenTool::mouseEvent(TFigureEditor *fe, const TMouseEvent &me)
       // 1 2  0 1  2  0 1  2
       // 0 1  2 3  4  5 6  7
       // ^      ^       ^
-//      cout << "going to add points: " << path->polygon.size() << endl;
-      if (path->polygon.size()%3 == 1) {
+//      cout << "going to add points: " << polygon.size() << endl;
+      if (polygon.size()%3 == 1) {
         // if (x == polygon.back().x && y==polygon.back().y) {
-        if (path->polygon.back().x-fe->fuzziness<=x && x<=path->polygon.back().x+fe->fuzziness &&
-            path->polygon.back().y-fe->fuzziness<=y && y<=path->polygon.back().y+fe->fuzziness)
+        if (polygon.back().x-fe->fuzziness<=x && x<=polygon.back().x+fe->fuzziness &&
+            polygon.back().y-fe->fuzziness<=y && y<=polygon.back().y+fe->fuzziness)
         {
           // corner after smooth curve
-          path->polygon.addPoint(x, y);
+          polygon.addPoint(x, y);
 //cout << "corner after smooth curve" << endl;
         } else {
           // smooth curve after smooth curve
 //cout << "smooth curve after smooth curve" << endl;
           TPolygon::iterator p0, p1;
-          p0 = path->polygon.end();
+          p0 = polygon.end();
           --p0;
           p1 = p0;
           --p0;
           if (p0->x != p1->x || p0->y != p1->y)
             path->corner.back() = 4;
-          path->polygon.addPoint(p1->x - ( p0->x - p1->x ),
-                                 p1->y - ( p0->y - p1->y ));
-          path->polygon.addPoint(x, y);
-          path->polygon.addPoint(x, y);
+          polygon.addPoint(p1->x - ( p0->x - p1->x ),
+                           p1->y - ( p0->y - p1->y ));
+          polygon.addPoint(x, y);
+          polygon.addPoint(x, y);
           path->corner.push_back(0);
         }
       } else {
 //cout << "hmm 1: add two start points ?o|" << endl;
         // this one add's point 0,1 and 2,3
-        path->polygon.addPoint(x, y);
-        path->polygon.addPoint(x, y);
+        polygon.addPoint(x, y);
+        polygon.addPoint(x, y);
         path->corner.push_back(0);
       }
-//      cout << "points now: " << path->polygon.size() << endl;
+//      cout << "points now: " << polygon.size() << endl;
       down = true;
-      break;
+    } break;
     case TMouseEvent::MOVE:
       if (down) {
-//        cout << "move with " << path->polygon.size() << ", " << path->polygon.size()%3 << endl;
-        if (path->polygon.size()%3 == 2) {
+        TPolygon &polygon = path->getPolygon();
+//        cout << "move with " << polygon.size() << ", " << polygon.size()%3 << endl;
+        if (polygon.size()%3 == 2) {
 //cout << "hmm 2" << endl;
           // make points 0,1 a smooth point
           path->corner.back() |= 2; // 2nd point has curve
-          path->polygon.back().x = x;
-          path->polygon.back().y = y;
+          polygon.back().x = x;
+          polygon.back().y = y;
         } else {
 //cout << "hmm 3" << endl;
           path->corner.back() |= 1; // 1st point has curve
           TPolygon::iterator p0, p1;
-          p0 = path->polygon.end();
+          p0 = polygon.end();
           --p0;
           p1 = p0;
           --p0;
@@ -228,7 +231,7 @@ TPenTool::keyEvent(TFigureEditor *fe, const TKeyEvent &ke)
     return;
   if (!path)
     return;
-  TPolygon &polygon = path->polygon;
+  TPolygon &polygon = path->getPolygon();
   vector<unsigned char> &corner = path->corner;
   switch(ke.key) {
     case TK_ESCAPE:
@@ -292,7 +295,7 @@ TPenTool::paintSelection(TFigureEditor *fe, TPenBase &pen)
     pen.push();
     pen.identity();
   }
-  TPolygon &polygon = path->polygon;
+  TPolygon &polygon = path->getPolygon();
   int i = polygon.size();
 
   if (i<4 || (i%3)!=1)  
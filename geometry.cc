@@ -22,6 +22,7 @@
 #include <toad/geometry.hh>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 /*
  * Paper.js - The Swiss Army Knife of Vector Graphics Scripting.
@@ -246,7 +247,8 @@ divideBezier(const TPoint *a, TPoint *p, TCoord min, TCoord max)
 {
   TPoint o0[7], o1[7];
   divideBezier(a, o0, min);
-  divideBezier(o0+3, o1, (max-min)/(1-min));
+  // when min is 1, the remaining part is a single point
+  divideBezier(o0+3, o1, min<1.0 ? (max-min)/(1-min) : 0.0);
   for(int i=0; i<4; ++i)
     p[i] = o1[i];
 }
@@ -280,8 +282,14 @@ clipToFatLine(const TPoint *p, const TPoint *q, TCoord *min, TCoord *max)
   TCoord dy = q[3].y - q[0].y;
   
   TCoord n = sqrt(dx*dx+dy*dy);
-  dx /= n;
-  dy /= n;
+  if (n<epsilon) {
+    // q starts and ends at the same point, any line through it will do
+    dx = 1.0;
+    dy = 0.0;
+  } else {
+    dx /= n;
+    dy /= n;
+  }
   a = dy;
   b = -dx;
   c = q[0].y*dx - q[0].x*dy;
@@ -314,6 +322,14 @@ clipToFatLine(const TPoint *p, const TPoint *q, TCoord *min, TCoord *max)
     }
   }
 
+  // the fat line of a straight curve has no width, so that rounding
+  // errors would put points on it above or below
+  TCoord scale = 1.0;
+  for(int i=0; i<4; ++i)
+    scale = std::max(scale, std::max(fabs(q[i].x), fabs(q[i].y)));
+  dmin -= scale * 16.0 * machine_epsilon;
+  dmax += scale * 16.0 * machine_epsilon;
+
   // bézier clipping
   vector<TPoint> d;
   for(int i=0; i<4; ++i) {
@@ -355,93 +371,190 @@ clipToFatLine(const TPoint *p, const TPoint *q, TCoord *min, TCoord *max)
 }
 
 
+namespace {
+
+/**
+ * one pending step of the bézier clipping in intersectCurveCurve
+ */
+struct TClipping {
+  TPoint p[4];          // part [pMin, pMax] of the curve to be clipped
+  TPoint q[4];          // part [qMin, qMax] of the curve whose fat line clips p
+  TCoord pMin, pMax;
+  TCoord qMin, qMax;
+  bool reverse;         // p is part of curve1 and q part of curve0
+  unsigned depth;
+};
+
+} // namespace
+
 /**
- * \param[in] p P from [pMin, pMax]
- * \param[in] q Q from [qMin, qMax]
- * \param[in] P the complete curve P
- * \param[in] Q the complete curve Q
- * \param[in] pMin see p
- * \param[in] pMax see p
- * \param[in] qMin see q
- * \param[in] qMax see q
- * \param[in] oldPDiff the width of the previous fatline
- * \param[in] depth number of recursions
+ * Intersect two cubic bézier curves with bézier clipping.
+ *
+ * The pending steps are kept on an explicit stack instead of recursing
+ * and the total number of steps is limited, so that tangential or
+ * overlapping curves can't blow up.
+ *
  * \param[out] ilist intersections found
  */
 void
-bezierClipping(const TPoint *p,
-               const TPoint *q,
-               const TPoint *P,
-               const TPoint *Q,
-               TCoord pMin, TCoord pMax,
-               TCoord qMin, TCoord qMax,
-               TCoord oldPDiff,
-               bool reverse,
-               unsigned depth,
-               TIntersectionList &ilist)
+intersectCurveCurve(TIntersectionList &ilist, const TPoint *curve0, const TPoint *curve1)
 {
-  if (depth>=32) {
-    cerr << "WARNING: bezierClipping went too deep" << endl;
-    return;
+  // identical curves have no distinct intersections
+  bool same = true, reversed = true;
+  for(int i=0; i<4; ++i) {
+    if (curve0[i] != curve1[i])
+      same = false;
+    if (curve0[i] != curve1[3-i])
+      reversed = false;
   }
+  if (same || reversed)
+    return;
 
-  TPoint pClipped[4];
-  
-  TCoord pMinNew, pMaxNew, pDiff;
-  if (q[0].x == q[3].x && qMax - qMin <= tolerance && depth > 3) {
-    pMaxNew = pMinNew = (pMax + pMin) / 2.0;
-    pDiff = 0.0;
-  } else {
-    TCoord pMinClip, pMaxClip;
-    clipToFatLine(p, q, &pMinClip, &pMaxClip);
-    if (pMinClip > pMaxClip) {
+  TBoundary bounds;
+  for(int i=0; i<4; ++i) {
+    bounds.expand(curve0[i]);
+    bounds.expand(curve1[i]);
+  }
+  const TCoord size = max(bounds.width(), bounds.height());
+  const TCoord minSize = tolerance * size;
+  const TCoord maxDistance = 100.0 * tolerance * size;
+  const size_t first = ilist.size();
+
+  vector<TClipping> stack;
+  stack.reserve(64);
+  stack.push_back(TClipping());
+  TClipping *c = &stack.back();
+  for(int i=0; i<4; ++i) {
+    c->p[i] = curve0[i];
+    c->q[i] = curve1[i];
+  }
+  c->pMin = c->qMin = 0.0;
+  c->pMax = c->qMax = 1.0;
+  c->reverse = false;
+  c->depth = 0;
+
+  unsigned steps = 0;
+  while(!stack.empty()) {
+    if (++steps > 4096) {
+      cerr << "WARNING: bezierClipping gave up" << endl;
       return;
     }
+    TClipping s = stack.back();
+    stack.pop_back();
+    if (s.depth>=40)
+      continue;
+
+    // the fat line is unbounded along its direction, so pieces next to
+    // each other on almost the same line would never be clipped away
+    TBoundary pb, qb;
+    for(int i=0; i<4; ++i) {
+      pb.expand(s.p[i]);
+      qb.expand(s.q[i]);
+    }
+    if (pb.p1.x + minSize < qb.p0.x || qb.p1.x + minSize < pb.p0.x ||
+        pb.p1.y + minSize < qb.p0.y || qb.p1.y + minSize < pb.p0.y)
+      continue;
 
-    divideBezier(p, pClipped, pMinClip, pMaxClip);
-    p = pClipped;
-
-    pDiff = pMaxClip - pMinClip;
-
-    pMinNew = pMax * pMinClip + pMin * (1 - pMinClip);
-    pMaxNew = pMax * pMaxClip + pMin * (1 - pMaxClip);
-  }
+    TCoord pMinClip, pMaxClip;
+    clipToFatLine(s.p, s.q, &pMinClip, &pMaxClip);
+    if (pMinClip > pMaxClip)
+      continue;
+
+    TCoord pMinNew = s.pMin + (s.pMax - s.pMin) * pMinClip;
+    TCoord pMaxNew = s.pMin + (s.pMax - s.pMin) * pMaxClip;
+    TCoord qDiff = s.qMax - s.qMin;
+
+    TPoint pClipped[4];
+    divideBezier(s.p, pClipped, pMinClip, pMaxClip);
+
+    // converged when the parameter ranges or the curves became small
+    // enough; the latter ends tangents and touching ends, where the
+    // clipping doesn't make much progress
+    bool converged = max(qDiff, pMaxNew - pMinNew) < tolerance;
+    if (!converged) {
+      TBoundary b;
+      for(int i=0; i<4; ++i) {
+        b.expand(pClipped[i]);
+        b.expand(s.q[i]);
+      }
+      converged = max(b.width(), b.height()) < minSize;
+    }
+    if (converged) {
+      // ranges reaching the end of a curve meet at its end
+      auto middle = [](TCoord min, TCoord max) {
+        if (min <= 0.0)
+          return 0.0;
+        if (max >= 1.0)
+          return 1.0;
+        return min + (max - min) / 2;
+      };
+      TCoord t1 = middle(pMinNew, pMaxNew);
+      TCoord t2 = middle(s.qMin, s.qMax);
+      TCoord u0 = s.reverse ? t2 : t1;
+      TCoord u1 = s.reverse ? t1 : t2;
+      TPoint p0 = bez2point(curve0, u0);
+      TPoint p1 = bez2point(curve1, u1);
+      // once a curve was clipped down to a single point, its fat line is
+      // a guess which may lead to points which don't meet
+      if (distance(p0, p1) > maxDistance)
+        continue;
+      // tangents and touching ends are found more than once
+      bool found = false;
+      for(size_t i=first; i<ilist.size(); ++i) {
+        if (fabs(ilist[i].seg0.u - u0) < 100.0 * tolerance &&
+            fabs(ilist[i].seg1.u - u1) < 100.0 * tolerance)
+        {
+          found = true;
+          break;
+        }
+      }
+      if (!found)
+        ilist.add(TVectorPath::CURVE, curve0, u0, p0,
+                  TVectorPath::CURVE, curve1, u1, p1);
+      continue;
+    }
 
-  if (oldPDiff > 0.5 && pDiff > 0.5) {
-    TPoint o[7];
-    if (pMaxNew - pMinNew > qMax - qMin) {
-      divideBezier(p, o, 0.5);
-      TCoord pMiddle =  pMinNew + (pMaxNew - pMinNew) / 2;
-      bezierClipping(q, o  , Q, P, qMin, qMax, pMinNew, pMiddle, pDiff, !reverse, depth+1, ilist);
-      bezierClipping(q, o+3, Q, P, qMin, qMax, pMiddle, pMaxNew, pDiff, !reverse, depth+1, ilist);
+    auto push = [&](const TPoint *p, TCoord pMin, TCoord pMax,
+                    const TPoint *q, TCoord qMin, TCoord qMax, bool reverse) {
+      stack.push_back(TClipping());
+      TClipping &n = stack.back();
+      for(int i=0; i<4; ++i) {
+        n.p[i] = p[i];
+        n.q[i] = q[i];
+      }
+      n.pMin = pMin;
+      n.pMax = pMax;
+      n.qMin = qMin;
+      n.qMax = qMax;
+      n.reverse = reverse;
+      n.depth = s.depth + 1;
+    };
+
+    if (pMaxClip - pMinClip > 0.8) {
+      // the clipping didn't help much, subdivide the curve which has
+      // converged the least (pushed in reverse order, so that the first
+      // half is processed first)
+      TPoint o[7];
+      if (pMaxNew - pMinNew > qDiff) {
+        divideBezier(pClipped, o, 0.5);
+        TCoord pMiddle = pMinNew + (pMaxNew - pMinNew) / 2;
+        push(s.q, s.qMin, s.qMax, o+3, pMiddle, pMaxNew, !s.reverse);
+        push(s.q, s.qMin, s.qMax, o  , pMinNew, pMiddle, !s.reverse);
+      } else {
+        divideBezier(s.q, o, 0.5);
+        TCoord qMiddle = s.qMin + qDiff / 2;
+        push(o+3, qMiddle, s.qMax, pClipped, pMinNew, pMaxNew, !s.reverse);
+        push(o  , s.qMin, qMiddle, pClipped, pMinNew, pMaxNew, !s.reverse);
+      }
+    } else
+    if (qDiff == 0.0 || qDiff >= tolerance) {
+      // clip q with the fat line of the clipped p next
+      push(s.q, s.qMin, s.qMax, pClipped, pMinNew, pMaxNew, !s.reverse);
     } else {
-      divideBezier(q, o, 0.5);
-      TCoord qMiddle =  qMin + (qMax - qMin) / 2;
-      bezierClipping(o  , p, Q, P, qMin, qMiddle, pMinNew, pMaxNew, pDiff, !reverse, depth+1, ilist);
-      bezierClipping(o+3, p, Q, P, qMiddle, qMax, pMinNew, pMaxNew, pDiff, !reverse, depth+1, ilist);
+      // q is already tight enough, keep on clipping p
+      push(pClipped, pMinNew, pMaxNew, s.q, s.qMin, s.qMax, s.reverse);
     }
-    return;
-  }
-  
-  if (max(qMax-qMin, pMaxNew-pMaxNew) < tolerance) {
-    TCoord t1 = pMinNew + (pMaxNew - pMinNew) / 2;
-    TCoord t2 = qMin + (qMax - qMin) / 2;
-    if (reverse)    
-      ilist.add(TVectorPath::CURVE, Q, t2, bez2point(Q, t2),
-                TVectorPath::CURVE, P, t1, bez2point(P, t1));
-    else
-      ilist.add(TVectorPath::CURVE, P, t1, bez2point(P, t1),
-                TVectorPath::CURVE, Q, t2, bez2point(Q, t2));
-    return;
   }
-  if (pDiff > 0)
-    bezierClipping(q, p, Q, P, qMin, qMax, pMinNew, pMaxNew, pDiff, !reverse, depth+1, ilist);
-}
-
-void
-intersectCurveCurve(TIntersectionList &ilist, const TPoint *curve0, const TPoint *curve1)
-{
-  bezierClipping(curve0, curve0, curve1, curve1, 0.0, 1.0, 0.0, 1.0, 0.0, false, 0, ilist);
 }
 
 /****************************************************************************
@@ -499,27 +612,36 @@ solveQuadratic(TCoord a, TCoord b, TCoord c, TCoord *roots, TCoord min, TCoord m
 }
 
 // The function gsl_poly_solve_cubic is copied from the GNU Scientific Library.
-// It's modified to return only unique solutions.
+// It's modified to return only unique solutions and split into two parts,
+// so that solveCubics() can do the first one for several equations at once.
 // For the math and history, which dates back to Scipione del Ferro (1465-1526)
 // see:
 //   https://en.wikipedia.org/wiki/Cubic_function
 //   http://mathworld.wolfram.com/CubicFormula.html
-static int 
-gsl_poly_solve_cubic(TCoord a, TCoord b, TCoord c, TCoord *roots)
-{
-  TCoord q = (a * a - 3 * b);
-  TCoord r = (2 * a * a * a - 9 * a * b + 27 * c);
+namespace {
 
-  TCoord Q = q / 9;
-  TCoord R = r / 54;
+// the terms of x³ + a*x² + b*x + c = 0 which decide on the kind of roots;
+// branch free, so that T can also be a vector of doubles
+template <class T>
+inline void
+cubicTerms(T a, T b, T c, T *Q, T *R, T *CR2, T *CQ3)
+{
+  T q = (a * a - 3 * b);
+  T r = (2 * a * a * a - 9 * a * b + 27 * c);
+  *Q = q / 9;
+  *R = r / 54;
+  *CR2 = 729 * r * r;
+  *CQ3 = 2916 * q * q * q;
+}
 
+int
+cubicRoots(TCoord a, TCoord Q, TCoord R, TCoord CR2, TCoord CQ3, TCoord *roots)
+{
   if (R == 0 && Q == 0) {
     roots[0] = - a / 3 ;
     return 1; // the original gsl function returns 3 values here
   }
 
-  TCoord CR2 = 729 * r * r;
-  TCoord CQ3 = 2916 * q * q * q;
   if (CR2 == CQ3) {
     /* this test is actually R2 == Q3, written in a form suitable
        for exact computation with integers */
@@ -571,10 +693,11 @@ gsl_poly_solve_cubic(TCoord a, TCoord b, TCoord c, TCoord *roots)
   return 1;
 }
 
+// keep the roots in [min, max]
 int
-solveCubic(TCoord a, TCoord b, TCoord c, TCoord d, TCoord *roots, TCoord min, TCoord max)
+clampRoots(TCoord *roots, int n, TCoord min, TCoord max)
 {
-  int i, j, n = gsl_poly_solve_cubic(b/a, c/a, d/a, roots);
+  int i, j;
   for(i=0, j=0; i<n; ++i) {
     if (j!=i)
       roots[j] = roots[i];
@@ -584,6 +707,101 @@ solveCubic(TCoord a, TCoord b, TCoord c, TCoord d, TCoord *roots, TCoord min, TC
   return j;
 }
 
+#if defined(__GNUC__)
+// two doubles, which GCC and Clang keep in SSE2 or NEON registers where
+// available and in two scalar registers otherwise
+typedef TCoord v2d __attribute__((vector_size(2*sizeof(TCoord))));
+#endif
+
+} // unnamed namespace
+
+static int 
+gsl_poly_solve_cubic(TCoord a, TCoord b, TCoord c, TCoord *roots)
+{
+  TCoord Q, R, CR2, CQ3;
+  cubicTerms(a, b, c, &Q, &R, &CR2, &CQ3);
+  return cubicRoots(a, Q, R, CR2, CQ3, roots);
+}
+
+int
+solveCubic(TCoord a, TCoord b, TCoord c, TCoord d, TCoord *roots, TCoord min, TCoord max)
+{
+  // dividing by a would give no roots at all
+  if (fabs(a) < tolerance)
+    return solveQuadratic(b, c, d, roots, min, max);
+  int n = gsl_poly_solve_cubic(b/a, c/a, d/a, roots);
+  return clampRoots(roots, n, min, max);
+}
+
+/**
+ * Solve the n cubic equations a[i]*x³ + b[i]*x² + c[i]*x + d[i] = 0 and
+ * restrict the results to [min, max].
+ *
+ * The roots of equation i are stored in ascending order at
+ * (*roots)[(*first)[i]] up to (*roots)[(*first)[i+1]], so 'first' has
+ * n+1 entries.
+ *
+ * This gives the same results as n calls to solveCubic(). The arithmetic
+ * up to the case analysis is done for two equations at once and the
+ * case analysis itself without any function calls in between.
+ */
+void
+solveCubics(const TCoord *a, const TCoord *b, const TCoord *c, const TCoord *d, size_t n,
+            TCoord min, TCoord max, vector<TCoord> *roots, vector<size_t> *first)
+{
+  // the terms of all equations, as structure of arrays
+  vector<TCoord> terms(5*n);
+  TCoord *A = terms.data(), *Q = A+n, *R = Q+n, *CR2 = R+n, *CQ3 = CR2+n;
+  size_t i = 0;
+#if defined(__GNUC__)
+  for(; i+2<=n; i+=2) {
+    v2d va, vb, vc, vd, vQ, vR, vCR2, vCQ3;
+    memcpy(&va, a+i, sizeof(v2d));
+    memcpy(&vb, b+i, sizeof(v2d));
+    memcpy(&vc, c+i, sizeof(v2d));
+    memcpy(&vd, d+i, sizeof(v2d));
+    vb /= va;
+    vc /= va;
+    vd /= va;
+    cubicTerms(vb, vc, vd, &vQ, &vR, &vCR2, &vCQ3);
+    memcpy(A+i, &vb, sizeof(v2d));
+    memcpy(Q+i, &vQ, sizeof(v2d));
+    memcpy(R+i, &vR, sizeof(v2d));
+    memcpy(CR2+i, &vCR2, sizeof(v2d));
+    memcpy(CQ3+i, &vCQ3, sizeof(v2d));
+  }
+#endif
+  for(; i<n; ++i) {
+    A[i] = b[i]/a[i];
+    cubicTerms(A[i], c[i]/a[i], d[i]/a[i], Q+i, R+i, CR2+i, CQ3+i);
+  }
+
+  // within [0, 1] the polynomial stays inside the hull of its bézier
+  // control values, so when they all have the same sign there is no root
+  // and the case analysis can be skipped, which is the case for most
+  // curves when intersecting with a scanline
+  bool unit = min>=0.0 && max<=1.0;
+
+  roots->resize(3*n);
+  first->resize(n+1);
+  size_t m = 0;
+  for(i=0; i<n; ++i) {
+    (*first)[i] = m;
+    if (unit) {
+      TCoord p0 = d[i], p1 = p0 + c[i]/3, p2 = p1 + (c[i] + b[i])/3, p3 = p0 + c[i] + b[i] + a[i];
+      if ((p0>0 && p1>0 && p2>0 && p3>0) || (p0<0 && p1<0 && p2<0 && p3<0))
+        continue;
+    }
+    TCoord *r = roots->data() + m;
+    if (fabs(a[i]) < tolerance)
+      m += solveQuadratic(b[i], c[i], d[i], r, min, max);
+    else
+      m += clampRoots(r, cubicRoots(A[i], Q[i], R[i], CR2[i], CQ3[i], r), min, max);
+  }
+  (*first)[n] = m;
+  roots->resize(m);
+}
+
 // Converts from the point coordinates (p1, c1, c2, p2) for one axis to
 // the polynomial coefficients and solves the polynomial for val
 int
@@ -673,6 +891,169 @@ intersectLineCurve(TIntersectionList &ilist, const TPoint *vl, const TPoint *vc)
     swap(ilist[i].seg0, ilist[i].seg1);
 }
 
+/****************************************************************************
+ *                                                                          *
+ *                          PATH-PATH-INTERSECTION                          *
+ *                                                                          *
+ ****************************************************************************/
+
+TPathSegment::TPathSegment(TVectorPath::EType t, const TPoint *p):
+  type(t), pt(p)
+{
+  // the control points enclose the curve
+  for(int i = (type==TVectorPath::CURVE ? 3 : 1); i>=0; --i)
+    bounds.expand(pt[i]);
+}
+
+static inline bool
+overlaps(const TBoundary &a, const TBoundary &b)
+{
+  return a.p0.x <= b.p1.x && b.p0.x <= a.p1.x &&
+         a.p0.y <= b.p1.y && b.p0.y <= a.p1.y;
+}
+
+static void
+intersectSegment(TIntersectionList &ilist, const TPathSegment &s0, const TPathSegment &s1)
+{
+  if (s0.type==TVectorPath::LINE) {
+    if (s1.type==TVectorPath::LINE)
+      intersectLineLine(ilist, s0.pt, s1.pt);
+    else
+      intersectLineCurve(ilist, s0.pt, s1.pt);
+  } else {
+    if (s1.type==TVectorPath::LINE)
+      intersectCurveLine(ilist, s0.pt, s1.pt);
+    else
+      intersectCurveCurve(ilist, s0.pt, s1.pt);
+  }
+}
+
+/**
+ * Intersect all segments of one list with all segments of the other.
+ *
+ * Only pairs whose bounding boxes overlap are intersected, which are
+ * found by sweeping over both lists along the x-axis. The intersections
+ * are in the same order as when intersecting each segment of
+ * 'segments0' with each segment of 'segments1'.
+ */
+void
+intersectSegments(TIntersectionList &ilist, const vector<TPathSegment> &segments0, const vector<TPathSegment> &segments1)
+{
+  struct TEvent {
+    TCoord x;
+    unsigned list;
+    size_t index;
+  };
+  vector<TEvent> events;
+  events.reserve(segments0.size() + segments1.size());
+  for(size_t i=0; i<segments0.size(); ++i)
+    events.push_back({segments0[i].bounds.p0.x, 0, i});
+  for(size_t i=0; i<segments1.size(); ++i)
+    events.push_back({segments1[i].bounds.p0.x, 1, i});
+  sort(events.begin(), events.end(), [](const TEvent &a, const TEvent &b) {
+    return a.x < b.x;
+  });
+
+  const vector<TPathSegment> *segments[2] = { &segments0, &segments1 };
+  vector<size_t> active[2];
+  vector<pair<size_t, size_t>> candidates;
+  for(auto &&e: events) {
+    const TBoundary &b = (*segments[e.list])[e.index].bounds;
+    vector<size_t> &other = active[1-e.list];
+    for(size_t i=0; i<other.size(); ) {
+      const TBoundary &o = (*segments[1-e.list])[other[i]].bounds;
+      if (o.p1.x < b.p0.x) {
+        // the sweep has passed this segment
+        other[i] = other.back();
+        other.pop_back();
+        continue;
+      }
+      if (overlaps(b, o)) {
+        if (e.list==0)
+          candidates.push_back(make_pair(e.index, other[i]));
+        else
+          candidates.push_back(make_pair(other[i], e.index));
+      }
+      ++i;
+    }
+    active[e.list].push_back(e.index);
+  }
+
+  sort(candidates.begin(), candidates.end());
+  for(auto &&c: candidates)
+    intersectSegment(ilist, segments0[c.first], segments1[c.second]);
+}
+
+/**
+ * Collect the segments of 'path', closing lines are stored in 'closing'.
+ */
+static void
+pathSegments(const TVectorPath &path, vector<TPathSegment> *segments, vector<TPoint> *closing)
+{
+  size_t n = 0;
+  for(auto &&t: path.type) {
+    if (t==TVectorPath::CLOSE)
+      n+=2;
+  }
+  // reserve so that the segments can point into it
+  closing->reserve(n);
+
+  const TPoint *start = 0;
+  const TPoint *pt = path.points.data();
+  for(auto &&t: path.type) {
+    switch(t) {
+      case TVectorPath::MOVE:
+        start=pt;
+        ++pt;
+        break;
+      case TVectorPath::LINE:
+        if (pt>path.points.data())
+          segments->push_back(TPathSegment(TVectorPath::LINE, pt-1));
+        ++pt;
+        break;
+      case TVectorPath::CURVE:
+        if (pt>path.points.data())
+          segments->push_back(TPathSegment(TVectorPath::CURVE, pt-1));
+        pt+=3;
+        break;
+      case TVectorPath::CLOSE:
+        if (start && pt>path.points.data()) {
+          closing->push_back(*(pt-1));
+          closing->push_back(*start);
+          segments->push_back(TPathSegment(TVectorPath::LINE, &closing->back()-1));
+        }
+        break;
+    }
+  }
+}
+
+void
+intersectPaths(TIntersectionList &ilist, const TVectorPath &path0, const TVectorPath &path1)
+{
+  vector<TPathSegment> segments0, segments1;
+  vector<TPoint> closing0, closing1;
+  pathSegments(path0, &segments0, &closing0);
+  pathSegments(path1, &segments1, &closing1);
+  intersectSegments(ilist, segments0, segments1);
+}
+
+/**
+ * Intersect two sequences of cubic bézier curves, where curve i is
+ * made of the points i*3 to i*3+3, as used by TPolygon based figures.
+ */
+void
+intersectCurves(TIntersectionList &ilist, const TPoint *curves0, size_t size0, const TPoint *curves1, size_t size1)
+{
+  vector<TPathSegment> segments0, segments1;
+  segments0.reserve(size0/3);
+  segments1.reserve(size1/3);
+  for(size_t i=0; i+3<size0; i+=3)
+    segments0.push_back(TPathSegment(TVectorPath::CURVE, curves0+i));
+  for(size_t i=0; i+3<size1; i+=3)
+    segments1.push_back(TPathSegment(TVectorPath::CURVE, curves1+i));
+  intersectSegments(ilist, segments0, segments1);
+}
+
 /****************************************************************************
  *                                                                          *
  *                               CURVE BOUNDS                               *
@@ -1159,4 +1540,164 @@ fitPath(const TPoint *d, size_t nPts, TCoord error, vector<TPoint> *out)
   out->push_back(d[nPts-1]);
 }
 
+/**
+ * Ramer-Douglas-Peucker: mark the points which are needed to approximate
+ * the polyline 'points' within a distance of 'epsilon'.
+ *
+ * Instead of recursing into both halves of a split, the range left of the
+ * split is done first and the next range to the right is found by looking
+ * for the next marked point, so 'keep' is the only memory needed.
+ */
+void
+ramerDouglasPeucker(const TPoint *points, size_t size, TCoord epsilon, vector<bool> *keep)
+{
+  keep->assign(size, false);
+  if (size==0)
+    return;
+  (*keep)[0] = (*keep)[size-1] = true;
+
+  TCoord epsilon2 = epsilon * epsilon;
+  size_t a = 0, b = size-1;
+  while(true) {
+    // the point farthest from the line a-b, where the distance is compared
+    // as the squared cross product to save the division by the line's
+    // length, or from a when the line is closed
+    TPoint ab = points[b] - points[a];
+    TCoord length2 = dot(ab, ab);
+    TCoord max = length2 != 0.0 ? epsilon2 * length2 : epsilon2;
+    size_t index = 0;
+    for(size_t i=a+1; i<b; ++i) {
+      TPoint ap = points[i] - points[a];
+      TCoord d;
+      if (length2 != 0.0) {
+        d = cross(ab, ap);
+        d *= d;
+      } else {
+        d = dot(ap, ap);
+      }
+      if (d > max) {
+        max = d;
+        index = i;
+      }
+    }
+    if (index != 0) {
+      (*keep)[index] = true;
+      b = index;
+      continue;
+    }
+    if (b==size-1)
+      break;
+    a = b;
+    for(b=a+1; !(*keep)[b]; ++b)
+      ;
+  }
+}
+
+void
+ramerDouglasPeucker(const vector<TPoint> &in, TCoord epsilon, vector<TPoint> *out)
+{
+  vector<bool> keep;
+  ramerDouglasPeucker(in.data(), in.size(), epsilon, &keep);
+  out->clear();
+  for(size_t i=0; i<in.size(); ++i) {
+    if (keep[i])
+      out->push_back(in[i]);
+  }
+}
+
+/**
+ * The number of lines needed to approximate the cubic bézier 'curve'
+ * within 'tolerance'.
+ *
+ * This is Wang's formula: the distance between the curve and its
+ * flattening with n lines is at most 3/4 * max|second difference| / n².
+ * Flat parts of a path get a single line and sharp bends as many as
+ * they need, without subdividing them first.
+ */
+size_t
+flattenCurveSegments(const TPoint *curve, TCoord tolerance)
+{
+  TPoint d0 = curve[0] - 2.0 * curve[1] + curve[2];
+  TPoint d1 = curve[1] - 2.0 * curve[2] + curve[3];
+  TCoord m = sqrt(max(d0.x*d0.x + d0.y*d0.y, d1.x*d1.x + d1.y*d1.y));
+  TCoord n = ceil(sqrt(0.75 * m / tolerance));
+  // also catches a NaN from a zero tolerance of a straight curve
+  if (!(n>=1.0))
+    return 1;
+  return n < 65536.0 ? static_cast<size_t>(n) : 65536;
+}
+
+/**
+ * Append the points of the lines approximating the cubic bézier 'curve'
+ * within 'tolerance' to 'out'. The first point, curve[0], is not added.
+ */
+void
+flattenCurve(const TPoint *curve, TCoord tolerance, vector<TPoint> *out)
+{
+  size_t n = flattenCurveSegments(curve, tolerance);
+
+  // forward differences of the polynomial at steps of h
+  TCoord h = 1.0 / n;
+  TPoint a = 3.0 * (curve[1] - curve[0]);
+  TPoint b = 3.0 * (curve[0] - 2.0 * curve[1] + curve[2]);
+  TPoint c = curve[3] - curve[0] + 3.0 * (curve[1] - curve[2]);
+  TPoint p = curve[0];
+  TPoint d1 = h * (a + h * (b + h * c));
+  TPoint d3 = 6.0 * h * h * h * c;
+  TPoint d2 = 2.0 * h * h * b + d3;
+
+  for(size_t i=1; i<n; ++i) {
+    p += d1;
+    d1 += d2;
+    d2 += d3;
+    out->push_back(p);
+  }
+  out->push_back(curve[3]);
+}
+
+/**
+ * Flatten the poly bézier 'curves' with 'size' = 3n+1 points into 'out'.
+ */
+void
+flattenCurves(const TPoint *curves, size_t size, TCoord tolerance, vector<TPoint> *out)
+{
+  out->clear();
+  if (size==0)
+    return;
+  out->push_back(curves[0]);
+  for(size_t i=0; i+3<size; i+=3)
+    flattenCurve(curves+i, tolerance, out);
+}
+
+/**
+ * Return the flattened 'curves', which are reused when the curves and the
+ * tolerance's power of two are the same as on the last call.
+ */
+const TPolygon&
+TFlatteningCache::flatten(const TPoint *curves, size_t size, TCoord tolerance)
+{
+  TCoord b = exp2(floor(log2(tolerance)));
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  const unsigned char *byte = reinterpret_cast<const unsigned char*>(curves);
+  for(size_t i=0; i<size*sizeof(TPoint); ++i)
+    h = (h ^ byte[i]) * 1099511628211ULL;
+  if (b!=bucket || size!=this->size || h!=hash) {
+    bucket = b;
+    this->size = size;
+    hash = h;
+    flattenCurves(curves, size, bucket, &flat);
+  }
+  return flat;
+}
+
+void
+TFlatteningCache::clear()
+{
+  size = 0;
+  hash = 0;
+  flat.clear();
+  bucket = 0.0;
+}
+
 } // namespace
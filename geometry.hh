@@ -22,6 +22,7 @@
 
 #include <toad/types.hh>
 #include <toad/vector.hh>
+#include <cstdint>
 
 namespace toad {
 
@@ -66,6 +67,20 @@ void intersectLineCurve(TIntersectionList &ilist, const TPoint *line, const TPoi
 void intersectLineLine(TIntersectionList &ilist, const TPoint *line0, const TPoint *line1);
 void intersectLineLine2(TIntersectionList *ilist, const TPoint *l0, const TPoint *l1);
 
+/**
+ * A line or curve of a path along with its bounding box.
+ */
+struct TPathSegment {
+  TPathSegment(TVectorPath::EType t, const TPoint *p);
+  TVectorPath::EType type; // LINE or CURVE
+  const TPoint *pt;        // 2 or 4 points
+  TBoundary bounds;
+};
+
+void intersectSegments(TIntersectionList &ilist, const vector<TPathSegment> &segments0, const vector<TPathSegment> &segments1);
+void intersectPaths(TIntersectionList &ilist, const TVectorPath &path0, const TVectorPath &path1);
+void intersectCurves(TIntersectionList &ilist, const TPoint *curves0, size_t size0, const TPoint *curves1, size_t size1);
+
 TRectangle curveBounds(const TPoint *curve);
 
 void divideBezier(const TPoint *a, TPoint *p, TCoord min, TCoord max);
@@ -77,6 +92,36 @@ inline void fitPath(const vector<TPoint> &in, TCoord tolerance, vector<TPoint> *
   fitPath(in.data(), in.size(), tolerance, out);
 }
 void convexHull(vector<TPoint> *points);
+void ramerDouglasPeucker(const TPoint *points, size_t size, TCoord epsilon, vector<bool> *keep);
+void ramerDouglasPeucker(const vector<TPoint> &in, TCoord epsilon, vector<TPoint> *out);
+size_t flattenCurveSegments(const TPoint *curve, TCoord tolerance);
+void flattenCurve(const TPoint *curve, TCoord tolerance, vector<TPoint> *out);
+void flattenCurves(const TPoint *curves, size_t size, TCoord tolerance, vector<TPoint> *out);
+
+/**
+ * Keeps the result of flattenCurves() until it is asked for other curves
+ * or another tolerance.
+ *
+ * Only the result is kept, the curves are recognized by their size and a
+ * hash of their points.
+ *
+ * Tolerances are rounded down to a power of two, so that small changes,
+ * ie. while zooming, don't cause the curves to be flattened again.
+ */
+class TFlatteningCache
+{
+  public:
+    const TPolygon& flatten(const TPoint *curves, size_t size, TCoord tolerance);
+    const TPolygon& flatten(const vector<TPoint> &curves, TCoord tolerance) {
+      return flatten(curves.data(), curves.size(), tolerance);
+    }
+    void clear();
+  protected:
+    size_t size = 0;
+    uint64_t hash = 0;
+    TPolygon flat;
+    TCoord bucket = 0.0;
+};
 
 /*
 A Bézier curve does not have self-intersections if the sum of all absolute
@@ -100,6 +145,13 @@ int solveQuadratic(TCoord a, TCoord b, TCoord c, TCoord *roots, TCoord min, TCoo
  */
 int solveCubic(TCoord a, TCoord b, TCoord c, TCoord d, TCoord *roots, TCoord min, TCoord max);
 
+/**
+ * solve the cubic equations a[i]*x^3 + b[i]*x^2 + c[i]*x + d[i] = 0 for i < n
+ * and restrict results to [min, max]
+ */
+void solveCubics(const TCoord *a, const TCoord *b, const TCoord *c, const TCoord *d, size_t n,
+                 TCoord min, TCoord max, vector<TCoord> *roots, vector<size_t> *first);
+
 enum BooleanOpType { INTERSECTION, UNION, DIFFERENCE, XOR };
 void boolean(const TVectorPath &subj, const TVectorPath &clip, TVectorPath *out, BooleanOpType op);
 
@@ -37,6 +37,8 @@
 #include <unistd.h>
 #include <iostream>
 #include <locale>
+#include <algorithm>
+#include <string_view>
 
 using namespace std;
 using namespace atv;
@@ -203,7 +205,7 @@ TATVParser::parse()
       case 0:
         switch(t) {
           case TKN_STRING:
-            unknown = yytext;
+            unknown.swap(yytext);
             state = 1;
             break;
           case '{':
@@ -241,26 +243,26 @@ TATVParser::parse()
         value.clear();
         switch(t) {
           case '=':
-            attribute = unknown;
+            attribute.swap(unknown);
             state = 2;
             break;
           case '{':
-            type = unknown;
+            type.swap(unknown);
             state = 0;
             if (!startGroup()) {
               return false;
             }
             break;
           case '}':
-            value = unknown;
+            value.swap(unknown);
             state = 10;
             if (!single()) {
               return false;
             }
             break;
           case TKN_STRING:
-            value = unknown;
-            unknown = yytext;
+            value.swap(unknown);
+            unknown.swap(yytext);
             if (!single()) {
               return false;
             }
@@ -268,7 +270,7 @@ TATVParser::parse()
               return true;
             break;
           case EOF:
-            value = unknown;
+            value.swap(unknown);
             state = 11;
             if (!single()) {
               return false;
@@ -284,7 +286,7 @@ TATVParser::parse()
       case 2: // attribute '=' ?
         switch(t) {
           case TKN_STRING:
-            unknown = yytext;
+            unknown.swap(yytext);
             state = 3;
             break;
           case '{':
@@ -301,16 +303,16 @@ TATVParser::parse()
       case 3: // attribute '=' string ?
         switch(t) {
           case '{': // attribute '=' string '{'
-            type = unknown;
+            type.swap(unknown);
             state = 0;
             if (!startGroup()) {
               return false;
             }
             break;
           case TKN_STRING:
-            value = unknown;
+            value.swap(unknown);
             state = 1;
-            unknown = yytext;
+            unknown.swap(yytext);
             if (!single()) {
               return false;
             }
@@ -320,14 +322,14 @@ TATVParser::parse()
             }
             break;
           case '}':
-            value = unknown;
+            value.swap(unknown);
             state=10;
             if (!single()) {
               return false;
             }
             break;
           case EOF:
-            value = unknown;
+            value.swap(unknown);
             state = 0;
             if (!single()) {
               return false;
@@ -531,6 +533,211 @@ TATVParser::yylex()
   }
 }
 
+namespace {
+
+// characters which end a string not enclosed in quotes, see yylex()
+inline bool
+isDelimiter(char c)
+{
+  switch(c) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case '{':
+    case '}':
+    case '=':
+    case '/':
+      return true;
+  }
+  return false;
+}
+
+enum EToken {
+  TOKEN_END,
+  TOKEN_ERROR,  // the text ends inside a string or comment
+  TOKEN_OPEN,
+  TOKEN_CLOSE,
+  TOKEN_EQUAL,
+  TOKEN_STRING,
+  TOKEN_QUOTED  // 'start' and 'p' include the quotes
+};
+
+// the next token of an ATV text from 'p' on, without interpreting it, for
+// findGroups() and findReferences(); comments are skipped
+EToken
+scan(const char *&p, const char *e, const char **start, bool *escaped)
+{
+  while(p<e) {
+    switch(*p) {
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        ++p;
+        break;
+      case '/':
+        if (p+1<e && p[1]=='/') {
+          while(p<e && *p!='\n')
+            ++p;
+        } else
+        if (p+1<e && p[1]=='*') {
+          p += 2;
+          while(p+1<e && !(p[0]=='*' && p[1]=='/'))
+            ++p;
+          if (p+1>=e)
+            return TOKEN_ERROR;
+          p += 2;
+        } else {
+          return TOKEN_ERROR;
+        }
+        break;
+      case '{':
+        *start = p++;
+        return TOKEN_OPEN;
+      case '}':
+        *start = p++;
+        return TOKEN_CLOSE;
+      case '=':
+        *start = p++;
+        return TOKEN_EQUAL;
+      case '\"':
+        *start = p++;
+        *escaped = false;
+        while(p<e && *p!='\"') {
+          if (*p=='\\') {
+            *escaped = true;
+            ++p;
+          }
+          ++p;
+        }
+        if (p>=e)
+          return TOKEN_ERROR;
+        ++p;
+        return TOKEN_QUOTED;
+      default:
+        *start = p;
+        while(p<e && !isDelimiter(*p))
+          ++p;
+        return TOKEN_STRING;
+    }
+  }
+  return TOKEN_END;
+}
+
+} // namespace
+
+/**
+ * Find the outermost groups of the given type in an ATV text without
+ * interpreting it, ie. to restore them in parallel.
+ *
+ * Types in quotes which contain escape sequences aren't recognized.
+ *
+ * \return 'false' when the text ends inside a string, comment or group
+ */
+bool
+atv::findGroups(const string &text, const string &type, vector<TATVGroupRange> *groups)
+{
+  const char *data = text.data(), *p = data, *e = data + text.size();
+  unsigned depth = 0, groupDepth = 0;
+  bool inside = false;
+  // the last token was a string equal to 'type', starting at 'type'
+  const char *match = nullptr;
+  const char *start;
+  bool escaped;
+
+  while(true) {
+    switch(scan(p, e, &start, &escaped)) {
+      case TOKEN_END:
+        return depth==0;
+      case TOKEN_ERROR:
+        return false;
+      case TOKEN_OPEN:
+        if (match && !inside) {
+          groups->push_back({ size_t(match-data), size_t(p-data), 0 });
+          inside = true;
+          groupDepth = depth;
+        }
+        ++depth;
+        match = nullptr;
+        break;
+      case TOKEN_CLOSE:
+        if (depth==0)
+          return false;
+        --depth;
+        if (inside && depth==groupDepth) {
+          groups->back().end = p-data;
+          inside = false;
+        }
+        match = nullptr;
+        break;
+      case TOKEN_EQUAL:
+        match = nullptr;
+        break;
+      case TOKEN_QUOTED:
+        match = !escaped && type.compare(0, string::npos, start+1, p-start-2)==0 ? start : nullptr;
+        break;
+      case TOKEN_STRING:
+        match = type.compare(0, string::npos, start, p-start)==0 ? start : nullptr;
+        break;
+    }
+  }
+}
+
+/**
+ * Collect the numbers assigned to attributes between 'begin' and 'end' of
+ * an ATV text without interpreting it: those assigned to 'id' in 'ids' and
+ * those assigned to one of 'attributes' in 'refs'.
+ *
+ * This tells which parts of a text restorePointer() and restoreShared()
+ * may connect, when 'attributes' are those they're called with. As the
+ * text isn't interpreted, an attribute of the same name which holds
+ * something else adds a number to 'refs' too.
+ *
+ * \return 'false' when the range ends inside a string or comment
+ */
+bool
+atv::findReferences(const string &text, size_t begin, size_t end,
+                    const set<string, less<>> &attributes,
+                    vector<unsigned> *ids, vector<unsigned> *refs)
+{
+  const char *p = text.data() + begin, *e = text.data() + end;
+  // 0: nothing, 1: a string, 2: a string and '='
+  unsigned state = 0;
+  const char *attribute = nullptr, *attributeEnd = nullptr;
+  const char *start;
+  bool escaped;
+
+  while(true) {
+    switch(scan(p, e, &start, &escaped)) {
+      case TOKEN_END:
+        return true;
+      case TOKEN_ERROR:
+        return false;
+      case TOKEN_EQUAL:
+        state = state==1 ? 2 : 0;
+        break;
+      case TOKEN_STRING:
+        if (state==2 && p-start<=9 && all_of(start, p, [](char c) { return c>='0' && c<='9'; })) {
+          unsigned n = 0;
+          for(const char *q = start; q<p; ++q)
+            n = n * 10 + (*q - '0');
+          string_view name(attribute, attributeEnd-attribute);
+          if (name=="id")
+            ids->push_back(n);
+          else if (attributes.find(name)!=attributes.end())
+            refs->push_back(n);
+        }
+        attribute = start;
+        attributeEnd = p;
+        state = 1;
+        break;
+      default:
+        state = 0;
+    }
+  }
+}
+
 bool
 TATVParser::single()
 {
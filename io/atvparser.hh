@@ -35,6 +35,8 @@
 #include <iostream>
 #include <sstream>
 #include <stack>
+#include <set>
+#include <vector>
 
 namespace atv {
 
@@ -203,6 +205,21 @@ class TATVParser
     std::string yytext;
 };
 
+/**
+ * The position of a group in an ATV text, see findGroups().
+ */
+struct TATVGroupRange
+{
+  size_t begin; //!< start of the group's type
+  size_t body;  //!< after the group's '{'
+  size_t end;   //!< after the group's '}'
+};
+
+bool findGroups(const std::string &text, const std::string &type, std::vector<TATVGroupRange> *groups);
+bool findReferences(const std::string &text, size_t begin, size_t end,
+                    const std::set<std::string, std::less<>> &attributes,
+                    std::vector<unsigned> *ids, std::vector<unsigned> *refs);
+
 } // namespace atv
 
 namespace toad {
@@ -32,6 +32,19 @@
 
 #include <iostream>
 #include <sstream>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <atomic>
+#include <thread>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#if !defined(__cpp_lib_to_chars) && defined(__APPLE__)
+#include <xlocale.h>
+#endif
 
 using namespace std;
 using namespace atv;
@@ -100,6 +113,40 @@ storePointer(TOutObjectStream &out, const char *attribute, const TSerializable *
   }
 }
 
+/**
+ * Store an object which is shared by several others.
+ *
+ * The first call for an object stores it like ::store(out, attribute, obj)
+ * along with an id and all following calls store the id only. Use
+ * restoreShared to restore it.
+ */
+void
+storeShared(TOutObjectStream &out, const char *attribute, const TSerializable *obj)
+{
+  if (!obj)
+    return;
+  if (strcmp(attribute, "id")==0)
+    throw std::invalid_argument("'id' is an reserved attribute");
+
+  bool first = out.shared.insert(obj).second;
+  switch(out.pass) {
+    case 0:
+      if (out.idMap.find(obj)==out.idMap.end())
+        out.idMap[obj] = ++out.id;
+      if (first)
+        ::store(out, obj);
+      break;
+    case 1:
+      out.indent();
+      if (first) {
+        out << attribute << " =";
+        ::store(out, obj);
+      } else {
+        out << attribute << " = " << out.idMap[obj];
+      }
+      break;
+  }
+}
 
 void
 TInObjectStream::close()
@@ -125,9 +172,13 @@ atv::getDefaultStore()
 }
 
 void 
-TObjectStore::registerObject(TSerializable *obj)
+TObjectStore::registerObject(TSerializable *obj, TFactory create)
 {
-  buffer[obj->getClassName()]=obj;
+  TEntry &entry = buffer[obj->getClassName()];
+  if (entry.prototype != obj)
+    delete entry.prototype;
+  entry.prototype = obj;
+  entry.create = create;
 }
 
 void
@@ -138,41 +189,51 @@ TObjectStore::unregisterAll()
   p = buffer.begin();
   e = buffer.end();
   while(p!=e) {
-    delete (*p).second;
+    delete (*p).second.prototype;
     ++p;
   }
   buffer.clear();
+  references.clear();
+  last = nullptr;
 #endif
 }
 
 bool
-TObjectStore::isRegistered(const string &type) const
+TObjectStore::isRegistered(string_view type) const
 {
-  return buffer.find(type.c_str())!=buffer.end();
+  return buffer.find(type)!=buffer.end();
 }
 
 /**
- * Find an object with the given typename and return a clone.
+ * Create an object of the given typename.
  */
 TSerializable*
-TObjectStore::clone(const string &type)
-{
-  TSerializable *s = 0;
-  TSerializableBuffer::iterator ptr;
-  ptr = buffer.find(type.c_str());
-  if (ptr!=buffer.end()) {
-    s = static_cast<TSerializable*>(ptr->second->clone());
-//    cerr << "in " << this << " found type " << type << endl;
-    if (!s) {
-      cerr << "failed to clone type, got NULL" << endl;
-    }
-  } else {
-    cerr << "in " << this << " unknown type " << type << endl;
-    ptr = buffer.begin();
-    while(ptr!=buffer.end()) {
-      cout << "  know " << (*ptr).first << endl;
-      ++ptr;
+TObjectStore::clone(string_view type)
+{
+  const TSerializableBuffer::value_type *entry = last;
+  if (!entry || entry->first != type) {
+    TSerializableBuffer::iterator ptr;
+    ptr = buffer.find(type);
+    if (ptr==buffer.end()) {
+      cerr << "in " << this << " unknown type " << type << endl;
+      ptr = buffer.begin();
+      while(ptr!=buffer.end()) {
+        cout << "  know " << (*ptr).first << endl;
+        ++ptr;
+      }
+      return 0;
     }
+    entry = &*ptr;
+    last = entry;
+  }
+  TSerializable *s;
+  if (entry->second.create)
+    s = entry->second.create();
+  else
+    s = static_cast<TSerializable*>(entry->second.prototype->clone());
+//  cerr << "in " << this << " found type " << type << endl;
+  if (!s) {
+    cerr << "failed to clone type, got NULL" << endl;
   }
   return s;
 }
@@ -246,12 +307,14 @@ TOutObjectStream::close()
   init(out->rdbuf()); // redirect our input to 'out'
   depth=0; line=0;
   pass = 1;
+  shared.clear();
   for(auto &s: all) {
     store(s);
   }
   
   all.clear();
   idMap.clear();
+  shared.clear();
 }
 
 void
@@ -384,6 +447,335 @@ TInObjectStream::restore()
   return obj;
 }
 
+namespace {
+
+// the placeholders get ids above those TOutObjectStream assigns
+const unsigned placeholderId = 0xf0000000;
+
+// 'text' with the body of each group replaced by the id of a placeholder
+string
+skeleton(const string &text, const vector<TATVGroupRange> &groups)
+{
+  string skeleton;
+  size_t pos = 0;
+  for(size_t i=0; i<groups.size(); ++i) {
+    skeleton.append(text, pos, groups[i].body - pos);
+    skeleton += " id = " + to_string(placeholderId + i) + " }";
+    pos = groups[i].end;
+  }
+  skeleton.append(text, pos, string::npos);
+  return skeleton;
+}
+
+// call work(0) to work(n-1) on 'threads' threads, 0 for one per core
+void
+parallel(size_t n, unsigned threads, const function<void(size_t)> &work)
+{
+  atomic<size_t> next(0);
+  auto worker = [&] {
+    size_t i;
+    while((i = next++) < n)
+      work(i);
+  };
+  if (threads == 0)
+    threads = thread::hardware_concurrency();
+  threads = min<size_t>(threads, n);
+  if (threads <= 1) {
+    worker();
+    return;
+  }
+  vector<thread> workers;
+  for(unsigned i=1; i<threads; ++i)
+    workers.push_back(thread(worker));
+  worker();
+  for(auto &&w: workers)
+    w.join();
+}
+
+} // namespace
+
+TLazyLoader::TLazyLoader(TObjectStore *store)
+{
+  this->store = store ? store : &defaultstore;
+  obj = nullptr;
+}
+
+/**
+ * Restore the object in 'text' with an empty placeholder in place of each
+ * of the outermost groups of the given type, which are restored later by
+ * load(), loadNext() or loadAll().
+ *
+ * replace(placeholder, object) is called for each group when it is
+ * restored, which has to put the object in the placeholder's place and
+ * delete the placeholder.
+ *
+ * \return the object or NULL when the text couldn't be restored
+ */
+TSerializable*
+TLazyLoader::restore(string text, const string &type, const TReplace &replace)
+{
+  this->text.swap(text);
+  this->replace = replace;
+  obj = nullptr;
+  if (!findGroups(this->text, type, &groups)) {
+    err << "the text ends inside a string, comment or group\n";
+    return nullptr;
+  }
+
+  // index the ids and the numbers which may refer to them, with the rest of
+  // the text as the last part
+  size_t rest = groups.size();
+  vector<vector<unsigned>> refs(rest+1);
+  unordered_map<unsigned, size_t> owner;
+  vector<unsigned> ids;
+  size_t pos = 0;
+  for(size_t i=0; i<=rest; ++i) {
+    ids.clear();
+    findReferences(this->text, pos, i<rest ? groups[i].begin : this->text.size(), store->getReferences(), &ids, &refs[rest]);
+    for(auto id: ids)
+      owner[id] = rest;
+    if (i==rest)
+      break;
+    ids.clear();
+    findReferences(this->text, groups[i].begin, groups[i].end, store->getReferences(), &ids, &refs[i]);
+    for(auto id: ids)
+      owner[id] = i;
+    pos = groups[i].end;
+  }
+
+  // join the parts which may refer to each other
+  vector<size_t> parent(rest+1);
+  for(size_t i=0; i<=rest; ++i)
+    parent[i] = i;
+  auto root = [&](size_t i) {
+    while(parent[i]!=i)
+      i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for(size_t i=0; i<=rest; ++i) {
+    for(auto ref: refs[i]) {
+      auto p = owner.find(ref);
+      if (p!=owner.end())
+        parent[root(i)] = root(p->second);
+    }
+  }
+  // the groups joined with the rest of the text are restored right away
+  vector<size_t> eager;
+  map<size_t, size_t> roots;
+  component.assign(rest, 0);
+  for(size_t i=0; i<rest; ++i) {
+    size_t r = root(i);
+    if (r==root(rest)) {
+      eager.push_back(i);
+      continue;
+    }
+    auto p = roots.insert(make_pair(r, components.size()));
+    if (p.second)
+      components.push_back(vector<size_t>());
+    component[i] = p.first->second;
+    components[p.first->second].push_back(i);
+  }
+
+  istringstream stream(skeleton(this->text, groups));
+  TInObjectStream in(&stream, store);
+  TSerializable *s = in.restore();
+  if (!s || !in) {
+    err << in.getErrorText();
+    in.idMap.clear();
+    in.refMap.clear();
+    delete s;
+    return nullptr;
+  }
+  placeholders.resize(rest);
+  for(size_t i=0; i<rest; ++i) {
+    auto p = in.idMap.find(placeholderId + i);
+    if (p == in.idMap.end()) {
+      err << "failed to restore the placeholder of a " << type << "\n";
+      in.idMap.clear();
+      in.refMap.clear();
+      delete s;
+      return nullptr;
+    }
+    placeholders[i] = const_cast<TSerializable*>(p->second);
+    in.idMap.erase(p);
+  }
+
+  vector<TSerializable*> objs;
+  if (!restoreGroups(eager, in, &objs)) {
+    err << in.getErrorText();
+    delete s;
+    return nullptr;
+  }
+  in.close();
+  obj = s;
+  for(auto &&c: components) {
+    for(auto i: c)
+      pending[placeholders[i]] = i;
+  }
+  place(eager, objs);
+  return s;
+}
+
+/**
+ * Restore the group of a placeholder along with the groups connected to
+ * it, when this wasn't done already.
+ */
+bool
+TLazyLoader::load(const TSerializable *placeholder)
+{
+  auto p = pending.find(placeholder);
+  if (p==pending.end())
+    return true;
+  const vector<size_t> &c = components[component[p->second]];
+  TInObjectStream in(nullptr, store);
+  vector<TSerializable*> objs;
+  if (!restoreGroups(c, in, &objs)) {
+    err << in.getErrorText();
+    return false;
+  }
+  in.close();
+  place(c, objs);
+  return true;
+}
+
+/**
+ * Restore the first group not restored yet, ie. while the application is
+ * idle.
+ *
+ * \return 'false' when there was no group left or it couldn't be restored
+ */
+bool
+TLazyLoader::loadNext()
+{
+  for(auto &&placeholder: placeholders) {
+    if (placeholder)
+      return load(placeholder);
+  }
+  return false;
+}
+
+/**
+ * Restore all groups which weren't restored yet, those which aren't
+ * connected to each other on worker threads.
+ *
+ * \param threads the number of threads, 0 for one per core
+ */
+bool
+TLazyLoader::loadAll(unsigned threads)
+{
+  vector<size_t> todo;
+  for(size_t i=0; i<components.size(); ++i) {
+    for(auto j: components[i]) {
+      if (placeholders[j]) {
+        todo.push_back(i);
+        break;
+      }
+    }
+  }
+
+  struct TPart {
+    vector<TSerializable*> objs;
+    string error;
+    bool ok = false;
+  };
+  vector<TPart> parts(todo.size());
+  parallel(todo.size(), threads, [&](size_t i) {
+    TInObjectStream in(nullptr, store);
+    parts[i].ok = restoreGroups(components[todo[i]], in, &parts[i].objs);
+    if (parts[i].ok)
+      in.close();
+    else
+      parts[i].error = in.getErrorText();
+  });
+
+  bool result = true;
+  for(size_t i=0; i<todo.size(); ++i) {
+    if (parts[i].ok) {
+      place(components[todo[i]], parts[i].objs);
+    } else {
+      err << parts[i].error;
+      result = false;
+    }
+  }
+  return result;
+}
+
+/**
+ * Forget a placeholder which is about to be deleted, ie. along with the
+ * slide it's on, so that an object created at its address later isn't
+ * taken for it. Its group isn't restored anymore and pointers into it
+ * are restored as NULL.
+ */
+void
+TLazyLoader::forget(const TSerializable *placeholder)
+{
+  auto p = pending.find(placeholder);
+  if (p==pending.end())
+    return;
+  placeholders[p->second] = nullptr;
+  pending.erase(p);
+  if (pending.empty())
+    string().swap(text);
+}
+
+// restore 'groups' in order, collecting their ids and pointers in 'in' so
+// that restoreShared() finds the objects of the groups before, with NULL
+// for the groups whose placeholder was forgotten
+bool
+TLazyLoader::restoreGroups(const vector<size_t> &groups, TInObjectStream &in, vector<TSerializable*> *objs)
+{
+  for(auto i: groups) {
+    if (!placeholders[i]) {
+      objs->push_back(nullptr);
+      continue;
+    }
+    const TATVGroupRange &g = this->groups[i];
+    istringstream stream(text.substr(g.begin, g.end - g.begin));
+    TInObjectStream part(&stream, store);
+    part.idMap.swap(in.idMap);
+    bool ok = false;
+    try {
+      ok = part.restore() && part;
+    }
+    catch(...) {
+    }
+    part.idMap.swap(in.idMap);
+    for(auto &&ref: part.refMap) {
+      auto &refs = in.refMap[ref.first];
+      refs.insert(refs.end(), ref.second.begin(), ref.second.end());
+    }
+    part.refMap.clear();
+    if (!ok) {
+      in.err << part.getErrorText();
+      delete part.obj;
+      for(auto &&obj: *objs)
+        delete obj;
+      objs->clear();
+      in.idMap.clear();
+      in.refMap.clear();
+      return false;
+    }
+    objs->push_back(part.obj);
+  }
+  return true;
+}
+
+// put the restored groups in place of their placeholders
+void
+TLazyLoader::place(const vector<size_t> &groups, const vector<TSerializable*> &objs)
+{
+  for(size_t i=0; i<groups.size(); ++i) {
+    TSerializable *&placeholder = placeholders[groups[i]];
+    if (!placeholder)
+      continue;
+    pending.erase(placeholder);
+    replace(placeholder, objs[i]);
+    placeholder = nullptr;
+  }
+  if (pending.empty())
+    string().swap(text);
+}
+
 /*
  * helper functions to retrieve implicit types
  * (non implicit types are returned via a pointer)
@@ -478,12 +870,160 @@ restore(TInObjectStream &in, unsigned *value)
   return true;
 }
 
+// numbers
+//---------------------------------------------------------------------------
+
+#ifdef __cpp_lib_to_chars
+
+// std::to_chars writes the shortest representation from which std::from_chars
+// restores the same value, and both ignore the locale
+
+template <class T>
+static char*
+format(char *first, char *last, T value)
+{
+  auto result = to_chars(first, last, value);
+  return result.ec == errc() ? result.ptr : nullptr;
+}
+
+template <class T>
+static bool
+parse(const char *first, const char *last, T *value)
+{
+  auto result = from_chars(first, last, *value);
+  return result.ec == errc() && result.ptr == last;
+}
+
+#else
+
+// fallback for C++ libraries without floating point std::to_chars and
+// std::from_chars: strtod_l and snprintf with increasing precision
+
+static locale_t
+clocale()
+{
+  static locale_t c = newlocale(LC_NUMERIC_MASK, "C", 0);
+  return c;
+}
+
+static double strto(const char *s, char **end, double*) { return strtod_l(s, end, clocale()); }
+static float strto(const char *s, char **end, float*) { return strtof_l(s, end, clocale()); }
+
+template <class T>
+static bool
+parse(const char *first, const char *last, T *value)
+{
+  char buffer[64];
+  size_t n = last - first;
+  if (n==0 || n>=sizeof(buffer) || isspace(*first))
+    return false;
+  memcpy(buffer, first, n);
+  buffer[n] = 0;
+  char *end;
+  *value = strto(buffer, &end, value);
+  return end == buffer + n;
+}
+
+template <class T>
+static char*
+format(char *first, char *last, T value)
+{
+  char buffer[32];
+  for(int precision = numeric_limits<T>::digits10; ; ++precision) {
+    snprintf(buffer, sizeof(buffer), "%.*g", precision, static_cast<double>(value));
+    T check;
+    if (precision >= numeric_limits<T>::max_digits10 ||
+        (parse(buffer, buffer+strlen(buffer), &check) && check == value))
+      break;
+  }
+  // snprintf uses the decimal point of the current locale
+  char point = *localeconv()->decimal_point;
+  size_t n = 0;
+  for(char *p=buffer; *p; ++p, ++n) {
+    if (*p == point)
+      *p = '.';
+  }
+  if (static_cast<size_t>(last-first) < n)
+    return nullptr;
+  memcpy(first, buffer, n);
+  return first + n;
+}
+
+#endif
+
+char* formatNumber(char *first, char *last, double value) { return format(first, last, value); }
+char* formatNumber(char *first, char *last, float value) { return format(first, last, value); }
+bool parseNumber(const char *first, const char *last, double *value) { return parse(first, last, value); }
+bool parseNumber(const char *first, const char *last, float *value) { return parse(first, last, value); }
+
+template <class T>
+static void
+writeNumbers(TOutObjectStream &out, const T *value, size_t n)
+{
+  // the 1st pass only collects the ids of shared objects and discards the
+  // output
+  if (out.rdbuf() == nullstream.rdbuf())
+    return;
+  char buffer[4096];
+  char *p = buffer;
+  for(size_t i=0; i<n; ++i) {
+    if (buffer + sizeof(buffer) - p < 64) {
+      out.write(buffer, p - buffer);
+      p = buffer;
+    }
+    *p++ = ' ';
+    p = format(p, buffer + sizeof(buffer), value[i]);
+  }
+  out.write(buffer, p - buffer);
+}
+
+template <class T>
+static bool
+readNumbers(TInObjectStream &in, T *value, size_t n)
+{
+  for(size_t i=0; i<n; ++i) {
+    if (!in.parse() ||
+        in.what != ATV_VALUE ||
+        !in.attribute.empty() ||
+        !in.type.empty() ||
+        !parseNumber(in.value, value+i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+storeNumbers(TOutObjectStream &out, const double *value, size_t n)
+{
+  writeNumbers(out, value, n);
+}
+
+void
+storeNumbers(TOutObjectStream &out, const float *value, size_t n)
+{
+  writeNumbers(out, value, n);
+}
+
+bool
+restoreNumbers(TInObjectStream &in, double *value, size_t n)
+{
+  return readNumbers(in, value, n);
+}
+
+bool
+restoreNumbers(TInObjectStream &in, float *value, size_t n)
+{
+  return readNumbers(in, value, n);
+}
+
 // float
 //---------------------------------------------------------------------------
 void
 store(TOutObjectStream &out, const float &value)
 {
-  out << ' ' << value;
+  storeNumbers(out, &value, 1);
 }
 
 bool
@@ -491,11 +1031,7 @@ restore(TInObjectStream &in, float *value)
 {
   if (in.what != ATV_VALUE)
     return false;
-  char *endptr;
-  *value = strtod(in.value.c_str(), &endptr);
-  if (endptr!=0 && *endptr!=0)
-    return false;
-  return true;
+  return parseNumber(in.value, value);
 }
 
 // double
@@ -503,32 +1039,15 @@ restore(TInObjectStream &in, float *value)
 void
 store(TOutObjectStream &out, const double &value)
 {
-  out << ' ' << value;
+  storeNumbers(out, &value, 1);
 }
 
 bool
 restore(TInObjectStream &in, double *value)
 {
-  if (in.what != ATV_VALUE) {
-    return false;
-  }
-#if 0
-  // broken for some reason...
-  istringstream vs(in.value);
-  vs.imbue(locale("C"));
-  vs >> *value;
-  if (static_cast<unsigned>(vs.tellg()) != in.value.size()) {
-    return false;
-  }
-#else
-  char *endptr;
-  setlocale(LC_NUMERIC, "C");
-  *value = strtod(in.value.c_str(), &endptr);
-  setlocale(LC_NUMERIC, "");
-  if (endptr!=0 && *endptr!=0)
+  if (in.what != ATV_VALUE)
     return false;
-#endif
-  return true;
+  return parseNumber(in.value, value);
 }
 
 // bool
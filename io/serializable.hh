@@ -38,9 +38,15 @@
 #include <ostream>
 #endif
 #include <map>
+#include <set>
+#include <functional>
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstring>
+#include <typeinfo>
 
 namespace atv {
 
@@ -52,6 +58,8 @@ class TSerializable;
 
 void storePointer(atv::TOutObjectStream &out, const char *attribute, const atv::TSerializable *obj);
 template <class T> bool restorePointer(atv::TInObjectStream &in, const char *attribute, T **ptr);
+void storeShared(atv::TOutObjectStream &out, const char *attribute, const atv::TSerializable *obj);
+template <class T> bool restoreShared(atv::TInObjectStream &in, const char *attribute, T **ptr);
 
 namespace atv {
 
@@ -79,6 +87,7 @@ class TOutObjectStream:
 {
   friend void TSerializable::store(TOutObjectStream &out) const;
   friend void ::storePointer(atv::TOutObjectStream &out, const char *attribute, const atv::TSerializable *obj);
+  friend void ::storeShared(atv::TOutObjectStream &out, const char *attribute, const atv::TSerializable *obj);
   public:
     TOutObjectStream();
     TOutObjectStream(std::ostream* out);
@@ -126,23 +135,53 @@ class TOutObjectStream:
     // to create required ids during the 1st pass
     unsigned id;
     std::map<const TSerializable*, unsigned> idMap;
+
+    // objects already stored by storeShared during the current pass
+    std::set<const TSerializable*> shared;
 };
 
+/**
+ * The types TInObjectStream can create, by their class name.
+ *
+ * Objects are created by a factory function when the prototype was
+ * registered with its own type, ie. registerObject(new TFPath()), and by
+ * the prototype's clone() otherwise.
+ */
 class TObjectStore
 {
-    struct TCompare {
-      bool operator()(const char *a, const char *b) const {
-        return strcmp(a, b)<0;
-      }
+  public:
+    typedef TSerializable* (*TFactory)();
+  private:
+    struct TEntry {
+      TSerializable *prototype;
+      TFactory create;
     };
-    typedef std::map<const char*,TSerializable*,TCompare> TSerializableBuffer;
+    // the keys point to the string literals returned by getClassName()
+    typedef std::unordered_map<std::string_view, TEntry> TSerializableBuffer;
     TSerializableBuffer buffer;
+    // the entry found by the last call to clone(), as objects of the same
+    // type tend to follow each other; atomic for TLazyLoader::loadAll
+    std::atomic<const TSerializableBuffer::value_type*> last { nullptr };
+
+    template <class T>
+    static TSerializable* create() { return new T(); }
   public:
     ~TObjectStore() { unregisterAll(); }
-    void registerObject(TSerializable *obj);
-    bool isRegistered(const std::string &type) const;
+    void registerObject(TSerializable *obj, TFactory create=nullptr);
+    template <class T>
+    void registerObject(T *obj) {
+      registerObject(obj, typeid(*obj)==typeid(T) ? &TObjectStore::create<T> : nullptr);
+    }
+    bool isRegistered(std::string_view type) const;
     void unregisterAll();
-    TSerializable* clone(const std::string &type);
+    TSerializable* clone(std::string_view type);
+
+    //! register an attribute given to storePointer() or storeShared()
+    void registerReference(const std::string &attribute) { references.insert(attribute); }
+    //! the attributes which may hold the ids of other objects, see TLazyLoader
+    const std::set<std::string, std::less<>>& getReferences() const { return references; }
+  private:
+    std::set<std::string, std::less<>> references;
 };
 
 TObjectStore& getDefaultStore();
@@ -151,7 +190,9 @@ class TInObjectStream:
   public TATVParser, public TATVInterpreter
 {
     template <class T> friend bool ::restorePointer(atv::TInObjectStream &in, const char *attribute, T **ptr);
+    template <class T> friend bool ::restoreShared(atv::TInObjectStream &in, const char *attribute, T **ptr);
     friend bool TSerializable::restore(TInObjectStream &in);
+    friend class TLazyLoader;
     
     TObjectStore *store;
   public:
@@ -181,6 +222,58 @@ class TInObjectStream:
     std::map<unsigned, std::vector<TSerializable**>> refMap;
 };
 
+/**
+ * Restores an object from an ATV text but the outermost groups of a given
+ * type only when they're asked for, ie. the layers of the slides of a
+ * document which aren't shown.
+ *
+ * The text is kept along with the position of these groups, which
+ * findGroups() determines when the text is restored. Groups connected by
+ * restorePointer() or restoreShared() with an attribute registered by
+ * TObjectStore::registerReference() are restored together, so an object
+ * never points into a group which isn't restored yet. Groups connected with
+ * the rest of the text are restored right away.
+ */
+class TLazyLoader
+{
+  public:
+    typedef std::function<void(TSerializable*, TSerializable*)> TReplace;
+
+    TLazyLoader(TObjectStore *store=nullptr);
+
+    TSerializable* restore(std::string text, const std::string &type, const TReplace &replace);
+    bool isPending(const TSerializable *placeholder) const {
+      return pending.find(placeholder) != pending.end();
+    }
+    bool load(const TSerializable *placeholder);
+    bool loadNext();
+    bool loadAll(unsigned threads=0);
+    void forget(const TSerializable *placeholder);
+    //! the number of groups not restored yet
+    size_t getPending() const { return pending.size(); }
+    std::string getErrorText() const { return err.str(); }
+
+    //! the object restored by restore()
+    TSerializable *obj;
+
+  protected:
+    TObjectStore *store;
+    std::string text;
+    std::vector<TATVGroupRange> groups;
+    // the placeholder of each group until the group is restored or the
+    // placeholder is forgotten
+    std::vector<TSerializable*> placeholders;
+    std::unordered_map<const TSerializable*, size_t> pending;
+    // the groups which are restored together and the one of each group
+    std::vector<std::vector<size_t>> components;
+    std::vector<size_t> component;
+    TReplace replace;
+    std::stringstream err;
+
+    bool restoreGroups(const std::vector<size_t> &groups, TInObjectStream &in, std::vector<TSerializable*> *objs);
+    void place(const std::vector<size_t> &groups, const std::vector<TSerializable*> &objs);
+};
+
 /**
  * A macro to ease the declaration of TSerializable derived classes.
  *
@@ -270,6 +363,20 @@ bool restore(atv::TInObjectStream &in, int *value);
 void store(atv::TOutObjectStream &out, unsigned value);
 bool restore(atv::TInObjectStream &in, unsigned *value);
 
+// float and double are written locale independent and with as many digits
+// as are needed to restore exactly the value which was stored
+char* formatNumber(char *first, char *last, double value);
+char* formatNumber(char *first, char *last, float value);
+bool parseNumber(const char *first, const char *last, double *value);
+bool parseNumber(const char *first, const char *last, float *value);
+
+inline bool parseNumber(const std::string &s, double *value) {
+  return parseNumber(s.data(), s.data()+s.size(), value);
+}
+inline bool parseNumber(const std::string &s, float *value) {
+  return parseNumber(s.data(), s.data()+s.size(), value);
+}
+
 // float
 void store(atv::TOutObjectStream &out, const float &value);
 bool restore(atv::TInObjectStream &in, float *value);
@@ -278,6 +385,14 @@ bool restore(atv::TInObjectStream &in, float *value);
 void store(atv::TOutObjectStream &out, const double &value);
 bool restore(atv::TInObjectStream &in, double *value);
 
+// double[], float[] (n values, each preceded by a space)
+void storeNumbers(atv::TOutObjectStream &out, const double *value, size_t n);
+void storeNumbers(atv::TOutObjectStream &out, const float *value, size_t n);
+
+// the next n values of the current group
+bool restoreNumbers(atv::TInObjectStream &in, double *value, size_t n);
+bool restoreNumbers(atv::TInObjectStream &in, float *value, size_t n);
+
 // bool
 void store(atv::TOutObjectStream &out, bool value);
 bool restore(atv::TInObjectStream &in, bool *value);
@@ -404,6 +519,27 @@ bool restoreObject(atv::TInObjectStream &in, const char *attribute, T *value) {
   return restoreObject(in, value);
 }
 
+/**
+ * Restore an object stored with storeShared, which is either the object
+ * itself or the id of an object restored earlier.
+ */
+template <class T> bool
+restoreShared(atv::TInObjectStream &in, const char *attribute, T **ptr)
+{
+  if (in.attribute != attribute)
+    return false;
+  if (in.what == atv::ATV_GROUP)
+    return restoreObject(in, ptr);
+  unsigned id;
+  if (!restore(in, &id))
+    return false;
+  auto p = in.idMap.find(id);
+  if (p == in.idMap.end())
+    return false;
+  *ptr = dynamic_cast<T*>(const_cast<atv::TSerializable*>(p->second));
+  return *ptr != nullptr;
+}
+
 namespace toad {
   using namespace atv;
 } // namespace toad
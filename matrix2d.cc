@@ -21,6 +21,15 @@
 #include <toad/matrix2d.hh>
 #include <cmath>
 
+// TCoord is a CGFloat, which is a double on 64bit platforms
+#if defined(__LP64__) && defined(__SSE2__)
+#include <immintrin.h>
+#define TOAD_MATRIX2D_SSE2 1
+#elif defined(__LP64__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TOAD_MATRIX2D_NEON 1
+#endif
+
 using namespace toad;
 using namespace std;
 
@@ -259,6 +268,75 @@ TMatrix2D::map(TCoord inX, TCoord inY, double *outX, double *outY) const
 */
 }
 
+/**
+ * Map 'n' points from 'in' to 'out'.
+ *
+ * This is what map(const TPoint&, TPoint*) does for a single point, but
+ * without a call per point and with SSE2/AVX or NEON where available.
+ * 'in' and 'out' may be the same array.
+ */
+void
+TMatrix2D::map(const TPoint *in, TPoint *out, size_t n) const
+{
+  size_t i = 0;
+  if (isOnlyTranslate()) {
+#if defined(TOAD_MATRIX2D_SSE2)
+    __m128d t = _mm_set_pd(ty, tx);
+    for(; i<n; ++i)
+      _mm_storeu_pd(&out[i].x, _mm_add_pd(_mm_loadu_pd(&in[i].x), t));
+#elif defined(TOAD_MATRIX2D_NEON)
+    float64x2_t t = { tx, ty };
+    for(; i<n; ++i)
+      vst1q_f64(&out[i].x, vaddq_f64(vld1q_f64(&in[i].x), t));
+#else
+    for(; i<n; ++i) {
+      out[i].x = in[i].x + tx;
+      out[i].y = in[i].y + ty;
+    }
+#endif
+    return;
+  }
+
+  // each point is a (x, y) pair of doubles, hence
+  //   (x', y') = (a, b) * (x, x) + (c, d) * (y, y) + (tx, ty)
+#if defined(TOAD_MATRIX2D_SSE2)
+#if defined(__AVX__)
+  __m256d a4 = _mm256_set_pd(b, a, b, a),
+          c4 = _mm256_set_pd(d, c, d, c),
+          t4 = _mm256_set_pd(ty, tx, ty, tx);
+  for(; i+2<=n; i+=2) {
+    __m256d p = _mm256_loadu_pd(&in[i].x);
+    __m256d x = _mm256_unpacklo_pd(p, p);
+    __m256d y = _mm256_unpackhi_pd(p, p);
+    p = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a4, x), _mm256_mul_pd(c4, y)), t4);
+    _mm256_storeu_pd(&out[i].x, p);
+  }
+#endif
+  __m128d a2 = _mm_set_pd(b, a),
+          c2 = _mm_set_pd(d, c),
+          t2 = _mm_set_pd(ty, tx);
+  for(; i<n; ++i) {
+    __m128d p = _mm_loadu_pd(&in[i].x);
+    __m128d x = _mm_unpacklo_pd(p, p);
+    __m128d y = _mm_unpackhi_pd(p, p);
+    _mm_storeu_pd(&out[i].x, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a2, x), _mm_mul_pd(c2, y)), t2));
+  }
+#elif defined(TOAD_MATRIX2D_NEON)
+  float64x2_t a2 = { a, b }, c2 = { c, d }, t2 = { tx, ty };
+  for(; i<n; ++i) {
+    float64x2_t p = vld1q_f64(&in[i].x);
+    float64x2_t q = vaddq_f64(vmulq_laneq_f64(a2, p, 0), vmulq_laneq_f64(c2, p, 1));
+    vst1q_f64(&out[i].x, vaddq_f64(q, t2));
+  }
+#else
+  for(; i<n; ++i) {
+    TCoord x = in[i].x, y = in[i].y;
+    out[i].x = a * x + c * y + tx;
+    out[i].y = b * x + d * y + ty;
+  }
+#endif
+}
+
 /**
  * Invert the matrix.
  *
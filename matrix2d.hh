@@ -102,6 +102,7 @@ class TMatrix2D:
     }
     
     TPoint map(const TPoint&) const;
+    void map(const TPoint *in, TPoint *out, size_t n) const;
     
     // obsolete
     void map(TCoord inX, TCoord inY, short int *outX, short int *outY) const;
@@ -0,0 +1,488 @@
+/*
+ * TOAD -- A Simple and Powerful C++ GUI Toolkit for X-Windows
+ * Copyright (C) 2015 by Mark-André Hopf <mhopf@mark13.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <toad/offset.hh>
+#include <toad/geometry.hh>
+#include <algorithm>
+
+using namespace toad;
+
+namespace {
+
+// how often a curve may be divided, no curve follows the cusps of an offset
+const unsigned maxDepth = 10;
+
+// unit vector to the left of v, which is v turned by +90°
+inline TPoint
+leftOf(const TPoint &v)
+{
+  TCoord l = length(v);
+  return l>0.0 ? TPoint(-v.y/l, v.x/l) : TPoint(0, 0);
+}
+
+inline TPoint
+startTangent(const TPoint *p)
+{
+  for(int i=1; i<4; ++i) {
+    if (p[i]!=p[0])
+      return p[i]-p[0];
+  }
+  return TPoint(0, 0);
+}
+
+inline TPoint
+endTangent(const TPoint *p)
+{
+  for(int i=2; i>=0; --i) {
+    if (p[i]!=p[3])
+      return p[3]-p[i];
+  }
+  return TPoint(0, 0);
+}
+
+/**
+ * A line or curve of a subpath and the distance of the outline at its ends.
+ * Lines have their control points at a third, so that the tangents of both
+ * are found alike.
+ */
+struct TSegment
+{
+  bool curve;
+  TPoint p[4];
+  TCoord d0, d1;
+
+  TPoint startTangent() const { return ::startTangent(p); }
+  TPoint endTangent() const { return ::endTangent(p); }
+  void reverse() {
+    swap(p[0], p[3]);
+    swap(p[1], p[2]);
+    swap(d0, d1);
+  }
+};
+
+struct TSubpath
+{
+  vector<TSegment> segments;
+  bool closed = false;
+  // where a subpath without segments is
+  TPoint start;
+  TCoord d = 0.0;
+};
+
+// split the path into subpaths without segments of zero length
+void
+subpaths(const TVectorPath &path, const vector<TCoord> *pressure, TCoord d, vector<TSubpath> *out)
+{
+  const TPoint *pt = path.points.data();
+  size_t i = 0;
+  TPoint current(0, 0);
+  TCoord dc = d;
+  bool open = false;
+
+  auto distance = [&](size_t i) {
+    return pressure && i<pressure->size() ? d * (*pressure)[i] : d;
+  };
+  auto begin = [&] {
+    out->push_back(TSubpath());
+    out->back().start = current;
+    out->back().d = dc;
+    open = true;
+  };
+  auto add = [&](bool curve, const TPoint *p, TCoord d1) {
+    if (!open)
+      begin();
+    TSegment s;
+    s.curve = curve;
+    s.p[0] = current;
+    if (curve) {
+      s.p[1] = p[0];
+      s.p[2] = p[1];
+      s.p[3] = p[2];
+    } else {
+      s.p[1] = current + (p[0]-current) / 3.0;
+      s.p[2] = current + (p[0]-current) * (2.0 / 3.0);
+      s.p[3] = p[0];
+    }
+    s.d0 = dc;
+    s.d1 = d1;
+    current = s.p[3];
+    dc = d1;
+    if (s.p[0]!=s.p[1] || s.p[0]!=s.p[2] || s.p[0]!=s.p[3])
+      out->back().segments.push_back(s);
+  };
+
+  for(auto t: path.type) {
+    switch(t) {
+      case TVectorPath::MOVE:
+        current = pt[i];
+        dc = distance(i);
+        ++i;
+        begin();
+        break;
+      case TVectorPath::LINE:
+        add(false, pt+i, distance(i));
+        ++i;
+        break;
+      case TVectorPath::CURVE:
+        add(true, pt+i, distance(i+2));
+        i+=3;
+        break;
+      case TVectorPath::CLOSE:
+        if (!open)
+          break;
+        if (current!=out->back().start) {
+          TPoint start = out->back().start;
+          add(false, &start, out->back().d);
+        }
+        out->back().closed = true;
+        current = out->back().start;
+        dc = out->back().d;
+        open = false;
+        break;
+    }
+  }
+}
+
+// the intersection of the lines through a0, a1 and b0, b1 or between a1
+// and b0 when they are parallel
+TPoint
+intersectLines(const TPoint &a0, const TPoint &a1, const TPoint &b0, const TPoint &b1)
+{
+  TPoint a = a1 - a0, b = b1 - b0;
+  TCoord c = cross(b, a);
+  if (fabs(c) <= 1e-9 * length(a) * length(b))
+    return (a1 + b0) * 0.5;
+  return a0 + a * (cross(b, b0 - a0) / c);
+}
+
+// Tiller-Hanson: move the legs of the control polygon p by d[] at its
+// points to the left and intersect them
+void
+tillerHanson(const TPoint *p, const TCoord *d, TPoint *q)
+{
+  TPoint leg[3] = { startTangent(p), p[2]-p[1], endTangent(p) };
+  if (leg[1]==TPoint(0, 0))
+    leg[1] = p[3]-p[0];
+  TPoint n[3] = { leftOf(leg[0]), leftOf(leg[1]), leftOf(leg[2]) };
+  q[0] = p[0] + n[0]*d[0];
+  q[3] = p[3] + n[2]*d[3];
+  q[1] = intersectLines(q[0], p[1] + n[0]*d[1], p[1] + n[1]*d[1], p[2] + n[1]*d[2]);
+  q[2] = intersectLines(p[1] + n[1]*d[1], p[2] + n[1]*d[2], p[2] + n[2]*d[2], q[3]);
+}
+
+// the largest distance across the curve p between q and the offset by d0…d3
+TCoord
+offsetError(const TPoint *p, const TPoint *q, TCoord d0, TCoord d3)
+{
+  TCoord e = 0.0;
+  for(int i=1; i<8; ++i) {
+    TCoord t = i/8.0;
+    TPoint n = leftOf(bez2direction(p, t));
+    if (n.x==0.0 && n.y==0.0)
+      continue;
+    TPoint v = bez2point(q, t) - bez2point(p, t);
+    e = max(e, fabs(dot(v, n) - (d0 + (d3-d0)*t)));
+  }
+  return e;
+}
+
+/**
+ * Call f(q) with the offsets q of the pieces of curve p, which is divided
+ * until they are within the tolerance.
+ */
+template <class F>
+void
+offsetCurve(const TPoint *p, TCoord d0, TCoord d3, TCoord tolerance, unsigned depth, F &f)
+{
+  TCoord d[4] = { d0, d0 + (d3-d0)/3.0, d0 + (d3-d0)*(2.0/3.0), d3 };
+  TPoint q[4];
+  tillerHanson(p, d, q);
+  if (depth<maxDepth && offsetError(p, q, d0, d3) > tolerance) {
+    TPoint r[7];
+    divideBezier(p, r, 0.5);
+    TCoord dm = (d0 + d3) * 0.5;
+    offsetCurve(r, d0, dm, tolerance, depth+1, f);
+    offsetCurve(r+3, dm, d3, tolerance, depth+1, f);
+    return;
+  }
+  f(q);
+}
+
+template <class F>
+void
+offsetSegment(const TSegment &s, TCoord d0, TCoord d1, TCoord tolerance, F f)
+{
+  if (s.curve) {
+    offsetCurve(s.p, d0, d1, tolerance, 0, f);
+    return;
+  }
+  TPoint n = leftOf(s.p[3]-s.p[0]);
+  TPoint q[4];
+  for(int i=0; i<4; ++i)
+    q[i] = s.p[i] + n * (d0 + (d1-d0) * (i/3.0));
+  f(q);
+}
+
+// append a line unless it ends where the path already is
+void
+lineTo(TVectorPath *out, const TPoint &p)
+{
+  if (out->points.empty() || !isZero(squaredLength(out->points.back() - p)))
+    out->line(p);
+}
+
+// append an arc around 'center' from 'from' to 'to', which turns by 'sweep'
+// radians, with one curve for up to 90°
+void
+arcTo(TVectorPath *out, const TPoint &center, const TPoint &from, const TPoint &to, TCoord sweep)
+{
+  TPoint v = from - center;
+  TCoord radius = length(v);
+  if (radius==0.0) {
+    lineTo(out, to);
+    return;
+  }
+  TCoord angle = atan2(v.y, v.x);
+  int n = max(1, static_cast<int>(ceil(fabs(sweep) / (M_PI/2) - 1e-9)));
+  TCoord h = sweep / n, k = 4.0/3.0 * tan(h/4) * radius;
+  for(int i=0; i<n; ++i) {
+    TPoint e0(cos(angle + h*i), sin(angle + h*i));
+    TPoint e1(cos(angle + h*(i+1)), sin(angle + h*(i+1)));
+    out->curve(center + e0*radius + TPoint(-e0.y, e0.x)*k,
+               center + e1*radius - TPoint(-e1.y, e1.x)*k,
+               i+1==n ? to : center + e1*radius);
+  }
+}
+
+/**
+ * Join the offsets by d of two segments meeting at v in directions a and b,
+ * from v + leftOf(a)*d to v + leftOf(b)*d. For an outline the inner side
+ * goes through v, which is covered by both segments.
+ */
+void
+join(const TPathOffset &o, TVectorPath *out, const TPoint &v, const TPoint &a, const TPoint &b, TCoord d, bool outline)
+{
+  TPoint na = leftOf(a), nb = leftOf(b);
+  TPoint from = v + na*d, to = v + nb*d;
+  if (distance(from, to) <= o.tolerance) {
+    lineTo(out, to);
+    return;
+  }
+  TCoord c = cross(b, a), s = dot(na, nb);
+  if (c*d > 0.0) {
+    if (outline)
+      lineTo(out, v);
+    lineTo(out, to);
+    return;
+  }
+  switch(o.join) {
+    case TPathOffset::ROUND_JOIN: {
+      TCoord sweep = atan2(cross(nb, na), s);
+      // a turn of 180° goes around the outer side
+      if (sweep*d > 0.0)
+        sweep = -sweep;
+      arcTo(out, v, from, to, sweep);
+    } break;
+    case TPathOffset::MITER_JOIN:
+      // the miter is 1/cos(θ/2) times the distance where θ is the angle
+      // between the normals and 1+s = 2cos²(θ/2)
+      if (1.0 + s >= 2.0 / (o.miterLimit * o.miterLimit))
+        lineTo(out, v + (na+nb) * (d / (1.0 + s)));
+      lineTo(out, to);
+      break;
+    case TPathOffset::BEVEL_JOIN:
+      lineTo(out, to);
+      break;
+  }
+}
+
+// cap the end v of a segment going in direction a from v + leftOf(a)*d to
+// v - leftOf(a)*d
+void
+cap(const TPathOffset &o, TVectorPath *out, const TPoint &v, const TPoint &a, TCoord d)
+{
+  TPoint n = leftOf(a) * d, t = normalize(a) * fabs(d);
+  switch(o.cap) {
+    case TPathOffset::BUTT_CAP:
+      break;
+    case TPathOffset::ROUND_CAP:
+      arcTo(out, v, v+n, v-n, d>0.0 ? -M_PI : M_PI);
+      break;
+    case TPathOffset::SQUARE_CAP:
+      lineTo(out, v+n+t);
+      lineTo(out, v-n+t);
+      break;
+  }
+  lineTo(out, v-n);
+}
+
+// a subpath without segments
+void
+spot(const TPathOffset &o, const TSubpath &s, TVectorPath *out)
+{
+  TCoord d = fabs(s.d);
+  if (d==0.0)
+    return;
+  switch(o.cap) {
+    case TPathOffset::BUTT_CAP:
+      break;
+    case TPathOffset::ROUND_CAP: {
+      TPoint p = s.start + TPoint(d, 0);
+      out->move(p);
+      arcTo(out, s.start, p, p, -2.0*M_PI);
+      out->close();
+    } break;
+    case TPathOffset::SQUARE_CAP:
+      out->move(s.start + TPoint(-d, -d));
+      out->line(s.start + TPoint(-d, d));
+      out->line(s.start + TPoint(d, d));
+      out->line(s.start + TPoint(d, -d));
+      out->close();
+      break;
+  }
+}
+
+// append the offsets of the segments by their distance times 'sign' to the
+// left, starting at the current point
+void
+side(const TPathOffset &o, const vector<TSegment> &segments, bool closed, TCoord sign, bool outline, TVectorPath *out)
+{
+  for(size_t i=0; i<segments.size(); ++i) {
+    const TSegment &s = segments[i];
+    offsetSegment(s, s.d0*sign, s.d1*sign, o.tolerance, [&](const TPoint *q) {
+      lineTo(out, q[0]);
+      if (s.curve)
+        out->curve(q[1], q[2], q[3]);
+      else
+        lineTo(out, q[3]);
+    });
+    if (i+1<segments.size() || closed) {
+      const TSegment &next = segments[(i+1) % segments.size()];
+      join(o, out, s.p[3], s.endTangent(), next.startTangent(), s.d1*sign, outline);
+    }
+  }
+}
+
+void
+moveToSide(const TSegment &s, TCoord sign, TVectorPath *out)
+{
+  out->move(s.p[0] + leftOf(s.startTangent()) * (s.d0*sign));
+}
+
+vector<TSegment>
+reversed(const vector<TSegment> &segments)
+{
+  vector<TSegment> r(segments.rbegin(), segments.rend());
+  for(auto &&s: r)
+    s.reverse();
+  return r;
+}
+
+// the outline of a subpath as one closed contour when it's open or two
+// when it's closed
+void
+outline(const TPathOffset &o, const TSubpath &s, TVectorPath *out)
+{
+  if (s.segments.empty()) {
+    spot(o, s, out);
+    return;
+  }
+  vector<TSegment> back = reversed(s.segments);
+  if (s.closed) {
+    moveToSide(s.segments.front(), 1.0, out);
+    side(o, s.segments, true, 1.0, true, out);
+    out->close();
+    moveToSide(back.front(), 1.0, out);
+    side(o, back, true, 1.0, true, out);
+    out->close();
+    return;
+  }
+  moveToSide(s.segments.front(), 1.0, out);
+  side(o, s.segments, false, 1.0, true, out);
+  const TSegment &last = s.segments.back();
+  cap(o, out, last.p[3], last.endTangent(), last.d1);
+  side(o, back, false, 1.0, true, out);
+  cap(o, out, back.back().p[3], back.back().endTangent(), back.back().d1);
+  out->close();
+}
+
+// twice the area of the control polygon, positive when it goes around
+// counterclockwise with y going up
+TCoord
+area(const TSubpath &s)
+{
+  TCoord a = 0.0;
+  for(auto &&segment: s.segments) {
+    for(int i=0; i<3; ++i)
+      a += cross(segment.p[i+1], segment.p[i]);
+  }
+  return a;
+}
+
+} // unnamed namespace
+
+TPathOffset::TPathOffset(TCoord width, EJoin join, ECap cap):
+  width(width), join(join), cap(cap),
+  miterLimit(4.0), tolerance(0.25)
+{
+}
+
+/**
+ * The outline of a stroke along the path.
+ *
+ * \param path     the centre of the stroke
+ * \param out      the outline
+ * \param pressure optional, one for each point of the path, which scales
+ *                 the width
+ */
+void
+TPathOffset::outline(const TVectorPath &path, TVectorPath *out, const vector<TCoord> *pressure) const
+{
+  out->clear();
+  vector<TSubpath> subpath;
+  subpaths(path, pressure, width * 0.5, &subpath);
+  for(auto &&s: subpath)
+    ::outline(*this, s, out);
+}
+
+/**
+ * Move the path by 'distance' across its direction.
+ *
+ * Closed subpaths grow for positive and shrink for negative distances,
+ * open ones move to the left of their direction, which is (-dy, dx).
+ * The offsets of segments meeting at an inner corner overlap and are
+ * joined by a line, which leaves a small loop.
+ */
+void
+TPathOffset::offset(const TVectorPath &path, TCoord distance, TVectorPath *out) const
+{
+  out->clear();
+  vector<TSubpath> subpath;
+  subpaths(path, nullptr, distance, &subpath);
+  for(auto &&s: subpath) {
+    if (s.segments.empty())
+      continue;
+    // the inside of a counterclockwise subpath is to its left
+    TCoord sign = s.closed && ::area(s) > 0.0 ? -1.0 : 1.0;
+    moveToSide(s.segments.front(), sign, out);
+    side(*this, s.segments, s.closed, sign, false, out);
+    if (s.closed)
+      out->close();
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * TOAD -- A Simple and Powerful C++ GUI Toolkit for X-Windows
+ * Copyright (C) 2015 by Mark-André Hopf <mhopf@mark13.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef _TOAD_OFFSET_HH
+#define _TOAD_OFFSET_HH 1
+
+#include <toad/types.hh>
+#include <toad/vector.hh>
+#include <vector>
+
+namespace toad {
+
+/**
+ * Offset curves and outlines of a TVectorPath.
+ *
+ * Curves are offset after Tiller and Hanson: the legs of the control
+ * polygon are moved along their normals and intersected. Where this is
+ * farther than 'tolerance' from the exact offset, the curve is divided and
+ * each half is offset on its own.
+ *
+ * The width may vary along the path by a pressure for each point of the
+ * path, which is interpolated linearly between the ends of each line and
+ * curve. The pressure of a curve's control points is ignored.
+ *
+ * The outline overlaps itself at inner joins and where a curve bends
+ * tighter than the width. All of it has the same orientation and is meant
+ * to be filled with the non-zero winding rule, like TStrokeOutline's
+ * preview(). The area of tablet samples without overlaps is given by
+ * TStrokeOutline::outline().
+ */
+class TPathOffset
+{
+  public:
+    enum EJoin { ROUND_JOIN, MITER_JOIN, BEVEL_JOIN };
+    enum ECap { BUTT_CAP, ROUND_CAP, SQUARE_CAP };
+
+    TPathOffset(TCoord width=1.0, EJoin join=ROUND_JOIN, ECap cap=ROUND_CAP);
+
+    //! width of the outline at pressure 1.0
+    TCoord width;
+    EJoin join;
+    ECap cap;
+    //! MITER_JOIN bevels where the miter is longer than miterLimit * width
+    TCoord miterLimit;
+    //! the largest distance from the exact offset
+    TCoord tolerance;
+
+    void outline(const TVectorPath &path, TVectorPath *out, const std::vector<TCoord> *pressure=nullptr) const;
+    void offset(const TVectorPath &path, TCoord distance, TVectorPath *out) const;
+};
+
+} // namespace toad
+
+#endif
@@ -20,6 +20,7 @@
 
 #include <cstdarg>
 #include <toad/penbase.hh>
+#include <toad/geometry.hh>
 
 using namespace toad;
 
@@ -329,95 +330,24 @@ TPenBase::textRatio(TCoord x,TCoord y,const string &str, unsigned width, TFont *
   return y+font->getHeight();
 }
 
-static void curve(TPolygon&,TCoord,TCoord,TCoord,TCoord,TCoord,TCoord,TCoord,TCoord);
+// a quarter of a pixel at 100%
+#define POLY2BEZIER_TOLERANCE 0.25
 
+/**
+ * Flatten the poly bézier 'src' of n = 3m+1 points into the polygon 'dst'.
+ *
+ * See flattenCurves() for a variant with a tolerance of your own.
+ */
 void 
 TPenBase::poly2Bezier(const TPoint* src, size_t n, TPolygon &dst)
 {
-  dst.erase(dst.begin(), dst.end());
-  dst.push_back(TPoint(src[0].x, src[0].y));
-  n-=3;
-  size_t i=0;
-  while(i<=n) {
-    ::curve(dst,
-          src[i].x,   src[i].y,
-          src[i+1].x, src[i+1].y,
-          src[i+2].x, src[i+2].y,
-          src[i+3].x, src[i+3].y);
-    i+=3;
-  }
+  flattenCurves(src, n, POLY2BEZIER_TOLERANCE, &dst);
 }
 
 void 
 TPenBase::poly2Bezier(const TPolygon &src, TPolygon &dst)
 {
-  dst.erase(dst.begin(), dst.end());
-  dst.addPoint(src[0]);
-  size_t n = src.size();
-  n-=3;
-  size_t i=0;
-  while(i<=n) {
-    ::curve(dst,
-          src[i].x,   src[i].y,
-          src[i+1].x, src[i+1].y,
-          src[i+2].x, src[i+2].y,
-          src[i+3].x, src[i+3].y);
-    i+=3;
-  }
-}
-
-static inline TCoord
-mid(TCoord a, TCoord b)
-{
-  return (a + b) / 2.0;
-}
-
-#define WEIGHT 4.0
-
-static void curve(
-  TPolygon &poly,
-  TCoord x0, TCoord y0, 
-  TCoord x1, TCoord y1,
-  TCoord x2, TCoord y2,
-  TCoord x3, TCoord y3)
-{
-  TCoord vx0 = x1-x0;
-  TCoord vx1 = x2-x1;
-  TCoord vx2 = x3-x2;
-  TCoord vy0 = y1-y0;
-  TCoord vy1 = y2-y1;
-  TCoord vy2 = y3-y2;
-  TCoord vx3 = x2-x0;
-  TCoord vx4 = x3-x0;
-  TCoord vy3 = y2-y0;
-  TCoord vy4 = y3-y0;
-
-  TCoord w0 = vx0 * vy1 - vy0 * vx1;
-  TCoord w1 = vx1 * vy2 - vy1 * vx2;
-  TCoord w2 = vx3 * vy4 - vy3 * vx4;
-  TCoord w3 = vx0 * vy4 - vy0 * vx4;
-
-  if (fabs(w0)+fabs(w1)+fabs(w2)+fabs(w3)<WEIGHT) {
-    poly.push_back(TPoint(x0, y0));
-    poly.push_back(TPoint(x1, y1));
-    poly.push_back(TPoint(x2, y2));
-    poly.push_back(TPoint(x3, y3));
-  } else {
-    TCoord xx  = mid(x1, x2);
-    TCoord yy  = mid(y1, y2);
-    TCoord x11 = mid(x0, x1);
-    TCoord y11 = mid(y0, y1);
-    TCoord x22 = mid(x2, x3);
-    TCoord y22 = mid(y2, y3);
-    TCoord x12 = mid(x11, xx);
-    TCoord y12 = mid(y11, yy);
-    TCoord x21 = mid(xx, x22);
-    TCoord y21 = mid(yy, y22);
-    TCoord cx  = mid(x12, x21);
-    TCoord cy  = mid(y12, y21);
-    curve(poly, x0, y0, x11, y11, x12, y12, cx, cy);
-    curve(poly, cx, cy, x21, y21, x22, y22, x3, y3);
-  }
+  flattenCurves(src.data(), src.size(), POLY2BEZIER_TOLERANCE, &dst);
 }
 
 /**
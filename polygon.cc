@@ -37,12 +37,11 @@ TPolygon::TPolygon(const TRectangle &r)
 void
 TPolygon::transform(const TMatrix2D &matrix)
 {
-  for(auto &&point: *this)
-    matrix.map(point, &point);
+  matrix.map(data(), data(), size());
 }
 
 TCoord
-TPolygon::distance(const TPoint &point) {
+TPolygon::distance(const TPoint &point) const {
   TPoint p1, p2;
   TCoord x1,y1,x2,y2;
   TCoord min = numeric_limits<TCoord>::infinity();
@@ -108,31 +107,12 @@ TPolygon::isInside(TCoord x, TCoord y) const
 bool
 TPolygon::getShape(TRectangle *r) const
 {
-  TPoint p1, p2;
-
-  const_iterator p(begin()), e(end());
-  
-  if (p==e) {
+  if (empty()) {
     r->set(0,0,0,0);
     return false;
   }
-
-  p1.x = p2.x = p->x;
-  p1.y = p2.y = p->y;
-
-  ++p;
-  while(p!=e) {
-    if (p->x < p1.x)
-      p1.x = p->x;
-    if (p->x > p2.x)
-      p2.x = p->x;
-    if (p->y < p1.y)
-      p1.y = p->y;
-    if (p->y > p2.y)
-      p2.y = p->y;
-    ++p;
-  }
-
-  r->set(p1,p2);
+  TBoundary b;
+  b.expand(data(), size());
+  r->set(b.p0, b.p1);
   return true;
 }
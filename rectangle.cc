@@ -20,6 +20,15 @@
 
 #include <toad/types.hh>
 
+// TCoord is a CGFloat, which is a double on 64bit platforms
+#if defined(__LP64__) && defined(__SSE2__)
+#include <immintrin.h>
+#define TOAD_BOUNDARY_SSE2 1
+#elif defined(__LP64__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TOAD_BOUNDARY_NEON 1
+#endif
+
 using namespace toad;
 
 void
@@ -111,6 +120,53 @@ TRectangle::intersects(const TRectangle &r) const
   return (f0 & f1)==0;
 }
 
+/**
+ * Expand the boundary by 'n' points.
+ *
+ * Each point is a (x, y) pair, so the minimum and maximum of both are
+ * collected with a single SIMD instruction where available.
+ */
+void
+TBoundary::expand(const TPoint *p, size_t n)
+{
+  if (n==0)
+    return;
+  if (empty) {
+    p0 = p1 = *p;
+    empty = false;
+  }
+#if defined(TOAD_BOUNDARY_SSE2)
+  __m128d lo = _mm_loadu_pd(&p0.x), hi = _mm_loadu_pd(&p1.x);
+  for(size_t i=0; i<n; ++i) {
+    __m128d q = _mm_loadu_pd(&p[i].x);
+    lo = _mm_min_pd(lo, q);
+    hi = _mm_max_pd(hi, q);
+  }
+  _mm_storeu_pd(&p0.x, lo);
+  _mm_storeu_pd(&p1.x, hi);
+#elif defined(TOAD_BOUNDARY_NEON)
+  float64x2_t lo = vld1q_f64(&p0.x), hi = vld1q_f64(&p1.x);
+  for(size_t i=0; i<n; ++i) {
+    float64x2_t q = vld1q_f64(&p[i].x);
+    lo = vminq_f64(lo, q);
+    hi = vmaxq_f64(hi, q);
+  }
+  vst1q_f64(&p0.x, lo);
+  vst1q_f64(&p1.x, hi);
+#else
+  for(size_t i=0; i<n; ++i) {
+    if (p[i].x<p0.x)
+      p0.x=p[i].x;
+    if (p[i].x>p1.x)
+      p1.x=p[i].x;
+    if (p[i].y<p0.y)
+      p0.y=p[i].y;
+    if (p[i].y>p1.y)
+      p1.y=p[i].y;
+  }
+#endif
+}
+
 // based on Dan Cohen and Ivan Sutherlands clipping algorithm
 bool
 TBoundary::intersects(const TBoundary &r) const
@@ -0,0 +1,435 @@
+/*
+ * TOAD -- A Simple and Powerful C++ GUI Toolkit for X-Windows
+ * Copyright (C) 2015 by Mark-André Hopf <mhopf@mark13.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <toad/stroke.hh>
+#include <toad/geometry.hh>
+#include <algorithm>
+
+using namespace toad;
+
+namespace {
+
+// index of the corner of 'nib' which is the farthest in direction 'n'
+size_t
+support(const vector<TPoint> &nib, const TPoint &n)
+{
+  size_t best = 0;
+  TCoord max = nib[0].x*n.x + nib[0].y*n.y;
+  for(size_t i=1; i<nib.size(); ++i) {
+    TCoord d = nib[i].x*n.x + nib[i].y*n.y;
+    if (d>max) {
+      max = d;
+      best = i;
+    }
+  }
+  return best;
+}
+
+// call f(i) for each corner of a nib between 'from' and 'to', going the
+// way which passes the corner 'via' or the shorter one when 'via' is one
+// of the ends
+template <class F>
+void
+walk(size_t size, size_t from, size_t to, size_t via, F f)
+{
+  if (from==to)
+    return;
+  size_t forward = (to + size - from) % size;
+  bool isForward = (via==from || via==to) ? forward <= size/2
+                                          : (via + size - from) % size < forward;
+  size_t steps = isForward ? forward : size - forward;
+  for(size_t i=1; i<steps; ++i)
+    f(isForward ? (from + i) % size : (from + size - i) % size);
+}
+
+/**
+ * Convex hull of the nibs 'a' and 'b' (Andrew's monotone chain).
+ *
+ * Unlike convexHull() in geometry.cc this returns indices, where the
+ * corners of 'b' follow those of 'a', so that the caller can tell which
+ * nib a corner belongs to. The hull has the same orientation as the nibs.
+ */
+void
+hull(const vector<TPoint> &a, const vector<TPoint> &b, vector<size_t> *out)
+{
+  size_t n = a.size() + b.size();
+  auto at = [&](size_t i) -> const TPoint& {
+    return i<a.size() ? a[i] : b[i-a.size()];
+  };
+  vector<size_t> sorted(n);
+  for(size_t i=0; i<n; ++i)
+    sorted[i] = i;
+  sort(sorted.begin(), sorted.end(), [&](size_t i, size_t j) {
+    const TPoint &p = at(i), &q = at(j);
+    return p.x<q.x || (p.x==q.x && (p.y<q.y || (p.y==q.y && i<j)));
+  });
+  auto turnsLeft = [&](size_t o, size_t i, size_t j) {
+    const TPoint &p = at(o), &q = at(i), &r = at(j);
+    return (q.x-p.x)*(r.y-p.y) - (q.y-p.y)*(r.x-p.x) > 0.0;
+  };
+
+  vector<size_t> &h = *out;
+  h.resize(2*n);
+  size_t k = 0;
+  for(size_t i=0; i<n; ++i) {
+    while(k>=2 && !turnsLeft(h[k-2], h[k-1], sorted[i]))
+      --k;
+    h[k++] = sorted[i];
+  }
+  for(size_t i=n-1, t=k+1; i>0; --i) {
+    while(k>=t && !turnsLeft(h[k-2], h[k-1], sorted[i-1]))
+      --k;
+    h[k++] = sorted[i-1];
+  }
+  h.resize(k-1);
+  // the chain runs counterclockwise, the nibs clockwise
+  reverse(h.begin(), h.end());
+}
+
+// twice the signed area of the polygon
+TCoord
+area(const TPoint *p, size_t n)
+{
+  TCoord a = 0.0;
+  for(size_t i=0; i<n; ++i)
+    a += cross(p[i], p[(i+1)%n]);
+  return a;
+}
+
+// even-odd rule
+bool
+contains(const TPoint *p, size_t n, const TPoint &q)
+{
+  bool inside = false;
+  for(size_t i=0, j=n-1; i<n; j=i++) {
+    if ((p[i].y>q.y) != (p[j].y>q.y) &&
+        q.x < p[j].x + (p[i].x-p[j].x) * (q.y-p[j].y) / (p[i].y-p[j].y))
+      inside = !inside;
+  }
+  return inside;
+}
+
+/**
+ * boolean() doesn't care about the orientation of its result. Turn the
+ * polygons of 'path', which don't overlap, so that those which aren't
+ * holes have the nibs' orientation and the holes the other one. Then the
+ * non-zero and the even-odd winding rule fill the same area.
+ */
+void
+orient(TVectorPath *path)
+{
+  vector<size_t> begin;
+  size_t end = 0;
+  for(auto t: path->type) {
+    if (t==TVectorPath::MOVE)
+      begin.push_back(end);
+    if (t!=TVectorPath::CLOSE)
+      ++end;
+  }
+  begin.push_back(end);
+
+  TPoint *p = path->points.data();
+  for(size_t i=0; i+1<begin.size(); ++i) {
+    size_t n = begin[i+1] - begin[i];
+    // a polygon is inside another one when its leftmost corner is
+    const TPoint *q = min_element(p+begin[i], p+begin[i+1], [](const TPoint &a, const TPoint &b) {
+      return a.x<b.x || (a.x==b.x && a.y<b.y);
+    });
+    bool hole = false;
+    for(size_t j=0; j+1<begin.size(); ++j) {
+      if (j!=i && contains(p+begin[j], begin[j+1]-begin[j], *q))
+        hole = !hole;
+    }
+    if ((area(p+begin[i], n) < 0.0) != hole)
+      reverse(p+begin[i], p+begin[i+1]);
+  }
+}
+
+} // unnamed namespace
+
+/**
+ * \param width  width of the nib at pressure 1.0
+ * \param height height of the nib at pressure 1.0
+ * \param corners number of corners of the polygon approximating the nib
+ */
+TStrokeOutline::TStrokeOutline(TCoord width, TCoord height, unsigned corners):
+  width(width), height(height), corners(corners)
+{
+  clear();
+}
+
+void
+TStrokeOutline::clear()
+{
+  samples = 0;
+  finished.clear();
+  nibs.clear();
+  first.clear();
+  envelope[0].clear();
+  envelope[1].clear();
+  last[0] = last[1] = 0;
+  start[0] = start[1] = 0;
+  direction = TPoint(0, 0);
+  merged.clear();
+  level.clear();
+}
+
+void
+TStrokeOutline::nib(const TFreehandPoint &sample, vector<TPoint> *out) const
+{
+  out->clear();
+  TCoord c = cos(sample.rotation), s = sin(sample.rotation);
+  for(unsigned i=0; i<corners; ++i) {
+    TCoord d = 2.0 * M_PI * i / corners;
+    TCoord x = sin(d) * width * sample.pressure;
+    TCoord y = cos(d) * height * sample.pressure;
+    out->push_back(TPoint(sample.x + c*x - s*y, sample.y + s*x + c*y));
+  }
+}
+
+/**
+ * Append a sample to the stroke.
+ *
+ * The envelopes grow by the bridges of the convex hull of the previous and
+ * this sample's nib, joined by the corners of the previous nib.
+ *
+ * When one nib contains the other, there is no bridge between them. The
+ * outline drawn so far is finished as a closed piece of its own and a new
+ * one is started with the larger nib.
+ *
+ * When the pen turns more than it moves, the hull may have more than two
+ * bridges. The hull is then added as a closed piece of its own and a new
+ * piece is started with this sample's nib.
+ */
+void
+TStrokeOutline::add(const TFreehandPoint &sample)
+{
+  ++samples;
+  vector<TPoint> next;
+  nib(sample, &next);
+
+  if (nibs==next)
+    return;
+
+  vector<size_t> onHull;
+  size_t bridges = 0, size = nibs.size();
+  if (nibs.empty()) {
+    cover(next);
+  } else {
+    hull(nibs, next, &onHull);
+    for(size_t i=0; i<onHull.size(); ++i) {
+      if ((onHull[i]<size) != (onHull[(i+1)%onHull.size()]<size))
+        ++bridges;
+    }
+    if (bridges==0) {
+      bool grows = onHull[0]>=size;
+      // a piece which is only the last nib is covered by the larger one
+      if (!envelope[0].empty())
+        piece(&finished);
+      if (grows) {
+        cover(next);
+      } else {
+        // continue with the larger nib, which is already covered
+        if (envelope[0].empty())
+          return;
+        next = nibs;
+      }
+      nibs.clear();
+    } else {
+      vector<TPoint> polygon;
+      for(auto &&c: onHull)
+        polygon.push_back(c<size ? nibs[c] : next[c-size]);
+      cover(polygon);
+      if (bridges>2) {
+        if (!envelope[0].empty())
+          piece(&finished);
+        finished.move(polygon[0]);
+        for(size_t i=1; i<polygon.size(); ++i)
+          finished.line(polygon[i]);
+        finished.close();
+        nibs.clear();
+      }
+    }
+  }
+
+  if (nibs.empty()) {
+    nibs.swap(next);
+    first = nibs;
+    envelope[0].clear();
+    envelope[1].clear();
+    center = sample;
+    return;
+  }
+
+  TPoint d = sample - center;
+  if (d.x==0.0 && d.y==0.0) {
+    // the pen was only rotated, keep on going into the last direction
+    d = direction;
+  }
+  // the angle by which the direction turns, decides on which way the
+  // envelopes go around the nib in a sharp turn
+  TCoord turn = atan2(direction.x*d.y - direction.y*d.x,
+                      direction.x*d.x + direction.y*d.y);
+  center = sample;
+
+  // the bridge from the last to the next nib is on the left side, the one
+  // back on the right side
+  size_t a[2], b[2];
+  TPoint n[2];
+  for(size_t i=0; i<onHull.size(); ++i) {
+    size_t c0 = onHull[i], c1 = onHull[(i+1)%onHull.size()];
+    if (c0<size && c1>=size) {
+      a[0] = c0;
+      b[0] = c1 - size;
+      TPoint e = next[b[0]] - nibs[a[0]];
+      n[0] = TPoint(-e.y, e.x);
+    } else
+    if (c0>=size && c1<size) {
+      a[1] = c1;
+      b[1] = c0 - size;
+      TPoint e = next[b[1]] - nibs[a[1]];
+      n[1] = TPoint(e.y, -e.x);
+    }
+  }
+
+  for(unsigned side=0; side<2; ++side) {
+    if (envelope[side].empty()) {
+      start[side] = a[side];
+      envelope[side].push_back(nibs[a[side]]);
+    } else {
+      // join the last bridge with the nib's onHull between them, going
+      // the way the bridge's normal turns
+      size_t from = last[side];
+      const TPoint &m = normal[side];
+      TCoord angle = atan2(m.x*n[side].y - m.y*n[side].x, m.x*n[side].x + m.y*n[side].y);
+      if (fabs(turn) > M_PI/2 && angle*turn < 0.0)
+        angle += angle < 0.0 ? 2.0*M_PI : -2.0*M_PI;
+      TCoord c = cos(angle/2), s = sin(angle/2);
+      size_t via = support(nibs, TPoint(c*m.x - s*m.y, s*m.x + c*m.y));
+      walk(size, from, a[side], via, [&](size_t i) {
+        append(side, nibs[i]);
+      });
+      append(side, nibs[a[side]]);
+    }
+    append(side, next[b[side]]);
+    last[side] = b[side];
+    normal[side] = n[side];
+  }
+  direction = d;
+  nibs.swap(next);
+}
+
+void
+TStrokeOutline::append(unsigned side, const TPoint &p)
+{
+  vector<TPoint> &e = envelope[side];
+  if (e.empty() || e.back()!=p)
+    e.push_back(p);
+}
+
+/**
+ * The area of the stroke as closed polygons, which don't overlap each other
+ * or themselves. Holes run the other way round than the rest, so that it
+ * can be filled with the even-odd as well as the non-zero winding rule.
+ *
+ * Unlike the outline, this doesn't follow the nib's corners exactly: where
+ * boolean() intersects edges, the points are rounded.
+ */
+void
+TStrokeOutline::outline(TVectorPath *path) const
+{
+  path->clear();
+  if (merged.empty())
+    return;
+  // unite the smaller areas first
+  *path = merged.back();
+  for(size_t i=merged.size()-1; i>0; --i) {
+    TVectorPath area;
+    boolean(merged[i-1], *path, &area, UNION);
+    *path = area;
+  }
+  orient(path);
+}
+
+/**
+ * The closed pieces of the envelopes, which may overlap each other and
+ * themselves where the stroke crosses itself or makes a sharp turn. They
+ * all have the same orientation and are meant to be filled with the
+ * non-zero winding rule.
+ */
+void
+TStrokeOutline::preview(TVectorPath *path) const
+{
+  *path = finished;
+  piece(path);
+}
+
+// add the convex 'hull' to the area covered by the stroke
+void
+TStrokeOutline::cover(const vector<TPoint> &hull)
+{
+  merged.push_back(TVectorPath());
+  level.push_back(0);
+  TVectorPath &area = merged.back();
+  area.move(hull[0]);
+  for(size_t i=1; i<hull.size(); ++i)
+    area.line(hull[i]);
+  area.close();
+
+  // like a binary counter, two areas of the same size carry over into one
+  // of the next size
+  while(level.size()>1 && level[level.size()-2]==level.back()) {
+    TVectorPath both;
+    boolean(merged[merged.size()-2], merged.back(), &both, UNION);
+    merged.pop_back();
+    level.pop_back();
+    merged.back() = both;
+    ++level.back();
+  }
+}
+
+// add the outline since the last finished piece to 'path'
+void
+TStrokeOutline::piece(TVectorPath *path) const
+{
+  if (nibs.empty())
+    return;
+
+  if (envelope[0].empty()) {
+    path->move(nibs[0]);
+    for(size_t i=1; i<nibs.size(); ++i)
+      path->line(nibs[i]);
+    path->close();
+    return;
+  }
+
+  // the caps are the corners of the first and the last nib on the hull,
+  // which follow the nib's orientation
+  const vector<TPoint> &l = envelope[0], &r = envelope[1];
+  path->move(l[0]);
+  for(size_t i=1; i<l.size(); ++i)
+    path->line(l[i]);
+  for(size_t i=(last[0]+1)%nibs.size(); i!=last[1]; i=(i+1)%nibs.size())
+    path->line(nibs[i]);
+  for(size_t i=r.size(); i>0; --i)
+    path->line(r[i-1]);
+  for(size_t i=(start[1]+1)%first.size(); i!=start[0]; i=(i+1)%first.size())
+    path->line(first[i]);
+  path->close();
+}
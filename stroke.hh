@@ -0,0 +1,111 @@
+/*
+ * TOAD -- A Simple and Powerful C++ GUI Toolkit for X-Windows
+ * Copyright (C) 2015 by Mark-André Hopf <mhopf@mark13.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef _TOAD_STROKE_HH
+#define _TOAD_STROKE_HH 1
+
+#include <toad/types.hh>
+#include <toad/vector.hh>
+#include <vector>
+
+namespace toad {
+
+/**
+ * A sample from a tablet: position, rotation in radians and pressure in
+ * the range [0, 1].
+ */
+struct TFreehandPoint:
+  public TPoint
+{
+  TFreehandPoint(TCoord x, TCoord y, TCoord r, TCoord p):TPoint(x,y), rotation(r), pressure(p){}
+  TCoord rotation, pressure;
+};
+
+/**
+ * Outline of a stroke drawn with an elliptic nib, which is rotated and
+ * scaled by the samples' rotation and pressure.
+ *
+ * The outline is build incrementally while the samples arrive: each
+ * sample appends the bridges of the convex hull of the previous and the
+ * new nib and the previous nib's corners between the last and the new
+ * bridges to the left and right envelope. Adding a sample doesn't depend on
+ * the length of the stroke.
+ *
+ * The envelopes keep the loops on the inner side of a turn and the places
+ * where the stroke crosses itself. preview() returns them as quickly as
+ * they're built, all with the same orientation, to be filled with the
+ * non-zero winding rule. Where the hull of two nibs doesn't have exactly
+ * two bridges, they're split into separate closed pieces.
+ *
+ * outline() returns the area of the stroke without overlaps instead. For
+ * this the convex hulls of every two successive nibs are united with
+ * boolean() while the samples arrive, always two areas made of the same
+ * number of hulls, so that adding a sample takes amortized logarithmic
+ * time.
+ */
+class TStrokeOutline
+{
+  public:
+    TStrokeOutline(TCoord width=2.0, TCoord height=10.0, unsigned corners=40);
+
+    void clear();
+    void add(const TFreehandPoint &sample);
+    bool empty() const { return nibs.empty(); }
+    //! number of samples added since the last clear()
+    size_t size() const { return samples; }
+
+    const std::vector<TPoint>& left() const { return envelope[0]; }
+    const std::vector<TPoint>& right() const { return envelope[1]; }
+
+    void outline(TVectorPath *path) const;
+    //! the closed pieces: left envelope, end cap, right envelope and start cap
+    void preview(TVectorPath *path) const;
+
+  protected:
+    TCoord width, height;
+    unsigned corners;
+
+    size_t samples;
+    // pieces of the outline which are done
+    TVectorPath finished;
+    // position of the last sample
+    TPoint center;
+    // direction of the last movement
+    TPoint direction;
+    // the nibs of the first and the last sample
+    std::vector<TPoint> nibs, first;
+    // corners of the first and the last nib where each envelope begins and
+    // currently ends and the normal of each envelope's last bridge
+    size_t start[2], last[2];
+    TPoint normal[2];
+    std::vector<TPoint> envelope[2];
+    // the area covered so far, where merged[i] is the union of 2^level[i]
+    // hulls and level decreases along the vector
+    std::vector<TVectorPath> merged;
+    std::vector<unsigned> level;
+
+    void nib(const TFreehandPoint &sample, std::vector<TPoint> *out) const;
+    void append(unsigned side, const TPoint &p);
+    void piece(TVectorPath *path) const;
+    void cover(const std::vector<TPoint> &hull);
+};
+
+} // namespace toad
+
+#endif
@@ -0,0 +1,922 @@
+/*
+ * Benchmarks
+ *
+ * These are disabled by default, run them with 'make bench'.
+ */
+
+#include "util.hh"
+#include "handpath.hh"
+#include "gtest.h"
+
+#include <toad/figuremodel.hh>
+#include <toad/figure.hh>
+#include <toad/stroke.hh>
+#include <toad/offset.hh>
+#include <toad/geometry.hh>
+#include <toad/matrix2d.hh>
+#include <toad/booleanop.hh>
+#include <toad/fischland/fitcurve.hh>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <clocale>
+#include <thread>
+
+using namespace toad;
+using namespace std;
+
+namespace {
+
+class Benchmark:
+  public ::testing::Test
+{
+  protected:
+    static void SetUpTestCase() {
+      toad::initialize(0, NULL);
+    }
+
+    static void TearDownTestCase() {
+      toad::terminate();
+    }
+};
+
+class TStopWatch
+{
+    chrono::steady_clock::time_point start;
+  public:
+    TStopWatch() { start = chrono::steady_clock::now(); }
+    double ms() const {
+      return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+TEST_F(Benchmark, DISABLED_FigureModelErase)
+{
+  const unsigned n = 100000;
+
+  for(unsigned step: {1000u, 10u, 2u}) {
+    TFigureModel model;
+    TFigureVector figures;
+    TFigureSet set;
+    for(unsigned i=0; i<n; ++i) {
+      TFigure *figure = new TFRectangle(i, 0, 1, 1);
+      figures.push_back(figure);
+      if (i % step == 0)
+        set.insert(figure);
+    }
+    model.add(figures);
+    vector<TFigure*> old(model.begin(), model.end());
+
+    // previous implementation: one vector erase per figure
+    TStopWatch oldErase;
+    TFigureAtDepthList oldPlacement;
+    unsigned depth = 0;
+    for(auto p=old.begin(); p!=old.end(); ++depth) {
+      if (set.find(*p)!=set.end()) {
+        oldPlacement.push_back(*p, depth);
+        p = old.erase(p);
+      } else {
+        ++p;
+      }
+    }
+    double tOldErase = oldErase.ms();
+
+    TStopWatch oldInsert;
+    for(auto &&p: oldPlacement)
+      old.insert(old.begin() + p.depth, p.figure);
+    double tOldInsert = oldInsert.ms();
+    oldPlacement.drop();
+
+    TStopWatch erase;
+    TFigureAtDepthList placement;
+    model.pureErase(set, &placement);
+    double tErase = erase.ms();
+
+    TStopWatch insert;
+    model.pureInsert(placement);
+    double tInsert = insert.ms();
+    placement.drop();
+
+    ASSERT_EQ(old.size(), model.size());
+    for(unsigned i=0; i<n; ++i)
+      ASSERT_EQ(old[i], model[i]);
+
+    cout << "erase/insert " << set.size() << " of " << n << " figures: "
+         << "old " << tOldErase << "/" << tOldInsert << "ms, "
+         << "new " << tErase << "/" << tInsert << "ms" << endl;
+  }
+}
+
+TEST_F(Benchmark, DISABLED_FigureSet)
+{
+  const unsigned n = 100000;
+  TFigureVector figures;
+  for(unsigned i=0; i<n; ++i)
+    figures.push_back(new TFRectangle(i, 0, 1, 1));
+
+  // previous implementation
+  TStopWatch oldSelect;
+  set<TFigure*> oldSet(figures.begin(), figures.end());
+  double tOldSelect = oldSelect.ms();
+  TStopWatch oldInvert;
+  set<TFigure*> oldInverted;
+  for(auto &&f: figures) {
+    if (oldSet.find(f)==oldSet.end())
+      oldInverted.insert(f);
+  }
+  double tOldInvert = oldInvert.ms();
+  TStopWatch oldIterate;
+  size_t oldSum = 0;
+  for(auto &&f: oldSet)
+    oldSum += f->getId();
+  double tOldIterate = oldIterate.ms();
+
+  TStopWatch select;
+  TFigureSet set(figures.begin(), figures.end());
+  double tSelect = select.ms();
+  TStopWatch invert;
+  TFigureSet inverted;
+  for(auto &&f: figures) {
+    if (!set.contains(f))
+      inverted.insert(f);
+  }
+  double tInvert = invert.ms();
+  TStopWatch iterate;
+  size_t sum = 0;
+  for(auto &&f: set)
+    sum += f->getId();
+  double tIterate = iterate.ms();
+
+  ASSERT_EQ(oldSum, sum);
+  ASSERT_EQ(oldInverted.size(), inverted.size());
+
+  cout << "select all/invert/iterate " << n << " figures: "
+       << "old " << tOldSelect << "/" << tOldInvert << "/" << tOldIterate << "ms, "
+       << "new " << tSelect << "/" << tInvert << "/" << tIterate << "ms" << endl;
+
+  for(auto &&f: figures)
+    delete f;
+}
+
+// test_tablet.cc used to join the convex hulls of every two successive nibs
+// with boolean(), which gets slower the longer the stroke is
+TEST_F(Benchmark, DISABLED_StrokeOutline)
+{
+  vector<TFreehandPoint> handpath = loadHandpath("backup-glitch010.txt");
+  ASSERT_FALSE(handpath.empty());
+
+  // a stroke of a single sample is the sample's nib
+  auto addNib = [](vector<TPoint> *hull, const TFreehandPoint &p) {
+    TStrokeOutline nib;
+    nib.add(p);
+    TVectorPath path;
+    nib.outline(&path);
+    hull->insert(hull->end(), path.points.begin(), path.points.end());
+  };
+
+  TStopWatch oldUnion;
+  TVectorPath oldPath;
+  for(size_t i=0; i<handpath.size(); ++i) {
+    vector<TPoint> hull;
+    if (i>0)
+      addNib(&hull, handpath[i-1]);
+    addNib(&hull, handpath[i]);
+    convexHull(&hull);
+    TVectorPath np;
+    np.move(hull[0]);
+    for(size_t j=1; j<hull.size(); ++j)
+      np.line(hull[j]);
+    np.close();
+    boolean(oldPath, np, &oldPath, UNION);
+  }
+  double tOldUnion = oldUnion.ms();
+
+  TStopWatch outline;
+  TStrokeOutline stroke;
+  for(auto &&p: handpath)
+    stroke.add(p);
+  double tAdd = outline.ms();
+  TVectorPath path;
+  stroke.outline(&path);
+  double tOutline = outline.ms();
+
+  cout << "stroke outline of " << handpath.size() << " samples: "
+       << "old " << tOldUnion << "ms (" << oldPath.points.size() << " points), "
+       << "new " << tOutline << "ms (" << path.points.size() << " points, "
+       << tAdd << "ms in add())" << endl;
+}
+
+TEST_F(Benchmark, DISABLED_CurveFitter)
+{
+  for(auto filename: handpathFiles) {
+    TPolygon polygon = loadHandpathPolygon(filename);
+    ASSERT_FALSE(polygon.empty());
+
+    // previous implementation: fit all samples at mouse up
+    TStopWatch batch;
+    TPolygon oldCurve;
+    fitCurve(polygon, &oldCurve, 50);
+    double tBatch = batch.ms();
+
+    // fit while the samples arrive and update the preview with each sample
+    TCurveFitter fitter(50);
+    TPolygon curve;
+    double tMax = 0.0;
+    TStopWatch replay;
+    for(auto &&p: polygon) {
+      TStopWatch sample;
+      fitter.add(p);
+      fitter.curve(&curve);
+      tMax = max(tMax, sample.ms());
+    }
+    double tReplay = replay.ms();
+
+    TStopWatch up;
+    fitter.curve(&curve);
+    double tUp = up.ms();
+
+    cout << filename << ": " << polygon.size() << " samples, "
+         << "batch " << tBatch << "ms (" << oldCurve.size() << " points), "
+         << "incremental " << tReplay << "ms, max. " << tMax << "ms per sample, "
+         << tUp << "ms at mouse up (" << curve.size() << " points)" << endl;
+  }
+}
+
+// previous implementation from algorithms/ramerDouglasPeucker.cc
+double
+perpendicularDistance(const TPoint &pt, const TPoint &lineStart, const TPoint &lineEnd)
+{
+  double dx = lineEnd.x - lineStart.x;
+  double dy = lineEnd.y - lineStart.y;
+  double mag = pow(pow(dx,2.0)+pow(dy,2.0),0.5);
+  if(mag > 0.0)	{
+    dx /= mag; dy /= mag;
+  }
+  double pvx = pt.x - lineStart.x;
+  double pvy = pt.y - lineStart.y;
+  double pvdot = dx * pvx + dy * pvy;
+  double ax = pvx - pvdot * dx;
+  double ay = pvy - pvdot * dy;
+  return pow(pow(ax,2.0)+pow(ay,2.0),0.5);
+}
+
+void
+oldRamerDouglasPeucker(const vector<TPoint> &in, double epsilon, vector<TPoint> *out)
+{
+  double dmax = 0.0;
+  size_t index = 0;
+  size_t end = in.size()-1;
+  for(size_t i = 1; i < end; ++i) {
+    double d = perpendicularDistance(in[i], in[0], in[end]);
+    if (d > dmax) {
+      index = i;
+      dmax = d;
+    }
+  }
+  if(dmax > epsilon) {
+    vector<TPoint> recResults1;
+    vector<TPoint> recResults2;
+    vector<TPoint> firstLine(in.begin(), in.begin()+index+1);
+    vector<TPoint> lastLine(in.begin()+index, in.end());
+    oldRamerDouglasPeucker(firstLine, epsilon, &recResults1);
+    oldRamerDouglasPeucker(lastLine, epsilon, &recResults2);
+    out->assign(recResults1.begin(), recResults1.end()-1);
+    out->insert(out->end(), recResults2.begin(), recResults2.end());
+  } else {
+    out->clear();
+    out->push_back(in[0]);
+    out->push_back(in[end]);
+  }
+}
+
+TEST_F(Benchmark, DISABLED_RamerDouglasPeucker)
+{
+  // all recordings one after another until there are a million samples
+  vector<TPoint> polygon;
+  TPoint offset(0, 0);
+  while(polygon.size() < 1000000) {
+    for(auto filename: handpathFiles) {
+      for(auto &&p: loadHandpath(filename))
+        polygon.push_back(p + offset);
+      ASSERT_FALSE(polygon.empty());
+      offset = polygon.back();
+    }
+  }
+
+  for(TCoord epsilon: {0.5, 2.0}) {
+    TStopWatch oldRDP;
+    vector<TPoint> oldOut;
+    oldRamerDouglasPeucker(polygon, epsilon, &oldOut);
+    double tOld = oldRDP.ms();
+
+    TStopWatch newRDP;
+    vector<TPoint> out;
+    ramerDouglasPeucker(polygon, epsilon, &out);
+    double tNew = newRDP.ms();
+
+    ASSERT_EQ(oldOut, out);
+    cout << "Ramer-Douglas-Peucker of " << polygon.size() << " points with epsilon " << epsilon << ": "
+         << "old " << tOld << "ms, new " << tNew << "ms (" << out.size() << " points)" << endl;
+  }
+
+  TVectorPath path;
+  path.move(polygon[0]);
+  for(size_t i=1; i<polygon.size(); ++i)
+    path.line(polygon[i]);
+  TStopWatch simplify;
+  path.simplify(4.0, 2.0*M_PI/360.0*30.0);
+  cout << "TVectorPath::simplify of " << polygon.size() << " points: "
+       << simplify.ms() << "ms (" << path.points.size() << " points)" << endl;
+}
+
+TEST_F(Benchmark, DISABLED_Transform)
+{
+  vector<TPoint> polygon;
+  for(size_t i=0; i<1000000; ++i)
+    polygon.push_back(TPoint(i%1000, i/1000));
+
+  TMatrix2D m;
+  m.translate(100, 50);
+  m.rotate(M_PI/7);
+  m.scale(1.5, 0.75);
+
+  for(int round=0; round<2; ++round) {
+    vector<TPoint> old(polygon);
+    TStopWatch oldMap;
+    for(auto &&p: old)
+      m.map(p, &p);
+    double tOldMap = oldMap.ms();
+
+    vector<TPoint> batch(polygon);
+    TStopWatch newMap;
+    m.map(batch.data(), batch.data(), batch.size());
+    double tNewMap = newMap.ms();
+
+    for(size_t i=0; i<old.size(); ++i) {
+      ASSERT_NEAR(old[i].x, batch[i].x, 1e-9);
+      ASSERT_NEAR(old[i].y, batch[i].y, 1e-9);
+    }
+
+    TStopWatch oldBounds;
+    TBoundary b0;
+    for(auto &&p: batch)
+      b0.expand(p);
+    double tOldBounds = oldBounds.ms();
+
+    TStopWatch newBounds;
+    TBoundary b1;
+    b1.expand(batch.data(), batch.size());
+    double tNewBounds = newBounds.ms();
+
+    ASSERT_EQ(b0.p0, b1.p0);
+    ASSERT_EQ(b0.p1, b1.p1);
+    cout << "transform " << polygon.size() << " points: old " << tOldMap << "ms, new " << tNewMap << "ms" << endl
+         << "bounds of " << polygon.size() << " points: old " << tOldBounds << "ms, new " << tNewBounds << "ms" << endl;
+  }
+}
+
+// previous implementation from TPenBase::poly2Bezier
+void
+oldCurve(TPolygon &poly, const TPoint *p)
+{
+  TCoord w0 = (p[1].x-p[0].x) * (p[2].y-p[1].y) - (p[1].y-p[0].y) * (p[2].x-p[1].x);
+  TCoord w1 = (p[2].x-p[1].x) * (p[3].y-p[2].y) - (p[2].y-p[1].y) * (p[3].x-p[2].x);
+  TCoord w2 = (p[2].x-p[0].x) * (p[3].y-p[0].y) - (p[2].y-p[0].y) * (p[3].x-p[0].x);
+  TCoord w3 = (p[1].x-p[0].x) * (p[3].y-p[0].y) - (p[1].y-p[0].y) * (p[3].x-p[0].x);
+  if (fabs(w0)+fabs(w1)+fabs(w2)+fabs(w3)<4.0) {
+    poly.insert(poly.end(), p, p+4);
+  } else {
+    TPoint half[7];
+    divideBezier(p, half, 0.5);
+    oldCurve(poly, half);
+    oldCurve(poly, half+3);
+  }
+}
+
+// the largest distance between the curves in 'path' and the lines 'flatten'
+// approximates each of them with
+template <class F>
+TCoord
+deviation(const TPolygon &path, F flatten)
+{
+  TCoord max = 0.0;
+  TPolygon lines;
+  for(size_t i=0; i+3<path.size(); i+=3) {
+    lines.clear();
+    lines.push_back(path[i]);
+    flatten(&path[i], &lines);
+    for(int k=0; k<=100; ++k) {
+      TPoint p = bez2point(&path[i], k/100.0);
+      TCoord min = 1.0/0.0;
+      for(size_t l=0; l+1<lines.size(); ++l) {
+        TPoint ab = lines[l+1] - lines[l];
+        TCoord len = dot(ab, ab);
+        TCoord u = len>0.0 ? std::max(0.0, std::min(1.0, dot(p - lines[l], ab) / len)) : 0.0;
+        min = std::min(min, distance(p, lines[l] + ab * u));
+      }
+      max = std::max(max, min);
+    }
+  }
+  return max;
+}
+
+TEST_F(Benchmark, DISABLED_Flatten)
+{
+  vector<TPolygon> paths;
+  size_t n = 0;
+  for(auto filename: handpathFiles) {
+    TPolygon polygon = loadHandpathPolygon(filename), curve;
+    ASSERT_FALSE(polygon.empty());
+    fitCurve(polygon, &curve, 50);
+    paths.push_back(curve);
+    n += curve.size()/3;
+  }
+
+  const int rounds = 100;
+  vector<TPolygon> old(paths.size());
+  TStopWatch oldFlatten;
+  for(int i=0; i<rounds; ++i) {
+    for(size_t j=0; j<paths.size(); ++j) {
+      old[j].clear();
+      old[j].push_back(paths[j][0]);
+      for(size_t k=0; k+3<paths[j].size(); k+=3)
+        oldCurve(old[j], &paths[j][k]);
+    }
+  }
+  double tOld = oldFlatten.ms() / rounds;
+  size_t points = 0;
+  TCoord d = 0.0;
+  for(size_t j=0; j<paths.size(); ++j) {
+    points += old[j].size();
+    d = max(d, deviation(paths[j], [](const TPoint *curve, TPolygon *out) {
+      oldCurve(*out, curve);
+    }));
+  }
+  cout << n << " curves: old " << tOld << "ms, "
+       << points << " points, deviation " << d << endl;
+
+  for(TCoord scale: {0.25, 1.0, 4.0}) {
+    TCoord tolerance = 0.25 / scale;
+    vector<TPolygon> flat(paths.size());
+    TStopWatch newFlatten;
+    for(int i=0; i<rounds; ++i) {
+      for(size_t j=0; j<paths.size(); ++j)
+        flattenCurves(paths[j].data(), paths[j].size(), tolerance, &flat[j]);
+    }
+    double tNew = newFlatten.ms() / rounds;
+
+    vector<TFlatteningCache> cache(paths.size());
+    for(size_t j=0; j<paths.size(); ++j)
+      cache[j].flatten(paths[j], tolerance);
+    TStopWatch cached;
+    for(int i=0; i<rounds; ++i) {
+      for(size_t j=0; j<paths.size(); ++j)
+        cache[j].flatten(paths[j], tolerance);
+    }
+    double tCached = cached.ms() / rounds;
+
+    points = 0;
+    d = 0.0;
+    for(size_t j=0; j<paths.size(); ++j) {
+      points += flat[j].size();
+      d = max(d, deviation(paths[j], [=](const TPoint *curve, TPolygon *out) {
+        flattenCurve(curve, tolerance, out);
+      }));
+    }
+    ASSERT_LE(d, tolerance);
+    cout << "  at " << scale*100 << "%: new " << tNew << "ms, cached " << tCached << "ms, "
+         << points << " points, deviation " << d << " (tolerance " << tolerance << ")" << endl;
+  }
+}
+
+// intersect the curves fitted to the recordings with horizontal lines, one
+// solveCubic() per curve or with solveCubics()
+TEST_F(Benchmark, DISABLED_SolveCubics)
+{
+  vector<TPoint> curves;
+  TBoundary bounds;
+  for(auto filename: handpathFiles) {
+    TPolygon polygon = loadHandpathPolygon(filename), curve;
+    ASSERT_FALSE(polygon.empty());
+    fitCurve(polygon, &curve, 50);
+    for(size_t i=0; i+3<curve.size(); i+=3) {
+      curves.insert(curves.end(), curve.begin()+i, curve.begin()+i+4);
+      bounds.expand(curveBounds(&curve[i]));
+    }
+  }
+  size_t n = curves.size()/4;
+
+  // the polynomials of the y coordinates
+  vector<TCoord> a(n), b(n), c(n), d(n), y(n);
+  for(size_t i=0; i<n; ++i) {
+    const TPoint *p = &curves[i*4];
+    c[i] = 3.0 * (p[1].y - p[0].y);
+    b[i] = 3.0 * (p[2].y - p[1].y) - c[i];
+    a[i] = p[3].y - p[0].y - c[i] - b[i];
+    y[i] = p[0].y;
+  }
+
+  const int lines = 200;
+  size_t oldCount = 0;
+  TStopWatch oldSolve;
+  for(int l=0; l<lines; ++l) {
+    TCoord line = bounds.p0.y + bounds.height() * (l + 0.5) / lines;
+    for(size_t i=0; i<n; ++i) {
+      TCoord roots[3];
+      oldCount += solveCubic(a[i], b[i], c[i], y[i] - line, roots, 0.0, 1.0);
+    }
+  }
+  double tOld = oldSolve.ms();
+
+  size_t newCount = 0;
+  vector<TCoord> roots;
+  vector<size_t> first;
+  TStopWatch newSolve;
+  for(int l=0; l<lines; ++l) {
+    TCoord line = bounds.p0.y + bounds.height() * (l + 0.5) / lines;
+    for(size_t i=0; i<n; ++i)
+      d[i] = y[i] - line;
+    solveCubics(a.data(), b.data(), c.data(), d.data(), n, 0.0, 1.0, &roots, &first);
+    newCount += roots.size();
+  }
+  double tNew = newSolve.ms();
+
+  ASSERT_EQ(oldCount, newCount);
+  cout << lines << " lines with " << n << " curves, " << newCount << " roots: solveCubic "
+       << tOld << "ms, solveCubics " << tNew << "ms" << endl;
+}
+
+// the coordinates of a document, as a TSerializable
+struct TBenchmarkPoints:
+  public TSerializable
+{
+  typedef TSerializable super;
+  vector<TPoint> p;
+  SERIALIZABLE_INTERFACE(, TBenchmarkPoints);
+};
+
+void
+TBenchmarkPoints::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  ::store(out, "p", p);
+}
+
+bool
+TBenchmarkPoints::restore(TInObjectStream &in)
+{
+  if (
+    super::restore(in) ||
+    ::restore(in, "p", &p)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+// convert the numbers of the sample documents, with a fraction added to
+// each, like store and restore of double did before and do now, and save
+// and load them as coordinates
+TEST_F(Benchmark, DISABLED_Numbers)
+{
+  vector<double> values;
+  for(auto filename: {
+    "fischland/comic001.fish",
+    "fischland/comic002.fish",
+    "fischland/egypt.fish",
+    "fischland/egypt2.fish",
+    "fischland/netedit.fish",
+    "fischland/nightmare_on_behmstreet.fish" })
+  {
+    ifstream in(filename);
+    ASSERT_TRUE(in.good()) << filename;
+    string token;
+    double d;
+    while(in >> token) {
+      if (parseNumber(token, &d))
+        values.push_back(d + 1.0/3.0);
+    }
+  }
+  const int rounds = 20;
+  size_t n = values.size();
+
+  // previous implementation
+  TStopWatch oldStore;
+  string oldText;
+  for(int i=0; i<rounds; ++i) {
+    ostringstream out;
+    for(auto &&v: values)
+      out << ' ' << v;
+    oldText = out.str();
+  }
+  double tOldStore = oldStore.ms();
+  vector<double> oldValues;
+  TStopWatch oldRestore;
+  for(int i=0; i<rounds; ++i) {
+    oldValues.clear();
+    istringstream in(oldText);
+    string token;
+    while(in >> token) {
+      char *endptr;
+      setlocale(LC_NUMERIC, "C");
+      oldValues.push_back(strtod(token.c_str(), &endptr));
+      setlocale(LC_NUMERIC, "");
+    }
+  }
+  double tOldRestore = oldRestore.ms();
+  ASSERT_EQ(n, oldValues.size());
+  size_t oldLost = 0;
+  for(size_t j=0; j<n; ++j) {
+    if (oldValues[j] != values[j])
+      ++oldLost;
+  }
+
+  TStopWatch format;
+  string text;
+  for(int i=0; i<rounds; ++i) {
+    text.clear();
+    char buffer[32];
+    for(auto &&v: values) {
+      text += ' ';
+      text.append(buffer, formatNumber(buffer, buffer+sizeof(buffer), v));
+    }
+  }
+  double tFormat = format.ms();
+  vector<double> newValues;
+  TStopWatch parse;
+  for(int i=0; i<rounds; ++i) {
+    newValues.clear();
+    istringstream in(text);
+    string token;
+    double d;
+    while(in >> token) {
+      parseNumber(token, &d);
+      newValues.push_back(d);
+    }
+  }
+  double tParse = parse.ms();
+  ASSERT_EQ(values, newValues);
+
+  // the whole way through TOutObjectStream and TInObjectStream
+  TBenchmarkPoints points;
+  for(size_t j=0; j+1<n; j+=2)
+    points.p.push_back(TPoint(values[j], values[j+1]));
+  toad::getDefaultStore().registerObject(new TBenchmarkPoints());
+  TStopWatch save;
+  for(int i=0; i<rounds; ++i) {
+    ostringstream out;
+    TOutObjectStream os(&out);
+    os.store(&points);
+    os.close();
+    text = out.str();
+  }
+  double tSave = save.ms();
+  TSerializable *s = nullptr;
+  TStopWatch load;
+  for(int i=0; i<rounds; ++i) {
+    delete s;
+    istringstream in(text);
+    TInObjectStream is(&in);
+    s = is.restore();
+    is.close();
+  }
+  double tLoad = load.ms();
+  TBenchmarkPoints *loaded = dynamic_cast<TBenchmarkPoints*>(s);
+  ASSERT_NE(nullptr, loaded);
+  ASSERT_EQ(points.p, loaded->p);
+  delete s;
+
+  cout << rounds << " times " << n << " numbers: old store/restore "
+       << tOldStore << "/" << tOldRestore << "ms (" << oldLost << " not restored), "
+       << "new " << tFormat << "/" << tParse << "ms, "
+       << "save/load as coordinates " << tSave << "/" << tLoad << "ms" << endl;
+}
+
+// a document of several parts, which TLazyLoader::loadAll() can restore on
+// worker threads
+struct TBenchmarkDocument:
+  public TSerializable
+{
+  typedef TSerializable super;
+  vector<TSerializable*> parts;
+  ~TBenchmarkDocument() {
+    for(auto &&part: parts)
+      delete part;
+  }
+  SERIALIZABLE_INTERFACE(, TBenchmarkDocument);
+};
+
+void
+TBenchmarkDocument::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  for(auto &&part: parts)
+    out.store(part);
+}
+
+bool
+TBenchmarkDocument::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP) {
+    TSerializable *part = in.clone(in.type);
+    if (!part)
+      return false;
+    parts.push_back(part);
+    in.setInterpreter(part);
+    return true;
+  }
+  if (super::restore(in))
+    return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+TEST_F(Benchmark, DISABLED_LoadAll)
+{
+  toad::getDefaultStore().registerObject(new TBenchmarkPoints());
+  toad::getDefaultStore().registerObject(new TBenchmarkDocument());
+
+  TBenchmarkDocument document;
+  for(int i=0; i<32; ++i) {
+    TBenchmarkPoints *part = new TBenchmarkPoints();
+    for(int j=0; j<20000; ++j)
+      part->p.push_back(TPoint(i + j/3.0, j - i/7.0));
+    document.parts.push_back(part);
+  }
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&document);
+  os.close();
+  string text = out.str();
+
+  const int rounds = 5;
+  TStopWatch serial;
+  for(int i=0; i<rounds; ++i) {
+    istringstream in(text);
+    TInObjectStream is(&in);
+    delete is.restore();
+  }
+  double tSerial = serial.ms();
+
+  TStopWatch parallel;
+  for(int i=0; i<rounds; ++i) {
+    TLazyLoader loader;
+    TSerializable *s = loader.restore(text, "TBenchmarkPoints", [&](TSerializable *placeholder, TSerializable *part) {
+      auto &parts = static_cast<TBenchmarkDocument*>(loader.obj)->parts;
+      *find(parts.begin(), parts.end(), placeholder) = part;
+      delete placeholder;
+    });
+    ASSERT_NE(nullptr, s);
+    ASSERT_TRUE(loader.loadAll());
+    auto &parts = static_cast<TBenchmarkDocument*>(s)->parts;
+    ASSERT_EQ(document.parts.size(), parts.size());
+    ASSERT_EQ(static_cast<TBenchmarkPoints*>(document.parts[31])->p, static_cast<TBenchmarkPoints*>(parts[31])->p);
+    delete s;
+  }
+  double tParallel = parallel.ms();
+
+  cout << rounds << " times " << text.size()/1024 << "kB in 32 parts: restore "
+       << tSerial << "ms, TLazyLoader::loadAll " << tParallel << "ms with "
+       << thread::hardware_concurrency() << " cores" << endl;
+}
+
+// open a document of 32 parts and look at one of them, with restore() and
+// with TLazyLoader
+TEST_F(Benchmark, DISABLED_LazyLoader)
+{
+  toad::getDefaultStore().registerObject(new TBenchmarkPoints());
+  toad::getDefaultStore().registerObject(new TBenchmarkDocument());
+
+  TBenchmarkDocument document;
+  for(int i=0; i<32; ++i) {
+    TBenchmarkPoints *part = new TBenchmarkPoints();
+    for(int j=0; j<20000; ++j)
+      part->p.push_back(TPoint(i + j/3.0, j - i/7.0));
+    document.parts.push_back(part);
+  }
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&document);
+  os.close();
+  string text = out.str();
+
+  const int rounds = 5;
+  TStopWatch serial;
+  for(int i=0; i<rounds; ++i) {
+    istringstream in(text);
+    TInObjectStream is(&in);
+    delete is.restore();
+  }
+  double tSerial = serial.ms();
+
+  TStopWatch lazy;
+  for(int i=0; i<rounds; ++i) {
+    TLazyLoader loader;
+    TSerializable *s = loader.restore(text, "TBenchmarkPoints", [&](TSerializable *placeholder, TSerializable *part) {
+      auto &parts = static_cast<TBenchmarkDocument*>(loader.obj)->parts;
+      *find(parts.begin(), parts.end(), placeholder) = part;
+      delete placeholder;
+    });
+    ASSERT_NE(nullptr, s);
+    auto &parts = static_cast<TBenchmarkDocument*>(s)->parts;
+    ASSERT_EQ(32, loader.getPending());
+    ASSERT_TRUE(loader.load(parts[5]));
+    ASSERT_EQ(static_cast<TBenchmarkPoints*>(document.parts[5])->p, static_cast<TBenchmarkPoints*>(parts[5])->p);
+    ASSERT_EQ(0, static_cast<TBenchmarkPoints*>(parts[6])->p.size());
+    delete s;
+  }
+  double tLazy = lazy.ms();
+
+  cout << rounds << " times " << text.size()/1024 << "kB in 32 parts: restore "
+       << tSerial << "ms, TLazyLoader with one part " << tLazy << "ms" << endl;
+}
+
+// create the objects of a document by their type name, in runs of the same
+// type like the strokes on a layer, with the previous std::map and clone()
+// and with TObjectStore
+TEST_F(Benchmark, DISABLED_ObjectStore)
+{
+  const char *types[] = {
+    "toad::TFRectangle", "toad::TFCircle", "toad::TFText", "toad::TFGroup",
+    "toad::TFConnection", "toad::TSerializableRGB"
+  };
+  const size_t n = 300000, run = 50;
+  vector<string> names;
+  for(size_t i=0; i<n; ++i)
+    names.push_back(types[(i/run) % (sizeof(types)/sizeof(types[0]))]);
+
+  // previous implementation
+  struct TCompare {
+    bool operator()(const char *a, const char *b) const {
+      return strcmp(a, b)<0;
+    }
+  };
+  map<const char*, TSerializable*, TCompare> old;
+  for(auto type: types)
+    old[type] = getDefaultStore().clone(type);
+  vector<TSerializable*> objects(n);
+  TStopWatch oldClone;
+  for(size_t i=0; i<n; ++i)
+    objects[i] = static_cast<TSerializable*>(old.find(names[i].c_str())->second->clone());
+  double tOldClone = oldClone.ms();
+  for(auto &&o: objects)
+    delete o;
+  for(auto &&o: old)
+    delete o.second;
+
+  TStopWatch clone;
+  for(size_t i=0; i<n; ++i)
+    objects[i] = getDefaultStore().clone(names[i]);
+  double tClone = clone.ms();
+  for(size_t i=0; i<n; ++i) {
+    ASSERT_STREQ(names[i].c_str(), objects[i]->getClassName());
+    delete objects[i];
+  }
+
+  cout << "create " << n << " objects: old " << tOldClone << "ms, "
+       << "new " << tClone << "ms" << endl;
+}
+
+// outline the curves fitted to the recordings with their pressure, as often
+// as it takes for the strokes of a comic page
+TEST_F(Benchmark, DISABLED_PathOffset)
+{
+  vector<TVectorPath> paths;
+  vector<vector<TCoord>> pressures;
+  size_t n = 0;
+  for(auto filename: handpathFiles) {
+    vector<TCoord> samples;
+    TPolygon polygon = loadHandpathPolygon(filename, &samples), curve;
+    ASSERT_FALSE(polygon.empty());
+    fitCurve(polygon, &curve, 50);
+    TVectorPath path;
+    path.move(curve[0]);
+    for(size_t i=1; i+2<curve.size(); i+=3)
+      path.curve(curve[i], curve[i+1], curve[i+2]);
+    paths.push_back(path);
+    // the pressure of the sample about as far along the recording
+    vector<TCoord> pressure;
+    for(size_t i=0; i<curve.size(); ++i)
+      pressure.push_back(samples[i * (samples.size()-1) / (curve.size()-1)]);
+    pressures.push_back(pressure);
+    n += curve.size()/3;
+  }
+
+  const int rounds = 250;
+  TPathOffset offset(8.0);
+  size_t points = 0;
+  TStopWatch outline;
+  for(int i=0; i<rounds; ++i) {
+    for(size_t j=0; j<paths.size(); ++j) {
+      TVectorPath out;
+      offset.outline(paths[j], &out, &pressures[j]);
+      points += out.points.size();
+    }
+  }
+  double tOutline = outline.ms();
+
+  cout << rounds*paths.size() << " strokes with " << rounds*n << " curves: outline "
+       << tOutline << "ms (" << points/rounds << " points per round)" << endl;
+}
+
+} // namespace
@@ -0,0 +1,107 @@
+#include <toad/geometry.hh>
+#include "gtest.h"
+
+using namespace toad;
+
+TEST(CurveCurveIntersection, TwoPoints) {
+  TPoint a[4] = {{0,0}, {10,20}, {20,20}, {30,0}};
+  TPoint b[4] = {{0,10}, {10,10}, {20,10}, {30,10}};
+
+  TIntersectionList il;
+  intersectCurveCurve(il, a, b);
+
+  ASSERT_EQ(2, il.size());
+  for(auto &&i: il) {
+    ASSERT_EQ(a, i.seg0.src);
+    ASSERT_EQ(b, i.seg1.src);
+    ASSERT_NEAR(10.0, i.seg0.pt.y, 1e-3);
+    ASSERT_NEAR(i.seg0.pt.x, i.seg1.pt.x, 1e-3);
+  }
+  ASSERT_NEAR(0.211325, il[0].seg0.u, 1e-4);
+  ASSERT_NEAR(0.788675, il[1].seg0.u, 1e-4);
+}
+
+// straight curves with the control points on the end points
+TEST(CurveCurveIntersection, StraightCurves) {
+  TPoint a[4] = {{0,0}, {0,0}, {30,0}, {30,0}};
+  TPoint b[4] = {{15,-10}, {15,-10}, {15,10}, {15,10}};
+
+  TIntersectionList il;
+  intersectCurveCurve(il, a, b);
+
+  ASSERT_EQ(1, il.size());
+  ASSERT_NEAR(0.5, il[0].seg0.u, 1e-4);
+  ASSERT_NEAR(0.5, il[0].seg1.u, 1e-4);
+}
+
+// straight curves with the control points in between, whose fat lines
+// have no width
+TEST(CurveCurveIntersection, CrossingStraightCurves) {
+  TPoint a[4] = {{60,-10}, {60,30}, {60,70}, {60,110}};
+  TPoint b[4] = {{-10,100}, {30,100}, {70,100}, {110,100}};
+
+  TIntersectionList il;
+  intersectCurveCurve(il, a, b);
+  intersectCurveCurve(il, b, a);
+
+  ASSERT_EQ(2, il.size());
+  ASSERT_NEAR(0.916667, il[0].seg0.u, 1e-4);
+  ASSERT_NEAR(0.583333, il[0].seg1.u, 1e-4);
+  ASSERT_NEAR(0.583333, il[1].seg0.u, 1e-4);
+  ASSERT_NEAR(0.916667, il[1].seg1.u, 1e-4);
+}
+
+TEST(CurveCurveIntersection, TouchingEnds) {
+  TPoint a[4] = {{0,0}, {10,20}, {20,20}, {30,0}};
+  TPoint b[4] = {{30,0}, {40,-20}, {50,-20}, {60,0}};
+
+  TIntersectionList il;
+  intersectCurveCurve(il, a, b);
+
+  ASSERT_EQ(1, il.size());
+  ASSERT_NEAR(1.0, il[0].seg0.u, 1e-4);
+  ASSERT_NEAR(0.0, il[0].seg1.u, 1e-4);
+}
+
+TEST(CurveCurveIntersection, SameCurve) {
+  TPoint a[4] = {{0,0}, {10,20}, {20,20}, {30,0}};
+  TPoint b[4] = {{30,0}, {20,20}, {10,20}, {0,0}};
+
+  TIntersectionList il;
+  intersectCurveCurve(il, a, a);
+  intersectCurveCurve(il, a, b);
+
+  ASSERT_EQ(0, il.size());
+}
+
+TEST(PathPathIntersection, Rectangles) {
+  TVectorPath p0, p1;
+  p0.addRect(TRectangle(0, 0, 20, 20));
+  p1.addRect(TRectangle(10, 10, 20, 20));
+
+  TIntersectionList il;
+  p0.intersect(il, p1);
+
+  ASSERT_EQ(2, il.size());
+  ASSERT_EQ(TPoint(20,10), il[0].seg0.pt);
+  ASSERT_EQ(TPoint(10,20), il[1].seg0.pt);
+}
+
+// b crosses a where a's two segments meet, which is found for both of them
+TEST(PathPathIntersection, Curves) {
+  TPoint a[7] = {{0,0}, {10,20}, {20,20}, {30,0}, {40,-20}, {50,-20}, {60,0}};
+  TPoint b[4] = {{0,10}, {20,10}, {40,-10}, {60,-10}};
+
+  TIntersectionList il;
+  intersectCurves(il, a, 7, b, 4);
+
+  ASSERT_EQ(4, il.size());
+  ASSERT_EQ(a,   il[0].seg0.src);
+  ASSERT_EQ(a,   il[1].seg0.src);
+  ASSERT_EQ(a+3, il[2].seg0.src);
+  ASSERT_EQ(a+3, il[3].seg0.src);
+  ASSERT_EQ(TPoint(30,0), il[1].seg0.pt);
+  ASSERT_NEAR(0.0, distance(il[1].seg0.pt, il[2].seg0.pt), 1e-3);
+  for(auto &&i: il)
+    ASSERT_NEAR(0.0, distance(i.seg0.pt, i.seg1.pt), 1e-3);
+}
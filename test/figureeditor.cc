@@ -14,6 +14,7 @@
 #include <toad/action.hh>
 #include <toad/vector.hh>
 #include <toad/undomanager.hh>
+#include <sstream>
 
 using namespace toad;
 using namespace std;
@@ -319,4 +320,523 @@ TEST_F(FigureEditor, RotateAConnectedFigure)
 
 }
 
+TEST_F(FigureEditor, SnapshotUndo)
+{
+  TFigureModel model;
+  model.setSnapshotUndo(true);
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  TUndoManager *undoManager = new TUndoManager(fe, "undomanager", "edit|undo", "edit|redo");
+  fe->setModel(&model);
+
+  TFRectangle *rectangle0 = new TFRectangle(10, 10, 20, 20);
+  TFRectangle *rectangle1 = new TFRectangle(70, 10, 20, 20);
+  model.add(rectangle0);
+  model.add(rectangle1);
+  ASSERT_EQ(2, model.size());
+
+  // taking a snapshot of an unmodified model is free
+  ASSERT_EQ(model.snapshot(), model.snapshot());
+
+  TFigureSet selection;
+  selection.insert(rectangle1);
+  model.translate(&selection, TPoint(10, 5));
+  ASSERT_EQ(rectangle1, model[1]);
+  ASSERT_EQ(TRectangle(80,15,20,20), model[1]->bounds());
+
+  // undo translate: the untouched figure is shared with the snapshot
+  ASSERT_EQ(true, undoManager->canUndo());
+  undoManager->doUndo();
+  ASSERT_EQ(2, model.size());
+  ASSERT_EQ(rectangle0, model[0]);
+  ASSERT_EQ(TRectangle(10,10,20,20), model[0]->bounds());
+  ASSERT_EQ(TRectangle(70,10,20,20), model[1]->bounds());
+
+  // redo translate
+  ASSERT_EQ(true, undoManager->canRedo());
+  undoManager->doRedo();
+  ASSERT_EQ(rectangle1, model[1]);
+  ASSERT_EQ(TRectangle(80,15,20,20), model[1]->bounds());
+
+  // undo translate and both inserts
+  undoManager->doUndo();
+  undoManager->doUndo();
+  ASSERT_EQ(1, model.size());
+  undoManager->doUndo();
+  ASSERT_EQ(0, model.size());
+}
+
+// the figures span several chunks, which are modified at different places
+TEST_F(FigureEditor, SnapshotUndoChunks)
+{
+  TFigureModel model;
+  model.setSnapshotUndo(true);
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  TUndoManager *undoManager = new TUndoManager(fe, "undomanager", "edit|undo", "edit|redo");
+  fe->setModel(&model);
+
+  TFigureVector all;
+  for(int i=0; i<300; ++i)
+    all.push_back(new TFRectangle(i, 0, 5, 5));
+  model.add(all);
+
+  auto xs = [&] {
+    vector<TCoord> result;
+    for(auto &&figure: model)
+      result.push_back(figure->bounds().origin.x);
+    return result;
+  };
+  vector<vector<TCoord>> states;
+  states.push_back(xs());
+
+  TFigureSet set;
+  set.insert(model[150]);
+  model.translate(&set, TPoint(1000, 0));
+  states.push_back(xs());
+
+  set.clear();
+  for(int i=10; i<300; i+=37)
+    set.insert(model[i]);
+  model.erase(set);
+  states.push_back(xs());
+
+  set.clear();
+  set.insert(model[100]);
+  set.insert(model[101]);
+  model.group(set);
+  states.push_back(xs());
+
+  model.add(new TFRectangle(2000, 0, 5, 5));
+  states.push_back(xs());
+
+  set.clear();
+  set.insert(model[0]);
+  set.insert(model[model.size()-1]);
+  model.translate(&set, TPoint(3000, 0));
+  states.push_back(xs());
+
+  // the snapshots share the chunks which weren't modified
+  ASSERT_GT(all.size() * sizeof(void*), TUndoManager::getMemoryUsage(&model));
+
+  for(size_t i=states.size()-1; i>0; --i) {
+    undoManager->doUndo();
+    ASSERT_EQ(states[i-1], xs()) << "undo to step " << i-1;
+  }
+  for(size_t i=1; i<states.size(); ++i) {
+    undoManager->doRedo();
+    ASSERT_EQ(states[i], xs()) << "redo to step " << i;
+  }
+}
+
+TEST_F(FigureEditor, UndoMemoryBudget)
+{
+  TFigureModel model;
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  TUndoManager *undoManager = new TUndoManager(fe, "undomanager", "edit|undo", "edit|redo");
+  fe->setModel(&model);
+
+  ASSERT_EQ(true, TUndoManager::setMemoryBudget(&model, 1));
+  TFigureEditor::relatedTo.clear(); // leftovers from previous tests
+
+  for(int i=0; i<10; ++i)
+    model.add(new TFRectangle(10*i, 10, 5, 5));
+  TFigureSet set;
+  set.insert(model.begin(), model.end());
+  model.translate(&set, TPoint(0, 100));
+  set.clear();
+  set.insert(model[0]);
+  set.insert(model[1]);
+  model.group(set);
+  ASSERT_EQ(9, model.size());
+  set.clear();
+  set.insert(model.begin(), model.end());
+  model.erase(set);
+  ASSERT_EQ(0, model.size());
+
+  // the removed figures went into the spill file
+  ASSERT_LT(0, TUndoManager::getSpilledSize(&model));
+
+  undoManager->doUndo();
+  ASSERT_EQ(9, model.size());
+  ASSERT_EQ(TRectangle(0,110,15,5), model[0]->bounds());
+  ASSERT_EQ(TRectangle(90,110,5,5), model[8]->bounds());
+  ASSERT_EQ(0, TUndoManager::getSpilledSize(&model));
+
+  // the older undo objects refer to the figures read back from the spill
+  // file
+  undoManager->doUndo();
+  ASSERT_EQ(10, model.size());
+  ASSERT_EQ(TRectangle(0,110,5,5), model[0]->bounds());
+  ASSERT_EQ(TRectangle(10,110,5,5), model[1]->bounds());
+
+  undoManager->doUndo();
+  ASSERT_EQ(TRectangle(0,10,5,5), model[0]->bounds());
+  ASSERT_EQ(TRectangle(90,10,5,5), model[9]->bounds());
+
+  for(int i=9; i>=0; --i) {
+    undoManager->doUndo();
+    ASSERT_EQ(i, model.size());
+  }
+}
+
+TEST_F(FigureEditor, EraseAndUndoKeepDepth)
+{
+  TFigureModel model;
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  TUndoManager *undoManager = new TUndoManager(fe, "undomanager", "edit|undo", "edit|redo");
+  fe->setModel(&model);
+
+  TFigureVector all;
+  for(int i=0; i<10; ++i)
+    all.push_back(new TFRectangle(10*i, 10, 5, 5));
+  model.add(all);
+
+  TFigureSet set;
+  for(int i=0; i<10; i+=3)
+    set.insert(all[i]);
+  fe->selection = set;
+  model.erase(fe->selection);
+
+  ASSERT_EQ(6, model.size());
+  ASSERT_EQ(true, fe->selection.empty());
+  ASSERT_EQ(all[1], model[0]);
+  ASSERT_EQ(all[2], model[1]);
+  ASSERT_EQ(all[4], model[2]);
+  ASSERT_EQ(all[8], model[5]);
+
+  undoManager->doUndo();
+  ASSERT_EQ(10, model.size());
+  for(int i=0; i<10; ++i)
+    ASSERT_EQ(all[i], model[i]);
+}
+
+TEST_F(FigureEditor, CachedBounds)
+{
+  TFigureModel model;
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  TUndoManager *undoManager = new TUndoManager(fe, "undomanager", "edit|undo", "edit|redo");
+  fe->setModel(&model);
+
+  ASSERT_EQ(true, model.bounds().empty);
+
+  TFRectangle *rectangle0 = new TFRectangle(10, 10, 20, 20);
+  TFRectangle *rectangle1 = new TFRectangle(70, 10, 20, 20);
+  model.add(rectangle0);
+  ASSERT_EQ(TRectangle(10,10,20,20), TRectangle(model.bounds()));
+  model.add(rectangle1);
+  ASSERT_EQ(TRectangle(10,10,80,20), TRectangle(model.bounds()));
+
+  TFigureSet selection;
+  selection.insert(rectangle1);
+  model.translate(&selection, TPoint(10, 5));
+  ASSERT_EQ(TRectangle(10,10,90,25), TRectangle(model.bounds()));
+
+  // groups derive their bounds from the cached bounds of their figures
+  selection.insert(rectangle0);
+  TFigure *group = model.group(selection);
+  ASSERT_EQ(TRectangle(10,10,90,25), group->bounds());
+
+  undoManager->doUndo();
+  ASSERT_EQ(2, model.size());
+  ASSERT_EQ(TRectangle(10,10,90,25), TRectangle(model.bounds()));
+
+  undoManager->doUndo();
+  ASSERT_EQ(TRectangle(10,10,80,20), TRectangle(model.bounds()));
+
+  model.erase(rectangle1);
+  ASSERT_EQ(TRectangle(10,10,20,20), TRectangle(model.bounds()));
+
+  // tools modify figures directly and tell the editor
+  fe->invalidateFigure(rectangle0);
+  rectangle0->setShape(10, 10, 40, 30);
+  fe->invalidateFigure(rectangle0);
+  ASSERT_EQ(TRectangle(10,10,40,30), TRectangle(model.bounds()));
+}
+
+TEST_F(FigureEditor, CachedBoundsOfGroups)
+{
+  TFigureModel model;
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  fe->setModel(&model);
+
+  // a rectangle in a group in a transform
+  TFRectangle *rectangle = new TFRectangle(10, 10, 20, 20);
+  TFGroup *group = new TFGroup();
+  group->gadgets.add(rectangle);
+  group->gadgets.add(new TFRectangle(50, 10, 20, 20));
+  TFTransform *transform = new TFTransform();
+  transform->figure = group;
+  transform->matrix.translate(100, 0);
+  model.add(transform);
+  ASSERT_EQ(TRectangle(10,10,60,20), group->bounds());
+  ASSERT_EQ(TRectangle(110,10,60,20), static_cast<TFigure*>(transform)->bounds());
+  ASSERT_EQ(TRectangle(110,10,60,20), TRectangle(model.bounds()));
+
+  // tools modify the rectangle directly and tell the editor, which doesn't
+  // know the group or the transform
+  fe->invalidateFigure(rectangle);
+  rectangle->setShape(10, 10, 20, 50);
+  fe->invalidateFigure(rectangle);
+  ASSERT_EQ(TRectangle(10,10,60,50), group->bounds());
+  ASSERT_EQ(TRectangle(110,10,60,50), static_cast<TFigure*>(transform)->bounds());
+  ASSERT_EQ(TRectangle(110,10,60,50), TRectangle(model.bounds()));
+}
+
+TEST_F(FigureEditor, CachedPath)
+{
+  TFigureModel model;
+
+  TFRectangle *rectangle0 = new TFRectangle(10, 10, 20, 20);
+  TFRectangle *rectangle1 = new TFRectangle(50, 10, 20, 20);
+  TFConnection *connection = new TFConnection(rectangle0, rectangle1);
+  model.add(rectangle0);
+  model.add(rectangle1);
+  model.add(connection);
+  TFigureEditor::relatedTo[rectangle0].insert(connection);
+  TFigureEditor::relatedTo[rectangle1].insert(connection);
+  connection->updatePoints();
+  ASSERT_EQ(TPoint(30, 20), connection->p[0]);
+  ASSERT_EQ(TPoint(50, 20), connection->p[1]);
+
+  // the path is kept until the figure is modified
+  const TVectorGraphic *path = rectangle1->getPath();
+  ASSERT_NE(nullptr, path);
+  ASSERT_EQ(path, rectangle1->getPath());
+  ASSERT_EQ(1, path->size());
+  ASSERT_EQ(TRectangle(50,10,20,20), TRectangle(path->front().path.bounds()));
+
+  TFigureSet selection;
+  selection.insert(rectangle1);
+  model.translate(&selection, TPoint(20, 0));
+
+  path = rectangle1->getPath();
+  ASSERT_EQ(TRectangle(70,10,20,20), TRectangle(path->front().path.bounds()));
+  ASSERT_EQ(TPoint(30, 20), connection->p[0]);
+  ASSERT_EQ(TPoint(70, 20), connection->p[1]);
+
+  path = connection->getPath();
+  ASSERT_NE(nullptr, path);
+  ASSERT_EQ(1, path->size());
+  ASSERT_EQ(connection->p, path->front().path.points);
+
+  rectangle1->setShape(70, 10, 40, 20);
+  ASSERT_EQ(TRectangle(70,10,40,20), TRectangle(rectangle1->getPath()->front().path.bounds()));
+
+  // an assigned figure keeps its id and a graphic of its own
+  TFRectangle copy(0, 0, 10, 10);
+  unsigned id = copy.getId();
+  ASSERT_NE(nullptr, copy.getPath());
+  copy = *rectangle1;
+  ASSERT_EQ(id, copy.getId());
+  ASSERT_NE(rectangle1->getPath(), copy.getPath());
+  ASSERT_EQ(TRectangle(70,10,40,20), TRectangle(copy.getPath()->front().path.bounds()));
+
+  TFigureEditor::relatedTo.erase(rectangle0);
+  TFigureEditor::relatedTo.erase(rectangle1);
+}
+
+class CountingConnection:
+  public TFConnection
+{
+  public:
+    CountingConnection(TFigure *start, TFigure *end): TFConnection(start, end) {}
+    unsigned modified = 0;
+    bool editEvent(TFigureEditEvent &ee) override {
+      if (ee.type == TFigureEditEvent::RELATION_MODIFIED)
+        ++modified;
+      return TFConnection::editEvent(ee);
+    }
+};
+
+TEST_F(FigureEditor, ConnectionFollowsModifiedEnd)
+{
+  TFigureModel model;
+
+  TFRectangle *rectangle0 = new TFRectangle(10, 10, 20, 20);
+  TFRectangle *rectangle1 = new TFRectangle(50, 10, 20, 20);
+  CountingConnection *connection = new CountingConnection(rectangle0, rectangle1);
+  connection->p.insert(connection->p.begin()+1, TPoint(40, 60));
+  model.add(rectangle0);
+  model.add(rectangle1);
+  model.add(connection);
+  TFigureEditor::relatedTo[rectangle0].insert(connection);
+  TFigureEditor::relatedTo[rectangle1].insert(connection);
+  connection->updatePoints();
+  ASSERT_NEAR(25, connection->p.front().x, 1e-9);
+  ASSERT_NEAR(30, connection->p.front().y, 1e-9);
+  ASSERT_NEAR(55, connection->p.back().x, 1e-9);
+  ASSERT_NEAR(30, connection->p.back().y, 1e-9);
+
+  // only the end attached to the moved figure is recalculated
+  connection->p.front() = TPoint(0, 0);
+  TFigureSet selection;
+  selection.insert(rectangle1);
+  model.translate(&selection, TPoint(20, 0));
+  ASSERT_EQ(1, connection->modified);
+  ASSERT_EQ(TPoint(0, 0), connection->p.front());
+  ASSERT_NEAR(70, connection->p.back().x, 1e-9);
+  ASSERT_NEAR(30, connection->p.back().y, 1e-9);
+
+  // moving both figures updates the connection once
+  connection->updatePoints();
+  selection.insert(rectangle0);
+  model.translate(&selection, TPoint(0, 10));
+  ASSERT_EQ(2, connection->modified);
+  ASSERT_NEAR(25, connection->p.front().x, 1e-9);
+  ASSERT_NEAR(40, connection->p.front().y, 1e-9);
+  ASSERT_NEAR(70, connection->p.back().x, 1e-9);
+  ASSERT_NEAR(40, connection->p.back().y, 1e-9);
+
+  TFigureEditor::relatedTo.erase(rectangle0);
+  TFigureEditor::relatedTo.erase(rectangle1);
+}
+
+TEST_F(FigureEditor, FigureSet)
+{
+  TFRectangle *r0 = new TFRectangle(0, 0, 1, 1);
+  TFRectangle *r1 = new TFRectangle(0, 0, 1, 1);
+  TFRectangle *r2 = new TFRectangle(0, 0, 1, 1);
+
+  TFigureSet set;
+  ASSERT_EQ(true, set.empty());
+  ASSERT_EQ(true, set.insert(r2).second);
+  ASSERT_EQ(true, set.insert(r0).second);
+  ASSERT_EQ(false, set.insert(r0).second);
+  ASSERT_EQ(2, set.size());
+  ASSERT_EQ(true, set.contains(r0));
+  ASSERT_EQ(false, set.contains(r1));
+  ASSERT_EQ(set.end(), set.find(r1));
+  ASSERT_EQ(r2, *set.find(r2));
+
+  // iteration is in id order
+  vector<TFigure*> figures(set.begin(), set.end());
+  ASSERT_EQ(2, figures.size());
+  ASSERT_LT(figures[0]->getId(), figures[1]->getId());
+
+  TFigureSet copy(set);
+  ASSERT_EQ(true, copy == set);
+  copy.erase(copy.find(r0));
+  ASSERT_EQ(1, copy.size());
+  ASSERT_EQ(r2, *copy.begin());
+  ASSERT_EQ(true, copy != set);
+  ASSERT_EQ(1, set.erase(r2));
+  ASSERT_EQ(0, set.erase(r2));
+  ASSERT_EQ(r0, *set.begin());
+
+  // end() doesn't change when the set grows
+  TFigureSet::iterator end = set.end();
+  set.insert(r1);
+  ASSERT_EQ(end, set.end());
+
+  // ids of deleted figures are reused, but not found in old sets
+  unsigned id = r1->getId();
+  delete r1;
+  ASSERT_EQ(1, set.size());
+  ASSERT_EQ(r0, *set.begin());
+  TFRectangle *r3 = new TFRectangle(0, 0, 1, 1);
+  ASSERT_EQ(id, r3->getId());
+  ASSERT_EQ(false, set.contains(r3));
+  ASSERT_EQ(vector<TFigure*>({ r0 }), vector<TFigure*>(set.begin(), set.end()));
+
+  // ...until it's inserted again
+  TFigureSet old(set);
+  ASSERT_EQ(true, set.insert(r3).second);
+  ASSERT_EQ(2, set.size());
+  ASSERT_EQ(true, set.contains(r3));
+  ASSERT_EQ(false, old.contains(r3));
+  ASSERT_EQ(true, old != set);
+  set.erase(r3);
+  ASSERT_EQ(true, old == set);
+
+  delete r0;
+  ASSERT_EQ(true, set.empty());
+  ASSERT_EQ(true, old.empty());
+  delete r2;
+  delete r3;
+}
+
+TEST_F(FigureEditor, ModifyInPlace)
+{
+  TFigureModel model;
+
+  TFigureEditor *fe = new TFigureEditor(nullptr, "TFigureEditor");
+  fe->setModel(&model);
+
+  TFText *text = new TFText(10, 10, "text");
+  model.add(text);
+  fe->setModified(false);
+
+  decltype(model.type) type = TFigureModel::ADD;
+  TFigureSet figures;
+  TSignalLink *link = model.sigChanged.add([&] {
+    type = model.type;
+    figures = model.figures;
+  });
+
+  // ie. the text tool edits the text without using the model
+  model.modify(text);
+  ASSERT_EQ(TFigureModel::MODIFY, type);
+  ASSERT_EQ(1, figures.size());
+  ASSERT_EQ(true, figures.contains(text));
+  ASSERT_EQ(true, fe->isModified());
+
+  model.sigChanged.remove(link);
+}
+
+TEST_F(FigureEditor, SymbolInstance)
+{
+  TFSymbol *symbol = new TFSymbol();
+  symbol->add(new TFRectangle(10, 10, 20, 20));
+
+  TMatrix2D m;
+  m.translate(100, 0);
+  TFigureModel model;
+  TFInstance *instance0 = new TFInstance(symbol);
+  TFInstance *instance1 = new TFInstance(symbol, &m);
+  model.add(instance0);
+  model.add(instance1);
+  ASSERT_EQ(TRectangle(10,10,20,20), instance0->bounds());
+  ASSERT_EQ(TRectangle(110,10,20,20), instance1->bounds());
+  ASSERT_GT(TFigure::RANGE, instance1->_distance(nullptr, 110, 20));
+  ASSERT_LT(TFigure::RANGE, instance1->_distance(nullptr, 10, 20));
+
+  // copies share the symbol
+  TFInstance *copy = static_cast<TFInstance*>(instance1->clone());
+  ASSERT_EQ(symbol, static_cast<TFSymbol*>(copy->symbol));
+  delete copy;
+
+  // the symbol is stored once
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&model);
+  os.close();
+  string s = out.str();
+  size_t first = s.find("toad::TFSymbol");
+  ASSERT_NE(string::npos, first);
+  ASSERT_EQ(string::npos, s.find("toad::TFSymbol", first+1));
+
+  istringstream in(s);
+  TInObjectStream is(&in);
+  TFigureModel *restored = dynamic_cast<TFigureModel*>(is.restore());
+  is.close();
+  ASSERT_NE(nullptr, restored);
+  ASSERT_EQ(2, restored->size());
+  TFInstance *r0 = dynamic_cast<TFInstance*>((*restored)[0]);
+  TFInstance *r1 = dynamic_cast<TFInstance*>((*restored)[1]);
+  ASSERT_NE(nullptr, r0);
+  ASSERT_NE(nullptr, r1);
+  TFSymbol *s0 = r0->symbol, *s1 = r1->symbol;
+  ASSERT_NE(nullptr, s0);
+  ASSERT_EQ(s0, s1);
+  ASSERT_NE(symbol, s0);
+  ASSERT_EQ(1, s0->size());
+  ASSERT_EQ(TRectangle(110,10,20,20), r1->bounds());
+  delete restored;
+}
+
 } // namespace
@@ -0,0 +1,93 @@
+#include <toad/fischland/filltool.hh>
+#include "gtest.h"
+
+#include <toad/core.hh>
+
+using namespace toad;
+using namespace fischland;
+
+namespace {
+
+class FillArrangement:
+  public ::testing::Test
+{
+  protected:
+    static void SetUpTestCase() {
+      toad::initialize(0, NULL);
+    }
+
+    static void TearDownTestCase() {
+      toad::terminate();
+    }
+};
+
+// a straight line as bézier curve
+TFPath*
+line(TCoord x0, TCoord y0, TCoord x1, TCoord y1)
+{
+  TFPath *path = new TFPath();
+  path->addPoint(x0, y0);
+  path->addPoint(x0 + (x1-x0)/3, y0 + (y1-y0)/3);
+  path->addPoint(x0 + (x1-x0)*2/3, y0 + (y1-y0)*2/3);
+  path->addPoint(x1, y1);
+  path->corner.assign(2, 0);
+  return path;
+}
+
+void
+expectBounds(const TRectangle &expected, TFPath *path)
+{
+  ASSERT_NE(nullptr, path);
+  TRectangle r = path->bounds();
+  EXPECT_NEAR(expected.origin.x, r.origin.x, 1.0);
+  EXPECT_NEAR(expected.origin.y, r.origin.y, 1.0);
+  EXPECT_NEAR(expected.size.width, r.size.width, 1.0);
+  EXPECT_NEAR(expected.size.height, r.size.height, 1.0);
+  delete path;
+}
+
+TEST_F(FillArrangement, Fill)
+{
+  TFigureModel model;
+  // a '#' of four lines, which encloses a square in the middle
+  model.add(line(-10, 0, 110, 0));
+  model.add(line(-10, 100, 110, 100));
+  model.add(line(0, -10, 0, 110));
+  TFPath *right = line(100, -10, 100, 110);
+  model.add(right);
+
+  TFillArrangement arrangement;
+  arrangement.setModel(&model);
+  expectBounds(TRectangle(0, 0, 100, 100), arrangement.fill(50, 50));
+  ASSERT_EQ(nullptr, arrangement.fill(50, 150));
+  ASSERT_EQ(nullptr, arrangement.fill(105, 50));
+
+  // only the modified paths are intersected again
+  model.erase(right);
+  TFPath *middle = line(60, -10, 60, 110);
+  model.add(middle);
+  expectBounds(TRectangle(0, 0, 60, 100), arrangement.fill(30, 50));
+  ASSERT_EQ(nullptr, arrangement.fill(80, 50));
+
+  // the smallest face containing the point is filled
+  model.add(line(-10, 50, 110, 50));
+  expectBounds(TRectangle(0, 50, 60, 50), arrangement.fill(30, 70));
+
+  // paths translated by the model are taken from its notifications
+  TFigureSet moved;
+  moved.insert(middle);
+  model.translate(&moved, TPoint(20, 0));
+  expectBounds(TRectangle(0, 50, 80, 50), arrangement.fill(70, 70));
+
+  // a square apart from the others is a component of its own
+  model.add(line(190, 200, 310, 200));
+  model.add(line(190, 300, 310, 300));
+  model.add(line(200, 190, 200, 310));
+  model.add(line(300, 190, 300, 310));
+  expectBounds(TRectangle(200, 200, 100, 100), arrangement.fill(250, 250));
+  expectBounds(TRectangle(0, 0, 80, 50), arrangement.fill(30, 30));
+
+  arrangement.setModel(nullptr);
+}
+
+} // namespace
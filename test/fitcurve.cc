@@ -1,8 +1,68 @@
 #include <toad/geometry.hh>
+#include <toad/fischland/fitcurve.hh>
+#include "handpath.hh"
 #include "gtest.h"
 
 using namespace toad;
 
+namespace {
+
+vector<TPoint>
+flatten(const TPolygon &curve)
+{
+  vector<TPoint> out;
+  out.push_back(curve[0]);
+  for(size_t i=1; i+2<curve.size(); i+=3) {
+    for(int j=1; j<=16; ++j) {
+      TCoord t = j/16.0, u = 1.0-t;
+      out.push_back(curve[i-1]*(u*u*u) + curve[i]*(3*u*u*t) +
+                    curve[i+1]*(3*u*t*t) + curve[i+2]*(t*t*t));
+    }
+  }
+  return out;
+}
+
+// the largest distance of a point in 'a' to the polyline 'b'
+TCoord
+farthest(const vector<TPoint> &a, const vector<TPoint> &b)
+{
+  TCoord result = 0.0;
+  for(auto &&p: a) {
+    TCoord d = 1.0/0.0;
+    for(size_t i=0; i+1<b.size(); ++i) {
+      TPoint ab = b[i+1] - b[i];
+      TCoord l = dot(ab, ab);
+      TCoord u = l>0.0 ? std::max(0.0, std::min(1.0, dot(p - b[i], ab) / l)) : 0.0;
+      d = std::min(d, distance(p, b[i] + ab * u));
+    }
+    result = std::max(result, d);
+  }
+  return result;
+}
+
+// the recursive Ramer-Douglas-Peucker from the textbook
+void
+referenceRDP(const TPoint *p, size_t a, size_t b, TCoord epsilon, vector<bool> *keep)
+{
+  TCoord max = 0.0;
+  size_t index = 0;
+  for(size_t i=a+1; i<b; ++i) {
+    TCoord d = p[a]==p[b] ? distance(p[i], p[a])
+                          : fabs(cross(p[b]-p[a], p[i]-p[a])) / distance(p[a], p[b]);
+    if (d > max) {
+      max = d;
+      index = i;
+    }
+  }
+  if (max > epsilon) {
+    (*keep)[index] = true;
+    referenceRDP(p, a, index, epsilon, keep);
+    referenceRDP(p, index, b, epsilon, keep);
+  }
+}
+
+} // namespace
+
 TEST(FitCurve, NoCurve001) {
   TPoint a[] = {
     { 10, 10 },
@@ -95,3 +155,155 @@ TEST(FitCurve, NoCurve003) {
 //  ASSERT_EQ(TPoint(116.667,76.6667), path.points[4]);
   ASSERT_EQ(a[4], path.points[5]);
 }
+
+// the points sampled along a straight line are removed before fitting
+TEST(FitCurve, SampledLine) {
+  TVectorPath path;
+  path.move(TPoint(10, 10));
+  for(int i=1; i<=100; ++i)
+    path.line(TPoint(10+i, 10+i/2.0));
+  path.simplify();
+
+  ASSERT_EQ(2, path.type.size());
+  ASSERT_EQ(TVectorPath::MOVE, path.type[0]);
+  ASSERT_EQ(TVectorPath::LINE, path.type[1]);
+  ASSERT_EQ(TPoint(10, 10), path.points[0]);
+  ASSERT_EQ(TPoint(110, 60), path.points[1]);
+}
+
+// curves are kept and the lines next to them stay connected to them
+TEST(FitCurve, SampledLineAfterCurve) {
+  TVectorPath path;
+  path.move(TPoint(10, 10));
+  path.curve(TPoint(20, 20), TPoint(30, 20), TPoint(40, 10));
+  for(int i=1; i<=100; ++i)
+    path.line(TPoint(40+i, 10+i/2.0));
+  path.curve(TPoint(150, 70), TPoint(160, 70), TPoint(170, 60));
+  path.simplify();
+
+  ASSERT_EQ(4, path.type.size());
+  ASSERT_EQ(TVectorPath::MOVE, path.type[0]);
+  ASSERT_EQ(TVectorPath::CURVE, path.type[1]);
+  ASSERT_EQ(TVectorPath::LINE, path.type[2]);
+  ASSERT_EQ(TVectorPath::CURVE, path.type[3]);
+  ASSERT_EQ(TPoint(10, 10), path.points[0]);
+  ASSERT_EQ(TPoint(40, 10), path.points[3]);
+  ASSERT_EQ(TPoint(140, 60), path.points[4]);
+  ASSERT_EQ(TPoint(170, 60), path.points[7]);
+}
+
+TEST(RamerDouglasPeucker, Line) {
+  vector<TPoint> in, out;
+  ramerDouglasPeucker(in, 1.0, &out);
+  ASSERT_TRUE(out.empty());
+
+  for(int i=0; i<=10; ++i)
+    in.push_back(TPoint(i*10, i==5 ? 0.5 : 0));
+  ramerDouglasPeucker(in, 1.0, &out);
+  ASSERT_EQ(2, out.size());
+  ASSERT_EQ(TPoint(0, 0), out[0]);
+  ASSERT_EQ(TPoint(100, 0), out[1]);
+
+  in[5].y = 1.2;
+  ramerDouglasPeucker(in, 1.0, &out);
+  ASSERT_EQ(3, out.size());
+  ASSERT_EQ(TPoint(50, 1.2), out[1]);
+}
+
+// the start and the end are the same point
+TEST(RamerDouglasPeucker, Closed) {
+  vector<TPoint> in = {
+    { 0, 0 }, { 5, 0.1 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 }
+  };
+  vector<TPoint> out;
+  ramerDouglasPeucker(in, 1.0, &out);
+  vector<TPoint> expect = {
+    { 0, 0 }, { 10, 0 }, { 10, 10 }, { 0, 10 }, { 0, 0 }
+  };
+  ASSERT_EQ(expect, out);
+}
+
+TEST(RamerDouglasPeucker, Replay) {
+  for(auto filename: handpathFiles) {
+    SCOPED_TRACE(filename);
+    TPolygon polygon = loadHandpathPolygon(filename);
+    for(TCoord epsilon: {0.5, 2.0, 8.0}) {
+      vector<bool> keep, expect(polygon.size(), false);
+      expect.front() = expect.back() = true;
+      referenceRDP(polygon.data(), 0, polygon.size()-1, epsilon, &expect);
+      ramerDouglasPeucker(polygon.data(), polygon.size(), epsilon, &keep);
+      ASSERT_EQ(expect, keep) << "epsilon " << epsilon;
+    }
+  }
+}
+
+TEST(CurveFitter, Empty) {
+  TCurveFitter fitter;
+  TPolygon curve;
+  fitter.curve(&curve);
+  ASSERT_TRUE(fitter.empty());
+  ASSERT_TRUE(curve.empty());
+
+  fitter.add(TPoint(10, 20));
+  fitter.add(TPoint(10, 20));
+  ASSERT_EQ(1, fitter.size());
+  fitter.curve(&curve);
+  ASSERT_EQ(1, curve.size());
+  ASSERT_EQ(TPoint(10, 20), curve[0]);
+}
+
+// where the samples are split at cusps only, the result is that of fitCurve()
+TEST(CurveFitter, Cusps) {
+  TPolygon polygon;
+  for(int leg=0; leg<8; ++leg) {
+    for(int i=0; i<10; ++i) {
+      TCoord x = leg%2 ? 90-i*8 : 10+i*8;
+      polygon.addPoint(x, 10 + leg*10 + i + (i*i)%3);
+    }
+  }
+
+  TPolygon batch;
+  fitCurve(polygon, &batch, 50);
+
+  TCurveFitter fitter(50);
+  TPolygon curve;
+  for(auto &&p: polygon) {
+    fitter.add(p);
+    fitter.curve(&curve);
+  }
+  ASSERT_EQ(batch, curve);
+}
+
+// replay some of the recorded tablet data, the benchmark replays all
+TEST(CurveFitter, Replay) {
+  const int smoothness = 50;
+  for(auto filename: {
+    "backup-glitch007.txt",
+    "backup-glitch008.txt",
+    "backup-hang005.txt",
+    "backup-overlap-glitch001.txt" })
+  {
+    SCOPED_TRACE(filename);
+    TPolygon polygon = loadHandpathPolygon(filename);
+    ASSERT_FALSE(polygon.empty());
+
+    TPolygon batch;
+    fitCurve(polygon, &batch, smoothness);
+
+    TCurveFitter fitter(smoothness);
+    for(auto &&p: polygon)
+      fitter.add(p);
+    TPolygon curve;
+    fitter.curve(&curve);
+
+    ASSERT_EQ(1, curve.size()%3);
+    ASSERT_EQ(batch.front(), curve.front());
+    // the end points of curves are truncated to integers, those of lines not
+    ASSERT_LT(distance(batch.back(), curve.back()), 1.5);
+    vector<TPoint> a = flatten(batch), b = flatten(curve);
+    TCoord tolerance = 2.0 * sqrt(smoothness);
+    ASSERT_LT(farthest(a, b), tolerance);
+    ASSERT_LT(farthest(b, a), tolerance);
+    ASSERT_LT(farthest(polygon, b), tolerance);
+  }
+}
@@ -0,0 +1,91 @@
+#include <toad/geometry.hh>
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+TCoord
+distanceToLine(const TPoint &p, const TPoint &a, const TPoint &b)
+{
+  TPoint ab = b - a;
+  TCoord l = dot(ab, ab);
+  TCoord u = l>0.0 ? std::max(0.0, std::min(1.0, dot(p - a, ab) / l)) : 0.0;
+  return distance(p, a + ab * u);
+}
+
+// the largest distance of the curve to the lines approximating it
+TCoord
+deviation(const TPoint *curve, const vector<TPoint> &lines)
+{
+  TCoord max = 0.0;
+  for(int i=0; i<=1000; ++i) {
+    TPoint p = bez2point(curve, i/1000.0);
+    TCoord min = 1.0/0.0;
+    for(size_t j=0; j+1<lines.size(); ++j)
+      min = std::min(min, distanceToLine(p, lines[j], lines[j+1]));
+    max = std::max(max, min);
+  }
+  return max;
+}
+
+} // namespace
+
+TEST(Flatten, Line) {
+  TPoint curve[] = { {0, 0}, {10, 10}, {20, 20}, {30, 30} };
+  ASSERT_EQ(1, flattenCurveSegments(curve, 0.25));
+  ASSERT_EQ(1, flattenCurveSegments(curve, 0.0));
+
+  vector<TPoint> out;
+  flattenCurve(curve, 0.25, &out);
+  ASSERT_EQ(1, out.size());
+  ASSERT_EQ(curve[3], out[0]);
+}
+
+TEST(Flatten, Tolerance) {
+  TPoint curves[][4] = {
+    { {0, 0}, {0, 100}, {100, 100}, {100, 0} },
+    { {0, 0}, {100, 100}, {0, 100}, {100, 0} },
+    { {10, 10}, {500, -20}, {-300, 80}, {40, 12} },
+    { {0, 0}, {1, 2}, {3, 2}, {4, 0} }
+  };
+  for(auto &&curve: curves) {
+    size_t last = 0;
+    for(TCoord tolerance: {4.0, 1.0, 0.25, 0.01}) {
+      SCOPED_TRACE(tolerance);
+      vector<TPoint> out;
+      flattenCurves(curve, 4, tolerance, &out);
+      ASSERT_EQ(flattenCurveSegments(curve, tolerance)+1, out.size());
+      ASSERT_EQ(curve[0], out.front());
+      ASSERT_EQ(curve[3], out.back());
+      ASSERT_LE(deviation(curve, out), tolerance);
+      // a smaller tolerance needs more lines
+      ASSERT_GE(out.size(), last);
+      last = out.size();
+    }
+  }
+}
+
+TEST(Flatten, Cache) {
+  vector<TPoint> curves = { {0, 0}, {0, 100}, {100, 100}, {100, 0}, {100, -100}, {200, -100}, {200, 0} };
+
+  TFlatteningCache cache;
+  const TPolygon *flat = &cache.flatten(curves, 0.3);
+  vector<TPoint> expect;
+  flattenCurves(curves.data(), curves.size(), 0.25, &expect);
+  ASSERT_EQ(expect, *flat);
+
+  // the same power of two
+  vector<TPoint> before = *flat;
+  ASSERT_EQ(flat, &cache.flatten(curves, 0.4));
+  ASSERT_EQ(before, *flat);
+
+  // another power of two
+  cache.flatten(curves, 0.1);
+  ASSERT_LT(before.size(), flat->size());
+
+  // other curves
+  curves[1].x = 50;
+  flattenCurves(curves.data(), curves.size(), 0.0625, &expect);
+  ASSERT_EQ(expect, cache.flatten(curves, 0.1));
+}
@@ -0,0 +1,113 @@
+#include <toad/fischland/fpath.hh>
+#include <toad/io/serializable.hh>
+#include <algorithm>
+#include <sstream>
+#include <set>
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+TFPath*
+makePath(TCoord x, TCoord y)
+{
+  TFPath *path = new TFPath();
+  path->addPoint(x, y);
+  path->addPoint(x+10, y);
+  path->addPoint(x+20, y+10);
+  path->addPoint(x+20, y+20);
+  path->corner.assign(2, 0);
+  return path;
+}
+
+TEST(FPath, CompactPoints)
+{
+  TFPath *path0 = makePath(10, 20);
+  TFPath *path1 = makePath(30, 40);
+  ASSERT_EQ(true, path0->compact());
+  ASSERT_EQ(true, path1->compact());
+  ASSERT_EQ(4, path0->pointCount());
+
+  // the decoded points of two paths don't share a buffer
+  TPolygon buffer0, buffer1;
+  const TPolygon &points0 = path0->points(buffer0);
+  const TPolygon &points1 = path1->points(buffer1);
+  ASSERT_EQ(TPoint(10, 20), points0[0]);
+  ASSERT_EQ(TPoint(30, 40), points1[0]);
+  ASSERT_EQ(TPoint(30, 40), points0[3]);
+  ASSERT_EQ(TPoint(50, 60), points1[3]);
+  ASSERT_EQ(true, path0->isCompact());
+
+  // reading single points and the bounds doesn't expand the path
+  TFPath *path2 = makePath(30, 40);
+  ASSERT_EQ(TPoint(50, 60), path1->point(3));
+  ASSERT_EQ(path2->bounds(), path1->bounds());
+  ASSERT_EQ(path2->editBounds(), path1->editBounds());
+  ASSERT_EQ(true, path1->isCompact());
+  delete path2;
+
+  // modifying it does
+  TPolygon &polygon = path0->getPolygon();
+  ASSERT_EQ(false, path0->isCompact());
+  ASSERT_EQ(&polygon, &path0->points(buffer0));
+  ASSERT_EQ(TPoint(30, 40), polygon[3]);
+
+  delete path0;
+  delete path1;
+}
+
+// groups of paths restored on several threads at once get ids of their own
+// and can be found by them
+TEST(FPath, RestoreParallel)
+{
+  toad::getDefaultStore().registerObject(new TFigureModel());
+  toad::getDefaultStore().registerObject(new TFGroup());
+  toad::getDefaultStore().registerObject(new TFPath());
+
+  TFigureModel m0;
+  for(unsigned i=0; i<16; ++i) {
+    TFGroup *group = new TFGroup();
+    for(unsigned j=0; j<100; ++j)
+      group->gadgets.add(makePath(i, j));
+    m0.add(group);
+  }
+
+  std::ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&m0);
+  os.close();
+
+  TLazyLoader loader;
+  TSerializable *s = loader.restore(out.str(), "toad::TFGroup", [&](TSerializable *placeholder, TSerializable *obj) {
+    TFigureModel *m = static_cast<TFigureModel*>(loader.obj);
+    *std::find(m->begin(), m->end(), placeholder) = static_cast<TFigure*>(obj);
+    delete placeholder;
+  });
+  TFigureModel *m1 = dynamic_cast<TFigureModel*>(s);
+  ASSERT_NE(nullptr, m1) << loader.getErrorText();
+  ASSERT_EQ(16, loader.getPending());
+  ASSERT_TRUE(loader.loadAll(4)) << loader.getErrorText();
+  ASSERT_EQ(0, loader.getPending());
+
+  ASSERT_EQ(16, m1->size());
+  std::set<unsigned> ids;
+  TPolygon buffer;
+  for(unsigned i=0; i<16; ++i) {
+    TFGroup *group = dynamic_cast<TFGroup*>((*m1)[i]);
+    ASSERT_NE(nullptr, group);
+    ASSERT_TRUE(ids.insert(group->getId()).second);
+    ASSERT_EQ(group, TFigureIds::get(group->getId()));
+    ASSERT_EQ(100, group->gadgets.size());
+    for(unsigned j=0; j<100; ++j) {
+      TFPath *path = dynamic_cast<TFPath*>(group->gadgets[j]);
+      ASSERT_NE(nullptr, path);
+      ASSERT_TRUE(ids.insert(path->getId()).second);
+      ASSERT_EQ(path, TFigureIds::get(path->getId()));
+      ASSERT_EQ(TPoint(i, j), path->points(buffer)[0]);
+    }
+  }
+  delete s;
+}
+
+} // namespace
@@ -0,0 +1,43 @@
+#include "handpath.hh"
+
+#include <fstream>
+
+using namespace toad;
+
+const vector<const char*> handpathFiles = {
+  "backup-glitch006.txt",
+  "backup-glitch007.txt",
+  "backup-glitch008.txt",
+  "backup-glitch009.txt",
+  "backup-glitch010.txt",
+  "backup-hang004-glitch.txt",
+  "backup-hang005.txt",
+  "backup-overlap-glitch001.txt"
+};
+
+vector<TFreehandPoint>
+loadHandpath(const string &filename)
+{
+  ifstream in(filename);
+  vector<TFreehandPoint> handpath;
+  TCoord x, y, r, p;
+  while(in >> x >> y >> r >> p)
+    handpath.push_back(TFreehandPoint(x, y, r, p));
+  return handpath;
+}
+
+// the recording without rotation and repeated positions, along with the
+// pressure of each point
+TPolygon
+loadHandpathPolygon(const string &filename, vector<TCoord> *pressure)
+{
+  TPolygon polygon;
+  for(auto &&p: loadHandpath(filename)) {
+    if (polygon.empty() || polygon.back()!=p) {
+      polygon.addPoint(p);
+      if (pressure)
+        pressure->push_back(p.pressure);
+    }
+  }
+  return polygon;
+}
@@ -0,0 +1,9 @@
+#include <toad/stroke.hh>
+#include <vector>
+#include <string>
+
+// the tablet recordings in the top directory
+extern const std::vector<const char*> handpathFiles;
+
+std::vector<toad::TFreehandPoint> loadHandpath(const std::string &filename);
+toad::TPolygon loadHandpathPolygon(const std::string &filename, std::vector<toad::TCoord> *pressure=nullptr);
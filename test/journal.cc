@@ -0,0 +1,336 @@
+#include <toad/fischland/journal.hh>
+#include <toad/fischland/page.hh>
+#include <toad/figure.hh>
+#include "gtest.h"
+
+#include <toad/core.hh>
+#include <algorithm>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace toad;
+using namespace fischland;
+
+namespace {
+
+class Journal:
+  public ::testing::Test
+{
+  protected:
+    static void SetUpTestCase() {
+      toad::initialize(0, NULL);
+      toad::getDefaultStore().registerObject(new TDocument());
+      toad::getDefaultStore().registerObject(new TSlide());
+      toad::getDefaultStore().registerObject(new TLayer());
+      toad::getDefaultStore().registerObject(new TJournalEntry());
+      toad::getDefaultStore().registerObject(new TJournalSplice());
+    }
+
+    static void TearDownTestCase() {
+      toad::terminate();
+    }
+
+    void SetUp() override {
+      filename = "/tmp/journal-test-" + to_string(getpid()) + ".fish";
+    }
+
+    void TearDown() override {
+      unlink((filename + ".journal").c_str());
+    }
+
+    string filename;
+};
+
+// the figures are rectangles told apart by their x
+void
+fill(TFigureModel *model, const vector<TCoord> &xs)
+{
+  for(auto x: xs)
+    model->add(new TFRectangle(x, 0, 5, 5));
+}
+
+vector<TCoord>
+xs(const TFigureModel &model)
+{
+  vector<TCoord> result;
+  for(auto &&figure: model)
+    result.push_back(figure->bounds().origin.x);
+  return result;
+}
+
+// diff 'model' with the figures it had 'before', of which 'copy' has
+// copies, and apply the splices to 'copy' after storing and restoring them
+// like the journal does
+void
+roundTrip(const vector<TFigure*> &before, const TFigureModel &model,
+          const TFigureSet &dirty, TFigureModel *copy)
+{
+  TJournalEntry entry;
+  ASSERT_TRUE(TJournalSplice::diff(before, model, dirty, "0:0", {}, &entry.splices));
+  ostringstream out;
+  {
+    TOutObjectStream os(&out);
+    os.store(&entry);
+  }
+  for(auto &&splice: entry.splices)
+    delete splice;
+
+  istringstream in(out.str());
+  TInObjectStream is(&in);
+  TSerializable *s = is.restore();
+  TJournalEntry *restored = dynamic_cast<TJournalEntry*>(s);
+  ASSERT_NE(nullptr, restored) << is.getErrorText();
+  ostringstream err;
+  for(auto &&splice: restored->splices) {
+    EXPECT_TRUE(splice->apply(copy, err)) << err.str();
+    delete splice;
+  }
+  delete s;
+  EXPECT_EQ(xs(model), xs(*copy));
+}
+
+TEST_F(Journal, Insert)
+{
+  TFigureModel model, copy;
+  fill(&model, { 0, 10, 20 });
+  fill(&copy, { 0, 10, 20 });
+  vector<TFigure*> before(model.begin(), model.end());
+  model.insert(model.begin() + 1, new TFRectangle(5, 0, 5, 5));
+  model.add(new TFRectangle(30, 0, 5, 5));
+
+  // one splice for each run of new figures, the last one first
+  vector<TJournalSplice*> splices;
+  ASSERT_TRUE(TJournalSplice::diff(before, model, TFigureSet(), "0:0", {}, &splices));
+  ASSERT_EQ(2, splices.size());
+  ASSERT_EQ(3, splices[0]->at);
+  ASSERT_EQ(0, splices[0]->erase);
+  ASSERT_EQ(1, splices[1]->at);
+  ASSERT_EQ(0, splices[1]->erase);
+  ASSERT_EQ(vector<TFigure*>({ model[1] }), splices[1]->figures);
+  for(auto &&splice: splices)
+    delete splice;
+
+  roundTrip(before, model, TFigureSet(), &copy);
+}
+
+TEST_F(Journal, Erase)
+{
+  TFigureModel model, copy;
+  fill(&model, { 0, 10, 20, 30, 40 });
+  fill(&copy, { 0, 10, 20, 30, 40 });
+  vector<TFigure*> before(model.begin(), model.end());
+  model.erase(model.begin() + 3);
+  model.erase(model.begin());
+  ASSERT_EQ(vector<TCoord>({ 10, 20, 40 }), xs(model));
+  roundTrip(before, model, TFigureSet(), &copy);
+}
+
+TEST_F(Journal, Reorder)
+{
+  TFigureModel model, copy;
+  fill(&model, { 0, 10, 20, 30, 40 });
+  fill(&copy, { 0, 10, 20, 30, 40 });
+  vector<TFigure*> before(model.begin(), model.end());
+  // move the first figure to the top and swap two others
+  rotate(model.begin(), model.begin() + 1, model.end());
+  swap(model.begin()[1], model.begin()[2]);
+  ASSERT_EQ(vector<TCoord>({ 10, 30, 20, 40, 0 }), xs(model));
+  roundTrip(before, model, TFigureSet(), &copy);
+}
+
+TEST_F(Journal, Modify)
+{
+  TFigureModel model, copy;
+  fill(&model, { 0, 10, 20 });
+  fill(&copy, { 0, 10, 20 });
+  vector<TFigure*> before(model.begin(), model.end());
+  // a figure modified in place is in the same position, only 'dirty'
+  // tells about it
+  TFigureSet dirty;
+  dirty.insert(model[1]);
+  model.translate(&dirty, TPoint(100, 0));
+  dirty.clear();
+  dirty.insert(model[1]);
+  ASSERT_EQ(vector<TCoord>({ 0, 110, 20 }), xs(model));
+  roundTrip(before, model, dirty, &copy);
+}
+
+TEST_F(Journal, ApplyOutOfRange)
+{
+  TFigureModel model;
+  fill(&model, { 0, 10 });
+  TJournalSplice splice;
+  splice.layer = "0:0";
+  splice.at = 1;
+  splice.erase = 2;
+  ostringstream err;
+  ASSERT_FALSE(splice.apply(&model, err));
+  ASSERT_FALSE(err.str().empty());
+  ASSERT_EQ(vector<TCoord>({ 0, 10 }), xs(model));
+}
+
+// a document with one slide with one layer
+TDocument*
+makeDocument(const vector<TCoord> &figures)
+{
+  TDocument *document = new TDocument();
+  TSlide *slide = new TSlide();
+  TLayer *layer = new TLayer();
+  fill(&layer->content, figures);
+  slide->content.setRoot(layer);
+  document->content.setRoot(slide);
+  return document;
+}
+
+TFigureModel&
+figuresOf(TDocument *document)
+{
+  return document->content.getRoot()->content.getRoot()->content;
+}
+
+string
+storeDocument(TDocument *document)
+{
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(document);
+  os.close();
+  return out.str();
+}
+
+size_t
+fileSize(const string &filename)
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st)!=0)
+    return 0;
+  return st.st_size;
+}
+
+vector<TCoord>
+range(TCoord n)
+{
+  vector<TCoord> result;
+  for(TCoord x=0; x<n; ++x)
+    result.push_back(x * 10);
+  return result;
+}
+
+// the document as it was saved, along with a saved and an autosaved entry
+TEST_F(Journal, Replay)
+{
+  TDocument *d0 = makeDocument(range(20));
+  string text = storeDocument(d0);
+  TJournal j0(d0);
+  j0.snapshot(filename, text);
+
+  figuresOf(d0).add(new TFRectangle(1000, 0, 5, 5));
+  ASSERT_TRUE(j0.isChanged());
+  ASSERT_TRUE(j0.append(true)) << j0.getErrorText();
+  size_t saved = fileSize(filename + ".journal");
+  ASSERT_LT(0, saved);
+  vector<TCoord> savedFigures = xs(figuresOf(d0));
+
+  figuresOf(d0).erase(figuresOf(d0).begin() + 3);
+  ASSERT_TRUE(j0.append(false)) << j0.getErrorText();
+  ASSERT_LT(saved, fileSize(filename + ".journal"));
+
+  // recover the autosaved changes
+  TDocument *d1 = TDocument::restoreLazy(text);
+  ASSERT_NE(nullptr, d1);
+  TJournal j1(d1);
+  ASSERT_TRUE(j1.read(filename, text)) << j1.getErrorText();
+  ASSERT_EQ(1, j1.getUnsaved());
+  ASSERT_TRUE(j1.replay(true)) << j1.getErrorText();
+  ASSERT_EQ(xs(figuresOf(d0)), xs(figuresOf(d1)));
+
+  // leave them out, which truncates the journal to the saved entry
+  TDocument *d2 = TDocument::restoreLazy(text);
+  ASSERT_NE(nullptr, d2);
+  TJournal j2(d2);
+  ASSERT_TRUE(j2.read(filename, text)) << j2.getErrorText();
+  ASSERT_TRUE(j2.replay(false)) << j2.getErrorText();
+  ASSERT_EQ(savedFigures, xs(figuresOf(d2)));
+  ASSERT_EQ(saved, fileSize(filename + ".journal"));
+
+  // a journal of another version of the file is ignored
+  TDocument *d3 = TDocument::restoreLazy(text);
+  ASSERT_NE(nullptr, d3);
+  TJournal j3(d3);
+  ASSERT_TRUE(j3.read(filename, text + " "));
+  ASSERT_EQ(0, j3.getUnsaved());
+  ASSERT_TRUE(j3.replay(true));
+  ASSERT_TRUE(d3->loadAll());
+  ASSERT_EQ(range(20), xs(figuresOf(d3)));
+
+  delete d0;
+  delete d1;
+  delete d2;
+  delete d3;
+}
+
+// an entry cut off by a crash while it was written is left out
+TEST_F(Journal, Truncated)
+{
+  TDocument *d0 = makeDocument(range(20));
+  string text = storeDocument(d0);
+  TJournal j0(d0);
+  j0.snapshot(filename, text);
+
+  figuresOf(d0).add(new TFRectangle(1000, 0, 5, 5));
+  ASSERT_TRUE(j0.append(true)) << j0.getErrorText();
+  size_t saved = fileSize(filename + ".journal");
+  vector<TCoord> savedFigures = xs(figuresOf(d0));
+
+  figuresOf(d0).add(new TFRectangle(2000, 0, 5, 5));
+  ASSERT_TRUE(j0.append(false)) << j0.getErrorText();
+  truncate((filename + ".journal").c_str(), fileSize(filename + ".journal") - 5);
+
+  TDocument *d1 = TDocument::restoreLazy(text);
+  ASSERT_NE(nullptr, d1);
+  TJournal j1(d1);
+  ASSERT_TRUE(j1.read(filename, text)) << j1.getErrorText();
+  ASSERT_EQ(0, j1.getUnsaved());
+  ASSERT_TRUE(j1.replay(true)) << j1.getErrorText();
+  ASSERT_EQ(savedFigures, xs(figuresOf(d1)));
+  // the rest of the entry is gone, so the next one follows the last
+  ASSERT_EQ(saved, fileSize(filename + ".journal"));
+
+  delete d0;
+  delete d1;
+}
+
+// closing a document without saving it drops the autosaved entries
+TEST_F(Journal, Discard)
+{
+  TDocument *d0 = makeDocument(range(20));
+  string text = storeDocument(d0);
+  TJournal j0(d0);
+  j0.snapshot(filename, text);
+
+  figuresOf(d0).add(new TFRectangle(1000, 0, 5, 5));
+  ASSERT_TRUE(j0.append(true)) << j0.getErrorText();
+  size_t saved = fileSize(filename + ".journal");
+  figuresOf(d0).add(new TFRectangle(2000, 0, 5, 5));
+  ASSERT_TRUE(j0.append(false)) << j0.getErrorText();
+  ASSERT_LT(saved, fileSize(filename + ".journal"));
+  j0.discard();
+  ASSERT_EQ(saved, fileSize(filename + ".journal"));
+  ASSERT_TRUE(j0.getFilename().empty());
+  ASSERT_FALSE(j0.append(true));
+
+  // without a saved entry the journal is removed
+  TJournal j1(d0);
+  j1.snapshot(filename, text);
+  ASSERT_EQ(0, fileSize(filename + ".journal"));
+  figuresOf(d0).add(new TFRectangle(3000, 0, 5, 5));
+  ASSERT_TRUE(j1.append(false)) << j1.getErrorText();
+  ASSERT_LT(0, fileSize(filename + ".journal"));
+  j1.discard();
+  ASSERT_NE(0, access((filename + ".journal").c_str(), F_OK));
+
+  delete d0;
+}
+
+} // namespace
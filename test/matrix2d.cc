@@ -0,0 +1,113 @@
+#include <toad/matrix2d.hh>
+#include <toad/types.hh>
+#include <toad/vector.hh>
+
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+vector<TPoint>
+samples(size_t n)
+{
+  vector<TPoint> points;
+  for(size_t i=0; i<n; ++i)
+    points.push_back(TPoint(i*1.5 - 7.0, 3.0 - i*i*0.25));
+  return points;
+}
+
+} // namespace
+
+// the batch map() must do the same as the one for a single point, for all
+// kinds of matrices and for counts which don't fit the SIMD registers
+TEST(Matrix2D, MapBatch) {
+  TMatrix2D translate, scale, rotate;
+  translate.translate(10, -20);
+  scale.translate(10, -20);
+  scale.scale(2, 0.5);
+  rotate.translate(5, 5);
+  rotate.rotate(M_PI/6);
+
+  for(auto &&m: { TMatrix2D(), translate, scale, rotate }) {
+    for(size_t n=0; n<10; ++n) {
+      SCOPED_TRACE(n);
+      vector<TPoint> in = samples(n), out(n), inplace = in;
+      m.map(in.data(), out.data(), n);
+      m.map(inplace.data(), inplace.data(), n);
+      for(size_t i=0; i<n; ++i) {
+        TPoint expect;
+        m.map(in[i], &expect);
+        ASSERT_NEAR(expect.x, out[i].x, 1e-9);
+        ASSERT_NEAR(expect.y, out[i].y, 1e-9);
+        ASSERT_EQ(out[i], inplace[i]);
+      }
+    }
+  }
+}
+
+TEST(Matrix2D, TransformPolygon) {
+  TPolygon polygon;
+  polygon.addPoint(0, 0);
+  polygon.addPoint(10, 0);
+  polygon.addPoint(10, 20);
+
+  TMatrix2D m;
+  m.translate(5, 5);
+  m.scale(2, 3);
+  polygon.transform(m);
+
+  ASSERT_EQ(TPoint(5, 5), polygon[0]);
+  ASSERT_EQ(TPoint(25, 5), polygon[1]);
+  ASSERT_EQ(TPoint(25, 65), polygon[2]);
+
+  TRectangle r;
+  ASSERT_TRUE(polygon.getShape(&r));
+  ASSERT_EQ(TRectangle(5, 5, 20, 60), r);
+}
+
+TEST(Boundary, ExpandBatch) {
+  for(size_t n=1; n<10; ++n) {
+    SCOPED_TRACE(n);
+    vector<TPoint> points = samples(n);
+    TBoundary expect, b;
+    for(auto &&p: points)
+      expect.expand(p);
+    b.expand(points.data(), points.size());
+    ASSERT_FALSE(b.empty);
+    ASSERT_EQ(expect.p0, b.p0);
+    ASSERT_EQ(expect.p1, b.p1);
+
+    // expanding an existing boundary keeps it
+    TBoundary c(-100, -100, -99, -99);
+    c.expand(points.data(), points.size());
+    ASSERT_EQ(TPoint(-100, -100), c.p0);
+    ASSERT_EQ(expect.p1, c.p1);
+  }
+
+  TBoundary b;
+  b.expand(nullptr, 0);
+  ASSERT_TRUE(b.empty);
+}
+
+// bounds() passes the points between the curves to the batch expand()
+TEST(VectorPath, Bounds) {
+  TVectorPath path;
+  path.move(0, 0);
+  path.curve(10, -10, 20, -10, 30, 0);
+  path.line(30, 5);
+  path.close();
+  path.move(-5, 2);
+  path.line(1, 8);
+  path.close();
+  path.move(2, 2);
+  path.curve(2, 2, 2, 2, 2, 2);
+
+  ASSERT_EQ(1, sizeof(TVectorPath::EType));
+  TBoundary b = path.bounds();
+  ASSERT_FALSE(b.empty);
+  ASSERT_NEAR(-5.0, b.p0.x, 1e-9);
+  ASSERT_NEAR(-7.5, b.p0.y, 1e-9);
+  ASSERT_NEAR(30.0, b.p1.x, 1e-9);
+  ASSERT_NEAR( 8.0, b.p1.y, 1e-9);
+}
@@ -0,0 +1,251 @@
+#include <toad/offset.hh>
+#include <toad/geometry.hh>
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+// the contours of a path with the curves flattened
+vector<vector<TPoint>>
+flatten(const TVectorPath &path)
+{
+  vector<vector<TPoint>> out;
+  const TPoint *pt = path.points.data();
+  for(auto t: path.type) {
+    switch(t) {
+      case TVectorPath::MOVE:
+        out.push_back(vector<TPoint>());
+        out.back().push_back(*pt++);
+        break;
+      case TVectorPath::LINE:
+        out.back().push_back(*pt++);
+        break;
+      case TVectorPath::CURVE:
+        flattenCurve(pt-1, 0.01, &out.back());
+        pt += 3;
+        break;
+      case TVectorPath::CLOSE:
+        out.back().push_back(out.back().front());
+        break;
+    }
+  }
+  return out;
+}
+
+// how often the contours, which are all closed, wind around p
+int
+winding(const vector<vector<TPoint>> &contours, const TPoint &p)
+{
+  int w = 0;
+  for(auto &&c: contours) {
+    for(size_t i=0; i<c.size(); ++i) {
+      const TPoint &a = c[i], &b = c[(i+1) % c.size()];
+      TCoord side = (b.x-a.x)*(p.y-a.y) - (p.x-a.x)*(b.y-a.y);
+      if (a.y<=p.y) {
+        if (b.y>p.y && side>0)
+          ++w;
+      } else {
+        if (b.y<=p.y && side<0)
+          --w;
+      }
+    }
+  }
+  return w;
+}
+
+TCoord
+distanceToLine(const TPoint &p, const TPoint &a, const TPoint &b)
+{
+  TPoint ab = b - a;
+  TCoord l = dot(ab, ab);
+  TCoord u = l>0.0 ? std::max(0.0, std::min(1.0, dot(p - a, ab) / l)) : 0.0;
+  return distance(p, a + ab * u);
+}
+
+TCoord
+distanceToLines(const vector<vector<TPoint>> &lines, const TPoint &p)
+{
+  TCoord min = 1.0/0.0;
+  for(auto &&l: lines) {
+    if (l.size()==1)
+      min = std::min(min, distance(p, l[0]));
+    for(size_t i=0; i+1<l.size(); ++i)
+      min = std::min(min, distanceToLine(p, l[i], l[i+1]));
+  }
+  return min;
+}
+
+// with round joins and caps the outline covers exactly what is nearer to
+// the path than half the width, which is checked on a grid except for a
+// band along the border
+void
+expectCoverage(const TVectorPath &path, TCoord width)
+{
+  TPathOffset offset(width);
+  TVectorPath outline;
+  offset.outline(path, &outline);
+  vector<vector<TPoint>> contours = flatten(outline), center = flatten(path);
+
+  TBoundary b = path.bounds();
+  TCoord band = 2.0 * offset.tolerance;
+  size_t inside = 0;
+  for(TCoord y=b.p0.y-width; y<=b.p1.y+width; y+=0.7) {
+    for(TCoord x=b.p0.x-width; x<=b.p1.x+width; x+=0.7) {
+      TPoint p(x, y);
+      TCoord d = distanceToLines(center, p) - width/2;
+      if (fabs(d)<band)
+        continue;
+      int w = winding(contours, p);
+      bool filled = w!=0;
+      ASSERT_EQ(d<0, filled) << "at " << p << ", " << d << " from the border, winding " << w;
+      if (filled)
+        ++inside;
+    }
+  }
+  ASSERT_LT(0, inside);
+}
+
+void
+expectBounds(const TVectorPath &path, TCoord x0, TCoord y0, TCoord x1, TCoord y1)
+{
+  TBoundary b = path.bounds();
+  ASSERT_NEAR(x0, b.p0.x, 1e-9);
+  ASSERT_NEAR(y0, b.p0.y, 1e-9);
+  ASSERT_NEAR(x1, b.p1.x, 1e-9);
+  ASSERT_NEAR(y1, b.p1.y, 1e-9);
+}
+
+vector<TVectorPath>
+samplePaths()
+{
+  vector<TVectorPath> paths(5);
+  // a zigzag with sharp and flat turns
+  paths[0].move(0, 0);
+  paths[0].line(40, 5);
+  paths[0].line(10, 20);
+  paths[0].line(60, 30);
+  paths[0].line(61, 60);
+  // a curve bending tighter than the width and one with a loop
+  paths[1].move(0, 0);
+  paths[1].curve(60, 0, 60, 10, 0, 10);
+  paths[1].curve(50, 40, 0, 60, 40, 30);
+  // a closed curve with corners
+  paths[2].move(10, 10);
+  paths[2].curve(40, -10, 60, 30, 50, 50);
+  paths[2].line(0, 40);
+  paths[2].close();
+  // curves meeting smoothly, like those from fitPath()
+  paths[3].move(0, 0);
+  paths[3].curve(10, 10, 20, 10, 30, 0);
+  paths[3].curve(40, -10, 50, -10, 60, 0);
+  // two subpaths and a dot
+  paths[4].move(0, 0);
+  paths[4].line(30, 0);
+  paths[4].move(15, -10);
+  paths[4].line(15, 10);
+  paths[4].move(40, 10);
+  return paths;
+}
+
+} // namespace
+
+TEST(PathOffset, Line) {
+  TVectorPath path;
+  path.move(0, 0);
+  path.line(100, 0);
+
+  TPathOffset offset(10, TPathOffset::MITER_JOIN, TPathOffset::BUTT_CAP);
+  TVectorPath outline;
+  offset.outline(path, &outline);
+
+  TVectorPath expect;
+  expect.move(0, 5);
+  expect.line(100, 5);
+  expect.line(100, -5);
+  expect.line(0, -5);
+  expect.line(0, 5);
+  expect.close();
+  ASSERT_EQ(expect, outline);
+}
+
+TEST(PathOffset, Coverage) {
+  for(auto &&path: samplePaths()) {
+    SCOPED_TRACE(::testing::Message() << path);
+    for(TCoord width: {4.0, 12.0, 30.0}) {
+      SCOPED_TRACE(width);
+      expectCoverage(path, width);
+    }
+  }
+}
+
+TEST(PathOffset, Joins) {
+  TVectorPath path;
+  path.move(0, 0);
+  path.line(100, 0);
+  path.line(100, 100);
+
+  TPathOffset offset(20, TPathOffset::MITER_JOIN, TPathOffset::BUTT_CAP);
+  TVectorPath outline;
+  auto covers = [&](TCoord x, TCoord y) {
+    offset.outline(path, &outline);
+    return winding(flatten(outline), TPoint(x, y)) != 0;
+  };
+
+  // the miter ends at (110, -10)
+  ASSERT_TRUE(covers(108, -8));
+  ASSERT_FALSE(covers(111, -5));
+  // the miter is sqrt(2) times the width
+  offset.miterLimit = 1.4;
+  ASSERT_FALSE(covers(108, -8));
+  ASSERT_TRUE(covers(104, -4));
+
+  offset.join = TPathOffset::BEVEL_JOIN;
+  ASSERT_FALSE(covers(108, -5));
+  ASSERT_TRUE(covers(104, -4));
+
+  offset.join = TPathOffset::ROUND_JOIN;
+  ASSERT_TRUE(covers(108, -5));
+  ASSERT_FALSE(covers(108, -8));
+}
+
+TEST(PathOffset, Pressure) {
+  TVectorPath path;
+  path.move(0, 0);
+  path.line(100, 0);
+  vector<TCoord> pressure = { 0.5, 1.0 };
+
+  TPathOffset offset(20, TPathOffset::ROUND_JOIN, TPathOffset::BUTT_CAP);
+  TVectorPath outline;
+  offset.outline(path, &outline, &pressure);
+  vector<vector<TPoint>> contours = flatten(outline);
+
+  ASSERT_NE(0, winding(contours, TPoint(1, 4.5)));
+  ASSERT_EQ(0, winding(contours, TPoint(1, 5.5)));
+  ASSERT_NE(0, winding(contours, TPoint(99, -9.5)));
+  ASSERT_EQ(0, winding(contours, TPoint(101, 0)));
+}
+
+TEST(PathOffset, Offset) {
+  TVectorPath square, reverse;
+  square.move(0, 0);
+  square.line(100, 0);
+  square.line(100, 100);
+  square.line(0, 100);
+  square.close();
+  reverse.move(0, 0);
+  reverse.line(0, 100);
+  reverse.line(100, 100);
+  reverse.line(100, 0);
+  reverse.close();
+
+  TPathOffset offset(1, TPathOffset::MITER_JOIN);
+  for(auto &&path: { square, reverse }) {
+    TVectorPath out;
+    offset.offset(path, 10, &out);
+    expectBounds(out, -10, -10, 110, 110);
+    // the loops at the inner corners reach back to the square's corners
+    offset.offset(path, -10, &out);
+    expectBounds(out, 0, 0, 100, 100);
+  }
+}
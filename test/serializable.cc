@@ -1,6 +1,8 @@
 #include <toad/io/serializable.hh>
 #include <toad/types.hh>
 #include <sstream>
+#include <limits>
+#include <clocale>
 #include "gtest.h"
 
 using namespace std;
@@ -138,6 +140,84 @@ TEST(Serializeable, ReservedAttributeId)
   os.close();
 }
 
+struct TestShared: public TSerializable {
+  typedef TSerializable super;
+  string name;
+  TestPointer *shared;
+  SERIALIZABLE_INTERFACE(, TestShared);
+};
+
+void TestShared::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  ::store(out, "name", name);
+  ::storeShared(out, "shared", shared);
+}
+
+bool
+TestShared::restore(TInObjectStream &in)
+{
+  if (
+    super::restore(in) ||
+    ::restore(in, "name", &name) ||
+    ::restoreShared(in, "shared", &shared)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+TEST(Serializeable, Shared) {
+  TestPointer p;
+  p.name     = "Wirsing";
+  p.x        = 10;
+  p.y        = 20;
+  p.relation = nullptr;
+
+  TestShared a0, a1, a2;
+  a0.name = "a0";
+  a1.name = "a1";
+  a2.name = "a2";
+  a0.shared = a1.shared = a2.shared = &p;
+
+  toad::getDefaultStore().registerObject(new TestPointer());
+  toad::getDefaultStore().registerObject(new TestShared());
+
+  // write
+  ostringstream out;
+  TOutObjectStream os(&out);
+  EXPECT_NO_THROW({os.store(&a0);});
+  EXPECT_NO_THROW({os.store(&a1);});
+  EXPECT_NO_THROW({os.store(&a2);});
+  os.close();
+
+  // the shared object is written only once
+  string s = out.str();
+  size_t first = s.find("TestPointer");
+  ASSERT_NE(string::npos, first);
+  ASSERT_EQ(string::npos, s.find("TestPointer", first+1));
+
+  // read
+  istringstream in(s);
+  TInObjectStream is(&in);
+
+  vector<TestShared*> c;
+  TSerializable *obj;
+  while( (obj = is.restore()) ) {
+    TestShared *a = dynamic_cast<TestShared*>(obj);
+    if (a)
+      c.push_back(a);
+  }
+  EXPECT_NO_THROW({is.close();});
+
+  ASSERT_EQ(3, c.size());
+  ASSERT_EQ("a2", c[2]->name);
+  ASSERT_NE(nullptr, c[0]->shared);
+  ASSERT_EQ(c[0]->shared, c[1]->shared);
+  ASSERT_EQ(c[0]->shared, c[2]->shared);
+  ASSERT_EQ("Wirsing", c[0]->shared->name);
+  ASSERT_EQ(20, c[0]->shared->y);
+}
+
 // check store/restore of vector<TPoint>
 // o store derivates from the atv format a bit and writes { x0 y0 x1 y1 ... }
 //   to save space.
@@ -296,3 +376,498 @@ TEST(Serializeable, List) {
   
 //  c[0]->print();
 }
+
+// numbers are written locale independent and restored exactly
+struct TestNumbers: public TSerializable {
+  typedef TSerializable super;
+  double d;
+  float f;
+  vector<TPoint> p;
+  
+  SERIALIZABLE_INTERFACE(, TestNumbers);
+};
+
+void TestNumbers::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  ::store(out, "d", d);
+  ::store(out, "f", f);
+  ::store(out, "p", p);
+}
+
+bool
+TestNumbers::restore(TInObjectStream &in)
+{
+  if (
+    super::restore(in) ||
+    ::restore(in, "d", &d) ||
+    ::restore(in, "f", &f) ||
+    ::restore(in, "p", &p)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+TEST(Serializeable, Numbers) {
+  const double values[] = {
+    0.0, -0.0, 1.0, -2.5, 0.1, 1.0/3.0, 3.1415926535897931, 1e-300, 4.9e-324,
+    123456789.12345678, 1e22, numeric_limits<double>::max()
+  };
+  char buffer[64];
+  for(double v: values) {
+    char *end = formatNumber(buffer, buffer+sizeof(buffer), v);
+    ASSERT_NE(nullptr, end);
+    double d;
+    ASSERT_TRUE(parseNumber(buffer, end, &d)) << string(buffer, end);
+    ASSERT_EQ(v, d) << string(buffer, end);
+
+    float f = v, g;
+    end = formatNumber(buffer, buffer+sizeof(buffer), f);
+    ASSERT_TRUE(parseNumber(buffer, end, &g)) << string(buffer, end);
+    ASSERT_EQ(f, g) << string(buffer, end);
+  }
+
+  // the shortest form which restores the value
+  char *end = formatNumber(buffer, buffer+sizeof(buffer), 0.1);
+  ASSERT_EQ("0.1", string(buffer, end));
+  end = formatNumber(buffer, buffer+sizeof(buffer), 0.1f);
+  ASSERT_EQ("0.1", string(buffer, end));
+
+  double d;
+  ASSERT_FALSE(parseNumber("", &d));
+  ASSERT_FALSE(parseNumber("1,5", &d));
+  ASSERT_FALSE(parseNumber("2x", &d));
+}
+
+TEST(Serializeable, NumbersRoundTrip) {
+  toad::getDefaultStore().registerObject(new TestNumbers());
+
+  TestNumbers n0;
+  n0.d = 1.0/3.0;
+  n0.f = 0.7f;
+  n0.p.push_back(TPoint(0.1, -1e-300));
+  n0.p.push_back(TPoint(2.0/3.0, 1e22));
+
+  // the decimal point of the locale must not matter, neither when writing
+  // nor when reading
+  const char *locale = setlocale(LC_NUMERIC, "de_DE.UTF-8");
+  
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&n0);
+  os.close();
+
+  istringstream in(out.str());
+  TInObjectStream is(&in);
+  TSerializable *s = is.restore();
+  is.close();
+
+  if (locale)
+    setlocale(LC_NUMERIC, "C");
+
+  TestNumbers *n1 = dynamic_cast<TestNumbers*>(s);
+  ASSERT_NE(nullptr, n1) << out.str();
+  ASSERT_EQ(n0.d, n1->d);
+  ASSERT_EQ(n0.f, n1->f);
+  ASSERT_EQ(n0.p, n1->p);
+  delete s;
+}
+
+// objects registered with their own type are created by a factory, others
+// by their prototype's clone()
+struct TestPrototype: public TestNumbers {
+  static unsigned clones;
+  TCloneable* clone() const override { ++clones; return new TestPrototype(*this); }
+  const char * getClassName() const override { return "TestPrototype"; }
+};
+unsigned TestPrototype::clones = 0;
+
+TEST(Serializeable, ObjectStore) {
+  TObjectStore store;
+  store.registerObject(new TestList());
+  TestNumbers *prototype = new TestPrototype();
+  store.registerObject(prototype);
+
+  ASSERT_TRUE(store.isRegistered("TestList"));
+  ASSERT_TRUE(store.isRegistered("TestPrototype"));
+  ASSERT_FALSE(store.isRegistered("TestNumbers"));
+
+  for(int i=0; i<3; ++i) {
+    for(auto type: {"TestList", "TestPrototype", "TestPrototype"}) {
+      TSerializable *s = store.clone(type);
+      ASSERT_NE(nullptr, s);
+      ASSERT_STREQ(type, s->getClassName());
+      delete s;
+    }
+  }
+  ASSERT_EQ(6, TestPrototype::clones);
+  ASSERT_EQ(nullptr, store.clone("TestNumbers"));
+
+  // registering a type again replaces the prototype, this time with its
+  // own type
+  store.registerObject(new TestPrototype());
+  TSerializable *p = store.clone("TestPrototype");
+  ASSERT_NE(nullptr, dynamic_cast<TestPrototype*>(p));
+  ASSERT_EQ(6, TestPrototype::clones);
+  delete p;
+
+  istringstream in("TestList { name = \"Kohl\" p = { 1 2 } }");
+  TInObjectStream is(&in, &store);
+  TSerializable *s = is.restore();
+  TestList *l = dynamic_cast<TestList*>(s);
+  ASSERT_NE(nullptr, l);
+  ASSERT_EQ("Kohl", l->name);
+  ASSERT_EQ(1, l->p.size());
+  delete s;
+}
+
+TEST(Serializeable, FindGroups) {
+  string text =
+    "A { x = 1 B { } }\n"
+    "// B { in a comment }\n"
+    "B { name = \"B { in a string }\" B { nested } }\n"
+    "b = \"B\" { /* B { */ }\n"
+    "B{}";
+  vector<TATVGroupRange> groups;
+  ASSERT_TRUE(findGroups(text, "B", &groups));
+  ASSERT_EQ(4, groups.size());
+  ASSERT_EQ("B { }", text.substr(groups[0].begin, groups[0].end - groups[0].begin));
+  ASSERT_EQ("B { name = \"B { in a string }\" B { nested } }", text.substr(groups[1].begin, groups[1].end - groups[1].begin));
+  ASSERT_EQ("\"B\" { /* B { */ }", text.substr(groups[2].begin, groups[2].end - groups[2].begin));
+  ASSERT_EQ("B{}", text.substr(groups[3].begin, groups[3].end - groups[3].begin));
+  ASSERT_EQ('{', text[groups[3].body-1]);
+
+  groups.clear();
+  ASSERT_FALSE(findGroups("B { \"", "B", &groups));
+}
+
+// a document whose items are restored in parallel
+struct TestDocument: public TSerializable {
+  typedef TSerializable super;
+  string name;
+  vector<TSerializable*> items;
+  ~TestDocument() {
+    for(auto &&item: items)
+      delete item;
+  }
+  SERIALIZABLE_INTERFACE(, TestDocument);
+};
+
+void TestDocument::store(TOutObjectStream &out) const
+{
+  super::store(out);
+  ::store(out, "name", name);
+  for(auto &&item: items)
+    out.store(item);
+}
+
+bool
+TestDocument::restore(TInObjectStream &in)
+{
+  if (in.what == ATV_GROUP) {
+    TSerializable *item = in.clone(in.type);
+    if (!item)
+      return false;
+    items.push_back(item);
+    in.setInterpreter(item);
+    return true;
+  }
+  if (
+    super::restore(in) ||
+    ::restore(in, "name", &name)
+  ) return true;
+  ATV_FAILED(in)
+  return false;
+}
+
+TEST(Serializeable, FindReferences) {
+  string text =
+    "A { id = 3 x = 12 p = \"5\" B { id = 4 q = 3 r = null } s = 7 8 }\n"
+    "// t = 9\n"
+    "{ 10 } u = -1 v = 1.5 w = 4";
+  // 's' holds a number which isn't an id
+  set<string, less<>> attributes { "x", "q", "r", "u", "w" };
+  vector<unsigned> ids, refs;
+  ASSERT_TRUE(findReferences(text, 0, text.size(), attributes, &ids, &refs));
+  ASSERT_EQ(vector<unsigned>({ 3, 4 }), ids);
+  ASSERT_EQ(vector<unsigned>({ 12, 3, 4 }), refs);
+
+  ids.clear();
+  refs.clear();
+  ASSERT_TRUE(findReferences(text, text.find("B {"), text.find(" s ="), attributes, &ids, &refs));
+  ASSERT_EQ(vector<unsigned>({ 4 }), ids);
+  ASSERT_EQ(vector<unsigned>({ 3 }), refs);
+}
+
+// a TestPointer which isn't restored lazily
+struct TestRelation: public TestPointer {
+  SERIALIZABLE_INTERFACE(, TestRelation);
+};
+
+void TestRelation::store(TOutObjectStream &out) const
+{
+  TestPointer::store(out);
+}
+
+bool
+TestRelation::restore(TInObjectStream &in)
+{
+  return TestPointer::restore(in);
+}
+
+TEST(Serializeable, LazyLoader) {
+  toad::getDefaultStore().registerObject(new TestDocument());
+  toad::getDefaultStore().registerObject(new TestPointer());
+  toad::getDefaultStore().registerObject(new TestRelation());
+  toad::getDefaultStore().registerReference("relation");
+
+  TestDocument d0;
+  for(unsigned i=0; i<10; ++i) {
+    TestPointer *p = new TestPointer();
+    p->name = "p" + to_string(i);
+    p->x = 1000 + i;
+    p->y = 0;
+    p->relation = nullptr;
+    d0.items.push_back(p);
+  }
+  // 2 and 7 refer to each other, 9 is referred to from outside
+  static_cast<TestPointer*>(d0.items[2])->relation = static_cast<TestPointer*>(d0.items[7]);
+  static_cast<TestPointer*>(d0.items[7])->relation = static_cast<TestPointer*>(d0.items[2]);
+  TestRelation *outside = new TestRelation();
+  outside->name = "outside";
+  outside->relation = static_cast<TestPointer*>(d0.items[9]);
+  d0.items.push_back(outside);
+
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&d0);
+  os.close();
+
+  TLazyLoader loader;
+  vector<TSerializable*> order;
+  TSerializable *s = loader.restore(out.str(), "TestPointer", [&](TSerializable *placeholder, TSerializable *obj) {
+    TestDocument *d = dynamic_cast<TestDocument*>(loader.obj);
+    ASSERT_NE(nullptr, d);
+    auto p = find(d->items.begin(), d->items.end(), placeholder);
+    ASSERT_NE(d->items.end(), p);
+    *p = obj;
+    delete placeholder;
+    order.push_back(obj);
+  });
+  TestDocument *d1 = dynamic_cast<TestDocument*>(s);
+  ASSERT_NE(nullptr, d1) << loader.getErrorText();
+  ASSERT_EQ(11, d1->items.size());
+  ASSERT_EQ(9, loader.getPending());
+  ASSERT_EQ(1, order.size());
+  ASSERT_EQ(d1->items[9], order[0]);
+  ASSERT_EQ(d1->items[9], static_cast<TestPointer*>(d1->items[10])->relation);
+  ASSERT_EQ("p9", static_cast<TestPointer*>(d1->items[9])->name);
+  ASSERT_TRUE(loader.isPending(d1->items[0]));
+  ASSERT_FALSE(loader.isPending(d1->items[9]));
+
+  // loading 7 loads 2 too
+  ASSERT_TRUE(loader.load(d1->items[7]));
+  ASSERT_EQ(7, loader.getPending());
+  ASSERT_EQ(3, order.size());
+  TestPointer *p2 = static_cast<TestPointer*>(d1->items[2]), *p7 = static_cast<TestPointer*>(d1->items[7]);
+  ASSERT_EQ("p2", p2->name);
+  ASSERT_EQ("p7", p7->name);
+  ASSERT_EQ(1007, p7->x);
+  ASSERT_EQ(p7, p2->relation);
+  ASSERT_EQ(p2, p7->relation);
+  ASSERT_TRUE(loader.load(p2));
+
+  ASSERT_TRUE(loader.loadNext());
+  ASSERT_EQ(6, loader.getPending());
+  ASSERT_EQ(d1->items[0], order.back());
+  ASSERT_EQ("p0", static_cast<TestPointer*>(d1->items[0])->name);
+
+  ASSERT_TRUE(loader.loadAll(4));
+  ASSERT_EQ(0, loader.getPending());
+  ASSERT_FALSE(loader.loadNext());
+  ASSERT_EQ(10, order.size());
+  for(unsigned i=0; i<10; ++i) {
+    TestPointer *p = dynamic_cast<TestPointer*>(d1->items[i]);
+    ASSERT_NE(nullptr, p);
+    ASSERT_EQ("p" + to_string(i), p->name);
+    ASSERT_EQ(1000 + i, p->x);
+    if (i!=2 && i!=7)
+      ASSERT_EQ(nullptr, p->relation);
+  }
+  delete s;
+}
+
+// a placeholder deleted before its group was restored, and an object
+// created at its address afterwards
+TEST(Serializeable, LazyLoaderForget) {
+  toad::getDefaultStore().registerObject(new TestDocument());
+  toad::getDefaultStore().registerObject(new TestPointer());
+  toad::getDefaultStore().registerReference("relation");
+
+  TestDocument d0;
+  for(unsigned i=0; i<4; ++i) {
+    TestPointer *p = new TestPointer();
+    p->name = "p" + to_string(i);
+    p->x = p->y = 0;
+    p->relation = nullptr;
+    d0.items.push_back(p);
+  }
+  // 1 and 2 refer to each other
+  static_cast<TestPointer*>(d0.items[1])->relation = static_cast<TestPointer*>(d0.items[2]);
+  static_cast<TestPointer*>(d0.items[2])->relation = static_cast<TestPointer*>(d0.items[1]);
+
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&d0);
+  os.close();
+
+  TLazyLoader loader;
+  TSerializable *s = loader.restore(out.str(), "TestPointer", [&](TSerializable *placeholder, TSerializable *obj) {
+    TestDocument *d = static_cast<TestDocument*>(loader.obj);
+    *find(d->items.begin(), d->items.end(), placeholder) = obj;
+    delete placeholder;
+  });
+  TestDocument *d1 = dynamic_cast<TestDocument*>(s);
+  ASSERT_NE(nullptr, d1) << loader.getErrorText();
+  ASSERT_EQ(4, loader.getPending());
+
+  TSerializable *p0 = d1->items[0];
+  loader.forget(p0);
+  ASSERT_FALSE(loader.isPending(p0));
+  ASSERT_EQ(3, loader.getPending());
+  d1->items[0] = new TestPointer();
+  // whether or not it got the same address, it isn't taken for p0
+  ASSERT_FALSE(loader.isPending(d1->items[0]));
+  delete p0;
+
+  // the pointer into a forgotten group is NULL
+  TSerializable *p1 = d1->items[1];
+  loader.forget(p1);
+  d1->items[1] = nullptr;
+  delete p1;
+  ASSERT_TRUE(loader.loadAll());
+  ASSERT_EQ(0, loader.getPending());
+  TestPointer *p2 = dynamic_cast<TestPointer*>(d1->items[2]);
+  ASSERT_NE(nullptr, p2);
+  ASSERT_EQ("p2", p2->name);
+  ASSERT_EQ(nullptr, p2->relation);
+  ASSERT_EQ("p3", static_cast<TestPointer*>(d1->items[3])->name);
+  delete s;
+}
+
+TEST(Serializeable, LazyLoaderShared) {
+  toad::getDefaultStore().registerObject(new TestDocument());
+  toad::getDefaultStore().registerObject(new TestShared());
+  toad::getDefaultStore().registerReference("shared");
+
+  TestPointer p;
+  p.name = "shared";
+  p.relation = nullptr;
+  TestDocument d0;
+  for(unsigned i=0; i<4; ++i) {
+    TestShared *shared = new TestShared();
+    shared->name = "s" + to_string(i);
+    shared->shared = i<3 ? &p : nullptr;
+    d0.items.push_back(shared);
+  }
+
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&d0);
+  os.close();
+
+  // the 2nd and 3rd item refer to the object restored with the 1st, which
+  // is restored along with them
+  TLazyLoader loader;
+  TSerializable *s = loader.restore(out.str(), "TestShared", [&](TSerializable *placeholder, TSerializable *obj) {
+    TestDocument *d = static_cast<TestDocument*>(loader.obj);
+    *find(d->items.begin(), d->items.end(), placeholder) = obj;
+    delete placeholder;
+  });
+  TestDocument *d1 = dynamic_cast<TestDocument*>(s);
+  ASSERT_NE(nullptr, d1) << loader.getErrorText();
+  ASSERT_EQ(4, loader.getPending());
+  ASSERT_TRUE(loader.load(d1->items[2]));
+  ASSERT_EQ(1, loader.getPending());
+  ASSERT_TRUE(loader.isPending(d1->items[3]));
+  TestPointer *shared = static_cast<TestShared*>(d1->items[0])->shared;
+  ASSERT_NE(nullptr, shared);
+  ASSERT_EQ("shared", shared->name);
+  ASSERT_EQ(shared, static_cast<TestShared*>(d1->items[1])->shared);
+  ASSERT_EQ(shared, static_cast<TestShared*>(d1->items[2])->shared);
+  ASSERT_EQ("s2", static_cast<TestShared*>(d1->items[2])->name);
+  delete shared;
+  delete s;
+}
+
+TEST(Serializeable, LazyLoaderParallel) {
+  toad::getDefaultStore().registerObject(new TestDocument());
+  toad::getDefaultStore().registerObject(new TestPointer());
+  toad::getDefaultStore().registerReference("relation");
+
+  TestDocument d0;
+  d0.name = "TestPointer { }";
+  for(unsigned i=0; i<20; ++i) {
+    TestPointer *p = new TestPointer();
+    p->name = "p" + to_string(i);
+    p->x = i;
+    p->y = 0;
+    p->relation = nullptr;
+    d0.items.push_back(p);
+  }
+  // pairs which refer to each other, and one pointer into the items from
+  // an inner document
+  for(unsigned i=0; i<20; ++i)
+    static_cast<TestPointer*>(d0.items[i])->relation = static_cast<TestPointer*>(d0.items[i^1]);
+  d0.items.push_back(new TestDocument());
+  TestPointer *outside = new TestPointer();
+  outside->name = "outside";
+  outside->relation = static_cast<TestPointer*>(d0.items[5]);
+  static_cast<TestDocument*>(d0.items.back())->items.push_back(outside);
+
+  ostringstream out;
+  TOutObjectStream os(&out);
+  os.store(&d0);
+  os.close();
+
+  TLazyLoader loader;
+  function<TSerializable**(TestDocument*, TSerializable*)> find = [&](TestDocument *d, TSerializable *placeholder) -> TSerializable** {
+    for(auto &&item: d->items) {
+      if (item == placeholder)
+        return &item;
+      TestDocument *inner = dynamic_cast<TestDocument*>(item);
+      TSerializable **p = inner ? find(inner, placeholder) : nullptr;
+      if (p)
+        return p;
+    }
+    return nullptr;
+  };
+  TSerializable *s = loader.restore(out.str(), "TestPointer", [&](TSerializable *placeholder, TSerializable *obj) {
+    TSerializable **p = find(dynamic_cast<TestDocument*>(loader.obj), placeholder);
+    ASSERT_NE(nullptr, p);
+    *p = obj;
+    delete placeholder;
+  });
+  TestDocument *d1 = dynamic_cast<TestDocument*>(s);
+  ASSERT_NE(nullptr, d1) << loader.getErrorText();
+  // the pointer in the inner document is a group too, which is restored
+  // along with the pair of 4 and 5
+  ASSERT_EQ(21, loader.getPending());
+  ASSERT_TRUE(loader.loadAll(4)) << loader.getErrorText();
+  ASSERT_EQ(0, loader.getPending());
+
+  ASSERT_EQ(d0.name, d1->name);
+  ASSERT_EQ(21, d1->items.size());
+  for(unsigned i=0; i<20; ++i) {
+    TestPointer *p = dynamic_cast<TestPointer*>(d1->items[i]);
+    ASSERT_NE(nullptr, p);
+    ASSERT_EQ("p" + to_string(i), p->name);
+    ASSERT_EQ(i, p->x);
+    ASSERT_EQ(d1->items[i^1], p->relation);
+  }
+  TestDocument *inner = dynamic_cast<TestDocument*>(d1->items[20]);
+  ASSERT_NE(nullptr, inner);
+  ASSERT_EQ(1, inner->items.size());
+  ASSERT_EQ(d1->items[5], static_cast<TestPointer*>(inner->items[0])->relation);
+  delete s;
+}
@@ -0,0 +1,103 @@
+#include <toad/geometry.hh>
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+// a·x³ + b·x² + c·x + d
+struct Cubic {
+  TCoord a, b, c, d;
+};
+
+// (x-r0)(x-r1)(x-r2) scaled by s
+Cubic
+fromRoots(TCoord s, TCoord r0, TCoord r1, TCoord r2)
+{
+  return { s, -s*(r0+r1+r2), s*(r0*r1 + r0*r2 + r1*r2), -s*r0*r1*r2 };
+}
+
+void
+solve(const vector<Cubic> &cubics, TCoord min, TCoord max, vector<TCoord> *roots, vector<size_t> *first)
+{
+  vector<TCoord> a, b, c, d;
+  for(auto &&e: cubics) {
+    a.push_back(e.a);
+    b.push_back(e.b);
+    c.push_back(e.c);
+    d.push_back(e.d);
+  }
+  solveCubics(a.data(), b.data(), c.data(), d.data(), cubics.size(), min, max, roots, first);
+}
+
+} // namespace
+
+TEST(SolveCubics, Roots) {
+  vector<Cubic> cubics = {
+    fromRoots(1.0, 0.1, 0.5, 0.9),
+    fromRoots(-2.0, 0.25, 0.25, 0.75),  // double root
+    fromRoots(3.0, 0.5, 0.5, 0.5),      // triple root
+    fromRoots(1.0, -1.0, 0.3, 2.0),     // one in [0, 1]
+    fromRoots(1.0, -1.0, -2.0, 2.0)     // none in [0, 1]
+  };
+  vector<TCoord> roots;
+  vector<size_t> first;
+  solve(cubics, 0.0, 1.0, &roots, &first);
+
+  ASSERT_EQ(cubics.size()+1, first.size());
+  ASSERT_EQ(0, first[0]);
+  ASSERT_EQ(roots.size(), first.back());
+
+  vector<vector<TCoord>> expect = { { 0.1, 0.5, 0.9 }, { 0.25, 0.75 }, { 0.5 }, { 0.3 }, {} };
+  for(size_t i=0; i<cubics.size(); ++i) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(expect[i].size(), first[i+1] - first[i]);
+    for(size_t j=0; j<expect[i].size(); ++j)
+      ASSERT_NEAR(expect[i][j], roots[first[i]+j], 1e-6);
+  }
+}
+
+TEST(SolveCubics, Quadratic) {
+  // with a = 0 this is (x-0.2)(x-0.6) and 2x-1
+  vector<Cubic> cubics = { { 0.0, 1.0, -0.8, 0.12 }, { 0.0, 0.0, 2.0, -1.0 }, { 0.0, 0.0, 0.0, 0.0 } };
+  vector<TCoord> roots;
+  vector<size_t> first;
+  solve(cubics, 0.0, 1.0, &roots, &first);
+
+  ASSERT_EQ(2, first[1] - first[0]);
+  ASSERT_NEAR(0.2, roots[0], 1e-9);
+  ASSERT_NEAR(0.6, roots[1], 1e-9);
+  ASSERT_EQ(1, first[2] - first[1]);
+  ASSERT_NEAR(0.5, roots[2], 1e-9);
+  ASSERT_EQ(first[2], first[3]);
+}
+
+// the batch must give the same results as solveCubic() for all the
+// cases of the case analysis and for counts which don't fit two lanes
+TEST(SolveCubics, SameAsSolveCubic) {
+  vector<Cubic> cubics;
+  for(int i=0; i<41; ++i) {
+    switch(i%4) {
+      case 0: cubics.push_back(fromRoots(1.0 + i, i*0.02, 0.5, 1.0 - i*0.01)); break;
+      case 1: cubics.push_back({ -0.5*i, 0.3*i, 1.0, -0.4 }); break;
+      case 2: cubics.push_back(fromRoots(i*0.1, 0.5 - i*0.01, 0.5 - i*0.01, 2.0)); break;
+      case 3: cubics.push_back({ i*1e-7, 1.0, -1.0 + i*0.01, 0.1 }); break;
+    }
+  }
+  for(size_t n=0; n<=cubics.size(); ++n) {
+    SCOPED_TRACE(n);
+    vector<Cubic> some(cubics.begin(), cubics.begin()+n);
+    vector<TCoord> roots;
+    vector<size_t> first;
+    solve(some, 0.0, 1.0, &roots, &first);
+    ASSERT_EQ(n+1, first.size());
+    for(size_t i=0; i<n; ++i) {
+      SCOPED_TRACE(i);
+      TCoord expect[3];
+      int m = solveCubic(some[i].a, some[i].b, some[i].c, some[i].d, expect, 0.0, 1.0);
+      ASSERT_EQ(m, first[i+1] - first[i]);
+      for(int j=0; j<m; ++j)
+        ASSERT_NEAR(expect[j], roots[first[i]+j], 1e-9);
+    }
+  }
+}
@@ -0,0 +1,286 @@
+#include <toad/stroke.hh>
+#include <toad/geometry.hh>
+#include "handpath.hh"
+#include "gtest.h"
+
+using namespace toad;
+
+namespace {
+
+// the same nib as in TStrokeOutline
+void
+addNib(vector<TPoint> *out, const TFreehandPoint &p)
+{
+  for(int i=0; i<40; ++i) {
+    TCoord d = 2.0 * M_PI * i / 40;
+    TCoord x = sin(d) * 2.0 * p.pressure;
+    TCoord y = cos(d) * 10.0 * p.pressure;
+    out->push_back(TPoint(p.x + cos(p.rotation)*x - sin(p.rotation)*y,
+                          p.y + sin(p.rotation)*x + cos(p.rotation)*y));
+  }
+}
+
+int
+winding(const TPoint *poly, size_t n, const TPoint &p)
+{
+  int w = 0;
+  for(size_t i=0; i<n; ++i) {
+    const TPoint &a = poly[i], &b = poly[(i+1)%n];
+    TCoord side = (b.x-a.x)*(p.y-a.y) - (p.x-a.x)*(b.y-a.y);
+    if (a.y<=p.y) {
+      if (b.y>p.y && side>0)
+        ++w;
+    } else {
+      if (b.y<=p.y && side<0)
+        --w;
+    }
+  }
+  return w;
+}
+
+// winding number of all closed polygons in 'path'
+int
+winding(const TVectorPath &path, const TPoint &p)
+{
+  int w = 0;
+  size_t begin = 0, end = 0;
+  for(auto t: path.type) {
+    if (t==TVectorPath::CLOSE) {
+      w += winding(path.points.data()+begin, end-begin, p);
+      begin = end;
+    } else {
+      ++end;
+    }
+  }
+  return w;
+}
+
+// non-zero winding rule
+bool
+isInside(const TVectorPath &path, const TPoint &p)
+{
+  return winding(path, p)!=0;
+}
+
+TCoord
+distanceToOutline(const TVectorPath &path, const TPoint &p)
+{
+  TCoord d = 1.0/0.0;
+  size_t begin = 0, end = 0;
+  for(auto t: path.type) {
+    if (t!=TVectorPath::CLOSE) {
+      ++end;
+      continue;
+    }
+    for(size_t i=begin; i<end; ++i) {
+      const TPoint &a = path.points[i], &b = path.points[i+1<end ? i+1 : begin];
+      TPoint ab = b - a;
+      TCoord l = dot(ab, ab);
+      TCoord u = l>0.0 ? std::max(0.0, std::min(1.0, dot(p - a, ab) / l)) : 0.0;
+      d = std::min(d, distance(p, a + ab * u));
+    }
+    begin = end;
+  }
+  return d;
+}
+
+} // namespace
+
+TEST(StrokeOutline, Empty) {
+  TStrokeOutline stroke;
+  TVectorPath path;
+  stroke.outline(&path);
+  ASSERT_TRUE(stroke.empty());
+  ASSERT_TRUE(path.empty());
+}
+
+TEST(StrokeOutline, OneSample) {
+  TStrokeOutline stroke;
+  stroke.add(TFreehandPoint(10, 20, 0, 1));
+
+  TVectorPath path;
+  stroke.outline(&path);
+
+  vector<TPoint> nib;
+  addNib(&nib, TFreehandPoint(10, 20, 0, 1));
+  ASSERT_EQ(41, path.type.size());
+  ASSERT_EQ(TVectorPath::CLOSE, path.type.back());
+  ASSERT_EQ(nib, path.points);
+}
+
+TEST(StrokeOutline, Line) {
+  TStrokeOutline stroke;
+  stroke.add(TFreehandPoint(10, 20, 0, 1));
+  stroke.add(TFreehandPoint(50, 20, 0, 1));
+  stroke.add(TFreehandPoint(90, 20, 0, 1));
+
+  TVectorPath path;
+  stroke.outline(&path);
+
+  TBoundary b = path.bounds();
+  ASSERT_NEAR( 8.0, b.p0.x, 1e-9);
+  ASSERT_NEAR(10.0, b.p0.y, 1e-9);
+  ASSERT_NEAR(92.0, b.p1.x, 1e-9);
+  ASSERT_NEAR(30.0, b.p1.y, 1e-9);
+  for(TCoord x=10; x<=90; x+=5) {
+    ASSERT_TRUE(isInside(path, TPoint(x, 20)));
+    ASSERT_TRUE(isInside(path, TPoint(x, 11)));
+    ASSERT_TRUE(isInside(path, TPoint(x, 29)));
+    ASSERT_FALSE(isInside(path, TPoint(x, 9)));
+    ASSERT_FALSE(isInside(path, TPoint(x, 31)));
+  }
+}
+
+// a sharp turn must go around the nib where the pen turns
+TEST(StrokeOutline, Turn) {
+  TStrokeOutline stroke;
+  stroke.add(TFreehandPoint(10, 20, M_PI/2, 1));
+  stroke.add(TFreehandPoint(50, 20, M_PI/2, 1));
+  stroke.add(TFreehandPoint(12, 22, M_PI/2, 1));
+
+  TVectorPath path;
+  stroke.outline(&path);
+
+  ASSERT_TRUE(isInside(path, TPoint(59, 20)));
+  ASSERT_TRUE(isInside(path, TPoint(1, 20)));
+  ASSERT_FALSE(isInside(path, TPoint(61, 20)));
+}
+
+// pressing the pen harder in the same place makes the nib grow
+TEST(StrokeOutline, Press) {
+  TStrokeOutline stroke;
+  stroke.add(TFreehandPoint(10, 20, 0, 0.1));
+  stroke.add(TFreehandPoint(30, 20, 0, 0.1));
+  stroke.add(TFreehandPoint(30, 20, 0, 1.0));
+  stroke.add(TFreehandPoint(50, 20, 0, 0.1));
+
+  TVectorPath path;
+  stroke.outline(&path);
+
+  ASSERT_TRUE(isInside(path, TPoint(30, 11)));
+  ASSERT_TRUE(isInside(path, TPoint(30, 29)));
+  ASSERT_TRUE(isInside(path, TPoint(10, 20)));
+  ASSERT_TRUE(isInside(path, TPoint(50, 20)));
+  ASSERT_FALSE(isInside(path, TPoint(30, 31)));
+}
+
+// nibs inside the last one add nothing
+TEST(StrokeOutline, Contained) {
+  TStrokeOutline stroke;
+  stroke.add(TFreehandPoint(10, 20, 0, 1.0));
+  stroke.add(TFreehandPoint(10, 20, 0, 0.5));
+  stroke.add(TFreehandPoint(10.5, 20, 0, 0.5));
+
+  TVectorPath path;
+  stroke.preview(&path);
+  ASSERT_EQ(41, path.type.size());
+  stroke.outline(&path);
+  ASSERT_EQ(41, path.type.size());
+}
+
+// a circle leaves a hole, which both winding rules keep
+TEST(StrokeOutline, Ring) {
+  TStrokeOutline stroke;
+  for(int i=0; i<=40; ++i) {
+    TCoord a = 2.0 * M_PI * i / 36;
+    stroke.add(TFreehandPoint(100 + 50*cos(a), 100 + 50*sin(a), 0, 0.5));
+  }
+
+  TVectorPath path;
+  stroke.outline(&path);
+
+  ASSERT_EQ(0, winding(path, TPoint(100, 100)));
+  ASSERT_EQ(0, winding(path, TPoint(160, 100)));
+  ASSERT_EQ(1, abs(winding(path, TPoint(150, 100))));
+  ASSERT_EQ(1, abs(winding(path, TPoint(100, 50))));
+}
+
+// replay the recorded tablet data
+TEST(StrokeOutline, Replay) {
+  for(auto filename: handpathFiles) {
+    SCOPED_TRACE(filename);
+    vector<TFreehandPoint> handpath = loadHandpath(filename);
+    ASSERT_FALSE(handpath.empty());
+
+    TStrokeOutline stroke;
+    for(auto &&p: handpath)
+      stroke.add(p);
+    ASSERT_EQ(handpath.size(), stroke.size());
+
+    TVectorPath path, preview;
+    stroke.outline(&path);
+    stroke.preview(&preview);
+
+    TBoundary all;
+    for(auto &&p: handpath) {
+      vector<TPoint> nib;
+      addNib(&nib, p);
+      for(auto &&q: nib)
+        all.expand(q);
+    }
+    TBoundary b = path.bounds();
+    ASSERT_NEAR(all.p0.x, b.p0.x, 1e-9);
+    ASSERT_NEAR(all.p0.y, b.p0.y, 1e-9);
+    ASSERT_NEAR(all.p1.x, b.p1.x, 1e-9);
+    ASSERT_NEAR(all.p1.y, b.p1.y, 1e-9);
+    TBoundary pb = preview.bounds();
+    ASSERT_EQ(b.p0, pb.p0);
+    ASSERT_EQ(b.p1, pb.p1);
+
+    for(auto &&p: handpath) {
+      ASSERT_TRUE(isInside(path, p)) << p;
+      ASSERT_TRUE(isInside(preview, p)) << p;
+    }
+  }
+}
+
+// compare the outline with the union of the convex hulls of every two
+// successive nibs
+TEST(StrokeOutline, ReplayUnion) {
+  for(auto filename: {
+    "backup-glitch007.txt",
+    "backup-overlap-glitch001.txt" })
+  {
+    SCOPED_TRACE(filename);
+    vector<TFreehandPoint> handpath = loadHandpath(filename);
+
+    TStrokeOutline stroke;
+    for(auto &&p: handpath)
+      stroke.add(p);
+    TVectorPath path;
+    stroke.outline(&path);
+
+    vector<vector<TPoint>> hulls;
+    vector<TBoundary> bounds;
+    for(size_t i=0; i<handpath.size(); ++i) {
+      vector<TPoint> hull;
+      if (i>0)
+        addNib(&hull, handpath[i-1]);
+      addNib(&hull, handpath[i]);
+      convexHull(&hull);
+      TBoundary b;
+      for(auto &&p: hull)
+        b.expand(p);
+      hulls.push_back(hull);
+      bounds.push_back(b);
+    }
+
+    TBoundary all = path.bounds();
+    for(TCoord y=floor(all.p0.y); y<=all.p1.y; y+=1.0) {
+      for(TCoord x=floor(all.p0.x); x<=all.p1.x; x+=1.0) {
+        TPoint p(x, y);
+        bool expect = false;
+        for(size_t i=0; i<hulls.size() && !expect; ++i) {
+          if (bounds[i].p0.x<=x && x<=bounds[i].p1.x &&
+              bounds[i].p0.y<=y && y<=bounds[i].p1.y)
+            expect = winding(hulls[i].data(), hulls[i].size(), p)!=0;
+        }
+        // the outline doesn't overlap itself
+        int w = winding(path, p);
+        ASSERT_LE(abs(w), 1) << "at " << p;
+        if (expect != (w!=0))
+          ASSERT_LT(distanceToOutline(path, p), 0.25) << "at " << p;
+      }
+    }
+  }
+}
@@ -1011,10 +1011,9 @@ class TFPath:
   public:
     TVectorPath path;
     
-    TVectorGraphic* getPath() const override {
-      auto *vg = new TVectorGraphic;
-      vg->push_back(new TVectorPainter(this, new TVectorPath(path)));
-      return vg;
+    bool buildPath(TVectorGraphic *graphic) const override {
+      graphic->push_back(TVectorPainter(this, path));
+      return true;
     }
     void paint(TPenBase &pen, EPaintType type=NORMAL) override {
       pen.setColor(0,0,0);
@@ -1029,6 +1028,7 @@ class TFPath:
     }
     bool transform(const TMatrix2D &transform) override {
       path.transform(transform);
+      invalidatePath();
       return true;
     }
     bool getHandle(unsigned handle, TPoint *p) override {
@@ -1039,6 +1039,7 @@ class TFPath:
     }
     void translateHandle(unsigned handle, TCoord x, TCoord y, unsigned modifier) override {
       path.points[handle] = TPoint(x, y);
+      invalidatePath();
     }
 
     SERIALIZABLE_INTERFACE(toad::, TFPath);
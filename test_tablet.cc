@@ -23,6 +23,7 @@
 #include <toad/connect.hh>
 #include <toad/vector.hh>
 #include <toad/geometry.hh>
+#include <toad/stroke.hh>
 #include <fstream>
 
 #include <toad/dialog.hh>
@@ -121,13 +122,6 @@ movingAverage(const vector<TPoint> &in, double epsilon, vector<TPoint> &out)
   }
 }
 
-struct TFreehandPoint:
-  public TPoint
-{
-  TFreehandPoint(TCoord x, TCoord y, TCoord r, TCoord p):TPoint(x,y), rotation(r), pressure(p){}
-  TCoord rotation, pressure;
-};
-
 class TMyWindow:
   public TWindow
 {
@@ -135,6 +129,9 @@ public:
     // information from the tablet
     vector<TFreehandPoint> handpath;
     
+    // outline of the stroke while it is drawn
+    TStrokeOutline stroke;
+    
     // cummulated path (only line segments)
     TVectorPath path;
     
@@ -189,14 +186,15 @@ TMyWindow::paint()
 {
   TPen pen(this);
 
-  // draw union in gray
-  pen.setStrokeColor(0,0,0);
+  if (!stroke.empty())
+    stroke.preview(&path);
+
+  // draw outline in gray, while drawing it overlaps itself and needs the
+  // non-zero winding rule of fillStroke() instead of fill()
+  pen.setStrokeColor(0.7,0.7,0.7);
   pen.setFillColor(0.7,0.7,0.7);
   path.apply(pen);
-  pen.fill();
-  path.apply(pen);
-  pen.stroke();
-//  pen.fillStroke();
+  pen.fillStroke();
 #if 0  
   // plot raw data in orange
   pen.setColor(1,0.5,0);
@@ -271,7 +269,7 @@ TMyWindow::paint()
 }
 
 static void
-addHull(vector<TPoint> *hull, vector<TFreehandPoint> handpath, size_t idx)
+addHull(vector<TPoint> *hull, const vector<TFreehandPoint> &handpath, size_t idx)
 {
   for(TCoord d=0.0; d<2*M_PI; d+=2*M_PI/40) {
     TPoint p(sin(d)*2.0*handpath[idx].pressure, cos(d)*10.0*handpath[idx].pressure);
@@ -295,12 +293,15 @@ static const TCoord fidility = 4.0; // smallest fidility setting in Illustrator
     lastpos = me.pos;
     backup.open("backup.txt", ofstream::out | ofstream::trunc);
     handpath.clear();
+    stroke.clear();
     path.clear();
   } else
   if (me.type==TMouseEvent::LUP) {
 //cout << "up" << endl;
     [NSEvent setMouseCoalescingEnabled: TRUE];
     backup.close();
+    stroke.outline(&path);
+    stroke.clear();
     path.simplify(4.0, 2.0*M_PI/360.0*30.0);
 cout << "path is now simplified" << endl;
     // quantify raw data
@@ -377,37 +378,9 @@ cout << uniqueID << " left proximity" << endl;
   }
 
   if (me.modifier() & MK_LBUTTON) {
-
-    vector<TPoint> hull;
-    if (handpath.empty()) {
-      backup << me.pos.x << " " << me.pos.y << " " << rotation/360.0 * 2.0 * M_PI << " " << pressure << endl;
-      handpath.push_back(TFreehandPoint(me.pos.x, me.pos.y, rotation/360.0 * 2.0 * M_PI, pressure));
-      addHull(&hull, handpath, 0);
-    } else {
-      backup << me.pos.x << " " << me.pos.y << " " << rotation/360.0 * 2.0 * M_PI << " " << pressure << endl;
-      handpath.push_back(TFreehandPoint(me.pos.x, me.pos.y, rotation/360.0 * 2.0 * M_PI, pressure));
-      addHull(&hull, handpath, handpath.size()-2);
-      addHull(&hull, handpath, handpath.size()-1);
-      convexHull(&hull);
-    }
-    
-    // this could be more efficient
-    TVectorPath np;
-    for(auto p: hull) {
-      if (np.empty())
-        np.move(p);
-      else
-        np.line(p);
-    }
-    np.close();
-//cout << "boolean: to " << path.points.size() << " add " << np.points.size() << endl;
-    boolean(path, np, &path, UNION);
-    if (booleanop_gap_error) {
-      backup.close();
-      cerr << "found gap error" << endl;
-      exit(EXIT_FAILURE);
-    }
-//cout << "added" << endl;
+    backup << me.pos.x << " " << me.pos.y << " " << rotation/360.0 * 2.0 * M_PI << " " << pressure << endl;
+    handpath.push_back(TFreehandPoint(me.pos.x, me.pos.y, rotation/360.0 * 2.0 * M_PI, pressure));
+    stroke.add(handpath.back());
 
     // reduce window updates to 60fps, otherwise the program slows down too
     // much well: cocoa is already coalescing screen updates and even syncs
@@ -851,11 +824,10 @@ global_debug = true;
   TMyWindow wnd(NULL, "test tablet");
 
 #if 0  
-  TEditModel m;
-  m.handpath = loadHandpath("fitcurve-segfault.txt");
-  m.pos = m.handpath.size()-1;
-  replay(&m);
-  wnd.path = m.path;
+  for(auto &&p: loadHandpath("backup-glitch010.txt"))
+    wnd.stroke.add(p);
+  wnd.stroke.outline(&wnd.path);
+  wnd.stroke.clear();
   wnd.path.simplify(4.0, 2.0*M_PI/360.0*30.0);
 #endif  
   
@@ -50,19 +50,15 @@ TMyWindow::paint()
   r0.setFillColor(TRGB(1,0.5,0));
   r0.setStrokeColor(TRGB(0,0,0));
 
-  TVectorGraphic *vb = r0.getPath();
+  TVectorGraphic vb(*r0.getPath());
 
   TFRectangle r1(100,80,200,50);
   r1.setFillColor(TRGB(0,0.5,1));
   r1.setStrokeColor(TRGB(0,0,0));
 
-  TVectorGraphic *vb2 = r1.getPath();
-  vb->push_back(vb2->front());
-  delete vb2;
+  vb.push_back(r1.getPath()->front());
 
-  vb->paint(pen);
-  
-  delete vb;
+  vb.paint(pen);
 }
 
 } // unnamed namespace
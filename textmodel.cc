@@ -21,6 +21,8 @@
 #include <toad/textmodel.hh>
 #include <toad/undomanager.hh>
 
+#include <iterator>
+
 using namespace toad;
 
 TTextModel::TTextModel()
@@ -276,6 +278,30 @@ TTextModel::TUndoRemove::getRedoName(string *name) const
   return true;
 }
 
+size_t
+TTextModel::TUndoRemove::getMemorySize() const
+{
+  return sizeof(*this) + text.capacity();
+}
+
+bool
+TTextModel::TUndoRemove::spill(ostream &out)
+{
+  // not worth a disk access for a few keystrokes
+  if (text.size() < 4096)
+    return false;
+  out.write(text.data(), text.size());
+  string().swap(text);
+  return true;
+}
+
+bool
+TTextModel::TUndoRemove::unspill(istream &in)
+{
+  text.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  return true;
+}
+
 void
 store(atv::TOutObjectStream &out, const TTextModel &value)
 {
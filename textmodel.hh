@@ -214,6 +214,9 @@ class TTextModel:
         }
         bool getRedoName(string *name) const;
         bool getUndoName(string *name) const;
+        size_t getMemorySize() const override;
+        bool spill(ostream &out) override;
+        bool unspill(istream &in) override;
         void undo() {
           model->insert(offset, text);
         }
@@ -22,10 +22,10 @@ toad::distance(const TPoint &q, const TPoint &p0, const TPoint &p1)
 void
 toad::store(TOutObjectStream &out, const vector<TPoint> &p)
 {
-  out << "{ ";
-  for(auto &&pt: p)
-    out << pt.x << " " << pt.y << " ";
-  out << "}";
+  static_assert(sizeof(TPoint) == 2 * sizeof(TCoord), "TPoint must be an array of coordinates");
+  out << "{";
+  storeNumbers(out, reinterpret_cast<const TCoord*>(p.data()), 2 * p.size());
+  out << " }";
 }
 
 bool
@@ -37,25 +37,18 @@ toad::restore(TInObjectStream &in, vector<TPoint> *p)
     in.setInterpreter(nullptr);
     p->clear();
     while(true) {
-      TCoord x, y;
-
+      TPoint pt;
       in.parse();
       if (in.what==ATV_FINISHED)
         break;
-      if (in.what!=ATV_VALUE || !in.attribute.empty() || !in.type.empty()) {
+      if (in.what!=ATV_VALUE || !in.attribute.empty() || !in.type.empty() ||
+          !parseNumber(in.value, &pt.x) ||
+          !restoreNumbers(in, &pt.y, 1))
+      {
         ATV_FAILED(in)
         return false;
       }
-      ::restore(in, &x);
-
-      in.parse();
-      if (in.what!=ATV_VALUE || !in.attribute.empty() || !in.type.empty()) {
-        ATV_FAILED(in)
-        return false;
-      }
-      ::restore(in, &y);
-
-      p->push_back(TPoint(x, y));
+      p->push_back(pt);
     }
     return true;
   }
@@ -263,6 +263,7 @@ struct TBoundary
     expand(b.p0);
     expand(b.p1);
   }
+  void expand(const TPoint *p, size_t n);
 
   bool isInside(TCoord x, TCoord y) const {
     return empty ? false : 
@@ -356,7 +357,7 @@ class TPolygon:
     TPolygon() {}
     TPolygon(const TRectangle &r);
     void transform(const TMatrix2D&);
-    TCoord distance(const TPoint&);
+    TCoord distance(const TPoint&) const;
     void addPoint(const TPoint &p) { push_back(p); }
     void addPoint(TCoord x, TCoord y) { push_back(TPoint(x,y)); }
     bool isInside(TCoord x, TCoord y) const;
@@ -48,3 +48,39 @@ TUndo::getRedoName(string *name) const
   return false;
 }
 
+
+/**
+ * Returns an estimate of the memory in bytes held by this object.
+ *
+ * TUndoManager uses this to keep the undo history of a model within the
+ * budget set with TUndoManager::setMemoryBudget.
+ */
+size_t
+TUndo::getMemorySize() const
+{
+  return sizeof(TUndo);
+}
+
+/**
+ * Write the data needed to undo to 'out' and release it.
+ *
+ * Afterwards getMemorySize() should return a smaller value. The data
+ * will be given back with unspill() before undo() is called.
+ *
+ * \return
+ *   false when the object can not be spilled, which is the default.
+ */
+bool
+TUndo::spill(std::ostream &out)
+{
+  return false;
+}
+
+/**
+ * Read back the data written by spill().
+ */
+bool
+TUndo::unspill(std::istream &in)
+{
+  return false;
+}
@@ -22,6 +22,8 @@
 #define _TOAD_UNDO_HH
 
 #include <string>
+#include <iosfwd>
+#include <cstddef>
 
 namespace toad {
 
@@ -35,6 +37,11 @@ class TUndo
     virtual void undo() = 0;
     virtual bool getUndoName(std::string *name) const;
     virtual bool getRedoName(std::string *name) const;
+
+    virtual size_t getMemorySize() const;
+    virtual bool spill(std::ostream &out);
+    virtual bool unspill(std::istream &in);
+
     static unsigned counter;
     unsigned serial;
 }; 
@@ -23,6 +23,10 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
 
 #define DBM(CMD)
 
@@ -54,8 +58,6 @@ using namespace toad;
  *   \li static methods which allow a window to call undo/redo
  *   \li static methods which allow a model to call undo/redo
  *   \li handle overflow of TUndo::serial counter
- *   \li limit number of stored undo event to a given maximum
- *       (to avoid huge memory consumption)
  */
 
 // How this stuff is organized:
@@ -73,6 +75,10 @@ using namespace toad;
 // undogroups
 // redogroups
 //
+// When a memory budget is set for a model, the data of the oldest undo
+// objects is written into a temporary spill file shared by all models
+// and read back right before the undo object is executed.
+//
 
 
 namespace {
@@ -92,6 +98,24 @@ class toad::TModelUndoStore
     typedef vector<TUndo*> TUndoStack;
     TUndoStack undostack, redostack;  
 
+    TModelUndoStore(): budget(0), memory(0), spilled(0) {}
+
+    // memory accounting
+    size_t budget;  // 0: unlimited
+    size_t memory;  // bytes held by undo objects in memory while budget!=0
+    size_t spilled; // bytes written to the spill file
+    struct TSpill {
+      off_t offset;
+      size_t size;
+    };
+    map<const TUndo*, TSpill> spills;
+
+    void push(TUndoStack &stack, TUndo *undo);
+    TUndo* pop(TUndoStack &stack);
+    void drop(TUndo *undo);
+    void limitMemory();
+    size_t getMemoryUsage() const;
+
     void addUndo(TModel *model, TUndo *undo);
     void clearRedo();
     void removeModel(TModel *model);
@@ -611,9 +635,9 @@ TUndoManager::doIt(bool back)
     if (!foundgroup) {
       // remove undo object from model
       if (back) {
-        pms->second.undostack.pop_back();
+        pms->second.pop(pms->second.undostack);
       } else {
-        pms->second.redostack.pop_back();
+        pms->second.pop(pms->second.redostack);
       }
       // execute undo
       undo->undo();
@@ -709,9 +733,9 @@ TUndoGroup::undo(bool back)
     }
     DBM(cerr << "  undo object inside group" << endl;)
     if (back)
-      pms->second.undostack.pop_back();
+      pms->second.pop(pms->second.undostack);
     else
-      pms->second.redostack.pop_back();
+      pms->second.pop(pms->second.redostack);
     undo->undo();
     delete undo;
   }
@@ -950,7 +974,8 @@ TModelUndoStore::addUndo(TModel *model, TUndo *undo)
   assert(undomanagers.begin()!=undomanagers.end());
   if (!TUndoManager::isUndoing()) {
     DBM(cerr << "add undo to models undostack" << endl;)
-    undostack.push_back(undo);
+    push(undostack, undo);
+    limitMemory();
     for(TUndoManagerSet::iterator p=undomanagers.begin();
         p!=undomanagers.end();
         ++p)
@@ -966,7 +991,7 @@ TModelUndoStore::addUndo(TModel *model, TUndo *undo)
     }
   } else {
     DBM(cerr << "add undo to models redostack" << endl;)
-    redostack.push_back(undo);
+    push(redostack, undo);
     for(TUndoManagerSet::iterator p=undomanagers.begin();
         p!=undomanagers.end();
         ++p)
@@ -980,7 +1005,7 @@ TModelUndoStore::addUndo(TModel *model, TUndo *undo)
 void
 TModelUndoStore::clearRedo() {
   while(!redostack.empty()) { 
-    delete redostack.back();
+    drop(redostack.back());
     redostack.pop_back();     
   }
 }  
@@ -1000,14 +1025,16 @@ TModelUndoStore::removeModel(TModel *model)
       p!=undostack.end();
       ++p)
   {
-    delete *p;
+    drop(*p);
   }
+  undostack.clear();
   for(TUndoStack::iterator p=redostack.begin();
       p!=redostack.end();
       ++p)
   {
-    delete *p;
+    drop(*p);
   }
+  redostack.clear();
   for(TUndoManagerSet::iterator p=undomanagers.begin();
       p!=undomanagers.end();
       ++p)
@@ -1025,3 +1052,279 @@ TModelUndoStore::removeModel(TModel *model)
     (*p)->mmodels.erase(q);
   }
 }
+
+/*
+ * memory budget
+ */
+
+namespace {
+
+int spillfd = -1;
+off_t spillend = 0;
+
+/**
+ * Open the spill file, which is already removed from the file system so
+ * it vanishes along with the process.
+ */
+int
+getSpillFile()
+{
+  if (spillfd!=-1)
+    return spillfd;
+  const char *tmpdir = getenv("TMPDIR");
+  string name = string(tmpdir ? tmpdir : "/tmp") + "/toad-undo-XXXXXX";
+  spillfd = mkstemp(&name[0]);
+  if (spillfd==-1) {
+    cerr << "TUndoManager: failed to create spill file " << name << endl;
+    return -1;
+  }
+  unlink(name.c_str());
+  return spillfd;
+}
+
+bool
+readSpill(off_t offset, char *data, size_t size)
+{
+  while(size>0) {
+    ssize_t n = pread(spillfd, data, size, offset);
+    if (n<=0)
+      return false;
+    data += n;
+    offset += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool
+writeSpill(off_t offset, const char *data, size_t size)
+{
+  while(size>0) {
+    ssize_t n = pwrite(spillfd, data, size, offset);
+    if (n<=0)
+      return false;
+    data += n;
+    offset += n;
+    size -= n;
+  }
+  return true;
+}
+
+/**
+ * Move the records still in use to the start of the spill file and
+ * truncate it once more than half of it is left over from undo objects
+ * which were executed or deleted.
+ */
+void
+compactSpillFile()
+{
+  if (spillfd==-1)
+    return;
+  vector<TModelUndoStore::TSpill*> records;
+  size_t used = 0;
+  for(auto &&model: models) {
+    for(auto &&spill: model.second.spills) {
+      records.push_back(&spill.second);
+      used += spill.second.size;
+    }
+  }
+  size_t unused = spillend - used;
+  if (unused==0 || (used && (unused < used || unused < 65536)))
+    return;
+  sort(records.begin(), records.end(),
+       [](const TModelUndoStore::TSpill *a, const TModelUndoStore::TSpill *b) {
+         return a->offset < b->offset;
+       });
+  off_t end = 0;
+  std::string data;
+  for(auto &&record: records) {
+    if (record->offset!=end) {
+      data.resize(record->size);
+      if (!readSpill(record->offset, &data[0], data.size()) ||
+          !writeSpill(end, data.data(), data.size()))
+      {
+        // the records moved so far are fine, keep the rest where it is
+        cerr << "TUndoManager: failed to compact spill file" << endl;
+        return;
+      }
+      record->offset = end;
+    }
+    end += record->size;
+  }
+  spillend = end;
+  if (ftruncate(spillfd, spillend)!=0)
+    cerr << "TUndoManager: failed to truncate spill file" << endl;
+}
+
+} // namespace
+
+/**
+ * The estimated memory of the undo objects in memory.
+ */
+size_t
+TModelUndoStore::getMemoryUsage() const
+{
+  // only kept up to date while there is a budget, for getMemorySize()
+  // might be expensive
+  if (budget)
+    return memory;
+  size_t size = 0;
+  for(auto &&undo: undostack)
+    size += undo->getMemorySize();
+  for(auto &&undo: redostack)
+    size += undo->getMemorySize();
+  return size;
+}
+
+void
+TModelUndoStore::push(TUndoStack &stack, TUndo *undo)
+{
+  stack.push_back(undo);
+  if (budget)
+    memory += undo->getMemorySize();
+}
+
+/**
+ * Remove the last undo object from 'stack' and read back it's spilled
+ * data so it can be executed.
+ */
+TUndo*
+TModelUndoStore::pop(TUndoStack &stack)
+{
+  TUndo *undo = stack.back();
+  stack.pop_back();
+  if (budget)
+    memory -= undo->getMemorySize();
+  auto p = spills.find(undo);
+  if (p!=spills.end()) {
+    std::string data(p->second.size, '\0');
+    bool ok = readSpill(p->second.offset, &data[0], data.size());
+    std::istringstream in(data);
+    if (!ok || !undo->unspill(in))
+      cerr << "TUndoManager: failed to read back spilled undo object" << endl;
+    spilled -= p->second.size;
+    spills.erase(p);
+    compactSpillFile();
+  }
+  return undo;
+}
+
+/**
+ * Delete an undo object which was already removed from the stacks.
+ */
+void
+TModelUndoStore::drop(TUndo *undo)
+{
+  auto p = spills.find(undo);
+  if (p!=spills.end()) {
+    spilled -= p->second.size;
+    spills.erase(p);
+    compactSpillFile();
+  }
+  if (budget)
+    memory -= undo->getMemorySize();
+  delete undo;
+}
+
+/**
+ * Spill the oldest undo objects until the memory used is within budget.
+ */
+void
+TModelUndoStore::limitMemory()
+{
+  if (budget==0 || memory<=budget)
+    return;
+  for(auto &&undo: undostack) {
+    if (memory<=budget)
+      break;
+    if (spills.find(undo)!=spills.end())
+      continue;
+    if (getSpillFile()==-1)
+      return;
+    size_t before = undo->getMemorySize();
+    std::ostringstream out;
+    if (!undo->spill(out))
+      continue;
+    const std::string &data = out.str();
+    if (!writeSpill(spillend, data.data(), data.size())) {
+      cerr << "TUndoManager: failed to write spill file" << endl;
+      std::istringstream in(data);
+      undo->unspill(in);
+      return;
+    }
+    spills[undo] = { spillend, data.size() };
+    spillend += data.size();
+    spilled += data.size();
+    memory = memory - before + undo->getMemorySize();
+  }
+}
+
+/**
+ * Limit the memory used for undo objects of 'model' to about 'bytes'.
+ *
+ * When exceeded, the data of the oldest undo objects, which support
+ * TUndo::spill, is moved into a temporary file. 0 disables the limit.
+ *
+ * \return
+ *   false in case the model isn't registered
+ */
+/*static*/ bool
+TUndoManager::setMemoryBudget(TModel *model, size_t bytes)
+{
+  TModelUndoMap::iterator q = models.find(model);
+  if (q==models.end())
+    return false;
+  q->second.memory = 0;
+  q->second.budget = 0;
+  if (bytes)
+    q->second.memory = q->second.getMemoryUsage();
+  q->second.budget = bytes;
+  q->second.limitMemory();
+  return true;
+}
+
+/*static*/ size_t
+TUndoManager::getMemoryBudget(TModel *model)
+{
+  TModelUndoMap::iterator q = models.find(model);
+  return q==models.end() ? 0 : q->second.budget;
+}
+
+/**
+ * Return the estimated memory in bytes held by the undo and redo objects
+ * of 'model', excluding the data spilled to disk.
+ */
+/*static*/ size_t
+TUndoManager::getMemoryUsage(TModel *model)
+{
+  TModelUndoMap::iterator q = models.find(model);
+  return q==models.end() ? 0 : q->second.getMemoryUsage();
+}
+
+/**
+ * Return the bytes of undo data of 'model' moved into the spill file.
+ */
+/*static*/ size_t
+TUndoManager::getSpilledSize(TModel *model)
+{
+  TModelUndoMap::iterator q = models.find(model);
+  return q==models.end() ? 0 : q->second.spilled;
+}
+
+/**
+ * Print the undo memory of all registered models, ie. for debugging.
+ */
+/*static*/ void
+TUndoManager::printMemoryUsage(ostream &out)
+{
+  for(auto &&p: models) {
+    out << "model " << p.first
+        << ": " << p.second.undostack.size() << " undo, "
+        << p.second.redostack.size() << " redo, "
+        << p.second.getMemoryUsage() << " bytes in memory, "
+        << p.second.spilled << " bytes spilled";
+    if (p.second.budget)
+      out << ", budget " << p.second.budget << " bytes";
+    out << endl;
+  }
+}
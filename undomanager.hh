@@ -61,6 +61,12 @@ class TUndoManager:
     static bool registerUndo(TModel*, TUndo*);
     
     static vector<TUndo*>& getUndoStack(TModel *model);
+
+    static bool setMemoryBudget(TModel *model, size_t bytes);
+    static size_t getMemoryBudget(TModel *model);
+    static size_t getMemoryUsage(TModel *model);
+    static size_t getSpilledSize(TModel *model);
+    static void printMemoryUsage(ostream &out);
     
     static void enableUndoRegistration();
     static void disableUndoRegistration();
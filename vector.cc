@@ -2,6 +2,8 @@
 #include <toad/geometry.hh>
 #include <toad/pen.hh>
 #include <toad/figure.hh>
+#include <algorithm>
+#include <cstring>
 
 using namespace toad;
 
@@ -29,9 +31,7 @@ TVectorPath::addRect(const TRectangle &rectangle)
 void
 TVectorPath::transform(const TMatrix2D &matrix)
 {
-  for(auto &&p: points) {
-    matrix.map(p, &p);
-  }
+  matrix.map(points.data(), points.data(), points.size());
 }
 
 void TVectorPath::clear()
@@ -72,10 +72,7 @@ ostream&
 toad::operator<<(ostream &out, const TVectorPainter& painter)
 {
   out <<"TVectorPainter {"<<endl;
-  if (!painter.path)
-    out << "nullptr" << endl;
-  else
-    out << *painter.path;
+  out << painter.path;
   out<<"}"<<endl;
   return out;
 }
@@ -86,7 +83,7 @@ toad::operator<<(ostream &out, const TVectorGraphic& graphic)
 {
   out <<"TVectorGraphic {"<<endl;
   for(auto &&painter: graphic)
-    out << *painter;
+    out << painter;
   out<<"}"<<endl;
   return out;
 }
@@ -121,25 +118,25 @@ TVectorPath::bounds() const
   TBoundary b;
   if (points.empty())
     return b;
+  // everything between two curves is moves and lines with one point each
+  // and closes without one, which go to the batch expand() at once
   const TPoint *pt = points.data();
-  b.expand(*pt);
-  for(auto p: type) {
-    switch(p) {
-      case MOVE:
-      case LINE:
-        b.expand(*pt);
-        ++pt;
-        break;
-      case CURVE: {
-        assert(pt>points.data());
-        TRectangle r(curveBounds(pt-1));
-        b.expand(r.origin);
-        b.expand(r.origin+r.size);
-        pt+=3;
-      } break;
-      case CLOSE:
-        break;
-    }
+  const EType *verb = type.data(), *end = verb + type.size();
+  while(true) {
+    const EType *curve = static_cast<const EType*>(memchr(verb, CURVE, end-verb));
+    if (!curve)
+      curve = end;
+    size_t n = (curve-verb) - count(verb, curve, CLOSE);
+    b.expand(pt, n);
+    pt += n;
+    if (curve==end)
+      break;
+    assert(pt>points.data());
+    TRectangle r(curveBounds(pt-1));
+    b.expand(r.origin);
+    b.expand(r.origin+r.size);
+    pt += 3;
+    verb = curve + 1;
   }
   return b;
 }
@@ -148,91 +145,17 @@ TBoundary
 TVectorPath::editBounds() const
 {
   TBoundary b;
-  if (points.empty())
-    return b;
-  auto p = points.begin();
-  b.expand(*p);
-  for(++p; p!=points.end(); ++p) {
-    b.expand(*p);
-  }
+  b.expand(points.data(), points.size());
   return b;
 }
 
-void
-TVectorPath::intersectHelper(TIntersectionList &ilist, TVectorPath::EType type0, const TPoint *pt0, const TVectorPath &vp) const
-{
-  const TPoint *start = 0;
-  const TPoint *pt = vp.points.data();
-  for(auto &p: vp.type) {
-    switch(p) {
-      case MOVE:
-        start=pt;
-        ++pt;
-        break;
-      case LINE:
-        if (pt>vp.points.data()) {
-          if (type0==LINE)
-            intersectLineLine(ilist, pt0, pt-1);
-          else
-            intersectCurveLine(ilist, pt0, pt-1);
-        }
-        ++pt;
-        break;
-      case CURVE:
-        if (pt>vp.points.data()) {
-          if (type0==LINE)
-            intersectLineCurve(ilist, pt0, pt-1);
-          else
-            intersectCurveCurve(ilist, pt0, pt-1);
-        }
-        pt+=3;
-        break;
-      case CLOSE:
-        if (start && pt>vp.points.data()) {
-          TPoint cl[2];
-          cl[0]=*(pt-1);
-          cl[1]=*start;
-          if (type0==LINE)
-            intersectLineLine(ilist, pt0, cl);
-          else
-            intersectCurveLine(ilist, pt0, cl);
-        }
-        break;
-    }
-  }
-}
-
+/**
+ * Add all intersections of this path with 'vp' to 'ilist'.
+ */
 void
 TVectorPath::intersect(TIntersectionList &ilist, const TVectorPath &vp) const
 {
-  const TPoint *start = 0;
-  const TPoint *pt = points.data();
-  for(auto &p: type) {
-    switch(p) {
-      case MOVE:
-        start=pt;
-        ++pt;
-        break;
-      case LINE:
-        if (pt>points.data())
-          intersectHelper(ilist, p, pt-1, vp);
-        ++pt;
-        break;
-      case CURVE:
-        if (pt>points.data())
-          intersectHelper(ilist, p, pt-1, vp);
-        pt+=3;
-        break;
-      case CLOSE:
-        if (start && pt>points.data()) {
-          TPoint cl[2];
-          cl[0]=*(pt-1);
-          cl[1]=*start;
-          intersectHelper(ilist, LINE, cl, vp);
-        }
-        break;
-    }
-  }
+  intersectPaths(ilist, *this, vp);
 }
 
 
@@ -375,6 +298,58 @@ TVectorPath::subdivide()
   }
 }
 
+namespace {
+
+// remove the points from lines, which are closer than 'epsilon' to the
+// line between their neighbours. lines of less than 'minimum' points were
+// rather placed than sampled and are kept as they are.
+void
+reduceLines(vector<TPoint> *points, vector<TVectorPath::EType> *type, TCoord epsilon, size_t minimum)
+{
+  vector<TPoint> &p = *points;
+  vector<TVectorPath::EType> &t = *type;
+  vector<bool> keep;
+  size_t pi = 0, po = 0, to = 0;
+  for(size_t ti=0; ti<t.size(); ) {
+    switch(t[ti]) {
+      case TVectorPath::MOVE:
+      case TVectorPath::LINE: {
+        // lines after a curve start at the curve's end, which is already
+        // in the result
+        size_t anchor = t[ti]==TVectorPath::LINE && pi>0 ? 1 : 0;
+        size_t begin = pi - anchor, typeBegin = ti - anchor;
+        do {
+          ++ti;
+          ++pi;
+        } while(ti<t.size() && t[ti]==TVectorPath::LINE);
+        if (pi-begin < minimum)
+          keep.assign(pi-begin, true);
+        else
+          ramerDouglasPeucker(p.data()+begin, pi-begin, epsilon, &keep);
+        for(size_t i=anchor; i<pi-begin; ++i) {
+          if (keep[i]) {
+            p[po++] = p[begin+i];
+            t[to++] = t[typeBegin+i];
+          }
+        }
+      } break;
+      case TVectorPath::CURVE:
+        p[po++] = p[pi++];
+        p[po++] = p[pi++];
+        p[po++] = p[pi++];
+        t[to++] = t[ti++];
+        break;
+      case TVectorPath::CLOSE:
+        t[to++] = t[ti++];
+        break;
+    }
+  }
+  p.resize(po);
+  t.resize(to);
+}
+
+} // unnamed namespace
+
 /**
  * Convert all lines in the path to curves
  *
@@ -390,6 +365,10 @@ TVectorPath::simplify(double tolerance, double radians)
   oldpoints.swap(points);
   oldtype.swap(type);
 
+  // points which are that close to the line between their neighbours make
+  // no difference for fitPath() but for the time it takes
+  reduceLines(&oldpoints, &oldtype, sqrt(tolerance)/4.0, 16);
+
   const TPoint *lineStart = 0;
   const TPoint *pt = oldpoints.data();
   const TPoint *lastPoint = pt + oldpoints.size()-1;
@@ -397,12 +376,20 @@ TVectorPath::simplify(double tolerance, double radians)
   for(auto p: oldtype) {
     if (p!=LINE && lineStart) {
 //      cout << "end of line fitcurve" << endl;
-      size_t n = points.size();
-      points.pop_back();
-      fitPath(lineStart, pt-lineStart-1, tolerance, &points);
-      n = points.size() - n;
-      for(size_t i=1; i<n; i+=3)
-        type.push_back(TVectorPath::CURVE);
+      if (p==CURVE && pt-lineStart==2) {
+        // a single line, as below
+        type.push_back(TVectorPath::LINE);
+        points.push_back(pt[-1]);
+      } else
+      if (pt-lineStart>1) {
+        // a curve starts at the last point of the lines
+        size_t n = points.size();
+        points.pop_back();
+        fitPath(lineStart, pt-lineStart-(p==CURVE ? 0 : 1), tolerance, &points);
+        n = points.size() - n;
+        for(size_t i=1; i<n; i+=3)
+          type.push_back(TVectorPath::CURVE);
+      }
       lineStart = nullptr;
     }
 again:
@@ -443,9 +430,12 @@ again:
         }
         ++pt;
         break;
-      case CURVE: // copy
-//        cerr << "TVectorPath::simplify(double tolerance): CURVE not implemented yet" << endl;
+      case CURVE:
+        // copy, the lines after it are fitted from its end
+        type.push_back(TVectorPath::CURVE);
+        points.insert(points.end(), pt, pt+3);
         pt+=3;
+        lineStart = pt-1;
         break;
       case CLOSE:
 //cout<<"close"<<endl;
@@ -455,6 +445,14 @@ again:
     }
   }
 
+  if (lineStart && lastPoint-lineStart < 2) {
+    // a single line, ie. after reduceLines() removed the points of a
+    // straight one
+    if (lastPoint!=lineStart) {
+      type.push_back(TVectorPath::LINE);
+      points.push_back(*lastPoint);
+    }
+  } else
   if (lineStart) {
 
 //cout << "final: lineStart=" << *lineStart <<", pt="<<*pt<<", lastPoint="<<*lastPoint<<endl;
@@ -517,9 +515,8 @@ again:
   }
 }
 
-TVectorPainter::TVectorPainter(const TAttributedFigure *figure, TVectorPath *path)
+TVectorPainter::TVectorPainter(const TAttributedFigure *figure)
 {
-  this->path = path;
   stroked = figure->outline;
   filled  = figure->filled;
   stroke = figure->line_color;
@@ -528,14 +525,39 @@ TVectorPainter::TVectorPainter(const TAttributedFigure *figure, TVectorPath *pat
   linewidth = figure->line_width;
 }
 
+TVectorPainter::TVectorPainter(const TAttributedFigure *figure, const TVectorPath &path):
+  TVectorPainter(figure)
+{
+  this->path = path;
+}
+
 void
-TVectorPainter::paint(TPenBase &pen)
+TVectorPainter::paint(TPenBase &pen) const
 {
   pen.setLineWidth(linewidth);
   pen.setStrokeColor(stroke);
   pen.setFillColor(fill);
   pen.setAlpha(alpha);
-  path->apply(pen);
+  draw(pen);
+}
+
+/**
+ * Paint the path with the colors, alpha and line width of 'figure'.
+ */
+void
+TVectorPainter::paint(TPenBase &pen, const TAttributedFigure *figure) const
+{
+  pen.setLineWidth(figure->line_width);
+  pen.setStrokeColor(figure->line_color);
+  pen.setFillColor(figure->fill_color);
+  pen.setAlpha(figure->alpha);
+  draw(pen);
+}
+
+void
+TVectorPainter::draw(TPenBase &pen) const
+{
+  path.apply(pen);
   if (stroked) {
     if (filled)
       pen.fillStroke();
@@ -548,15 +570,22 @@ TVectorPainter::paint(TPenBase &pen)
 }
 
 void
-TVectorGraphic::paint(TPenBase &pen)
+TVectorGraphic::paint(TPenBase &pen) const
+{
+  for(auto &&painter: *this)
+    painter.paint(pen);
+}
+
+void
+TVectorGraphic::paint(TPenBase &pen, const TAttributedFigure *figure) const
 {
   for(auto &&painter: *this)
-    painter->paint(pen);
+    painter.paint(pen, figure);
 }
 
 void
 TVectorGraphic::transform(const TMatrix2D &matrix)
 {
   for(auto &&painter: *this)
-    painter->path->transform(matrix);
+    painter.path.transform(matrix);
 }
@@ -51,10 +51,14 @@ class TVectorPath
     TVectorPath(const TVectorPath &&v): points(std::move(v.points)), type(std::move(v.type)) {}
     TVectorPath& operator=(const TVectorPath &&v) { points=std::move(v.points); type=std::move(v.type); return *this; }
   
-    enum EType {
+    // one byte per verb, so that runs of verbs can be scanned with
+    // memchr() and the like
+    enum EType: unsigned char {
       MOVE, LINE, CURVE, CLOSE
     };
+    //! the coordinates of all verbs, in one contiguous array of (x, y) pairs
     vector<TPoint> points;
+    //! the verbs: MOVE and LINE take one point, CURVE three and CLOSE none
     vector<EType> type;
 
     bool empty() const { return type.empty(); }
@@ -81,7 +85,6 @@ class TVectorPath
     
     void apply(TPenBase &pen) const;
     
-    void intersectHelper(TIntersectionList &ilist, TVectorPath::EType type0, const TPoint *pt0, const TVectorPath &vp) const;
     void intersect(TIntersectionList &ilist, const TVectorPath &vp) const;
     void subdivide();
     
@@ -119,24 +122,30 @@ class TAttributedFigure;
 class TVectorPainter:
   protected TPathAttributes
 {
-// FIXME: destructor
   public:
-    TVectorPath *path;
-    TVectorPainter(const TAttributedFigure *figure, TVectorPath *path);
-    void paint(TPenBase &pen);
+    TVectorPath path;
+    TVectorPainter(const TAttributedFigure *figure);
+    TVectorPainter(const TAttributedFigure *figure, const TVectorPath &path);
+    void paint(TPenBase &pen) const;
+    void paint(TPenBase &pen, const TAttributedFigure *figure) const;
+  protected:
+    void draw(TPenBase &pen) const;
 };
 
 ostream& operator<<(ostream &s, const TVectorPainter& p);
 
 /**
  * A collection of TVectorPainter
+ *
+ * The painters and their paths are stored by value, so copying or
+ * clearing a graphic doesn't leave anything behind.
  */
 class TVectorGraphic:
-  public vector<TVectorPainter*>
+  public vector<TVectorPainter>
 {
-// FIXME: destructor!!!
   public:
-    void paint(TPenBase &pen);
+    void paint(TPenBase &pen) const;
+    void paint(TPenBase &pen, const TAttributedFigure *figure) const;
     void transform(const TMatrix2D &matrix);
 };
 